@@ -0,0 +1,115 @@
+/** \file autotune.h
+ * \brief Choosing the fastest kernel parameters of a host and graph once and
+ * remembering them.
+ *
+ * How fast the events of a \ref glauber_context run depends on the batch size
+ * of \ref glauber_new, the prefetch distance of the update_batch of the \ref
+ * polya_rule and the instruction set of \ref categorical_choose, and which
+ * values are the fastest depends on the CPU, its caches and the graph. \ref
+ * autotune measures them with short runs of the rule on a copy of the graph
+ * and saves the fastest \ref autotune_config in a profile, a small text file
+ * with one line per \ref autotune_key (CPU model, rule, graph class, maximal
+ * degree and the number of vertices rounded to a power of two), so later runs
+ * on the same kind of host and graph read it instead of measuring again.
+ *
+ * The profile may be shared by the hosts of a cluster: every host only reads
+ * and replaces the lines of its CPU model, writers take turns through a lock
+ * on the file profile.lock and the file is replaced atomically.
+ * The three parameters do not change the law of the simulation, the
+ * instruction set not even its trajectory (with the pcg clocks the batch size
+ * does, cf. \ref glauber_set_rng).
+ **/
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stddef.h>
+
+#include "glauber.h"
+#include "sampling.h"
+
+/** \brief The length of the keys of \ref autotune_key including the final 0. */
+#define AUTOTUNE_KEY_LENGTH 256
+
+/** \brief The duration of one run of \ref autotune in seconds, which takes
+ * about 50 of them. */
+#define AUTOTUNE_SECONDS 0.01
+
+/** \typedef autotune_config
+ * \brief Typedef of the \ref autotune_config struct.
+ *
+ * \struct autotune_config autotune.h include/autotune.h
+ * \brief The tuned parameters. */
+typedef struct autotune_config {
+        int batch_size; /**< \brief The batch size of \ref glauber_new. */
+        int prefetch_distance; /**< \brief \ref update_params.prefetch_distance. */
+        simd_level simd; /**< \brief The level of \ref categorical_set_level. */
+} autotune_config;
+
+/** \brief The profile used if none is given, the file named by the
+ * environment variable GLAUBER_AUTOTUNE_PROFILE, otherwise glauber_autotune
+ * in $XDG_CACHE_HOME or $HOME/.cache (created if needed).
+ *
+ * \returns A newly allocated file name or NULL if there is no home. */
+char *autotune_default_profile(void);
+
+/** \brief Write the key of g and rule on this host into key.
+ *
+ * \param g The graph.
+ * \param rule The rule that is run on g.
+ * \param graph_class A word describing the graph, e.g. torus, without tabs.
+ * \param key The key of at least \ref AUTOTUNE_KEY_LENGTH chars. */
+void autotune_key(const graph *g, const rule_interface *rule,
+                  const char *graph_class, char *key);
+
+/** \brief Read the config of key from the profile.
+ *
+ * \returns 1 if it was found, 0 otherwise (also if the profile does not
+ * exist). */
+int autotune_lookup(const char *profile, const char *key,
+                    autotune_config *config);
+
+/** \brief Save config as the one of key in the profile, replacing a previous
+ * one of key and keeping the other lines (also the ones other processes save
+ * at the same time, cf. \ref autotune.h).
+ *
+ * \returns 0 on success, -1 if the profile could not be written. */
+int autotune_store(const char *profile, const char *key,
+                   const autotune_config *config);
+
+/** \brief Measure the fastest config of rule with params on g.
+ *
+ * The number of events of a run is first doubled until a run takes seconds
+ * with the defaults (\ref SIMD_DEFAULT and the defaults of the program), then
+ * the instruction sets, the batch sizes and the prefetch distances are tried
+ * in this order, each starting from the best values found before, and
+ * every candidate is timed by the fastest of three runs on a copy of g
+ * after one run to warm it up. The copy is made once and gets the weights of
+ * g back before every candidate. A candidate only replaces the best one if it
+ * is at least 5% faster, so noise keeps the defaults. The level of \ref
+ * categorical_choose is restored afterwards.
+ *
+ * \param g The graph, it is not changed.
+ * \param rule The rule.
+ * \param params The parameters of the rule.
+ * \param seconds The wanted duration of one run.
+ * \param config The fastest config. */
+void autotune_measure(const graph *g, const rule_interface *rule,
+                      const update_params *params, double seconds,
+                      autotune_config *config);
+
+/** \brief Find the config of g and rule in profile or measure it with runs of
+ * \ref AUTOTUNE_SECONDS and save it there.
+ *
+ * \param profile The profile, NULL for \ref autotune_default_profile.
+ * \param g The graph.
+ * \param rule The rule.
+ * \param params The parameters of the rule.
+ * \param graph_class The class of g as for \ref autotune_key.
+ * \param config The config.
+ * \returns 1 if it was read from the profile, 0 if it was measured and saved
+ * and -1 if it was measured but could not be saved. */
+int autotune(const char *profile, const graph *g, const rule_interface *rule,
+             const update_params *params, const char *graph_class,
+             autotune_config *config);
+
+#endif
@@ -0,0 +1,89 @@
+/** \file clusters.h
+ * \brief The clusters formed by the dominant edges of the vertices.
+ *
+ * Late in a run nearly every vertex sends its events to a single edge, its
+ * dominant edge, which is its heaviest edge (ties broken by the lower index
+ * in graph.edges). The clusters are the connected components of the graph of
+ * all dominant edges. Since every vertex picks one edge and the edges are
+ * totally ordered, every cluster is a tree whose only mutual pair (the edge
+ * dominant for both of its vertices) is its heaviest edge. Vertices without
+ * edges are clusters of size 1.
+ *
+ * \ref clusters_analyse finds the clusters with a lock-free union-find over
+ * the vertices, which OpenMP threads (if enabled) share, and summarises
+ * their sizes. On a torus (cf. \ref graph_construct_torus, possibly
+ * relabelled) it also counts per axis the
+ *
+ *  - spanning clusters: the clusters of the torus cut open at the layers 0
+ *    and n-1 (i.e. of the box without the edges across the periodic
+ *    boundary) that touch both of these layers,
+ *  - wrapping clusters: the clusters that reach around the torus, i.e. whose
+ *    lift to the infinite lattice (the tree unrolled along its edges) covers
+ *    at least n layers.
+ *
+ * Everything takes O(n + m) time and a few arrays of n indices.
+ **/
+#ifndef CLUSTERS_H
+#define CLUSTERS_H
+
+#include <stdio.h>
+
+#include "weightedgraph.h"
+
+/** \brief The largest dimension of a torus whose geometry is analysed. */
+#define CLUSTERS_MAX_DIM 16
+
+/** \typedef cluster_analysis
+ * \brief Typedef of the \ref cluster_analysis struct.
+ *
+ * \struct cluster_analysis clusters.h include/clusters.h
+ * \brief The clusters of the dominant edges and their statistics. */
+typedef struct cluster_analysis {
+        graph_index n_vertices; /**< \brief The number of vertices. */
+        graph_index *labels; /**< \brief The cluster of every vertex, given by
+                                  the smallest vertex index in it. */
+        graph_index n_clusters; /**< \brief The number of clusters. */
+        graph_index largest; /**< \brief The size of the largest cluster. */
+        graph_index second; /**< \brief The size of the second largest cluster
+                                 (0 if there is only one). */
+        double mean_size; /**< \brief The mean size of the cluster of a
+                               uniformly chosen vertex, i.e. the sum of the
+                               squared sizes over n_vertices. */
+        graph_index n_sizes; /**< \brief The number of distinct sizes. */
+        graph_index *sizes; /**< \brief The distinct sizes in increasing order. */
+        graph_index *counts; /**< \brief The number of clusters of every size. */
+        int d; /**< \brief The dimension of the torus whose geometry was
+                    analysed, 0 if the graph was not analysed as a torus. */
+        graph_index spanning[CLUSTERS_MAX_DIM]; /**< \brief The number of
+                                                     spanning clusters per axis. */
+        graph_index wrapping[CLUSTERS_MAX_DIM]; /**< \brief The number of
+                                                     wrapping clusters per axis. */
+} cluster_analysis;
+
+/** \brief Find the clusters of the dominant edges of g.
+ *
+ * \param g The graph, it is only read.
+ * \param weights The weights, weights[i] belonging to g->edges[i], or NULL
+ * for the weights of the graph itself (cf. \ref lod_rebuild).
+ * \param n The side length if g is an n^d torus, the axis k of the vertex
+ * with original index i being digit k of i in base n. The geometry is only
+ * analysed if g has n^d vertices, n >= 3, 1 <= d <= \ref CLUSTERS_MAX_DIM and
+ * every dominant edge connects neighbours of the torus (so the edge lists
+ * of tori can be passed with their n and d), otherwise n and d are ignored.
+ * \param d The dimension of the torus.
+ * \returns The newly allocated analysis. */
+cluster_analysis *clusters_analyse(const graph *g, const double *weights,
+                                   int n, int d);
+
+/** \brief Free the analysis. */
+void clusters_free(cluster_analysis *clusters);
+
+/** \brief Write the analysis as text.
+ *
+ * After a comment line with the time t follow the lines `vertices`,
+ * `clusters`, `largest`, `second` and `mean_size` with their value, for tori
+ * the lines `spanning` and `wrapping` with one count per axis, and the line
+ * `sizes K` followed by K lines `size count`. */
+void clusters_write(const cluster_analysis *clusters, FILE *out, double t);
+
+#endif
@@ -0,0 +1,78 @@
+/** \file correlation.h
+ * \brief Spatial correlations of the edge weights of a torus.
+ *
+ * On the n^d torus (cf. \ref graph_construct_torus, possibly relabelled) the
+ * edge from site x to its neighbour x + e_k belongs to site x and direction
+ * k, which splits the weights into d fields w_k on the n^d sites. For every
+ * direction k the analysis computes from the fluctuation f = w_k - mean(w_k)
+ *
+ *  - the structure factor S_k(q) = |sum_x exp(-2 pi i q.x/n) f(x)|^2 / n^d,
+ *  - the correlation function C_k(r) = sum_x f(x) f(x+r) / (n^d var(w_k)),
+ *    which is 1 at r = 0 (and 0 everywhere for constant weights),
+ *  - per axis j the correlation length, the distance along axis j at which
+ *    C_k first drops below 1/e (interpolated linearly, n/2 if it does not
+ *    within n/2).
+ *
+ * S_k is the transform of f and C_k the backward transform of S_k, so
+ * everything takes O(N log N) for N = n^d sites with the transforms of \ref
+ * fft.h, which also run in parallel. Only the profiles along the axes are
+ * kept, i.e. r and q multiples of e_j for 0 <= r, q <= n/2, which is n/2+1
+ * values per direction and axis.
+ **/
+#ifndef CORRELATION_H
+#define CORRELATION_H
+
+#include <stdio.h>
+
+#include "fft.h"
+#include "weightedgraph.h"
+
+/** \typedef correlation_analysis
+ * \brief Typedef of the \ref correlation_analysis struct.
+ *
+ * \struct correlation_analysis correlation.h include/correlation.h
+ * \brief The correlations of the weights of an n^d torus and the transform
+ * computing them, which is reused by every \ref correlation_analyse. */
+typedef struct correlation_analysis {
+        int n; /**< \brief The side length of the torus. */
+        int d; /**< \brief The dimension of the torus. */
+        int n_distances; /**< \brief The number of distances and wave numbers
+                              per profile, n/2+1. */
+        double *mean; /**< \brief The mean weight of every direction. */
+        double *variance; /**< \brief The variance of the weights of every direction. */
+        double *correlation; /**< \brief C_k(r e_j) at correlation[(k*d +
+                                  j)*n_distances + r]. */
+        double *structure; /**< \brief S_k(q e_j) at structure[(k*d + j)*n_distances + q]. */
+        double *length; /**< \brief The correlation length of direction k
+                             along axis j at length[k*d + j]. */
+        fft_plan *plan; /**< \brief The transform of the n^d sites. */
+} correlation_analysis;
+
+/** \brief Prepare the analyses of the n^d torus (n >= 3, d >= 1). */
+correlation_analysis *correlation_new(int n, int d);
+
+/** \brief Free the analysis. */
+void correlation_free(correlation_analysis *corr);
+
+/** \brief Compute the correlations of the weights of g.
+ *
+ * \param corr The analysis of the n^d torus, its results are replaced.
+ * \param g The graph, it is only read. The site of a vertex is its original
+ * index (so the edge lists of tori can be passed as well), missing edges
+ * count as weight 0.
+ * \param weights The weights, weights[i] belonging to g->edges[i], or NULL
+ * for the weights of the graph itself (cf. \ref lod_rebuild).
+ * \returns 0 on success, -1 (leaving the results unchanged) if g has not
+ * n^d vertices or an edge does not connect neighbours of the torus. */
+int correlation_analyse(correlation_analysis *corr, const graph *g,
+                        const double *weights);
+
+/** \brief Write the results of the last \ref correlation_analyse as text.
+ *
+ * After a comment line with the time t follow for every direction k the
+ * lines `mean k value`, `variance k value` and `length k` with the length of
+ * every axis, then for every axis j the lines `correlation k j` and
+ * `structure k j` with their n/2+1 values. */
+void correlation_write(const correlation_analysis *corr, FILE *out, double t);
+
+#endif
@@ -12,7 +12,9 @@
  * \subsection installation Prerequisites and Installation
  *
  * To use this library you will need `make`, `pkg-config`, `glib-2.0`, `graphviz`
- * (such that the C `pkg-config --libs pkg glib-2.0 libgvc`). The commands in
+ * (such that the C `pkg-config --libs pkg glib-2.0 libgvc`). Graphviz is
+ * only needed to draw the frames, it is loaded at run time (see \ref render.h)
+ * and `./configure --without-graphviz` builds without it. The commands in
  * this section further use `ffmpeg` to convert frames to video and save the
  * video/stream it to a video player (here `mpv`). This library has been used
  * and tested on GNU/Linux based systems so no assurance is given that
@@ -49,6 +51,42 @@
  *
  *      ./glauber_dynamics -qi.
  *
+ * To record a time series of observables (maximal weight, weight quantiles,
+ * number of fixated vertices and optionally the weights of some edges) every
+ * `0.5` time units in a quiet run, add the `--series` option
+ *
+ *      ./glauber_dynamics -q --series series.csv --series-interval 0.5
+ *
+ * `--series-format binary` writes packed doubles instead of CSV (cf.
+ * \ref series.h).
+ *
+ * Instead of the torus any graph given as an edge list (one `v1 v2` pair per
+ * line) can be simulated in a quiet run with `--graph edges.txt`.
+ *
+ * For long exploratory runs `--tau-leap tau` approximates the dynamics by
+ * leaps of length at most `tau` in which every vertex draws all its events
+ * against the weights at the start of the leap. The leap lengths adapt such
+ * that no weight changes by more than the fraction `--leap-epsilon` per leap,
+ * and the estimated deviation from the exact dynamics is reported at the end.
+ *
+ * On machines with several NUMA nodes add `--pin` to pin every thread (or
+ * every MPI process) to its own CPU and keep its part of the graph in the
+ * memory of its node.
+ *
+ * For large graphs configure with `./configure --with-mpi` which additionally
+ * builds `glauber_dynamics_mpi` (cf. \ref glauber_mpi.c and \ref
+ * partition.h). It takes the same options and splits the graph over the MPI
+ * processes, which exchange the events at the boundaries of their parts every
+ * `--window` time units
+ *
+ *      mpirun -np 4 ./glauber_dynamics_mpi -q -n 1000 --series series.csv
+ *
+ * The simulation itself is also installed as the library `libglauber` with the
+ * header \ref glauber.h. A \ref glauber_context holds the whole state of one
+ * simulation, so several can run side by side in one process, and the edge
+ * weights are read in place, e.g. from Python with `ctypes` and `numpy`,
+ * without copying.
+ *
  * To save the video file of the configuration evolution using `ffmpeg` for
  * example use that `./glauber_dynamics` streams `png` files to `stdout` and
  * hence you can pipe the output to ffmpeg directly and save it for example in
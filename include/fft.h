@@ -0,0 +1,47 @@
+/** \file fft.h
+ * \brief Discrete Fourier transforms of n^d periodic arrays.
+ *
+ * A plan owns an array of n^d complex numbers, site x_0 + x_1 n + ... +
+ * x_{d-1} n^{d-1} at that index like the vertices of \ref
+ * graph_construct_torus, which is transformed in place along all d axes in
+ * O(n^d log n^d). If configured with FFTW (`./configure --with-fftw`) the
+ * plans are FFTW plans, run on all OpenMP threads if FFTW has thread
+ * support. Otherwise the bundled transforms are used: radix-2 for powers of 2
+ * and Bluestein's algorithm (a convolution with a chirp of power-of-2 length)
+ * for any other n, with the n^{d-1} lines of every axis split between the
+ * OpenMP threads.
+ **/
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex.h>
+
+#include "graph_index.h"
+
+/** \typedef fft_plan
+ * \brief Opaque plan of the transforms of one array size, see \ref fft.h. */
+typedef struct fft_plan fft_plan;
+
+/** \brief Plan the transforms of n^d arrays.
+ *
+ * \param n The side length (at least 1).
+ * \param d The number of axes (at least 1).
+ * \returns The plan with its array (not initialised). */
+fft_plan *fft_plan_new(int n, int d);
+
+/** \brief Free the plan and its array. */
+void fft_plan_free(fft_plan *plan);
+
+/** \brief The n^d complex numbers the plan transforms. */
+double complex *fft_data(fft_plan *plan);
+
+/** \brief Transform the array of the plan in place.
+ *
+ * Computes X(q) = sum_x exp(sign 2 pi i q.x/n) x(x) without normalisation, so
+ * a forward (sign -1) and a backward (sign +1) transform multiply by n^d.
+ *
+ * \param plan The plan.
+ * \param sign -1 for the forward, +1 for the backward transform. */
+void fft_execute(fft_plan *plan, int sign);
+
+#endif
@@ -0,0 +1,101 @@
+/** \file frames.h
+ * \brief Change-driven emission of frames.
+ *
+ * A frame draws every edge with the penwidth penwidth*weight/t (cf. \ref
+ * draw_torus2png), so late in a run, when the weights grow proportionally to
+ * the time, consecutive frames look alike. The \ref frame_tracker follows the
+ * weight changes since the last frame drawn at time t0 and bounds the change
+ * of the drawn penwidths at time t by
+ *
+ *      |w/t - w0/t0| <= |w - w0|/t + w0 |1/t - 1/t0|
+ *
+ * for every edge (w0 its weight at t0). Summed over the edges (L1) and
+ * maximised over them (L∞) the first term is kept up to date in O(1) per
+ * changed weight with \ref frames_observe, the second one needs only the
+ * total and the maximal weight at t0. The changes w - w0 are kept lazily, an
+ * edge starts from 0 on its first change after the frame, so \ref
+ * frames_reset takes O(1) as well.
+ *
+ * The bounds are upper bounds, a frame is only skipped if the change is
+ * certainly below the thresholds of \ref frames_due.
+ **/
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include "weightedgraph.h"
+
+/** \typedef frame_tracker
+ * \brief Typedef of the \ref frame_tracker struct.
+ *
+ * \struct frame_tracker frames.h include/frames.h
+ * \brief The change of the weights of a graph since the last frame. */
+typedef struct frame_tracker {
+        graph *g; /**< \brief The drawn graph (not owned). */
+        double penwidth; /**< \brief The penwidth of the frames. */
+        double frame_time; /**< \brief The time t0 of the last frame. */
+        unsigned int epoch; /**< \brief The number of the current frame. */
+        unsigned int *stamps; /**< \brief The epoch in which drift[i] was last
+                                   changed, edges[i] has not changed since the
+                                   last frame if it is not the current one. */
+        double *drift; /**< \brief The change of the weight of edges[i] since
+                            the last frame. */
+        graph_index capacity; /**< \brief The room of stamps and drift. */
+        double total; /**< \brief The sum of the current weights. */
+        double frame_total; /**< \brief The sum of the weights at the last frame. */
+        double max_weight; /**< \brief An upper bound of the current weights. */
+        double frame_max; /**< \brief An upper bound of the weights at the last frame. */
+        double l1; /**< \brief The sum of |w - w0| over the edges. */
+        double linf; /**< \brief An upper bound of the maximum of |w - w0|. */
+} frame_tracker;
+
+/** \brief Track the changes of the weights of g from a frame at time t.
+ *
+ * \param g The graph, it has to outlive the tracker.
+ * \param penwidth The penwidth of the frames.
+ * \param t The time of the last frame. */
+frame_tracker *frames_new(graph *g, double penwidth, double t);
+
+/** \brief Free the tracker (but not its graph). */
+void frames_free(frame_tracker *frames);
+
+/** \brief Account for the change of the weight of e by delta (e already holds
+ * the new weight).
+ *
+ * Has the signature of a \ref glauber_observer with the tracker as data and
+ * runs in O(1). */
+void frames_observe(void *frames, const graph *g, const edge *e, double delta);
+
+/** \brief Account for an added or removed edge, which appears or disappears
+ * from the frame.
+ *
+ * Has the signature of a \ref graph_hook with the tracker as data (cf. \ref
+ * graph_add_hook) and runs in O(1) (amortised for added edges). */
+void frames_topology(void *frames, graph *g, const graph_change *change);
+
+/** \brief Bound the change of the penwidths since the last frame.
+ *
+ * \param frames The tracker.
+ * \param t The current time.
+ * \param mean Set to the bound of the mean change of the penwidth per edge.
+ * \param max Set to the bound of the largest change of a penwidth. Both are
+ * infinite if the last frame was at time 0. */
+void frames_change(const frame_tracker *frames, double t, double *mean,
+                   double *max);
+
+/** \brief Whether the change of the penwidths at time t may reach a
+ * threshold.
+ *
+ * \param frames The tracker.
+ * \param t The current time.
+ * \param mean_threshold The threshold of the mean change, unused if not
+ * positive.
+ * \param max_threshold The threshold of the largest change, unused if not
+ * positive.
+ * \returns 1 if a used threshold may be reached, otherwise 0. */
+int frames_due(const frame_tracker *frames, double t, double mean_threshold,
+               double max_threshold);
+
+/** \brief Start tracking from a frame drawn at time t in O(1). */
+void frames_reset(frame_tracker *frames, double t);
+
+#endif
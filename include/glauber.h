@@ -0,0 +1,325 @@
+/** \file glauber.h
+ * \brief The simulation as a library (libglauber).
+ *
+ * A \ref glauber_context holds everything one simulation needs: the graph,
+ * the instantiated update rule, its own RNGs and the events drawn ahead. No
+ * state of the simulation is kept outside of the context, so any number of
+ * contexts can be created and run concurrently (one thread per context) in
+ * one process. The only process-global setting is the instruction set of the
+ * edge choice (\ref categorical_set_level, e.g. set by \ref autotune), which
+ * may be changed while contexts run since all levels choose the same edges.
+ *
+ * The simulation is advanced with \ref glauber_step (a number of events) or
+ * \ref glauber_run_until (a simulation time). In between, the state is read
+ * in place: \ref glauber_edges returns the contiguous array of edges and
+ * \ref glauber_weights the weights inside it as a strided array. From Python
+ * with ctypes and numpy, for example,
+ *
+ *      ctx = lib.glauber_new_torus(100, 2, 0.5, 42)
+ *      lib.glauber_run_until(ctx, 100.0)
+ *      m = lib.glauber_edge_count(ctx)
+ *      edges = numpy.ctypeslib.as_array(lib.glauber_edges(ctx), (m,))
+ *
+ * gives a structured array with the fields v1, v2 and weight (declare the
+ * restype of glauber_edges as a pointer to a ctypes.Structure matching \ref
+ * edge) that follows the simulation without being copied, as long as the
+ * topology does not change (see \ref glauber_topology_generation).
+ **/
+#ifndef GLAUBER_H
+#define GLAUBER_H
+
+#include <stdint.h>
+
+#include "update_rules.h" // contains weightedgraph.h
+#include "trace.h"
+
+/** \brief Number of events drawn ahead if 0 is passed as batch size. */
+#define GLAUBER_DEFAULT_BATCH_SIZE 1024
+
+/** \brief The random number generators selectable with \ref glauber_set_rng. */
+typedef enum glauber_rng {
+        GLAUBER_RNG_PCG, /**< \brief The three sequential pcg32 streams of \ref
+                              glauber_new (the default). */
+        GLAUBER_RNG_PHILOX /**< \brief A Philox clock per vertex (cf. \ref philox.h). */
+} glauber_rng;
+
+/** \typedef glauber_context
+ * \brief Opaque simulation context, see \ref glauber.h. */
+typedef struct glauber_context glauber_context;
+
+/** \brief Function called after the weight of e changed by delta.
+ *
+ * \param data The pointer given to \ref glauber_add_observer.
+ * \param g The simulated graph.
+ * \param e The changed edge, it already holds the new weight.
+ * \param delta The change of the weight. */
+typedef void (*glauber_observer)(void *data, const graph *g, const edge *e,
+                                 double delta);
+
+/** \brief Create a simulation of rule on g.
+ *
+ * The clocks of all vertices ring at rate 1, or at the rates given by the rate
+ * entry of the rule, which are kept in a \ref rate_tree and updated after
+ * every event (the events are then drawn one at a time since their randomness
+ * depends on the state). The three RNGs of the context
+ * (event times, vertex choice, update uniforms) are streams 0, 1 and 2 of
+ * pcg32 seeded with seed, so equal seeds give equal simulations (see \ref
+ * glauber_set_rng for streams that do not depend on how the events are
+ * drawn).
+ *
+ * \param g The initial state, the context takes ownership of it.
+ * \param rule The update rule which is instantiated on g.
+ * \param params The parameters of the rule (copied).
+ * \param seed The seed of the RNGs.
+ * \param batch_size The number of events drawn ahead, 0 for \ref
+ * GLAUBER_DEFAULT_BATCH_SIZE.
+ * \returns The new context at time 0. */
+glauber_context *glauber_new(graph *g, const rule_interface *rule,
+                             const update_params *params, uint64_t seed,
+                             int batch_size);
+
+/** \brief Create a simulation of the \ref polya_rule on the n^d torus with
+ * initial weights 1 (cf. \ref graph_construct_torus).
+ *
+ * \returns The context or NULL if the torus does not fit into a \ref
+ * graph_index. */
+glauber_context *glauber_new_torus(int n, int d, double alpha, uint64_t seed);
+
+/** \brief Free the context including its graph. */
+void glauber_free(glauber_context *ctx);
+
+/** \brief Free the context but not its graph, e.g. to run another context
+ * on the same state.
+ *
+ * \returns The graph, owned by the caller again. */
+graph *glauber_release(glauber_context *ctx);
+
+/** \brief Call observer with data after every change of a weight.
+ *
+ * Lets derived state (e.g. the block pyramid of \ref lod.h) follow the
+ * simulation without rescanning the graph. The changes of a batch of events
+ * are reported after the whole batch ran, a tau-leap reports every edge once
+ * with the sum of its increments. Rules without a constant increment (cf.
+ * \ref rule_interface) are then run one event at a time. */
+void glauber_add_observer(glauber_context *ctx, glauber_observer observer,
+                          void *data);
+
+/** \brief Run follower on the events of leader (common random numbers).
+ *
+ * Afterwards every event of leader, i.e. its time, its vertex and the uniform
+ * choosing the edge, is also run on the state of follower, and the rule of
+ * follower gets a copy of the extra randomness of the one of leader. Two
+ * simulations with different parameters (e.g. alpha or the initial weights)
+ * then only differ by the parameters, so the differences of their observables
+ * have a much smaller variance than the ones of independent runs.
+ *
+ * Both graphs need the same number of vertices and the same vertex order,
+ * the events are matched by vertex index. The follower is only advanced by
+ * its leader, running it directly does nothing. Coupled runs are exact, \ref
+ * glauber_leap_until runs them with \ref glauber_run_until. The leader does
+ * not own its followers, they have to be freed after it.
+ *
+ * \returns 0 on success, -1 (without coupling) if a rule has state dependent
+ * rates, a context skips ahead (cf. \ref glauber_set_skip_ahead), the
+ * generators (cf. \ref glauber_set_rng) or the numbers of vertices
+ * differ, follower already has a leader or
+ * followers, or leader is a follower itself. */
+int glauber_couple(glauber_context *leader, glauber_context *follower);
+
+/** \brief Switch the random number generator of ctx.
+ *
+ * With \ref GLAUBER_RNG_PHILOX every vertex has its own clock whose k-th
+ * event (its time and the uniform of the update rule) is block k of the
+ * Philox stream of the original index of the vertex (cf. \ref
+ * graph_original_index and \ref philox_clock) keyed by the seed of the
+ * context, and the seeds of the tau-leaps come from the stream 2^64-1. The
+ * adjacency arrays are sorted by the original indices of the neighbours (\ref
+ * graph_sort_edges), so the same uniform picks the same edge. A trajectory is
+ * then a function of the seed, the rule and the initial state alone: it does
+ * not depend on the batch size, the vertex order or the number of processes
+ * of glauber_dynamics_mpi, and the stream of any vertex can be regenerated
+ * directly. The clocks are merged with a binary heap, which costs O(log n)
+ * per event. Extra randomness of the rule (not used by the \ref polya_rule)
+ * still comes from the sequential pcg32 stream 2.
+ *
+ * The clocks start at the current time and the events drawn ahead are
+ * dropped, which is valid by the memorylessness of the clocks. A follower
+ * (cf. \ref glauber_couple) needs the same generator as its leader.
+ *
+ * \returns 0 on success, -1 (without change) if the rule has state dependent
+ * rates or ctx skips ahead (cf. \ref glauber_set_skip_ahead). */
+int glauber_set_rng(glauber_context *ctx, glauber_rng rng);
+
+/** \brief Skip the events of vertices that almost surely change their
+ * leading edge.
+ *
+ * Late in runs with alpha > 1 most vertices change their heaviest edge in
+ * nearly every event. A vertex whose events change another edge than its
+ * leading one (cf. the leading entry of \ref rule_interface) with
+ * probability at most 1 - threshold becomes fast: its clock is thinned into
+ * the events that are sure to change the leading edge, which are applied in
+ * bulk as a Poisson number of increments when the vertex or an edge it shares
+ * is next looked at, and the remaining ones, which are drawn one at a time
+ * like the events of rules with rates. The bound is taken again whenever
+ * another edge of the vertex changes, and two fast neighbours have to lead to
+ * each other or not lead over their common edge at all, so the simulation
+ * stays exact in distribution (though not equal to the one of the same seed
+ * without skipping).
+ *
+ * Observers see the bulk increments like the ones of a tau-leap. The state
+ * is complete after every \ref glauber_step and \ref glauber_run_until,
+ * which apply the sure events of all fast vertices up to the current time in
+ * O(n), so the gain grows with the time between two calls. \ref
+ * glauber_event_count includes the skipped events, \ref glauber_step
+ * counts the drawn ones. \ref glauber_leap_until runs exact events.
+ *
+ * \param ctx The context.
+ * \param threshold The least probability of the leading edge of a fast
+ * vertex, in (0.5, 1), or 0 to draw every event again.
+ * \returns 0 on success, -1 (without change) if the threshold is out of range
+ * or the rule has no leading and update_other entries, no constant increment,
+ * state dependent rates or changes the topology, or ctx uses \ref
+ * GLAUBER_RNG_PHILOX, is coupled or records or replays a trace. */
+int glauber_set_skip_ahead(glauber_context *ctx, double threshold);
+
+/** \brief Write the events of ctx to trace from now on.
+ *
+ * Every event run afterwards (by \ref glauber_step or \ref
+ * glauber_run_until, \ref glauber_leap_until then runs exact events as well)
+ * is appended with its time, its vertex and the slot of the changed edge, so
+ * that \ref glauber_replay_trace can repeat the run without its randomness.
+ * The trace has to be opened with the graph of ctx in its current state and
+ * the increment of the rule, with \ref TRACE_SORTED_EDGES if the generator
+ * is \ref GLAUBER_RNG_PHILOX. The context does not own the trace, it has to be
+ * closed after the last event.
+ *
+ * \param ctx The context.
+ * \param trace The trace to write to, NULL to stop recording.
+ * \returns 0 on success, -1 (without change) if the rule has no constant
+ * increment or changes the topology, ctx is a follower, replays a trace or
+ * skips ahead. */
+int glauber_record_trace(glauber_context *ctx, trace_writer *trace);
+
+/** \brief Run the events of trace instead of drawing them.
+ *
+ * The events are read ahead in batches and applied by adding the increment of
+ * the trace to the recorded edges, without random numbers or the rule, while
+ * the observers (cf. \ref glauber_add_observer) see them as usual. After the
+ * last event of the trace nothing happens anymore. The graph of ctx has to be
+ * in the state in which the trace was started and ctx at its time, the
+ * adjacency arrays are sorted first if the trace says so. The context does not
+ * own the trace.
+ *
+ * \param ctx The context.
+ * \param trace The trace to read from, NULL to draw the events again.
+ * \returns 0 on success, -1 (without change) if ctx is coupled, records a
+ * trace or skips ahead. */
+int glauber_replay_trace(glauber_context *ctx, trace_reader *trace);
+
+/** \brief Run the next n_events events. */
+void glauber_step(glauber_context *ctx, int64_t n_events);
+
+/** \brief Run all events before time t.
+ *
+ * Afterwards \ref glauber_time is t, the events drawn ahead beyond t stay
+ * pending for the next call. Nothing happens if t is not after the current
+ * time. */
+void glauber_run_until(glauber_context *ctx, double t);
+
+/** \brief Approximately run the \ref polya_rule up to time t with tau-leaps.
+ *
+ * See \ref tau_leap.h, the leap lengths are chosen adaptively such that the
+ * relative change of every weight per leap stays within epsilon, but are at
+ * most tau_max. Events drawn ahead for \ref glauber_step are dropped, which
+ * is valid by the memorylessness of the clocks. Rules with state dependent
+ * rates or changing the topology are run exactly with \ref glauber_run_until
+ * instead.
+ *
+ * \param ctx The context.
+ * \param t The time to leap to.
+ * \param tau_max The maximal leap length.
+ * \param epsilon The bound of the relative weight change per leap. */
+void glauber_leap_until(glauber_context *ctx, double t, double tau_max,
+                        double epsilon);
+
+/** \brief The number of tau-leaps done so far. */
+int64_t glauber_leap_count(const glauber_context *ctx);
+
+/** \brief Estimated deviation of the tau-leaps from the exact dynamics.
+ *
+ * The expected fraction of the leaped events that an exact run using the same
+ * uniforms would have put on another edge (cf. \ref tau_leap_apply), 0 if
+ * there were no leaps. */
+double glauber_leap_deviation(const glauber_context *ctx);
+
+/** \brief Whether the rule of ctx adds or removes edges during its events
+ * (cf. \ref rule_interface). */
+int glauber_changes_topology(const glauber_context *ctx);
+
+/** \brief The current simulation time, i.e. the time of the last event run
+ * or the last t passed to \ref glauber_run_until. */
+double glauber_time(const glauber_context *ctx);
+
+/** \brief The number of events run so far. */
+int64_t glauber_event_count(const glauber_context *ctx);
+
+/** \brief Start a consistent read of the state from another thread.
+ *
+ * The context is a sequence lock: every change of the state (a batch of
+ * events, a tau-leap or an advance of the time) makes the sequence odd
+ * before and even again after it. A reader copies what it needs (weights,
+ * \ref glauber_time, \ref glauber_event_count) between this call and \ref
+ * glauber_read_retry and repeats the copy while the latter returns non-zero.
+ * The simulation never waits for readers, so the copy should be short
+ * compared to a batch of events.
+ *
+ *      uint64_t sequence;
+ *      do {
+ *              sequence = glauber_read_begin(ctx);
+ *              w = glauber_edges(ctx)[i].weight;
+ *      } while (glauber_read_retry(ctx, sequence));
+ *
+ * \returns The sequence to pass to \ref glauber_read_retry. */
+uint64_t glauber_read_begin(const glauber_context *ctx);
+
+/** \brief Whether the read started with \ref glauber_read_begin returning
+ * sequence overlapped a change of the state and has to be repeated. */
+int glauber_read_retry(const glauber_context *ctx, uint64_t sequence);
+
+/** \brief The simulated graph.
+ *
+ * Can be used for reading and drawing. Its topology may be changed between
+ * events with \ref graph_add_edge and \ref graph_rm_edge (the context follows
+ * through a hook of the graph), but not by moving the edges directly. */
+graph *glauber_graph(glauber_context *ctx);
+
+/** \brief The number of edges of the simulated graph. */
+graph_index glauber_edge_count(const glauber_context *ctx);
+
+/** \brief The number of changes of the topology of the simulated graph so
+ * far (by the rule or with \ref graph_add_edge and \ref graph_rm_edge).
+ *
+ * Adding an edge may move the array of \ref glauber_edges and removing one
+ * moves the last edge into its index, so views of the array are only valid
+ * while this number stays the same. */
+uint64_t glauber_topology_generation(const glauber_context *ctx);
+
+/** \brief Read-only view of the contiguous array of the edges.
+ *
+ * Follows the weights for the life of the context, but the pointer, \ref
+ * glauber_edge_count and the edge at an index are only valid until the next
+ * change of the topology (cf. \ref glauber_topology_generation), which
+ * rules with \ref rule_interface.changes_topology make during events. */
+const edge *glauber_edges(const glauber_context *ctx);
+
+/** \brief Read-only view of the edge weights.
+ *
+ * The weight of edge i is at byte offset i*stride from the returned pointer,
+ * i.e. inside the array of \ref glauber_edges and valid as long as that view.
+ *
+ * \param ctx The context.
+ * \param stride If not NULL set to the distance of two weights in bytes.
+ * \returns Pointer to the weight of edge 0. */
+const double *glauber_weights(const glauber_context *ctx, size_t *stride);
+
+#endif
@@ -1,8 +1,26 @@
 /** \file glauber_dynamics.h
  * \brief Contains main dynamics and main function.*/
+#ifndef GLAUBER_DYNAMICS_H
+#define GLAUBER_DYNAMICS_H
 
 #include "pcg_variants.h"
-#include "update_rules.h" // contains weightedgraph.h
+#include "glauber.h" // contains update_rules.h and weightedgraph.h
+#include "series.h"
+#include "lod.h"
+#include "frames.h"
+#include "render.h"
+#include "inspect.h"
+#include "clusters.h"
+#include "correlation.h"
+#include "autotune.h"
+
+/** \brief Vertex orders selectable with --order (cf. \ref ordering.h). */
+typedef enum vertex_order {
+        ORDER_NONE, /**< \brief Keep the row-major order of the torus. */
+        ORDER_MORTON, /**< \brief \ref torus_morton_order. */
+        ORDER_HILBERT, /**< \brief \ref torus_hilbert_order. */
+        ORDER_RCM /**< \brief \ref graph_rcm_order. */
+} vertex_order;
 
 /** \typedef arguments
  * \brief Typedef of the \ref arguments struct.
@@ -19,6 +37,7 @@
  */
 typedef struct arguments {
 	int silent; /**< \brief Default: 0. */
+    int pin; /**< \brief Pin the threads to CPUs (cf. \ref placement.h). Default: 0. */
     int do_init; /**< \brief Goes to 1 if -i is mentioned (even without fname)
                       Default: 0. */
 	int n; /**< \brief Default: 10. */
@@ -29,21 +48,87 @@ typedef struct arguments {
     int dpi; /**< \brief Default: 200. */
     int penwidth; /**< \brief Default: 10. */
     double alpha; /**< \brief Default: 0.5. */
+    double rate_exponent; /**< \brief Default: 0 (all clocks at rate 1). */
+    double tau_leap; /**< \brief Default: 0 (exact events, no tau-leaping). */
+    double leap_epsilon; /**< \brief Default: 0.03. */
     double frame_density; /**< \brief Default: 1. */
+    double frame_change; /**< \brief Default: 0 (cf. \ref frames_due). */
+    double frame_change_max; /**< \brief Default: 0 (cf. \ref frames_due). */
+    double frame_max_interval; /**< \brief Default: 100 (only used with frame_change or
+                                    frame_change_max). */
+    int batch_size; /**< \brief Default: 1024. */
+    int batch_size_given; /**< \brief Whether --batch-size was given. Default: 0. */
+    int prefetch_distance; /**< \brief Default: 2. */
+    int prefetch_distance_given; /**< \brief Whether --prefetch-distance was given.
+                                      Default: 0. */
+    int autotune; /**< \brief Whether to take batch_size and prefetch_distance
+                       (unless given) and the level of \ref categorical_choose
+                       from \ref autotune. Default: 0. */
+    vertex_order order; /**< \brief Default: ORDER_NONE. */
+    lod_mode lod; /**< \brief Default: LOD_NONE (frames drawn by graphviz). */
+    double window; /**< \brief Default: 1 (only used by glauber_dynamics_mpi). */
+    double series_interval; /**< \brief Default: 1. */
+    int series_edges; /**< \brief Default: 0. */
+    double series_fixation; /**< \brief Default: 0.9. */
+    series_format series_type; /**< \brief Default: SERIES_CSV. */
+    int n_coupled; /**< \brief The number of replicas coupled with --couple
+                        (cf. \ref glauber_couple). Default: 0. */
+    double *coupled_alpha; /**< \brief The alpha of every replica. Default: NULL. */
+    int *coupled_weight; /**< \brief The initial weight of every replica. Default: NULL. */
+    uint64_t seed; /**< \brief The seed of the random numbers if seed_given. */
+    int seed_given; /**< \brief Whether --seed was given, otherwise the seed
+                         comes from the entropy of the system. Default: 0. */
+    glauber_rng rng; /**< \brief Default: GLAUBER_RNG_PCG (cf. \ref glauber_set_rng). */
+    double skip_ahead; /**< \brief The threshold of \ref glauber_set_skip_ahead,
+                            0 for none. Default: 0. */
 
 	/* string options */
 	char *init_fname; /**< optional init_fname option. Default: init */
     char *output; /**< output fname. Default: final */
+    char *series_fname; /**< optional time series fname. Default: NULL */
+    char *graph_fname; /**< optional edge list fname replacing the torus. Default: NULL */
+    char *inspect_fname; /**< optional socket of the \ref inspect_server. Default: NULL */
+    char *clusters_fname; /**< optional output fname of the \ref clusters.h analysis. Default: NULL */
+    char *correlation_fname; /**< optional output fname of the \ref correlation.h analysis. Default: NULL */
+    char *record_fname; /**< optional fname of the \ref trace.h written by the run. Default: NULL */
+    char *replay_fname; /**< optional fname of the \ref trace.h whose events are run. Default: NULL */
+    char *autotune_fname; /**< optional profile of \ref autotune, NULL for the default one. Default: NULL */
 } arguments;
 
-/** \brief Do a glauber evolution on init_state using the provided update rule.
+/** \brief Set the defaults of args and parse the command-line arguments into
+ * it (exits with a usage message on invalid input).
+ *
+ * \param argc The argc of main.
+ * \param argv The argv of main.
+ * \param args The \ref arguments to fill. */
+void arguments_parse(int argc, char **argv, arguments *args);
+
+/** \brief Do a glauber evolution of the state of ctx up to threshold_time.
  * 
- * \param init_state Pointer to the initial state, note that this is changed in
- * place and after running the function the pointer points to the evolved graph.
- * \param graph_update \ref update_rule which should be run on every vertex every exp(1)
+ * \param ctx The \ref glauber_context to run, it continues from its current
  * time.
  * \param threshold_time Maximum time for which the system runs.
- * \param args \ref arguments from parsed command-line arguments.
+ * \param args \ref arguments from parsed command-line arguments, used for
+ * drawing the frames.
+ * \param series Optional \ref series_writer which records the observables of
+ * the state during the evolution. Can be NULL.
+ * \param lod Optional \ref lod_renderer observing ctx which draws the
+ * frames. If NULL they are drawn with \ref render_torus_png.
+ * \param frames Optional \ref frame_tracker observing ctx. If given the state
+ * is checked every frame-density time units and a frame is only drawn if
+ * \ref frames_due with the thresholds of args or frame-max-interval time units
+ * passed since the last one, which then lasts for the time since. Can be NULL.
+ * \param inspect Optional \ref inspect_server answering queries about ctx,
+ * it is polled every \ref INSPECT_POLL_EVENTS events. Can be NULL.
+ * \param correlation Optional \ref correlation_analysis of the torus which is
+ * written to correlation_out at every record of series. Can be NULL.
+ * \param correlation_out The file of the correlations.
+ * \returns The simulation time reached, i.e. threshold_time.
  *
  * \see graph */
-void glauber_dynamics(graph *init_state, update_rule graph_update, int threshold_time, arguments *args);
+double glauber_dynamics(glauber_context *ctx, int threshold_time,
+                        arguments *args, series_writer *series,
+                        lod_renderer *lod, frame_tracker *frames,
+                        inspect_server *inspect, correlation_analysis *correlation, FILE *correlation_out);
+
+#endif
@@ -0,0 +1,76 @@
+/** \file inspect.h
+ * \brief Live inspection of a running simulation over a UNIX domain socket.
+ *
+ * An \ref inspect_server listens on a socket file and answers queries from a
+ * background thread while the simulation keeps running, e.g. with
+ *
+ *      echo observables | nc -U /tmp/glauber.sock
+ *
+ * Every query is one line, every answer ends with a line `ok` or a line
+ * starting with `error`. The queries are
+ *
+ *  - `time`: the simulation time and the number of events,
+ *  - `rate`: the events and the simulation time per wall clock second since
+ *    the previous `rate` query (or the start of the server),
+ *  - `observables`: max_weight, q10 to q90 and fixated (cf. \ref series.h),
+ *  - `vertex V [R]`: the lines `v1 v2 weight` of the edges of the vertices
+ *    within distance R-1 (default 1, i.e. the edges of V) of vertex V,
+ *  - `region ROW COL ROWS COLS`: the same for the edges to the right and
+ *    lower neighbours of the vertices in a rectangle of a 2 dimensional torus,
+ *  - `frame FILE [mean|max|direction]`: write a PNG of a 2 dimensional torus
+ *    with the \ref lod.h blocks,
+ *  - `dump FILE`: write all edges as `v1 v2 weight` lines.
+ *
+ * Vertices are given and reported by their original indices.
+ *
+ * The reads of a few edges are consistent copies taken with the sequence
+ * lock of the context (cf. \ref glauber_read_begin). The queries reading all
+ * edges work on a snapshot of the weights instead, which the simulating
+ * thread copies at its next call of \ref inspect_poll, so the simulation only
+ * pauses for the copy while the answer is computed and written by the server.
+ *
+ * If edges are added or removed during the simulation (cf. \ref
+ * glauber_changes_topology, or as soon as the first such change is seen),
+ * every query except `time` and `rate` takes a snapshot and the simulating
+ * thread waits in \ref inspect_poll until the answer is written, since the
+ * answers also read the edges of the graph.
+ **/
+#ifndef INSPECT_H
+#define INSPECT_H
+
+#include "glauber.h"
+
+/** \brief The number of events after which a simulation with an \ref
+ * inspect_server should call \ref inspect_poll. */
+#define INSPECT_POLL_EVENTS 65536
+
+/** \typedef inspect_server
+ * \brief Opaque handle of a running inspection server. */
+typedef struct inspect_server inspect_server;
+
+/** \brief Listen on the socket file path and start answering queries about
+ * ctx.
+ *
+ * \param path The socket file, it is replaced if it exists.
+ * \param ctx The simulation, it has to outlive the server. A \ref
+ * graph_hook is added to its graph until \ref inspect_stop.
+ * \param n The side length if the graph of ctx is a 2 dimensional torus,
+ * otherwise 0 (which disables `region` and `frame`).
+ * \param pixels The side length of frames in pixels.
+ * \param fixation The fixation fraction of the observables.
+ * \returns The server or NULL if the socket could not be created. */
+inspect_server *inspect_start(const char *path, glauber_context *ctx, int n,
+                              int pixels, double fixation);
+
+/** \brief Copy the weights if the server waits for a snapshot.
+ *
+ * Has to be called by the simulating thread between events, about every
+ * \ref INSPECT_POLL_EVENTS events. It only reads an atomic flag unless a
+ * snapshot is due. If the topology of the graph changes, it returns only
+ * after the server has answered the query that requested the snapshot. */
+void inspect_poll(inspect_server *server);
+
+/** \brief Stop the server, remove the socket file and free the server. */
+void inspect_stop(inspect_server *server);
+
+#endif
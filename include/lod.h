@@ -0,0 +1,134 @@
+/** \file lod.h
+ * \brief Level-of-detail frames of large 2 dimensional tori.
+ *
+ * \ref draw_torus2png hands every edge to graphviz, which is fine for small
+ * tori but takes time and memory proportional to m even when many edges fall
+ * on one pixel. The \ref lod_renderer instead divides the n x n torus into
+ * square blocks of block_size x block_size vertices such that there are at
+ * most as many blocks per side as the frame has pixels, and keeps for every
+ * block the sum and the maximum of the weights of its horizontal and its
+ * vertical edges (the edge from a vertex to its right and its lower
+ * neighbour belongs to the block of the vertex).
+ *
+ * Above these blocks sits a pyramid of coarser levels, each block of level
+ * k+1 aggregating 2 x 2 blocks of level k up to a single block for the whole
+ * torus. The blocks of level 0 are updated incrementally with \ref
+ * lod_observe, which is a \ref glauber_observer, in O(1) per changed weight.
+ * The coarser levels are recombined from level 0 when they are read after a
+ * change, which takes time proportional to the number of pixels like a frame
+ * (\ref lod_draw_png), so nothing after the construction takes time
+ * proportional to the number of edges.
+ *
+ * If edges of the torus are removed or added back during the simulation,
+ * \ref lod_topology keeps the blocks up to date as a \ref graph_hook. Edges
+ * that do not connect neighbours of the torus are not shown.
+ **/
+#ifndef LOD_H
+#define LOD_H
+
+#include <stdio.h>
+
+#include "weightedgraph.h"
+
+/** \brief What a block of the frame shows (selected with --lod). */
+typedef enum lod_mode {
+        LOD_NONE, /**< \brief No level of detail, draw every edge with graphviz. */
+        LOD_MEAN, /**< \brief The mean weight of the edges of the block. */
+        LOD_MAX, /**< \brief The maximal weight of the edges of the block. */
+        LOD_DIRECTION /**< \brief The mean weight, coloured from blue (vertical
+                           edges carry the weight) to red (horizontal edges). */
+} lod_mode;
+
+/** \typedef lod_block
+ * \brief Typedef of the \ref lod_block struct.
+ *
+ * \struct lod_block lod.h include/lod.h
+ * \brief The aggregated weights of one block, index 0 for the horizontal and
+ * 1 for the vertical edges. */
+typedef struct lod_block {
+        double sum[2]; /**< \brief The sum of the weights. */
+        double max[2]; /**< \brief The maximal weight (0 without edges). */
+        graph_index count[2]; /**< \brief The number of edges. */
+} lod_block;
+
+/** \typedef lod_renderer
+ * \brief Typedef of the \ref lod_renderer struct.
+ *
+ * \struct lod_renderer lod.h include/lod.h
+ * \brief The block pyramid of a torus and the buffers of its frames. */
+typedef struct lod_renderer {
+        graph *g; /**< \brief The torus (not owned). */
+        int n; /**< \brief The side length of the torus. */
+        lod_mode mode; /**< \brief What the frames show. */
+        int block_size; /**< \brief The side length of the blocks of level 0 in vertices. */
+        int levels; /**< \brief The number of levels of the pyramid. */
+        int *sides; /**< \brief The number of blocks per side of every level. */
+        lod_block **pyramid; /**< \brief The row-major blocks of every level. */
+        int stale; /**< \brief Whether level 0 changed since the coarser levels
+                        were combined. */
+        int scale; /**< \brief The side length of a block of level 0 in pixels. */
+        unsigned char *raw; /**< \brief The filtered scanlines of a frame. */
+        unsigned char *png; /**< \brief The encoded frame. */
+        size_t png_size; /**< \brief The length of the encoded frame. */
+} lod_renderer;
+
+/** \brief Create the pyramid of the n x n torus g (cf. \ref
+ * graph_construct_torus, possibly relabelled) for square frames of pixels x
+ * pixels.
+ *
+ * \param g The torus, it has to outlive the renderer.
+ * \param n The side length of the torus.
+ * \param pixels The side length of the frames in pixels (at least 1).
+ * \param mode What the frames show.
+ * \param weights The initial weights, NULL for the ones of g (cf. \ref
+ * lod_rebuild).
+ * \returns The renderer holding the given weights. */
+lod_renderer *lod_new(graph *g, int n, int pixels, lod_mode mode,
+                      const double *weights);
+
+/** \brief Free the renderer (but not its graph). */
+void lod_free(lod_renderer *lod);
+
+/** \brief Recompute the whole pyramid in O(m).
+ *
+ * \param lod The renderer.
+ * \param weights The weights, weights[i] belonging to g->edges[i], or NULL
+ * for the weights of the graph itself. Only the topology of the graph is read
+ * otherwise, so a snapshot can be drawn while the graph changes (cf. \ref
+ * inspect.h). */
+void lod_rebuild(lod_renderer *lod, const double *weights);
+
+/** \brief Account for the change of the weight of e by delta (e already holds
+ * the new weight).
+ *
+ * Has the signature of a \ref glauber_observer with the renderer as data, the
+ * graph has to be the one of the renderer. Runs in O(1), unless the maximal
+ * weight of a block decreased which rescans that block. */
+void lod_observe(void *lod, const graph *g, const edge *e, double delta);
+
+/** \brief Account for an added or removed edge.
+ *
+ * Has the signature of a \ref graph_hook with the renderer as data (cf.
+ * \ref graph_add_hook). Runs in O(1), unless the removed edge carried the
+ * maximal weight of its block which rescans that block. */
+void lod_topology(void *lod, graph *g, const graph_change *change);
+
+/** \brief The block in row, col of the given level (0 is the finest).
+ *
+ * Recombines the coarser levels first if level 0 changed since. */
+const lod_block *lod_block_at(lod_renderer *lod, int level, int row, int col);
+
+/** \brief Write a frame of level 0 as PNG.
+ *
+ * Every block becomes a square of scale x scale pixels whose darkness is its
+ * mean or maximal weight relative to the largest one of the frame. The PNG is
+ * stored uncompressed, so no library is needed and the time is proportional
+ * to the number of pixels.
+ *
+ * \param lod The renderer.
+ * \param out The file to write to, stdout if NULL.
+ * \param duration The number of times the frame is written (like \ref
+ * draw_torus2png, to keep the frame rate of a video proportional to time). */
+void lod_draw_png(lod_renderer *lod, FILE *out, unsigned int duration);
+
+#endif
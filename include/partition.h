@@ -0,0 +1,59 @@
+/** \file partition.h
+ * \brief Split the vertices of a graph into contiguous ranges, one per
+ * process of \ref glauber_mpi.c.
+ *
+ * Part p owns the vertices offsets[p], ..., offsets[p+1]-1. Contiguous ranges
+ * keep the ownership test a binary search and, for the row-major numbering of
+ * \ref graph_construct_torus, make slabs of the torus with a small boundary.
+ **/
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "graph_index.h"
+
+/** \typedef partition
+ * \brief Typedef of the \ref partition struct.
+ *
+ * \struct partition partition.h include/partition.h
+ * \brief Contiguous ranges of vertex indices. */
+typedef struct partition {
+        int n_parts; /**< \brief The number of parts. */
+        graph_index *offsets; /**< \brief The n_parts+1 boundaries of the ranges. */
+} partition;
+
+/** \brief Allocate a partition into n_parts parts whose offsets the caller
+ * fills in, e.g. with the ones computed by another process. */
+partition *partition_new(int n_parts);
+
+/** \brief Partition the torus of \ref graph_construct_torus into slabs.
+ *
+ * The torus is cut along the slowest dimension (the digit of n^(d-1)), so
+ * that every part consists of whole layers and only has neighbours in the
+ * two adjacent parts.
+ *
+ * \param n The number of vertices per dimension.
+ * \param d The dimension of the torus.
+ * \param n_parts The number of parts, at most n.
+ * \returns The new partition or NULL if n_parts is out of range. */
+partition *partition_torus(int n, int d, int n_parts);
+
+/** \brief Partition the vertices 0, ..., n_vertices-1 such that the parts have
+ * about the same total cost.
+ *
+ * The cost of vertex v is degrees[v]+1, i.e. the work of its events plus the
+ * drawing of its clock. Every part gets at least one vertex.
+ *
+ * \param degrees The degree of every vertex.
+ * \param n_vertices The number of vertices.
+ * \param n_parts The number of parts, at most n_vertices.
+ * \returns The new partition or NULL if n_parts is out of range. */
+partition *partition_balanced(const graph_index *degrees, graph_index n_vertices,
+                              int n_parts);
+
+/** \brief The part owning vertex v. */
+int partition_owner(const partition *p, graph_index v);
+
+/** \brief Free the partition. */
+void partition_free(partition *p);
+
+#endif
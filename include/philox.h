@@ -0,0 +1,74 @@
+/** \file philox.h
+ * \brief The counter-based RNG Philox4x32-10 and the clocks built on it.
+ *
+ * Philox (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3",
+ * 2011) maps a 128 bit counter and a 64 bit key to 128 random bits with ten
+ * rounds of multiplications and xors. Unlike pcg32 it has no state: any
+ * number of the stream can be computed directly from the counter. With the
+ * seed as key and the counter made of a stream number and the position in
+ * the stream, the k-th event of the clock of a vertex depends only on the
+ * seed, the vertex and k, and not on the order in which the clocks are
+ * advanced, e.g. by how many threads or processes (cf. \ref glauber_set_rng).
+ **/
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <math.h>
+#include <stdint.h>
+
+/** \brief The 128 random bits of counter ctr with key key, the reference
+ * implementation of Philox4x32-10 (checked against its known answers). */
+static inline void philox4x32_10(const uint32_t ctr[4], const uint32_t key[2],
+                                 uint32_t out[4]){
+        uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round=0; round<10; round++){
+                uint64_t p0 = (uint64_t) 0xD2511F53u*c0;
+                uint64_t p1 = (uint64_t) 0xCD9E8D57u*c2;
+                uint32_t hi0 = p0 >> 32, lo0 = (uint32_t) p0;
+                uint32_t hi1 = p1 >> 32, lo1 = (uint32_t) p1;
+                c0 = hi1 ^ c1 ^ k0;
+                c1 = lo1;
+                c2 = hi0 ^ c3 ^ k1;
+                c3 = lo0;
+                /* the Weyl sequence of the key */
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+}
+
+/** \brief The block number position of the given stream under seed. */
+static inline void philox_block(uint64_t seed, uint64_t stream,
+                                uint64_t position, uint32_t out[4]){
+        uint32_t ctr[4] = {(uint32_t) position, (uint32_t) (position >> 32),
+                           (uint32_t) stream, (uint32_t) (stream >> 32)};
+        uint32_t key[2] = {(uint32_t) seed, (uint32_t) (seed >> 32)};
+        philox4x32_10(ctr, key, out);
+}
+
+/** \brief The event number k of the rate 1 Poisson clock of the given stream.
+ *
+ * Both values come from block k of the stream, so the serial and the
+ * distributed simulation compute them with exactly the same arithmetic.
+ *
+ * \param seed The seed of the run.
+ * \param stream The stream of the clock, e.g. the original index of its
+ * vertex.
+ * \param k The number of events of the clock before this one.
+ * \param uniform Set to the uniform on [0, 1) the update rule gets for the
+ * event.
+ * \returns The exponential time since the previous event of the clock. */
+static inline double philox_clock(uint64_t seed, uint64_t stream, uint64_t k,
+                                  double *uniform){
+        uint32_t block[4];
+        philox_block(seed, stream, k, block);
+        *uniform = ldexp(block[2], -32);
+        /* the half keeps the uniform for the time away from 0 */
+        return -log(ldexp(block[0] + 0.5, -32));
+}
+
+#endif
@@ -0,0 +1,64 @@
+/** \file placement.h
+ * \brief NUMA aware memory placement and thread pinning.
+ *
+ * On machines with several NUMA nodes (sockets) memory is fastest from the
+ * node whose CPU accesses it. The threads working on the graph (the OpenMP
+ * loops of \ref tau_leap.h and \ref graph_construct_torus, or the ranks of
+ * glauber_dynamics_mpi) each handle a contiguous range of vertices, so the
+ * policy is:
+ *
+ *  - pin every thread to its own CPU (\ref placement_pin_threads, `--pin`),
+ *    so that it stays on one node,
+ *  - let the threads first touch their own ranges when the graph is built,
+ *    which places the pages on their nodes, and move the large arrays of a
+ *    graph built otherwise with \ref placement_spread_graph,
+ *  - allocate per thread state (RNGs, output buffers) in the thread using
+ *    it, i.e. the event loop allocates its context and series buffers itself.
+ *
+ * The functions use the Linux system calls (getcpu, mbind, sched affinity)
+ * directly, so libnuma is not needed. On other systems, or if the calls are
+ * not permitted, they do nothing and report a single node.
+ **/
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>
+
+#include "weightedgraph.h"
+
+/** \brief The number of NUMA nodes of the machine (1 if unknown). */
+int placement_nodes(void);
+
+/** \brief The NUMA node of the CPU the calling thread runs on (0 if
+ * unknown). */
+int placement_current_node(void);
+
+/** \brief Move the pages of [addr, addr+size) to node and keep them there.
+ *
+ * The range is extended to whole pages.
+ *
+ * \param addr Start of the memory.
+ * \param size Size of the memory in bytes.
+ * \param node The NUMA node.
+ * \returns 0 on success, -1 if the memory could not be placed. */
+int placement_bind(void *addr, size_t size, int node);
+
+/** \brief Pin the calling thread to the index-th CPU (modulo their number) of
+ * those the process may run on.
+ *
+ * \returns 0 on success, -1 if the affinity could not be set. */
+int placement_pin(int index);
+
+/** \brief Pin every OpenMP thread (or only the calling thread without
+ * OpenMP) to its own CPU, thread i to the i-th CPU.
+ *
+ * \returns 0 on success, -1 if some thread could not be pinned. */
+int placement_pin_threads(void);
+
+/** \brief Move the vertex and edge arrays of g to the nodes of the OpenMP
+ * threads processing them in statically scheduled loops over the vertices.
+ *
+ * Does nothing on machines with a single node. */
+void placement_spread_graph(graph *g);
+
+#endif
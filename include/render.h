@@ -0,0 +1,37 @@
+/** \file render.h
+ * \brief Loading the graphviz rendering when the first frame is drawn.
+ *
+ * \ref draw_torus2png is the only user of graphviz, so it is built as the
+ * module glauber_render (cf. draw.h) instead of being linked into the
+ * simulation, and loaded with dlopen by the first call of \ref
+ * render_available or \ref render_torus_png. Runs that draw no graphviz
+ * frames (quiet runs of graph files, frames drawn by \ref lod_draw_png) thus
+ * neither load nor need graphviz.
+ *
+ * The module is the file named by the environment variable
+ * GLAUBER_RENDER_MODULE if it is set (e.g. .libs/glauber_render.so to run
+ * from the build directory), otherwise the installed one (RENDER_MODULE, set
+ * by the build) or glauber_render.so found by dlopen. Builds with
+ * WITHOUT_RENDER defined (glauber_dynamics_core) have no rendering at all.
+ **/
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdio.h>
+
+#include "weightedgraph.h"
+
+/** \brief Whether frames can be drawn, loads the module on the first call.
+ *
+ * \returns 1 if the module is loaded, 0 if it could not be (the reason is
+ * written to stderr once). */
+int render_available(void);
+
+/** \brief \ref draw_torus2png of the module, with the same parameters.
+ *
+ * \returns 0 if the frame was drawn, -1 if the module is not available. */
+int render_torus_png(graph *draw_torus, int n, int d, unsigned int duration,
+                     FILE *out_stream, int max_width, int max_height,
+                     int max_dpi, int penwidth, double passed_time);
+
+#endif
@@ -0,0 +1,92 @@
+/** \file replicas.h
+ * \brief Replicas of the Polya dynamics on one shared topology.
+ *
+ * Replicas of the same model on the same graph differ only in their weights
+ * and random numbers. A \ref replica_set keeps the topology once, as arrays
+ * of the offsets of the edges of every vertex, and the weights of its lanes
+ * (the replicas) interleaved per edge, the weight of edge i (the index in
+ * graph.edges) in lane l at weights[i*lanes + l]. The lanes run in lockstep:
+ * in every round each lane with events left applies the next one, and groups of
+ * 4 (AVX2) or 8 (AVX-512) lanes gather the weights of the edges of their
+ * vertices, gather weight^alpha from a table shared by all lanes (the weights
+ * stay integers), form the cumulative sums in the order of \ref
+ * categorical_choose and increment the chosen weights (with a scatter under
+ * AVX-512). Every instruction set computes the same sums, so the weights do
+ * not depend on the one used.
+ *
+ * Since the clocks ring at rate 1, the events of a lane form a Poisson
+ * process of rate n whose vertices and uniforms do not depend on the times,
+ * so \ref replicas_run_until draws only the number of events of every lane
+ * (cf. \ref poisson_rand_r) and no exponential times. The weights of a lane
+ * thus have the law of the ones of a \ref glauber_context of the \ref
+ * polya_rule at the same time, but they are not its trajectory for any seed.
+ *
+ * Other rules, rates and changes of the topology are not supported, the set
+ * reads the graph only when it is created.
+ **/
+#ifndef REPLICAS_H
+#define REPLICAS_H
+
+#include <stdint.h>
+
+#include "weightedgraph.h"
+#include "sampling.h"
+
+/** \typedef replica_set
+ * \brief Opaque handle of replicas, see \ref replicas.h. */
+typedef struct replica_set replica_set;
+
+/** \brief Create lanes replicas of the Polya dynamics with alpha on g.
+ *
+ * Every lane starts with the weights of g at time 0, the set keeps copies of
+ * the topology and the weights, so g may be changed or freed afterwards.
+ * Weights that are not non-negative integers are supported, but all events
+ * then evaluate pow for every edge instead of using the vector kernels.
+ *
+ * \param g The graph.
+ * \param lanes The positive number of replicas.
+ * \param alpha The parameter of the \ref polya_rule.
+ * \param seed Lane l draws the numbers of its events, its vertices and its
+ * uniforms from the three pcg32 streams \ref glauber_new seeds with seed + l
+ * (in this order).
+ * \returns The set. */
+replica_set *replicas_new(const graph *g, int lanes, double alpha,
+                          uint64_t seed);
+
+/** \brief Free the set. */
+void replicas_free(replica_set *set);
+
+/** \brief Choose the instruction set of the update kernel.
+ *
+ * \param set The set.
+ * \param level The wanted level, lowered to \ref simd_supported.
+ * \returns The level used from now on (the best supported one by default). */
+simd_level replicas_set_simd(replica_set *set, simd_level level);
+
+/** \brief Run every lane up to time t (nothing if t is not after \ref
+ * replicas_time), i.e. draw the Poisson number of its events in between and
+ * apply them. */
+void replicas_run_until(replica_set *set, double t);
+
+/** \brief The time the lanes were run to (0 at the start). */
+double replicas_time(const replica_set *set);
+
+/** \brief The number of lanes. */
+int replicas_lanes(const replica_set *set);
+
+/** \brief The number of events lane has applied. */
+int64_t replicas_event_count(const replica_set *set, int lane);
+
+/** \brief The interleaved weights, the one of edge i in lane l at
+ * [i*\ref replicas_lanes + l] (read only, valid until the set is freed). */
+const double *replicas_weights(const replica_set *set);
+
+/** \brief Copy the weights of lane into g (and update its local weights).
+ *
+ * \param set The set.
+ * \param lane The lane.
+ * \param g A graph with the topology the set was created from, e.g. the
+ * graph itself, to draw or analyse the replica with the other tools. */
+void replicas_copy_lane(const replica_set *set, int lane, graph *g);
+
+#endif
@@ -0,0 +1,124 @@
+/** \file sampling.h
+ * \brief Random sampling helpers used on the hot path of the simulation. */
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include "pcg_variants.h"
+#include "graph_index.h"
+
+/** \brief Uniform random index in 0, ..., bound-1.
+ *
+ * For bounds below 2^32 this is pcg32_boundedrand_r, so 32 bit builds get the
+ * same stream as before. Larger bounds (only possible with 64 bit \ref
+ * graph_index) combine two outputs of rng into a 64 bit value which is mapped
+ * to the range with a multiplication and rejection (Lemire, "Fast random
+ * integer generation in an interval", 2019), which needs no division except
+ * in the rare rejection case.
+ *
+ * \param rng The RNG to draw from.
+ * \param bound The positive exclusive upper bound.
+ * \returns The uniform index. */
+graph_index index_boundedrand_r(pcg32_random_t *rng, graph_index bound);
+
+/** \brief Poisson distributed random number with the given mean.
+ *
+ * Means below 10 use inversion by sequential search, larger means the
+ * transformed rejection PTRS (Hörmann, "The transformed rejection method for
+ * generating Poisson random variables", 1993), which needs O(1) uniforms.
+ *
+ * \param rng The RNG to draw from.
+ * \param mean The non-negative mean.
+ * \returns The Poisson number. */
+int64_t poisson_rand_r(pcg32_random_t *rng, double mean);
+
+/** \brief The vector instruction sets the sampling kernels can use. */
+typedef enum simd_level {
+        SIMD_DEFAULT = -1, /**< \brief Only for \ref categorical_set_level: the
+                                best supported level, but AVX2 instead of
+                                AVX-512 for more than 32 weights. */
+        SIMD_SCALAR, /**< \brief Plain C. */
+        SIMD_AVX2, /**< \brief 4 doubles per register. */
+        SIMD_AVX512 /**< \brief 8 doubles per register. */
+} simd_level;
+
+/** \brief The best \ref simd_level the CPU supports (determined at runtime). */
+simd_level simd_supported(void);
+
+/** \brief Choose an index with probability proportional to its weight.
+ *
+ * Returns the first i with x < P_i where P_i is the sum of the weights
+ * 0, ..., i and x = unif*P_{count-1}, i.e. the categorical distribution
+ * inverted at unif. All levels compute the sums P_i with the same operations
+ * in the same order (the order of an in-register prefix sum over blocks of
+ * four: within a block add the neighbour at distance one, then the one at
+ * distance two, then the sum of the previous blocks), so they give exactly
+ * the same index for the same uniform.
+ *
+ * \param level The instruction set to use, at most \ref simd_supported.
+ * \param weights The non-negative weights, their sum must be positive.
+ * \param count The number of weights.
+ * \param unif The uniform on [0, 1).
+ * \returns The chosen index or -1 if count is 0. */
+graph_index categorical_choose_level(simd_level level, const double *weights,
+                                     graph_index count, double unif);
+
+/** \brief \ref categorical_choose_level with the level set by \ref
+ * categorical_set_level (\ref SIMD_DEFAULT unless one was set), fewer than 8
+ * weights are always chosen by the scalar code. */
+graph_index categorical_choose(const double *weights, graph_index count,
+                               double unif);
+
+/** \brief Choose the instruction set of \ref categorical_choose for the
+ * whole process, e.g. the one \ref autotune measured to be the fastest.
+ *
+ * All levels choose the same indices, so only the speed changes, and the
+ * level may be set while other threads choose.
+ *
+ * \param level The wanted level, lowered to \ref simd_supported, or \ref
+ * SIMD_DEFAULT.
+ * \returns The level used before, to restore it. */
+simd_level categorical_set_level(simd_level level);
+
+/** \typedef rate_tree
+ * \brief Typedef of the \ref rate_tree struct.
+ *
+ * \struct rate_tree sampling.h include/sampling.h
+ * \brief Dynamic sampler choosing an index with probability proportional to
+ * its rate.
+ *
+ * The rates are kept in a Fenwick (binary indexed) tree, so changing a rate,
+ * the total rate and choosing an index all take O(log n). To stop rounding
+ * errors of the incremental updates from accumulating the tree is rebuilt
+ * from the exact rates after every n updates, which is O(1) amortised. */
+typedef struct rate_tree {
+        graph_index n; /**< \brief The number of indices. */
+        double *rates; /**< \brief The current rate of every index. */
+        double *tree; /**< \brief The 1-based Fenwick tree of the rates. */
+        graph_index top; /**< \brief The largest power of two <= n. */
+        graph_index updates; /**< \brief Updates since the last rebuild. */
+} rate_tree;
+
+/** \brief Create a sampler over n indices which all have rate 0. */
+rate_tree *rate_tree_new(graph_index n);
+
+/** \brief Free the sampler. */
+void rate_tree_free(rate_tree *t);
+
+/** \brief Set the rate of index i to the non-negative rate. */
+void rate_tree_set(rate_tree *t, graph_index i, double rate);
+
+/** \brief The sum of all rates. */
+double rate_tree_total(const rate_tree *t);
+
+/** \brief Find the index i with rate(0)+...+rate(i-1) <= x < rate(0)+...+rate(i).
+ *
+ * For x uniform on [0, \ref rate_tree_total) this chooses i with probability
+ * proportional to its rate. Indices of rate 0 are never returned (as long as
+ * some rate is positive), even if rounding puts x at the end of the range.
+ *
+ * \param t The sampler.
+ * \param x The position in the cumulative rates.
+ * \returns The index. */
+graph_index rate_tree_find(const rate_tree *t, double x);
+
+#endif
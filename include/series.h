@@ -0,0 +1,112 @@
+/** \file series.h
+ * \brief Buffered time series output of observables of a running simulation.
+ *
+ * A \ref series_writer samples a fixed set of observables of the \ref graph
+ * state at equidistant simulation times and writes them as CSV or as a packed
+ * binary file. Formatting happens on the simulating thread into one of two
+ * buffers while a background thread writes the other one to disk, so the
+ * event loop never waits on the file system unless both buffers are full.
+ *
+ * Every record consists of the following fields (in this order)
+ *
+ *      time, max_weight, q10, q25, q50, q75, q90, fixated, w_0, ..., w_{k-1}
+ *
+ * where q10 to q90 are the quantiles of the edge weight histogram, fixated is
+ * the number of vertices whose heaviest edge carries at least the fixation
+ * fraction of the local weight and w_0 to w_{k-1} are the weights of k edges
+ * sampled at equal strides from graph.edges when the writer is opened (the
+ * same edges by their \ref graph_edge_id for the whole series, NaN once an
+ * edge is removed). A writer opened with \ref
+ * series_open_coupled appends for every coupled replica k = 1, 2, ... the
+ * paired differences
+ *
+ *      dk_max_weight, dk_q10, ..., dk_q90, dk_fixated
+ *
+ * of its observables minus the ones of the sampled graph.
+ *
+ * The binary format starts with the 8 bytes `GDSERIES`, followed by the
+ * number of doubles per record as uint32_t and then the records as native
+ * doubles. */
+#ifndef SERIES_H
+#define SERIES_H
+
+#include "weightedgraph.h"
+
+/** \brief The number of weight histogram quantiles in every record. */
+#define SERIES_N_QUANTILES 5
+
+/** \brief The number of fields per record without sampled edge weights. */
+#define SERIES_N_OBSERVABLES (3 + SERIES_N_QUANTILES)
+
+/** \brief Output formats a \ref series_writer can produce. */
+typedef enum series_format {
+        SERIES_CSV, /**< \brief One comma separated line per record with header. */
+        SERIES_BINARY /**< \brief Packed native doubles after a short header. */
+} series_format;
+
+/** \typedef series_writer
+ * \brief Opaque handle of a running time series output. */
+typedef struct series_writer series_writer;
+
+/** \brief Open fname and start the background writer.
+ *
+ * \param fname The file to write the series to (truncated if it exists).
+ * \param format The \ref series_format of the output.
+ * \param interval The simulation time between two records.
+ * \param sampled_edges The number of edge weights to add to every record
+ * (capped at g->m).
+ * \param fixation Fraction of the local weight the heaviest edge of a vertex
+ * needs to carry for the vertex to count as fixated.
+ * \param g The graph that is going to be sampled, used to fix the sampled
+ * edges and the record layout.
+ * \returns The new writer or NULL if fname could not be opened. */
+series_writer *series_open(const char *fname, series_format format,
+                           double interval, int sampled_edges,
+                           double fixation, graph *g);
+
+/** \brief Open fname like \ref series_open and also record the paired
+ * differences of the observables of replicas of g.
+ *
+ * The replicas are meant to run on the same random numbers as g (cf. \ref
+ * glauber_couple), so the differences show the effect of their parameters
+ * with far less noise than independent runs. They are observed at the same
+ * times as g and have to outlive the writer.
+ *
+ * \param coupled The replicas (the array is copied).
+ * \param n_coupled The number of replicas. */
+series_writer *series_open_coupled(const char *fname, series_format format,
+                                   double interval, int sampled_edges,
+                                   double fixation, graph *g, graph **coupled,
+                                   int n_coupled);
+
+/** \brief The simulation time at which the next record is due. */
+double series_next_time(series_writer *s);
+
+/** \brief Record the observables of state for all due times up to t.
+ *
+ * Since the state is constant between two events, calling this with the time
+ * of the upcoming event before applying it records the correct state for all
+ * sample times that have passed in between.
+ *
+ * \param s The writer to record to.
+ * \param state The graph to sample.
+ * \param t The current simulation time. */
+void series_record_until(series_writer *s, graph *state, double t);
+
+/** \brief Compute the observables of a record except the time and the
+ * sampled weights, i.e. max_weight, q10 to q90 and fixated.
+ *
+ * \param state The graph whose topology is used.
+ * \param weights The weights, weights[i] belonging to state->edges[i], or
+ * NULL for the weights of state itself (e.g. a snapshot of a running
+ * simulation, cf. \ref inspect.h).
+ * \param fixation The fixation fraction (cf. \ref series_open).
+ * \param values The SERIES_N_OBSERVABLES-1 observables are stored here. */
+void series_observables(graph *state, const double *weights, double fixation,
+                        double *values);
+
+/** \brief Flush all buffered records, stop the background writer, close the
+ * file and free s. */
+void series_close(series_writer *s);
+
+#endif
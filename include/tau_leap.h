@@ -0,0 +1,83 @@
+/** \file tau_leap.h
+ * \brief Approximate tau-leaping of the \ref polya_rule.
+ *
+ * Instead of running the events one by one, a leap of length tau freezes the
+ * weights, lets the clock of every vertex ring Poisson(tau) times and
+ * distributes these rings over the incident edges like the polya rule would
+ * with the frozen weights (a multinomial with probabilities
+ * weight^alpha/sum of weight^alpha). By Poisson splitting this is the same as
+ * drawing Poisson(tau*p) increments for every vertex and incident edge
+ * independently, which is what is done. Every vertex gets its own RNG stream
+ * for the leap, so the vertices are processed in parallel (with OpenMP if
+ * enabled) and the result does not depend on the number of threads.
+ *
+ * The error of a leap comes from the probabilities changing while they are
+ * frozen. \ref tau_leap_choose bounds the mean and standard deviation of the
+ * change of every weight per leap by epsilon times the weight (or by 1 for
+ * small weights, as in Cao, Gillespie and Petzold, "Efficient step size
+ * selection for the tau-leaping simulation method", 2006). \ref
+ * tau_leap_apply estimates the deviation from the exact dynamics.
+ **/
+#ifndef TAU_LEAP_H
+#define TAU_LEAP_H
+
+#include <stdint.h>
+
+#include "update_rules.h" // contains weightedgraph.h
+
+/** \typedef tau_leap
+ * \brief Typedef of the \ref tau_leap struct.
+ *
+ * \struct tau_leap tau_leap.h include/tau_leap.h
+ * \brief Scratch space for leaping on a graph of fixed topology. */
+typedef struct tau_leap {
+        graph_index *offsets; /**< \brief The slots of vertex v are
+                                offsets[v], ..., offsets[v+1]-1 of the arrays
+                                below. */
+        double *probs; /**< \brief The frozen probabilities of every slot. */
+        int64_t *counts; /**< \brief The increments of every slot. */
+        double *mean_change; /**< \brief The expected change per unit time of
+                               every edge of the pool. */
+} tau_leap;
+
+/** \brief Create the scratch space for g, whose topology must not change
+ * while it is used. */
+tau_leap *tau_leap_new(const graph *g);
+
+/** \brief Free the scratch space. */
+void tau_leap_free(tau_leap *leap);
+
+/** \brief Freeze the probabilities of the current weights of g and choose the
+ * largest leap length for which the change of every weight stays within the
+ * error bound.
+ *
+ * \param leap The scratch space of g.
+ * \param g The state.
+ * \param params The parameters of the polya rule.
+ * \param epsilon The bound of the relative change of a weight per leap.
+ * \returns The leap length, INFINITY if no weight can change. */
+double tau_leap_choose(tau_leap *leap, graph *g, const update_params *params,
+                       double epsilon);
+
+/** \brief Run a leap of length tau with the probabilities frozen by the last
+ * call of \ref tau_leap_choose.
+ *
+ * As an estimate of the deviation from the exact dynamics, deviation is
+ * increased by the expected number of the events of the leap that an exact
+ * run using the same uniforms would have put on another edge, i.e. for every
+ * vertex its number of events times half the total variation distance between
+ * its probabilities at the start and at the end of the leap (the
+ * probabilities drift over the leap, so on average half of the distance
+ * applies).
+ *
+ * \param leap The scratch space of g.
+ * \param g The state.
+ * \param params The parameters of the polya rule.
+ * \param tau The leap length.
+ * \param seed The seed of the RNG streams of the vertices.
+ * \param deviation Accumulates the deviation estimate.
+ * \returns The number of events of the leap. */
+int64_t tau_leap_apply(tau_leap *leap, graph *g, const update_params *params,
+                       double tau, uint64_t seed, double *deviation);
+
+#endif
@@ -0,0 +1,101 @@
+/** \file trace.h
+ * \brief Compact traces of the events of a simulation.
+ *
+ * A trace stores for every event its time, its vertex and the slot of the
+ * changed edge in the adjacency array of the vertex, which is all that is
+ * needed to apply the events again (cf. \ref glauber_replay_trace) without
+ * drawing random numbers or evaluating the rule. The events are bit-packed:
+ *
+ *  - the time as the difference of its IEEE 754 bit pattern to the one of
+ *    the previous event (0 before the first), which is non-negative since
+ *    the times increase, stored as its length in 6 bits followed by that many
+ *    bits, so the times are exact,
+ *  - the vertex in ceil(log2 n) bits,
+ *  - the slot plus 1 (0 if the event changed no edge) in ceil(log2(deg+1))
+ *    bits for the degree deg of the vertex, e.g. 3 bits on a 2 dimensional
+ *    torus.
+ *
+ * The file starts with the 8 bytes `GDTRACE1`, followed by n, m and the flags
+ * as uint64_t and the increment of the weights as double, and then holds
+ * chunks of at most \ref TRACE_CHUNK_EVENTS events, each a uint32_t with the
+ * number of events and one with the number of uint64_t words of its bits,
+ * followed by the words. All numbers are native. Since the slots refer to the
+ * adjacency arrays, a trace can only be read with the graph it was written
+ * for, in the same state and order.
+ **/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "weightedgraph.h"
+
+/** \brief The maximal number of events per chunk. */
+#define TRACE_CHUNK_EVENTS 65536
+
+/** \brief Flag of traces whose adjacency arrays were sorted by \ref
+ * graph_sort_edges (with NULL keys) before the first event. */
+#define TRACE_SORTED_EDGES 1
+
+/** \typedef trace_writer
+ * \brief Opaque handle of a trace being written. */
+typedef struct trace_writer trace_writer;
+
+/** \typedef trace_reader
+ * \brief Opaque handle of a trace being read. */
+typedef struct trace_reader trace_reader;
+
+/** \brief Create the trace fname of the events on g.
+ *
+ * \param fname The file to write (truncated if it exists).
+ * \param g The graph in its initial state.
+ * \param increment The change of the weight of the edge of every event.
+ * \param flags The flags of the trace, e.g. \ref TRACE_SORTED_EDGES.
+ * \returns The writer or NULL (with errno set) if fname could not be opened. */
+trace_writer *trace_writer_open(const char *fname, const graph *g,
+                                double increment, unsigned int flags);
+
+/** \brief Append count events.
+ *
+ * \param trace The writer.
+ * \param g The graph after the events (only the degrees are read, which the
+ * events do not change).
+ * \param times The increasing times of the events.
+ * \param vertex_indices The vertices of the events.
+ * \param slots The slots of the changed edges, -1 for events without change. */
+void trace_write(trace_writer *trace, const graph *g, const double *times,
+                 const graph_index *vertex_indices, const graph_index *slots,
+                 int count);
+
+/** \brief Write the last chunk, close the file and free the writer.
+ *
+ * \returns 0 on success, -1 if writing to the file failed at any point. */
+int trace_writer_close(trace_writer *trace);
+
+/** \brief Open the trace fname for replaying it on g.
+ *
+ * \returns The reader or NULL if fname could not be opened (errno set) or is
+ * no trace of a graph with the vertex and edge numbers of g (errno 0). */
+trace_reader *trace_reader_open(const char *fname, const graph *g);
+
+/** \brief The flags the trace was written with. */
+unsigned int trace_flags(const trace_reader *trace);
+
+/** \brief The change of the weight of the edge of every event. */
+double trace_increment(const trace_reader *trace);
+
+/** \brief Read the next events.
+ *
+ * \param trace The reader.
+ * \param g The graph in the state after the events read before.
+ * \param times Set to the times of the events.
+ * \param vertex_indices Set to the vertices of the events.
+ * \param slots Set to the slots of the events, -1 for events without change.
+ * \param count The number of events to read at most.
+ * \returns The number of events read, less than count only at the end of the
+ * trace (or at the first event not fitting g). */
+int trace_read(trace_reader *trace, const graph *g, double *times,
+               graph_index *vertex_indices, graph_index *slots, int count);
+
+/** \brief Close the file and free the reader. */
+void trace_reader_close(trace_reader *trace);
+
+#endif
@@ -2,32 +2,226 @@
  * \brief Define a general update_rule class and contains examples for them.
  *
  * This file is used to outline the possible update rules to graphs once the
- * Poisson clock on a vertex has rung, the functions should be of the form
+ * Poisson clock on a vertex has rung. An update rule is described by a
+ * \ref rule_interface which bundles
  *
- *      void graph_update(graph *state, int vertex_index, double alpha, pcg32_random_t *rng)
+ *  - optional `init` and `free` hooks creating and destroying per-rule state
+ *    (caches, lookup tables, samplers) for a given graph,
+ *  - an `update` entry performing a single event,
+ *  - an optional `update_batch` entry performing many events in a row,
+ *  - an optional `rate` entry giving state dependent clock rates,
+ *  - optional `leading` and `update_other` entries splitting an event into
+ *    its most likely edge and the others, for the skip-ahead of \ref
+ *    glauber_set_skip_ahead,
+ *  - an optional `topology` hook keeping the per-rule state valid when edges
+ *    are added or removed (cf. \ref graph_add_hook).
  *
- * and update the pointed to graph using the random value given by rng in case
- * it is needed.
+ * Rules may add and remove edges of the graph during their events with \ref
+ * graph_add_edge and \ref graph_rm_edge (e.g. pruning light edges and
+ * rewiring them), if they set `changes_topology`. The samplers of the event
+ * loop follow these changes through the hooks of the graph.
+ *
+ * Both entries get the uniform on [0,1) for the event passed in, so that
+ * the event loop can generate the randomness for thousands of events ahead
+ * and hand them over in one call. Rules that need more randomness than one
+ * uniform per event draw it from the passed RNG. The parameters of the model
+ * are passed as an \ref update_params block.
+ *
+ * To run a rule it is instantiated on a graph with \ref rule_instance_new,
+ * which calls its `init` hook, and applied with \ref rule_apply_batch, which
+ * falls back to calling `update` in a loop for rules without a batch entry.
+ *
+ * The original single event function type \ref update_rule is kept for
+ * simple uses such as the tests, \ref polya_update is of this type.
  **/
+#ifndef UPDATE_RULES_H
+#define UPDATE_RULES_H
 
 #include "pcg_variants.h"
 #include "weightedgraph.h"
 
-/** \brief The update_rule function type to which all update rules should
- * adhere.
+/** \brief The update_rule function type for single stateless updates.
  *
  * \p graph The input graph to update.
- * \p int The index of the vertex to update (i.e. whose clock 'rang').
+ * \p graph_index The index of the vertex to update (i.e. whose clock 'rang').
  * \p double The intrinsic alpha parameter of the model.
  * \p pcg32_random_t The RNG governing the randomness in the model.
- * \see glauber_dynamics */
-typedef void (*update_rule)(graph*, int, double, pcg32_random_t*);
+ * \see rule_interface */
+typedef void (*update_rule)(graph*, graph_index, double, pcg32_random_t*);
+
+/** \typedef update_params
+ * \brief Typedef of the \ref update_params struct.
+ *
+ * \struct update_params update_rules.h include/update_rules.h
+ * \brief The parameters of an update rule. */
+typedef struct update_params {
+        double alpha; /**< \brief The intrinsic alpha parameter of the model. */
+        double rate_exponent; /**< \brief The exponent of the local weight in
+                                the clock rate of \ref polya_rate_rule. */
+        int prefetch_distance; /**< \brief The number of events between two
+                                 stages of the prefetching in update_batch, 0
+                                 for \ref DEFAULT_PREFETCH_DISTANCE. */
+} update_params;
+
+/** \brief The prefetch distance used if \ref update_params.prefetch_distance
+ * is 0. */
+#define DEFAULT_PREFETCH_DISTANCE 2
+
+/** \typedef rule_interface
+ * \brief Typedef of the \ref rule_interface struct.
+ *
+ * \struct rule_interface update_rules.h include/update_rules.h
+ * \brief The interface every update rule provides.
+ *
+ * Only `name` and `update` are mandatory, all other entries may be NULL. */
+typedef struct rule_interface {
+        const char *name; /**< \brief Human readable name of the rule. */
+
+        /** \brief Create the per-rule state for state and params (may return
+         * NULL if the rule is stateless). */
+        void *(*init)(graph *state, const update_params *params);
+
+        /** \brief Free the per-rule state created by init. */
+        void (*free)(void *rule_state);
+
+        /** \brief Perform the event of vertex_index using the uniform unif.
+         *
+         * \returns The slot in the edges array of the vertex of the edge that
+         * was changed or -1 if no edge was changed. */
+        graph_index (*update)(graph *state, graph_index vertex_index, double unif,
+                              const update_params *params, void *rule_state,
+                              pcg32_random_t *rng);
+
+        /** \brief Perform count events in order, the i-th one on
+         * vertex_indices[i] with the uniform uniforms[i].
+         *
+         * Has to give the same result as calling update count times. If slots
+         * is not NULL the return values of update are stored in it. */
+        void (*update_batch)(graph *state, const graph_index *vertex_indices,
+                             const double *uniforms, int count,
+                             const update_params *params, void *rule_state,
+                             pcg32_random_t *rng, graph_index *slots);
+
+        /** \brief The rate of the clock of vertex_index in state.
+         *
+         * NULL means that every clock rings at rate 1. After an event only the
+         * rates of the two vertices of the changed edge are recomputed, so the
+         * rate may only depend on the vertex and its incident edges. */
+        double (*rate)(const graph *state, graph_index vertex_index,
+                       const update_params *params);
+
+        /** \brief The leading edge of vertex_index, i.e. the one its events
+         * change most likely, and the probability that an event changes
+         * another edge instead.
+         *
+         * The probability is computed from the other edges directly, so it
+         * stays accurate close to 0. It may only depend on the incident edges
+         * of the vertex and must not grow when the weight of the leading edge
+         * grows by the increment, so that it bounds the probability of later
+         * events until another edge of the vertex changes.
+         *
+         * \returns The probability of the other edges (1 if the vertex has no
+         * edges), with the slot of the leading edge in slot (-1 without
+         * edges). */
+        double (*leading)(const graph *state, graph_index vertex_index,
+                          const update_params *params, void *rule_state,
+                          graph_index *slot);
+
+        /** \brief Perform the event of vertex_index conditioned on not
+         * changing the edge in slot, using the uniform unif.
+         *
+         * \returns The slot of the changed edge as for update. */
+        graph_index (*update_other)(graph *state, graph_index vertex_index,
+                                    graph_index slot, double unif,
+                                    const update_params *params, void *rule_state,
+                                    pcg32_random_t *rng);
+
+        /** \brief The change of the weight of the changed edge in every
+         * event, or 0 if it is not always the same.
+         *
+         * Lets observers of the events (cf. \ref glauber_add_observer) be
+         * informed without saving the weights before every event. */
+        double increment;
+
+        /** \brief Called with the per-rule state after every change of the
+         * topology of the graph (registered by \ref rule_instance_new). */
+        graph_hook topology;
+
+        /** \brief Whether events add or remove edges.
+         *
+         * The slot returned by an event then refers to the adjacency array
+         * after the event (-1 if the changed edge was removed), observed
+         * events run one at a time and tau-leaps fall back to exact events. */
+        int changes_topology;
+} rule_interface;
+
+/** \typedef rule_instance
+ * \brief Typedef of the \ref rule_instance struct.
+ *
+ * \struct rule_instance update_rules.h include/update_rules.h
+ * \brief A \ref rule_interface together with its parameters and the state
+ * created by its init hook. */
+typedef struct rule_instance {
+        const rule_interface *rule; /**< \brief The rule that is run. */
+        update_params params; /**< \brief The parameters passed to the rule. */
+        void *state; /**< \brief The per-rule state, NULL for stateless rules. */
+        graph *g; /**< \brief The graph the instance was created for. */
+} rule_instance;
+
+/** \brief Instantiate rule with params on g calling its init hook.
+ *
+ * If the rule has a topology hook it is added to the hooks of g until the
+ * instance is freed.
+ *
+ * \param rule The rule to instantiate.
+ * \param g The graph the rule is going to update.
+ * \param params The parameters of the rule (copied).
+ * \returns The newly allocated instance. */
+rule_instance *rule_instance_new(const rule_interface *rule, graph *g,
+                                 const update_params *params);
+
+/** \brief Free the instance and the per-rule state using the free hook. */
+void rule_instance_free(rule_instance *instance);
+
+/** \brief Perform count events of instance on state.
+ *
+ * Uses the update_batch entry if the rule has one and calls update count
+ * times otherwise. For the arguments see \ref rule_interface. */
+void rule_apply_batch(rule_instance *instance, graph *state,
+                      const graph_index *vertex_indices, const double *uniforms,
+                      int count, pcg32_random_t *rng, graph_index *slots);
 
 /** \brief The polya update rule leading to polya competition on the graph.
  *
  * For details see the paper by Yannick Couzinié and Christian Hirsch and the
  * references therein. Essentially the update rules are like polya urns on
- * every vertex reinforced with a power law which is governed by the double
- * parameter in the update rule (i.e. double alpha = 1 is linear
- * reinforcement). */
-update_rule polya_update;
+ * every vertex reinforced with a power law which is governed by the alpha
+ * parameter in the update rule (i.e. alpha = 1 is linear reinforcement).
+ *
+ * The state of the rule is a table of weight^alpha for integer weights, so
+ * that the normalisation of a vertex with integer weights needs no call to
+ * pow. The edge is chosen with \ref categorical_choose, which uses
+ * vector instructions for vertices of large degree.
+ *
+ * Its batch entry is software pipelined: the memory an event touches is a
+ * chain of dependent loads (the entry of graph.vertices, the vertex, its
+ * edges array and the edges), so while running event i it prefetches the
+ * k-th link of the chain for event i+(4-k)*prefetch_distance. Every load
+ * then hits memory requested prefetch_distance events earlier, while the
+ * events are still applied in order.
+ *
+ * The leading edge of a vertex is its heaviest one, for alpha < 0 (where
+ * growing the heaviest edge lowers its probability) every vertex of degree
+ * above 1 reports probability 1 for its other edges and is never skipped. */
+extern const rule_interface polya_rule;
+
+/** \brief The \ref polya_rule with the clock of a vertex ringing at rate
+ * local_weight^rate_exponent instead of 1, i.e. heavier vertices update more
+ * often (rate_exponent > 0) or less often (rate_exponent < 0). */
+extern const rule_interface polya_rate_rule;
+
+/** \brief Single stateless event of \ref polya_rule drawing the uniform from
+ * the passed RNG. */
+extern update_rule polya_update;
+
+#endif
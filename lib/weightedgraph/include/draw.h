@@ -0,0 +1,59 @@
+/** \file draw.h
+ * \brief Rendering of graphs with graphviz.
+ *
+ * The only part of libweightedgraph that needs graphviz. It is not part of
+ * the library itself but built as the module glauber_render, which the
+ * simulation loads with dlopen when it draws a frame (cf. render.h), so runs
+ * without frames neither load nor need graphviz. */
+#ifndef DRAW_H
+#define DRAW_H
+
+#include "weightedgraph.h"
+
+/** \brief Output a png rendering of draw_torus to out_stream.
+ *
+ * This works by generating a valid graphviz string out of draw_torus and then
+ * invoking the graphviz C libraries to render those into png streams and
+ * outputting them to oustream or stdout if outstream=NULL.
+ *
+ * The penwidth and decrease rate are needed to calculate how much the edge
+ * weight influences the penwidth drawing. The formula goes like
+ *
+ *      penwidth * (edge_weight/max_weight_in_the_graph)^decrease_rate
+ *
+ * \param draw_torus The graph to be drawn (should correspond to the output of
+ * \ref graph_construct_torus, possibly relabelled with \ref graph_relabel
+ * since the drawing uses the original indices).
+ * \param n The amount of particles in one direction (before the periodically
+ * connected boundaries are hit) (same as \ref graph_construct_torus).
+ * \param d The dimension of the graph (same as \ref graph_construct_torus).
+ * \param duration The amount of times the frame is copied ot out_stream.
+ * \param out_stream The opened file to which to copy the rendered png. Can be
+ * set to NULL to automatically get stdout.
+ * \param max_width Corresponds to width parameter in the graphviz image.
+ * \param max_height Corresponds to height paramter in the graphviz image.
+ * \param max_dpi corresponds to the dpi (i.e. resolution) in the graphviz
+ * image.
+ * \param penwidth Is the maximum penwidth in the graphviz image for the edges.
+ * \param passed_time The parameter by which to divide the weights (i.e. the
+ * time passed until now).
+ *
+ * \todo Add a drawing function for values d other than 2.
+ *  
+ * \todo Separate the string generation and png rendering to make the png
+ * rendering reusable by other graphviz string generating drawing functions.
+ *  
+ * \todo Understand graphviz library better and avoid the string generation
+ * step alltogether and directly build the graph itself.
+ *
+ * \todo Find a more elegant solution to the duration parameter than just
+ * rendering the same frame duration amount of times. Ideally a way that allows
+ * for double duration (i.e. generate one frame and assign it a duration on
+ * sendover through the pipe) since the exponential times are doubles and not
+ * integers..
+ */
+void draw_torus2png(graph *draw_torus, int n, int d, unsigned int duration,
+                    FILE *out_stream, int max_width, int max_height, int max_dpi,
+                    int penwidth, double passed_time);
+
+#endif
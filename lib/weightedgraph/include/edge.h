@@ -1,5 +1,9 @@
 /** \file edge.h
  *  \brief Define the edge struct and functions relating to it. */
+#ifndef EDGE_H
+#define EDGE_H
+
+#include "graph_index.h"
 
 /**\typedef edge
  * \brief typedef of the \ref edge struct.
@@ -8,8 +12,8 @@
  * \brief Edge struct to be used as edges in the graph structs.
  */
 typedef struct edge {
-        int v1; /**< \brief The integer of vertex in \ref graph of one end of edge. */
-        int v2; /**< \brief The integer of vertex in \ref graph of the other end of edge. */
+        graph_index v1; /**< \brief The integer of vertex in \ref graph of one end of edge. */
+        graph_index v2; /**< \brief The integer of vertex in \ref graph of the other end of edge. */
         double weight; /**< \brief The weight for this particular edge. */
 } edge;
 
@@ -19,8 +23,10 @@ typedef struct edge {
  *  \param weight the integer that will bein edge->weight.
  *  \return The pointer to the new edge.
  */
-edge *edge_new(int v1, int v2, int weight);
+edge *edge_new(graph_index v1, graph_index v2, int weight);
 
 /** \brief Free the memory taken by the \ref edge.
  *  \param e edge to be freed. */
 void edge_free(edge *e);
+
+#endif
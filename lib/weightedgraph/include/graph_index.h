@@ -0,0 +1,36 @@
+/** \file graph_index.h
+ * \brief The integer type of vertex and edge indices.
+ *
+ * By default indices are 32 bit, which keeps edges and index arrays compact
+ * for all graphs with less than 2^31 vertices and edges (e.g. the torus with
+ * n=800, d=3). Compiling with GRAPH_INDEX_64 defined (configure
+ * --enable-large-graphs) makes them 64 bit for larger graphs. Library and
+ * program have to be compiled with the same choice.
+ **/
+#ifndef GRAPH_INDEX_H
+#define GRAPH_INDEX_H
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#ifdef GRAPH_INDEX_64
+/** \brief Signed integer type of vertex and edge indices (64 bit variant). */
+typedef int64_t graph_index;
+/** \brief The largest representable index. */
+#define GRAPH_INDEX_MAX INT64_MAX
+/** \brief printf conversion for \ref graph_index (use as "%" PRIgi). */
+#define PRIgi PRId64
+/** \brief scanf conversion for \ref graph_index (use as "%" SCNgi). */
+#define SCNgi SCNd64
+#else
+/** \brief Signed integer type of vertex and edge indices (32 bit variant). */
+typedef int32_t graph_index;
+/** \brief The largest representable index. */
+#define GRAPH_INDEX_MAX INT32_MAX
+/** \brief printf conversion for \ref graph_index (use as "%" PRIgi). */
+#define PRIgi PRId32
+/** \brief scanf conversion for \ref graph_index (use as "%" SCNgi). */
+#define SCNgi SCNd32
+#endif
+
+#endif
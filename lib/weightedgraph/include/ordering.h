@@ -0,0 +1,42 @@
+/** \file ordering.h
+ * \brief Locality preserving vertex orders to be used with \ref graph_relabel.
+ *
+ * \ref graph_construct_torus numbers the vertices in row-major order, so the
+ * neighbours of a vertex in dimension j are n^j indices away. The orders in
+ * this file place vertices that are close in the graph close in the order,
+ * which after \ref graph_relabel means close in memory.
+ *
+ * All functions return a newly allocated permutation order of 0, ..., N-1 in
+ * the convention of \ref graph_relabel (i.e. order[i] is the current index of
+ * the vertex that gets index i) which has to be freed by the caller.*/
+#ifndef ORDERING_H
+#define ORDERING_H
+
+#include "weightedgraph.h"
+
+/** \brief Z-order (Morton order) of the vertices of the torus of \ref
+ * graph_construct_torus with the same n and d.
+ *
+ * The coordinates are embedded into the smallest cube of side length a power
+ * of two and the vertices are sorted by their interleaved coordinate bits.
+ * Requires d*ceil(log2(n)) <= 64. */
+graph_index *torus_morton_order(int n, int d);
+
+/** \brief Hilbert curve order of the vertices of the torus of \ref
+ * graph_construct_torus with the same n and d.
+ *
+ * Uses the transposition algorithm of Skilling ("Programming the Hilbert
+ * curve", 2004) which works for any dimension. If n is not a power of two the
+ * order is the one induced by the curve of the enclosing cube. Requires
+ * d*ceil(log2(n)) <= 64. */
+graph_index *torus_hilbert_order(int n, int d);
+
+/** \brief Reverse Cuthill-McKee order of the vertices of an arbitrary graph.
+ *
+ * Every connected component is traversed breadth first from a vertex of
+ * (pseudo-)maximal eccentricity visiting neighbours by increasing degree,
+ * and the resulting order is reversed. This reduces the bandwidth of the
+ * adjacency, i.e. neighbours get close indices. */
+graph_index *graph_rcm_order(graph *g);
+
+#endif
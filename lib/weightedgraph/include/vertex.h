@@ -4,6 +4,8 @@
  * The vertex struct is defined with its general memory management functions
  * and \ref edge adding and removing utitilities are defined.
  **/
+#ifndef VERTEX_H
+#define VERTEX_H
 
 #include "edge.h"
 
@@ -12,12 +14,21 @@
  *
  * \struct vertex vertex.h lib/weightedgraph/include/vertex.h
  * \brief The vertex struct containing the neighbouring edges as pointers.
+ *
+ * The edges array has room for capacity edges and grows by doubling, so
+ * adding an edge is amortised O(1) and removing one never reallocates.
  * \see edge*/
 typedef struct vertex {
-                int dim;               /**< \brief The number of slots in array (local dimension)*/
+                graph_index dim;               /**< \brief The number of slots in array (local dimension)*/
                 double local_weight;   /**< \brief The sum of all weights of connected edges */
                 edge **edges;          /**< \brief The list of neighbour \ref edge instances as pointers */
-} vertex;;
+                graph_index capacity;  /**< \brief The number of slots edges has room for. */
+                graph_index *lookup;   /**< \brief Open addressing hash table from the
+                                            neighbours to their slots in edges, only kept
+                                            by the graph for vertices of large degree (cf.
+                                            \ref graph_find_edge), otherwise NULL. */
+                graph_index lookup_size; /**< \brief The number of entries of lookup (a power of 2). */
+} vertex;
 
 /** \brief Allocate the memory for a new vertex with no neighbours.
  * \return The pointer to the newly allocated vertex. */
@@ -50,7 +61,12 @@ void vertex_add_edge_to_neighbourhood(vertex *v, edge *e);
  *
  * The function checks if e is contained in the neighbourhood of v and does
  * nothing if that is not the case. This also decrements \ref vertex.dim and
- * \ref vertex.local_weight accordingly.
+ * \ref vertex.local_weight accordingly. The last edge of the neighbourhood
+ * takes the place of e.
+ *
+ * The edges of a \ref graph should be removed with \ref graph_rm_edge instead,
+ * which finds the slot of e in O(1) (this function searches it) and keeps
+ * the lookup and the edge ids of the graph.
  *
  * \param v Pointer to the \ref vertex whose nieghbourhood should be shrunk.
  * \param e Pointer to the \ref edge to remove fromthe neighbourhood of v. */
@@ -59,8 +75,13 @@ void vertex_rm_edge_from_neighbourhood(vertex *v, edge *e);
 /** \brief Find the edge that connects \ref vertex v with the vertex of index
  * dst.
  *
+ * Searches the neighbourhood linearly, \ref graph_find_edge uses the lookup
+ * of vertices of large degree instead.
+ *
  * \param v The vertex whose neighbourhood is to be searched.
  * \param dst The target vertex of the desired edge.
  * \returns NULL if no edge is found or a pointer to the connecting \ref edge.
  **/
-edge *vertex_find_connecting_edge(vertex *v, int dst);
+edge *vertex_find_connecting_edge(vertex *v, graph_index dst);
+
+#endif
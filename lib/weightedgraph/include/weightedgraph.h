@@ -3,21 +3,92 @@
  *
  * Any function not strictly acting only on either \ref edge or \ref vertex
  * instances but on both usually should be contained in here.*/
+#ifndef WEIGHTEDGRAPH_H
+#define WEIGHTEDGRAPH_H
 
 #include <stdio.h>
 #include "vertex.h"
 
+typedef struct graph graph;
+
+/** \brief The kinds of topology changes reported to a \ref graph_hook. */
+typedef enum graph_change_kind {
+        GRAPH_EDGE_ADDED, /**< \brief An edge was appended to graph.edges. */
+        GRAPH_EDGE_REMOVED, /**< \brief An edge was removed from graph.edges. */
+        GRAPH_EDGE_MOVED /**< \brief The last edge of graph.edges moved into the
+                              place of a removed one. */
+} graph_change_kind;
+
+/** \typedef graph_change
+ * \brief Typedef of the \ref graph_change struct.
+ *
+ * \struct graph_change weightedgraph.h lib/weightedgraph/include/weightedgraph.h
+ * \brief A change of the topology of a graph, see \ref graph_add_hook. */
+typedef struct graph_change {
+        graph_change_kind kind; /**< \brief What happened. */
+        edge edge; /**< \brief A copy of the edge (for removed edges as it was
+                        before, including its last weight). */
+        graph_index id; /**< \brief The stable id of the edge (cf. \ref graph_edge_id). */
+        graph_index index; /**< \brief The index of the edge in graph.edges, for
+                                removed edges the one it had. */
+        graph_index from; /**< \brief The previous index of a moved edge. */
+} graph_change;
+
+/** \brief Function called after every change of the topology of a graph.
+ *
+ * \param data The pointer given to \ref graph_add_hook.
+ * \param g The changed graph, already in its new state.
+ * \param change What changed. */
+typedef void (*graph_hook)(void *data, graph *g, const graph_change *change);
+
 /** \typedef graph
  * \brief The typedef of the \ref graph struct.
  *
  * \struct graph weightedgraph.h lib/weightedgraph/include/weightedgraph.h
- * \brief The graph struct containing the pointers to edges and vertices. \see edge \see vertex*/
-typedef struct graph {
-        int n;                  /**< \brief The number of vertices in the graph.*/
-        int m;                  /**< \brief The number of edges in the graph.*/
+ * \brief The graph struct containing the pointers to edges and vertices. \see edge \see vertex
+ *
+ * The edges of a graph are not allocated one by one but live in the single
+ * array graph.edge_pool, with graph.edges[i] pointing to edge_pool[i]. So the
+ * weights can be read in place as a strided array (stride sizeof(\ref edge))
+ * without copying. Adding edges may move the pool, which invalidates pointers
+ * to edges held outside of the graph.
+ *
+ * Graphs whose topology changes during a simulation keep a few more arrays,
+ * which are only allocated by the first \ref graph_rm_edge (a graph that only
+ * grows or never changes does not pay for them): the slots of every edge in
+ * the adjacency arrays of its two vertices, so that removing an edge takes
+ * O(1), and stable edge ids with a free list of the ids of removed edges.
+ * Vertices of degree at least \ref GRAPH_LOOKUP_DEGREE additionally get a hash
+ * table from their neighbours to their edges (cf. \ref graph_find_edge). */
+struct graph {
+        graph_index n;          /**< \brief The number of vertices in the graph.*/
+        graph_index m;          /**< \brief The number of edges in the graph.*/
         vertex **vertices; /**< \brief List of \ref vertex pointers for vertices contained in the graph */
         edge **edges; /**< \brief List of \ref edge pointers for vertices contained in the graph */
-} graph;
+        edge *edge_pool; /**< \brief Contiguous storage of the m edges. */
+        graph_index capacity; /**< \brief Number of edges edge_pool has room for. */
+        graph_index *labels; /**< \brief Original index of every vertex after \ref graph_relabel
+                          (NULL if the graph was never relabelled). */
+        graph_index *positions; /**< \brief Inverse of labels, i.e. the current index of
+                             every original index (NULL if never relabelled). */
+        graph_index *slots; /**< \brief The slot of edges[i] in the adjacency array of its
+                                 v1 (slots[2i]) and of its v2 (slots[2i+1]), NULL before the
+                                 first removal. */
+        graph_index *ids; /**< \brief The id of edges[i] (NULL before the first removal,
+                               the id is i until then). */
+        graph_index *id_positions; /**< \brief The index in edges of every id, -1 for
+                                        free ids. */
+        graph_index *free_ids; /**< \brief The ids of removed edges, reused last in first out. */
+        graph_index n_free_ids; /**< \brief The number of free ids. */
+        graph_index n_ids; /**< \brief The number of ids handed out (used or free). */
+        int n_hooks; /**< \brief The number of topology hooks. */
+        graph_hook *hooks; /**< \brief The hooks called after topology changes. */
+        void **hook_data; /**< \brief The data passed to the hooks. */
+};
+
+/** \brief Vertices of at least this degree get a hash table from their
+ * neighbours to their edges, below it a linear search is faster. */
+#define GRAPH_LOOKUP_DEGREE 16
 
 /** \brief Allocate memory for an empty graph.
  * \return Pointer to the newly allocated empty graph. */
@@ -26,7 +97,7 @@ graph *graph_new();
 /** \brief Free all the memory contained in the graph.
  *
  * This will iterate through the vertices and free all the memory allocated to
- * edges and vertices contained in the graph.
+ * vertices and the edge pool of the graph.
  *
  * \param g The graph to be freed. */
 void graph_free(graph *g);
@@ -39,26 +110,116 @@ void graph_free(graph *g);
  * \param g The graph to which to add the n vertices.
  * \param n The number of vertices to add.
  * \see vertex_new */
-void graph_add_n_vertices(graph *g, int n);
+void graph_add_n_vertices(graph *g, graph_index n);
 
 /** \brief Connect vertices with index v1 and v2 with an edge of weight weight.
  *
  * This will create a new edge and
  * add an edge to an existing graph between two vertices if the connection does
- * not already exist.
+ * not already exist. The edge is appended to graph.edges and gets the most
+ * recently freed id (cf. \ref graph_edge_id), the hooks are called with \ref
+ * GRAPH_EDGE_ADDED. Takes amortised O(1) time.
+ *
+ * \returns The id of the new edge or -1 if the connection existed.
  **/
-void graph_add_edge(graph *g, int v1, int v2, int weight);
+graph_index graph_add_edge(graph *g, graph_index v1, graph_index v2, int weight);
 
 /** \brief Searches for an \ref edge connecting v1 and v2 and removes it.
  *
  * This will only remove existing edges, if the edge does not exist nothing
- * happens.
+ * happens. The last edge of graph.edges takes the place of the removed one
+ * and in the adjacency arrays of the two vertices their last edges take its
+ * slots, so no memory is allocated or freed. The hooks are called with \ref
+ * GRAPH_EDGE_REMOVED and, if an edge moved, with \ref GRAPH_EDGE_MOVED.
+ * Takes O(1) time (expected for vertices with a lookup), except for the
+ * first removal which sets up the slots and ids in O(m).
  *
  * \param g The graph from which to remove the vertex.
  * \param v1 One end of the edge to remove.
  * \param v2 The other end of the edge to remove. */
-void graph_rm_edge(graph *g, int v1, int v2);
+void graph_rm_edge(graph *g, graph_index v1, graph_index v2);
+
+/** \brief The edge connecting v1 and v2 or NULL if there is none.
+ *
+ * Vertices of degree at least \ref GRAPH_LOOKUP_DEGREE are looked up in
+ * their hash table in expected O(1), smaller ones searched like \ref
+ * vertex_find_connecting_edge. Only reads the graph. */
+edge *graph_find_edge(const graph *g, graph_index v1, graph_index v2);
+
+/** \brief The stable id of edges[index].
+ *
+ * Unlike the index, the id of an edge does not change when other edges are
+ * removed. Ids of removed edges are reused by later \ref graph_add_edge, so
+ * there are never more ids than the largest number of edges the graph had.
+ * Until the first removal the id of an edge is its index. \ref graph_relabel
+ * gives every edge its new index as id. */
+graph_index graph_edge_id(const graph *g, graph_index index);
+
+/** \brief The edge with the given id or NULL if the id is not in use. */
+edge *graph_edge_by_id(const graph *g, graph_index id);
+
+/** \brief Call hook with data after every change of the topology of g.
+ *
+ * Lets samplers and caches built on the graph (rates, per edge tables,
+ * indices of sampled edges) follow edges that are added and removed, e.g.
+ * by an update rule during a simulation. Hooks are called in the order they
+ * were added. */
+void graph_add_hook(graph *g, graph_hook hook, void *data);
 
+/** \brief Stop calling hook with data (does nothing if it was not added). */
+void graph_remove_hook(graph *g, graph_hook hook, void *data);
+
+/** \brief Read a graph from an edge list.
+ *
+ * Every line of in contains the indices of the two vertices of an edge
+ * separated by whitespace, optionally followed by the weight of the edge
+ * (e.g. the dumps of the inspection server), everything after a '#' is
+ * ignored. The graph gets
+ * one more vertex than the largest index that appears. Self-edges are skipped
+ * and repeated edges are only added once.
+ *
+ * \param in The opened file to read from.
+ * \param init_weight The weight of the edges without a weight in the file.
+ * \returns The new graph or NULL if a line could not be parsed. */
+graph *graph_read_edge_list(FILE *in, int init_weight);
+
+/** \brief Renumber the vertices of g in the given order.
+ *
+ * The vertex that is currently at index order[i] gets the index i. All edges
+ * are renamed accordingly, graph.edges is sorted by the new indices and the
+ * vertices, edges and adjacency arrays are reallocated in the new order so
+ * that vertices which are close in the order are close in memory. The
+ * adjacency array of every vertex lists its edges in the order of
+ * graph.edges afterwards.
+ *
+ * The original indices are kept in graph.labels (composed over several
+ * relabellings), use \ref graph_original_index and \ref graph_current_index
+ * to translate between them. The edge ids start over as the new indices and
+ * no hooks are called, so relabel before setting up anything on the graph.
+ *
+ * \param g The graph to relabel.
+ * \param order A permutation of 0, ..., g->n-1. */
+void graph_relabel(graph *g, const graph_index *order);
+
+/** \brief The index vertex i had before any \ref graph_relabel. */
+graph_index graph_original_index(const graph *g, graph_index i);
+
+/** \brief The current index of the vertex that had index original before any
+ * \ref graph_relabel. */
+graph_index graph_current_index(const graph *g, graph_index original);
+
+/** \brief Sort the adjacency array of every vertex by a key of its neighbours.
+ *
+ * Which edge an update rule picks with a given uniform depends on the order
+ * of the adjacency array, which depends on how the graph was built (e.g. on
+ * \ref graph_relabel or on the split between processes). Sorting every copy
+ * by a key that does not, such as the original index, makes them pick the
+ * same edges. The lookups and slots follow, the edges keep their indices and
+ * ids and no hooks are called. Parallel edges keep an arbitrary order.
+ *
+ * \param g The graph to sort.
+ * \param keys The key of every vertex, NULL for \ref graph_original_index. */
+void graph_sort_edges(graph *g, const graph_index *keys);
 
 /** \brief Allocate memory for a square lattice with periodic boundary
  * conditions (i.e. a torus).
@@ -68,62 +229,29 @@ void graph_rm_edge(graph *g, int v1, int v2);
  * essentially corresponds to \\Z^d \\setminus n\\Z.
  *
  * NOTE: Do not use this with n<3 since then you forcibly will get double or
- * self-edges to fulfill periodic boundary conditions.
+ * self-edges to fulfill periodic boundary conditions. The number of edges
+ * n^d*d has to fit into a \ref graph_index (cf. \ref graph_index.h and
+ * \ref graph_torus_fits).
  *
  * \param n The amount of particles in one direction (before the periodically
  * connected boundaries are hit).
  * \param d The dimension of the graph.
  * \param init_weight The initial weight assigned to all edges.
  *
- * \returns A pointer to the graph corresponding to the d-dimensional n-torus.
+ * \returns A pointer to the graph corresponding to the d-dimensional n-torus
+ * or NULL if its edges do not fit into a \ref graph_index.
  *
- * \todo Move this and draw_torus2png to its own header in libweightedgraph and
- * define a easily extendable general {graph_constructing_function,
- * graph_drawing_function} struct and make graphs choosable from the command
- * line.*/
-graph *graph_construct_torus(int n, int d, int init_weight);
+ * \todo Move this to its own header in libweightedgraph (like \ref
+ * draw_torus2png in draw.h) and define a easily extendable general
+ * {graph_constructing_function, graph_drawing_function} struct and make graphs
+ * choosable from the command line.*/
+graph *graph_construct_torus(graph_index n, graph_index d, int init_weight);
 
-/** \brief Output a png rendering of draw_torus to out_stream.
- *
- * This works by generating a valid graphviz string out of draw_torus and then
- * invoking the graphviz C libraries to render those into png streams and
- * outputting them to oustream or stdout if outstream=NULL.
+/** \brief Whether the n^d torus fits into a \ref graph_index, i.e. its n^d*d
+ * edges (and hence its vertices) can be indexed.
  *
- * The penwidth and decrease rate are needed to calculate how much the edge
- * weight influences the penwidth drawing. The formula goes like
- *
- *      penwidth * (edge_weight/max_weight_in_the_graph)^decrease_rate
- *
- * \param draw_torus The graph to be drawn (should correspond to the output of
- * \ref graph_construct_torus).
- * \param n The amount of particles in one direction (before the periodically
- * connected boundaries are hit) (same as \ref graph_construct_torus).
- * \param d The dimension of the graph (same as \ref graph_construct_torus).
- * \param duration The amount of times the frame is copied ot out_stream.
- * \param out_stream The opened file to which to copy the rendered png. Can be
- * set to NULL to automatically get stdout.
- * \param max_width Corresponds to width parameter in the graphviz image.
- * \param max_height Corresponds to height paramter in the graphviz image.
- * \param max_dpi corresponds to the dpi (i.e. resolution) in the graphviz
- * image.
- * \param penwidth Is the maximum penwidth in the graphviz image for the edges.
- * \param passed_time The parameter by which to divide the weights (i.e. the
- * time passed until now).
- *
- * \todo Add a drawing function for values d other than 2.
- *  
- * \todo Separate the string generation and png rendering to make the png
- * rendering reusable by other graphviz string generating drawing functions.
- *  
- * \todo Understand graphviz library better and avoid the string generation
- * step alltogether and directly build the graph itself.
- *
- * \todo Find a more elegant solution to the duration parameter than just
- * rendering the same frame duration amount of times. Ideally a way that allows
- * for double duration (i.e. generate one frame and assign it a duration on
- * sendover through the pipe) since the exponential times are doubles and not
- * integers..
- */
-void draw_torus2png(graph *draw_torus, int n, int d, unsigned int duration,
-                    FILE *out_stream, int max_width, int max_height, int max_dpi,
-                    int penwidth, double passed_time);
+ * \returns 1 if \ref graph_construct_torus can build it, 0 otherwise (also
+ * for n<1 or d<1). */
+int graph_torus_fits(graph_index n, graph_index d);
+
+#endif
@@ -0,0 +1,136 @@
+#define _GNU_SOURCE 1 // asprintf
+
+#include <assert.h>
+#include <gvc.h> //graphviz
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "draw.h"
+
+/* This macro ensures that the string that was extended is freed and returns an
+ * extended string. The inputs are the previous string as previous_str and
+ * variable amounts of printf-like arguments
+ * NOTE: main_string_containing_percents has to contain %s (basically where to
+ * insert the original string, for usual concatenation put at beginning, has to
+ * be the first % argument in any case).
+ * NOTE: Use ##__VAR_ARGS__ to not include the comma if there are no
+ * __VA_ARGS__ given, see gcc docs on variadic macros.*/
+#define ConcatStr(previous_str, main_string_containing_percents, ...){                                  \
+        char *tmp=previous_str;                                                                         \
+        if (asprintf(&previous_str, main_string_containing_percents, previous_str, ##__VA_ARGS__)<0){   \
+                perror("Could not concatenate strings, run again with gdb or report bug.");             \
+                abort();                                                                                \
+        }                                                                                               \
+        free(tmp);                                                                                      \
+}
+
+/* find the edge between the vertices with original indices a and b */
+edge static *torus_edge(graph *g, graph_index a, graph_index b){
+        return graph_find_edge(g, graph_current_index(g, a), graph_current_index(g, b));
+}
+
+/* get a png file as string stream */
+void draw_torus2png(graph *draw_torus, int n, int d, unsigned int duration,
+					FILE *out_stream, int max_width, int max_height, int max_dpi,
+					int penwidth, double passed_time){
+        /* only d==2 printing case has been handled */
+        assert(d==2);
+
+        /* if no output file has been specified, take stdout */
+        if (out_stream == NULL){
+                out_stream = stdout;
+        }
+        /* calculate the max weight first */
+        double max_weight=0;
+        for (graph_index i=0; i<draw_torus->m; i++){
+                max_weight = fmax(max_weight, draw_torus->edges[i]->weight);
+        }
+        char *graph_gv_str; // need to initialize for ConcatStr not to segfault
+
+        if (asprintf(&graph_gv_str, "graph {\n") < 0){
+                perror("Could not allocate string 'graph {\n' to graph_gv_str, check with gdb or report bug.");
+                abort();
+        }
+        ConcatStr(graph_gv_str, "%ssize=\"%i,%i\";\ndpi=%i;\n",
+                  max_width, max_height, max_dpi);
+        ConcatStr(graph_gv_str, "%snode [shape=point, style=dot, width=.1, height=.1];\n");
+        ConcatStr(graph_gv_str, "%srankdir=LR;\n");
+        /* find all the horizontal vertices that are invisible and serve as
+         * docking points for edges to 'loop' around to the other end (i.e.
+         * open edges) */
+        for (int i=0; i<n; i++){
+                ConcatStr(graph_gv_str, "%sH%i [style=invis];\n", n*i); /* analogously for horizontal connections */
+                ConcatStr(graph_gv_str, "%sH%i [style=invis];\n", n*i+(n-1));
+        }
+
+        for (int i=0; i<n; i++){
+                ConcatStr(graph_gv_str, "%sV%i [style=invis];\n", i); /* first line needs vertical connections to the top */
+                ConcatStr(graph_gv_str, "%sV%i [style=invis];\n", (int) (i+n*n-n)); /* and last line */
+        }
+
+        /* Do the horizontal connections */ 
+        for (int i=0; i < n; i++){
+
+                edge *looping_edge = torus_edge(draw_torus, n*i, n*i+n-1);
+                double looping_weight_ratio=penwidth*looping_edge->weight/passed_time;
+                ConcatStr(graph_gv_str, "%sH%i -- %i[penwidth=%f];\n", n*i, n*i, looping_weight_ratio);
+
+                for (int j=1; j < n; j++){
+                        int cur_vertex_index = n*i+j;
+
+                        edge *connecting_edge = torus_edge(draw_torus, cur_vertex_index-1,
+                                                           cur_vertex_index);
+                        double weight_ratio = penwidth*connecting_edge->weight/passed_time;
+
+                        ConcatStr(graph_gv_str, "%s%i -- %i[penwidth=%f];\n", cur_vertex_index-1, cur_vertex_index, weight_ratio);
+                }
+                ConcatStr(graph_gv_str, "%s%i -- H%i[penwidth=%f];\n", n*i+n-1, n*i+n-1, looping_weight_ratio);
+        }
+
+        /* Now do the vertical connections and define their ranks as same */ 
+        for (int i=0; i < n; i++){
+                char *same_rank;
+                if (asprintf(&same_rank, "V%i, %i", i, i)<0){
+                        perror("Could not allocate with asprintf to initialize string same_rank, check with gdb or report bug.");
+                        abort();
+                }
+                
+                
+                edge *looping_edge = torus_edge(draw_torus, i, i+n*(n-1));
+                double looping_weight_ratio=penwidth*looping_edge->weight/passed_time;
+                ConcatStr(graph_gv_str, "%sV%i -- %i[penwidth=%f];\n", i, i, looping_weight_ratio);
+
+                for (int j=1; j < n; j++){
+                        int prev_vertex_index=i+n*(j-1);
+                        int cur_vertex_index=i+n*j;
+
+                        edge *connecting_edge = torus_edge(draw_torus, prev_vertex_index,
+                                                           cur_vertex_index);
+
+                        double weight_ratio = penwidth*connecting_edge->weight/passed_time;
+
+                        ConcatStr(graph_gv_str, "%s%i -- %i[penwidth=%f];\n", prev_vertex_index, cur_vertex_index, weight_ratio);
+                        ConcatStr(same_rank, "%s, %i", cur_vertex_index);
+                }
+                ConcatStr(graph_gv_str, "%s%i -- V%i[penwidth=%f];\n", i+n*(n-1), i+n*(n-1), looping_weight_ratio);
+                ConcatStr(same_rank, "%s, %i, V%i", i+n*(n-1), i+n*(n-1));
+                ConcatStr(graph_gv_str, "%s{ rank=same; %s};\n", same_rank);
+                free(same_rank);
+        }
+        ConcatStr(graph_gv_str, "%s}");
+        
+        /** BEGIN GRAPHVIZ CONVERSION **/
+        Agraph_t *g = agmemread(graph_gv_str); /* read the graph from memory */
+        GVC_t *gvc = gvContext();
+
+        gvLayout(gvc, g, "dot"); /* layout the gv file using dot */
+
+        for (int i=0; i<duration; i++){
+                gvRender(gvc, g, "png", out_stream); /* and convert it to png */
+        }
+        free(graph_gv_str);
+        gvFreeLayout(gvc, g);
+        agclose(g);
+        gvFreeContext(gvc);
+}
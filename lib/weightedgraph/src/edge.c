@@ -1,7 +1,7 @@
 #include <stdlib.h> // malloc
 #include "edge.h"
 
-edge *edge_new(int v1, int v2, int weight){
+edge *edge_new(graph_index v1, graph_index v2, int weight){
         edge *out = malloc(sizeof(edge));
         *out = (edge){.v1=v1, .v2=v2, .weight=weight};
         return out;
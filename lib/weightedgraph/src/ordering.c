@@ -0,0 +1,192 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h> // malloc
+
+#include "ordering.h"
+
+/* a vertex index with the key it is sorted by */
+typedef struct keyed_index {
+        uint64_t key;
+        graph_index index;
+} keyed_index;
+
+int static keyed_index_cmp(const void *a, const void *b){
+        const keyed_index *k1 = a;
+        const keyed_index *k2 = b;
+        if (k1->key != k2->key){
+                return k1->key < k2->key ? -1 : 1;
+        }
+        return (k1->index > k2->index) - (k1->index < k2->index);
+}
+
+/* number of bits needed for the coordinates 0, ..., n-1 */
+int static coordinate_bits(int n){
+        int bits = 1;
+        while ((1L << bits) < n){
+                bits++;
+        }
+        return bits;
+}
+
+/* interleave the bits of the d coordinates, most significant bits first and
+ * the last (slowest) dimension first within each bit */
+uint64_t static interleave(const uint32_t *x, int bits, int d){
+        uint64_t key = 0;
+        for (int b=bits-1; b>=0; b--){
+                for (int j=d-1; j>=0; j--){
+                        key = (key << 1) | ((x[j] >> b) & 1);
+                }
+        }
+        return key;
+}
+
+/* Skilling's in place transformation of the coordinates into the transposed
+ * Hilbert index */
+void static axes_to_transpose(uint32_t *x, int bits, int d){
+        uint32_t m = 1u << (bits-1);
+        /* inverse undo */
+        for (uint32_t q=m; q>1; q>>=1){
+                uint32_t p = q-1;
+                for (int i=0; i<d; i++){
+                        if (x[i] & q){
+                                x[0] ^= p;
+                        }
+                        else {
+                                uint32_t t = (x[0] ^ x[i]) & p;
+                                x[0] ^= t;
+                                x[i] ^= t;
+                        }
+                }
+        }
+        /* gray encode */
+        for (int i=1; i<d; i++){
+                x[i] ^= x[i-1];
+        }
+        uint32_t t = 0;
+        for (uint32_t q=m; q>1; q>>=1){
+                if (x[d-1] & q){
+                        t ^= q-1;
+                }
+        }
+        for (int i=0; i<d; i++){
+                x[i] ^= t;
+        }
+}
+
+/* sort the row-major torus indices by the key computed from their
+ * coordinates with either the morton or the hilbert transformation */
+graph_index static *torus_curve_order(int n, int d, int hilbert){
+        int bits = coordinate_bits(n);
+        assert(d*bits <= 64);
+
+        graph_index vertex_count = 1;
+        for (int j=0; j<d; j++){
+                vertex_count *= n;
+        }
+        keyed_index *keys = malloc(vertex_count*sizeof(keyed_index));
+        uint32_t *x = malloc(d*sizeof(uint32_t));
+        for (graph_index i=0; i<vertex_count; i++){
+                /* coordinate j is the digit of n^j as in graph_construct_torus */
+                graph_index rest = i;
+                for (int j=0; j<d; j++){
+                        x[j] = rest % n;
+                        rest /= n;
+                }
+                if (hilbert){
+                        /* the transposed index has the first axis as most
+                         * significant, so reverse to match interleave */
+                        axes_to_transpose(x, bits, d);
+                        for (int j=0; j<d/2; j++){
+                                uint32_t tmp = x[j];
+                                x[j] = x[d-1-j];
+                                x[d-1-j] = tmp;
+                        }
+                }
+                keys[i] = (keyed_index){.key=interleave(x, bits, d), .index=i};
+        }
+        qsort(keys, vertex_count, sizeof(keyed_index), keyed_index_cmp);
+
+        graph_index *order = malloc(vertex_count*sizeof(graph_index));
+        for (graph_index i=0; i<vertex_count; i++){
+                order[i] = keys[i].index;
+        }
+        free(x);
+        free(keys);
+        return order;
+}
+
+graph_index *torus_morton_order(int n, int d){
+        return torus_curve_order(n, d, 0);
+}
+
+graph_index *torus_hilbert_order(int n, int d){
+        return torus_curve_order(n, d, 1);
+}
+
+/* breadth first search from start writing the visited vertices to queue,
+ * returns the index in queue after the last visited vertex. Neighbours are
+ * enqueued by increasing degree (insertion sort on the few new entries). */
+graph_index static bfs(graph *g, graph_index start, graph_index *queue,
+                        graph_index tail, char *visited){
+        graph_index head = tail;
+        queue[tail++] = start;
+        visited[start] = 1;
+        while (head < tail){
+                vertex *v = g->vertices[queue[head]];
+                graph_index cur = queue[head++];
+                graph_index first_new = tail;
+                for (graph_index j=0; j<v->dim; j++){
+                        edge *e = v->edges[j];
+                        graph_index other = e->v1 == cur ? e->v2 : e->v1;
+                        if (visited[other]){
+                                continue;
+                        }
+                        visited[other] = 1;
+                        graph_index pos = tail++;
+                        while (pos > first_new &&
+                               g->vertices[queue[pos-1]]->dim > g->vertices[other]->dim){
+                                queue[pos] = queue[pos-1];
+                                pos--;
+                        }
+                        queue[pos] = other;
+                }
+        }
+        return tail;
+}
+
+graph_index *graph_rcm_order(graph *g){
+        graph_index *order = malloc(g->n*sizeof(graph_index));
+        graph_index *scratch = malloc(g->n*sizeof(graph_index));
+        char *visited = calloc(g->n, 1);
+        char *scratch_visited = calloc(g->n, 1);
+
+        graph_index filled = 0;
+        for (graph_index i=0; i<g->n; i++){
+                if (visited[i]){
+                        continue;
+                }
+                /* find a pseudo-peripheral start: the last vertex of a breadth
+                 * first search is far away from its start, repeating this a
+                 * few times approximates a vertex of maximal eccentricity */
+                graph_index start = i;
+                for (int k=0; k<2; k++){
+                        graph_index end = bfs(g, start, scratch, 0, scratch_visited);
+                        start = scratch[end-1];
+                        for (graph_index j=0; j<end; j++){
+                                scratch_visited[scratch[j]] = 0;
+                        }
+                }
+                filled = bfs(g, start, order, filled, visited);
+        }
+
+        /* reverse */
+        for (graph_index i=0; i<g->n/2; i++){
+                graph_index tmp = order[i];
+                order[i] = order[g->n-1-i];
+                order[g->n-1-i] = tmp;
+        }
+        free(scratch);
+        free(visited);
+        free(scratch_visited);
+        return order;
+}
@@ -1,4 +1,4 @@
-#include <glib.h>
+#include <assert.h>
 #include <stdlib.h> // malloc
 
 #include "vertex.h"
@@ -11,12 +11,13 @@ vertex *vertex_new(){
 }
 
 void vertex_free(vertex *v){
-        for(int i=0; i<v->dim; i++){
+        for(graph_index i=0; i<v->dim; i++){
                 edge_free(v->edges[i]);
         }
         if(v->edges){
                 free(v->edges);
         }
+        free(v->lookup);
         free(v);
 }
 
@@ -25,57 +26,43 @@ void vertex_add_edge_to_neighbourhood(vertex *v, edge *e){
          *
          * NOTE: This does not check for different edges connecting the same
          * vertices (should not happen when used with weightedgraphs). */
-        g_assert(e->v1 != e->v2);        
+        assert(e->v1 != e->v2);        
 
         /* check that the edge is not already contained */
-        for(int i=0; i<v->dim; i++){
+        for(graph_index i=0; i<v->dim; i++){
                 if (v->edges[i] == e){
                         return;
                 }
         }
-        v->dim++;
-        v->local_weight += e->weight;
-        v->edges = realloc(v->edges, sizeof(edge*)*v->dim);
-        v->edges[v->dim-1] = e;
-}
-
-/**
- * make a new edges-array for the incoming vertex removing the i-th edge but
- * not freeing it.
- * 
- * Note that this is a pure utility function (hence static, i.e. limited to the
- * file) for vertex_rm_edge_from_neighbourhood.
- *
- * CAUTION: Always assign have this on the right side of an assignment to
- * v->edges since it frees the original v->edges.
- **/
-edge static **rm_i_th_edge(vertex const *v, int to_remove){
-        edge **out;
-        edge **old_edges = v->edges;
-        out = malloc(sizeof(edge*)*(v->dim-1));
-        for (int i=0; i<v->dim-1; i++){
-                /* skip the i-th index in assigning */
-                if (i<to_remove) { out[i] = old_edges[i]; }
-                else if (i>=to_remove) { out[i] = old_edges[i+1]; }
+        if (v->dim == v->capacity){
+                v->capacity = v->capacity ? 2*v->capacity : 4;
+                v->edges = realloc(v->edges, sizeof(edge*)*v->capacity);
         }
-        free(old_edges);
-        return out;
+        v->edges[v->dim++] = e;
+        v->local_weight += e->weight;
+        /* the lookup belongs to the graph, which rebuilds it when needed */
+        free(v->lookup);
+        v->lookup = NULL;
 }
 
 void vertex_rm_edge_from_neighbourhood(vertex *v, edge *e){
-        for(int i=0; i<v->dim; i++){
+        for(graph_index i=0; i<v->dim; i++){
                 /* compare memory adresses */
                 if(v->edges[i] == e){
-                        v->edges = rm_i_th_edge(v, i);
+                        /* the last edge fills the hole */
+                        v->edges[i] = v->edges[v->dim-1];
+                        v->edges[v->dim-1] = NULL;
                         v->dim--;
                         v->local_weight -= e->weight;
+                        free(v->lookup);
+                        v->lookup = NULL;
                         return;
                 }
         }
 }
 
-edge *vertex_find_connecting_edge(vertex *v, int dst){
-        for (int i=0; i<v->dim; i++){
+edge *vertex_find_connecting_edge(vertex *v, graph_index dst){
+        for (graph_index i=0; i<v->dim; i++){
                 if (v->edges[i]->v1 == dst ||
                     v->edges[i]->v2 == dst){
                         return v->edges[i];
@@ -1,10 +1,10 @@
 #define _GNU_SOURCE 1
 
-#include <glib.h>
-#include <gvc.h> //graphviz
+#include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h> // malloc
+#include <string.h> // strchr, memcpy
 
 #include "weightedgraph.h"
 
@@ -22,239 +22,642 @@ graph *graph_new(){
 }
 
 void graph_free(graph *g){
-        for(int i=0; i<g->n; i++){
-                vertex *v = g->vertices[i];
-                /**
-                 * use the fact that vertex_free frees the memory location for all
-                 * edges contained in it so remove the edge from the other
-                 * vertex.
-                 **/
-                for (int j=0; j<v->dim; j++){
-                        edge *e = v->edges[j];
-                        int to_cleanse = e->v1;
-                        if (e->v2 != i){
-                                /* if v2 is the vertex that is not i then v1==i
-                                 * and we have to remove the edge from v2 not
-                                 * from v1 */
-                                to_cleanse = e->v2;
-                        }
-                        vertex_rm_edge_from_neighbourhood(g->vertices[to_cleanse], e);
-                }
-                vertex_free(g->vertices[i]);
+        /* the edges belong to the pool, so only the adjacency arrays are
+         * freed with the vertices */
+        for(graph_index i=0; i<g->n; i++){
+                free(g->vertices[i]->edges);
+                free(g->vertices[i]->lookup);
+                free(g->vertices[i]);
         }
         free(g->vertices);
         free(g->edges);
+        free(g->edge_pool);
+        free(g->labels);
+        free(g->positions);
+        free(g->slots);
+        free(g->ids);
+        free(g->id_positions);
+        free(g->free_ids);
+        free(g->hooks);
+        free(g->hook_data);
         free(g);
 }
 
-void graph_add_n_vertices(graph *g, int to_add){
+void graph_add_n_vertices(graph *g, graph_index to_add){
         /* update g->n only at the end and use that it contains the old value */
-        g->vertices = realloc(g->vertices, sizeof(g->vertices) + to_add*sizeof(vertex));
-        for (int i=g->n; i<to_add; i++){
+        g->vertices = realloc(g->vertices, (g->n + to_add)*sizeof(vertex*));
+        for (graph_index i=g->n; i<g->n + to_add; i++){
                 g->vertices[i] = vertex_new();
         }
         g->n += to_add;
 }
 
-void graph_add_edge(graph *g, int v1, int v2, int weight){
-        /* check that the vertices are possible for the graph */
-        g_assert(v1 < g->n);
-        g_assert(v2 < g->n);
+/* replace the pool by new_pool (holding copies of the edges at the same
+ * positions) and point graph.edges and the adjacency arrays to it */
+void static rebase_edges(graph *g, edge *new_pool){
+        edge *old_pool = g->edge_pool;
+        for (graph_index i=0; i<g->n; i++){
+                vertex *v = g->vertices[i];
+                for (graph_index j=0; j<v->dim; j++){
+                        v->edges[j] = new_pool + (v->edges[j] - old_pool);
+                }
+        }
+        for (graph_index i=0; i<g->m; i++){
+                g->edges[i] = new_pool + i;
+        }
+        free(old_pool);
+        g->edge_pool = new_pool;
+}
 
-        /* check that the connection does not exist */
-        for (int i=0; i<g->vertices[v1]->dim; i++){
-                if (g->vertices[v1]->edges[i]->v1 == v2 ||
-                    g->vertices[v1]->edges[i]->v2 == v2){
+/* double the capacity of the edge pool */
+void static grow_edges(graph *g){
+        graph_index capacity = g->capacity ? 2*g->capacity : 16;
+        edge *new_pool = malloc(capacity*sizeof(edge));
+        if (g->m){
+                memcpy(new_pool, g->edge_pool, g->m*sizeof(edge));
+        }
+        g->edges = realloc(g->edges, capacity*sizeof(edge*));
+        if (g->slots){
+                g->slots = realloc(g->slots, 2*capacity*sizeof(graph_index));
+                g->ids = realloc(g->ids, capacity*sizeof(graph_index));
+                g->id_positions = realloc(g->id_positions, capacity*sizeof(graph_index));
+                g->free_ids = realloc(g->free_ids, capacity*sizeof(graph_index));
+        }
+        g->capacity = capacity;
+        rebase_edges(g, new_pool);
+}
+
+/* the end of e that is not v */
+graph_index static inline other_end(const edge *e, graph_index v){
+        return e->v1 == v ? e->v2 : e->v1;
+}
+
+/* the slot of the edge with pool index k in the adjacency array of its end v */
+graph_index static inline *edge_slot(graph *g, graph_index k, graph_index v){
+        return g->slots + 2*k + (g->edge_pool[k].v1 != v);
+}
+
+/*
+ * The lookup of a vertex is an open addressing hash table with linear
+ * probing from the neighbours to the slots of their edges, -1 marking empty
+ * entries. It is kept at most half full and entries are deleted by shifting
+ * the following ones back, so no tombstones accumulate under many removals.
+ */
+
+/* the first entry probed for the neighbour key in a table of size entries */
+graph_index static lookup_start(graph_index key, graph_index size){
+        uint64_t hash = (uint64_t) key * UINT64_C(0x9E3779B97F4A7C15);
+        return (graph_index) ((hash >> 32) & (uint64_t) (size-1));
+}
+
+/* the entry of the lookup of vertex vi holding key or the empty entry where
+ * it would go */
+graph_index static lookup_probe(const graph *g, graph_index vi, graph_index key){
+        const vertex *v = g->vertices[vi];
+        graph_index mask = v->lookup_size-1;
+        graph_index i = lookup_start(key, v->lookup_size);
+        while (v->lookup[i] >= 0 && other_end(v->edges[v->lookup[i]], vi) != key){
+                i = (i+1) & mask;
+        }
+        return i;
+}
+
+/* (re)build the lookup of vertex vi with room for twice its degree */
+void static lookup_build(graph *g, graph_index vi){
+        vertex *v = g->vertices[vi];
+        graph_index size = 2*GRAPH_LOOKUP_DEGREE;
+        while (size < 4*v->dim){
+                size *= 2;
+        }
+        free(v->lookup);
+        v->lookup = malloc(size*sizeof(graph_index));
+        v->lookup_size = size;
+        for (graph_index i=0; i<size; i++){
+                v->lookup[i] = -1;
+        }
+        for (graph_index j=0; j<v->dim; j++){
+                v->lookup[lookup_probe(g, vi, other_end(v->edges[j], vi))] = j;
+        }
+}
+
+/* empty the entry hole of the lookup of vertex vi */
+void static lookup_delete(graph *g, graph_index vi, graph_index hole){
+        vertex *v = g->vertices[vi];
+        graph_index mask = v->lookup_size-1;
+        for (graph_index j=(hole+1) & mask; v->lookup[j] >= 0; j=(j+1) & mask){
+                graph_index home = lookup_start(other_end(v->edges[v->lookup[j]], vi),
+                                                v->lookup_size);
+                /* the entry may fill the hole if its probe sequence passes
+                 * the hole before reaching j */
+                if (((j - home) & mask) >= ((j - hole) & mask)){
+                        v->lookup[hole] = v->lookup[j];
+                        hole = j;
+                }
+        }
+        v->lookup[hole] = -1;
+}
+
+/* append the edge with pool index k to the adjacency array of vi */
+void static attach_edge(graph *g, graph_index vi, graph_index k){
+        vertex *v = g->vertices[vi];
+        if (v->dim >= v->capacity){
+                v->capacity = v->dim ? 2*v->dim : 4;
+                v->edges = realloc(v->edges, v->capacity*sizeof(edge*));
+        }
+        v->edges[v->dim] = g->edge_pool + k;
+        if (g->slots){
+                *edge_slot(g, k, vi) = v->dim;
+        }
+        v->dim++;
+        v->local_weight += g->edge_pool[k].weight;
+        if (v->lookup && 2*v->dim <= v->lookup_size){
+                v->lookup[lookup_probe(g, vi, other_end(g->edge_pool + k, vi))] = v->dim-1;
+        }
+        else if (v->dim >= GRAPH_LOOKUP_DEGREE){
+                lookup_build(g, vi);
+        }
+}
+
+/* remove the edge with pool index k from the adjacency array of vi, its last
+ * edge takes the slot */
+void static detach_edge(graph *g, graph_index vi, graph_index k){
+        vertex *v = g->vertices[vi];
+        graph_index slot = *edge_slot(g, k, vi);
+        graph_index last = v->dim-1;
+        if (v->lookup){
+                lookup_delete(g, vi, lookup_probe(g, vi, other_end(g->edge_pool + k, vi)));
+        }
+        if (slot != last){
+                edge *moved = v->edges[last];
+                if (v->lookup){
+                        v->lookup[lookup_probe(g, vi, other_end(moved, vi))] = slot;
+                }
+                v->edges[slot] = moved;
+                *edge_slot(g, moved - g->edge_pool, vi) = slot;
+        }
+        v->edges[last] = NULL;
+        v->dim--;
+        v->local_weight -= g->edge_pool[k].weight;
+}
+
+/* set up the slots and ids on the first removal, the id of every edge is its
+ * index until then */
+void static track_topology(graph *g){
+        graph_index capacity = g->capacity > 1 ? g->capacity : 1;
+        g->slots = malloc(2*capacity*sizeof(graph_index));
+        g->ids = malloc(capacity*sizeof(graph_index));
+        g->id_positions = malloc(capacity*sizeof(graph_index));
+        g->free_ids = malloc(capacity*sizeof(graph_index));
+        for (graph_index i=0; i<g->n; i++){
+                vertex *v = g->vertices[i];
+                for (graph_index j=0; j<v->dim; j++){
+                        *edge_slot(g, v->edges[j] - g->edge_pool, i) = j;
+                }
+        }
+        for (graph_index k=0; k<g->m; k++){
+                g->ids[k] = k;
+                g->id_positions[k] = k;
+        }
+        g->n_ids = g->m;
+        g->n_free_ids = 0;
+}
+
+/* drop the slots and ids, e.g. when the edges are renumbered */
+void static untrack_topology(graph *g){
+        free(g->slots);
+        free(g->ids);
+        free(g->id_positions);
+        free(g->free_ids);
+        g->slots = g->ids = g->id_positions = g->free_ids = NULL;
+        g->n_ids = g->n_free_ids = 0;
+}
+
+void static notify(graph *g, const graph_change *change){
+        for (int i=0; i<g->n_hooks; i++){
+                g->hooks[i](g->hook_data[i], g, change);
+        }
+}
+
+void graph_add_hook(graph *g, graph_hook hook, void *data){
+        g->hooks = realloc(g->hooks, (g->n_hooks+1)*sizeof(graph_hook));
+        g->hook_data = realloc(g->hook_data, (g->n_hooks+1)*sizeof(void*));
+        g->hooks[g->n_hooks] = hook;
+        g->hook_data[g->n_hooks] = data;
+        g->n_hooks++;
+}
+
+void graph_remove_hook(graph *g, graph_hook hook, void *data){
+        for (int i=0; i<g->n_hooks; i++){
+                if (g->hooks[i] == hook && g->hook_data[i] == data){
+                        memmove(g->hooks+i, g->hooks+i+1, (g->n_hooks-i-1)*sizeof(graph_hook));
+                        memmove(g->hook_data+i, g->hook_data+i+1,
+                                (g->n_hooks-i-1)*sizeof(void*));
+                        g->n_hooks--;
                         return;
                 }
         }
+}
+
+edge *graph_find_edge(const graph *g, graph_index v1, graph_index v2){
+        vertex *v = g->vertices[v1];
+        if (v1 == v2){
+                return NULL;
+        }
+        if (!v->lookup){
+                return vertex_find_connecting_edge(v, v2);
+        }
+        graph_index slot = v->lookup[lookup_probe(g, v1, v2)];
+        return slot < 0 ? NULL : v->edges[slot];
+}
+
+graph_index graph_edge_id(const graph *g, graph_index index){
+        return g->ids ? g->ids[index] : index;
+}
+
+edge *graph_edge_by_id(const graph *g, graph_index id){
+        if (id < 0){
+                return NULL;
+        }
+        if (!g->ids){
+                return id < g->m ? g->edges[id] : NULL;
+        }
+        if (id >= g->n_ids || g->id_positions[id] < 0){
+                return NULL;
+        }
+        return g->edges[g->id_positions[id]];
+}
+
+graph_index graph_add_edge(graph *g, graph_index v1, graph_index v2, int weight){
+        /* check that the vertices are possible for the graph */
+        assert(v1 < g->n);
+        assert(v2 < g->n);
+        /* self-edges cannot be represented */
+        assert(v1 != v2);
+
+        /* check that the connection does not exist */
+        if (graph_find_edge(g, v1, v2)){
+                return -1;
+        }
 
         /* update g->m only at the end and use that it contains the old value */
-        g->edges = realloc(g->edges, (g->m+1) * sizeof(edge*));
-        edge *new_edge = edge_new(v1, v2, weight);
-        g->edges[g->m] = new_edge;
+        if (g->m == g->capacity){
+                grow_edges(g);
+        }
+        graph_index k = g->m;
+        g->edge_pool[k] = (edge){.v1=v1, .v2=v2, .weight=weight};
+        g->edges[k] = g->edge_pool + k;
+        graph_index id = k;
+        if (g->ids){
+                /* reuse the most recently freed id */
+                id = g->n_free_ids ? g->free_ids[--g->n_free_ids] : g->n_ids++;
+                g->ids[k] = id;
+                g->id_positions[id] = k;
+        }
 
-        vertex_add_edge_to_neighbourhood(g->vertices[v1], new_edge);
-        vertex_add_edge_to_neighbourhood(g->vertices[v2], new_edge);
+        attach_edge(g, v1, k);
+        attach_edge(g, v2, k);
         g->m++;
+        notify(g, &(graph_change){.kind=GRAPH_EDGE_ADDED, .edge=g->edge_pool[k],
+                                  .id=id, .index=k, .from=k});
+        return id;
 }
 
-void graph_rm_edge(graph *g, int v1, int v2){
+void graph_rm_edge(graph *g, graph_index v1, graph_index v2){
         /* check that the vertices are possible for the graph */
-        g_assert(v1 < g->n);
-        g_assert(v2 < g->n);
+        assert(v1 < g->n);
+        assert(v2 < g->n);
 
-        /**
-         * Since we need the correct memory location we cannot just create a
-         * new edge instance, but need to loop through the edges and find the
-         * actual edge.
-         **/
-        edge *connecting_edge = vertex_find_connecting_edge(g->vertices[v1], v2); 
-        if (connecting_edge){
-                /* only if the connecting edge is not NULL */
-                vertex_rm_edge_from_neighbourhood(g->vertices[v1], connecting_edge);
-                vertex_rm_edge_from_neighbourhood(g->vertices[v2], connecting_edge);
-                free(connecting_edge);
-                g->m--;
+        edge *connecting_edge = graph_find_edge(g, v1, v2);
+        if (!connecting_edge){
+                return;
+        }
+        if (!g->slots){
+                track_topology(g);
+        }
+        graph_index k = connecting_edge - g->edge_pool;
+        graph_change removed = {.kind=GRAPH_EDGE_REMOVED, .edge=*connecting_edge,
+                                .id=g->ids[k], .index=k, .from=k};
+        detach_edge(g, removed.edge.v1, k);
+        detach_edge(g, removed.edge.v2, k);
+        g->id_positions[removed.id] = -1;
+        g->free_ids[g->n_free_ids++] = removed.id;
+
+        /* keep the pool contiguous by moving the last edge into the hole,
+         * its slots say where the adjacency arrays point to it */
+        graph_index last = g->m-1;
+        g->m--;
+        if (k != last){
+                edge *moved = g->edge_pool + last;
+                g->edge_pool[k] = *moved;
+                g->vertices[moved->v1]->edges[g->slots[2*last]] = g->edge_pool + k;
+                g->vertices[moved->v2]->edges[g->slots[2*last+1]] = g->edge_pool + k;
+                g->slots[2*k] = g->slots[2*last];
+                g->slots[2*k+1] = g->slots[2*last+1];
+                g->ids[k] = g->ids[last];
+                g->id_positions[g->ids[k]] = k;
+        }
+        notify(g, &removed);
+        if (k != last){
+                notify(g, &(graph_change){.kind=GRAPH_EDGE_MOVED, .edge=g->edge_pool[k],
+                                          .id=g->ids[k], .index=k, .from=last});
         }
 }
 
-/* write a pow function for integers since the math.h pow uses exp(log(x))
- * which is not the most precise way of calculating it for integers. */
-int static int_pow(int base, int exponent){
-        int result = 1;
-        while (exponent){
-                if (exponent & 1){
-                        result *= base;
+graph *graph_read_edge_list(FILE *in, int init_weight){
+        /* read all pairs first since the number of vertices is only known at
+         * the end */
+        long capacity = 1024;
+        long count = 0;
+        graph_index *pairs = malloc(2*capacity*sizeof(graph_index));
+        double *weights = malloc(capacity*sizeof(double));
+        graph_index max_index = -1;
+
+        char *line = NULL;
+        size_t line_size = 0;
+        while (getline(&line, &line_size, in) != -1){
+                char *comment = strchr(line, '#');
+                if (comment){
+                        *comment = '\0';
+                }
+                graph_index v1, v2;
+                double weight = init_weight;
+                char rest;
+                int matched = sscanf(line, " %" SCNgi " %" SCNgi " %lf %c", &v1, &v2,
+                                     &weight, &rest);
+                if (matched == EOF){
+                        continue; /* empty or comment line */
+                }
+                if (matched < 2 || matched > 3 || v1 < 0 || v2 < 0){
+                        free(line);
+                        free(pairs);
+                        free(weights);
+                        return NULL;
                 }
-                exponent /= 2;
-                base *= base;
+                if (count == capacity){
+                        capacity *= 2;
+                        pairs = realloc(pairs, 2*capacity*sizeof(graph_index));
+                        weights = realloc(weights, capacity*sizeof(double));
+                }
+                pairs[2*count] = v1;
+                pairs[2*count+1] = v2;
+                weights[count] = weight;
+                count++;
+                max_index = v1 > max_index ? v1 : max_index;
+                max_index = v2 > max_index ? v2 : max_index;
         }
-        return result;
-}
+        free(line);
 
-graph *graph_construct_torus(int n, int d, int init_weight){
-        g_assert(n>2); /* if n=2 then you get connections like - 0 - 1 - which
-                         is a double edge so no periodic boundary conditions are possible
-                       */
         graph *out = graph_new();
-        int vertex_count = int_pow(n, d);
-        graph_add_n_vertices(out, vertex_count);
-
-        for (int i=0; i<vertex_count; i++){
-                for (int j=0; j<d; j++){
-                        /* the offset ensures that we dont modulo down to the
-                         * first cases all the time but only close the
-                         * boundaries */
-                        int offset = i - (i % int_pow(n,j+1));
-                        /* connect it to  the next vertex in the next
-                         * dimensions, i.e. in 2 dimensions the lower one and
-                         * the right one take care of the periodic boundary conditions. */
-                        int connect_to = (i + (int_pow(n,j))) % int_pow(n,j+1) + offset; 
-                        graph_add_edge(out, i, connect_to, init_weight);
+        graph_add_n_vertices(out, max_index+1);
+        for (long i=0; i<count; i++){
+                /* self-edges cannot be represented, duplicates are ignored by
+                 * graph_add_edge */
+                if (pairs[2*i] != pairs[2*i+1] &&
+                    graph_add_edge(out, pairs[2*i], pairs[2*i+1], init_weight) >= 0){
+                        /* the weights of the file may not be integers */
+                        edge *e = out->edges[out->m-1];
+                        out->vertices[e->v1]->local_weight += weights[i] - init_weight;
+                        out->vertices[e->v2]->local_weight += weights[i] - init_weight;
+                        e->weight = weights[i];
                 }
         }
+        free(pairs);
+        free(weights);
         return out;
 }
 
-/* This macro ensures that the string that was extended is freed and returns an
- * extended string. The inputs are the previous string as previous_str and
- * variable amounts of printf-like arguments
- * NOTE: main_string_containing_percents has to contain %s (basically where to
- * insert the original string, for usual concatenation put at beginning, has to
- * be the first % argument in any case).
- * NOTE: Use ##__VAR_ARGS__ to not include the comma if there are no
- * __VA_ARGS__ given, see gcc docs on variadic macros.*/
-#define ConcatStr(previous_str, main_string_containing_percents, ...){                                  \
-        char *tmp=previous_str;                                                                         \
-        if (asprintf(&previous_str, main_string_containing_percents, previous_str, ##__VA_ARGS__)<0){   \
-                perror("Could not concatenate strings, run again with gdb or report bug.");             \
-                abort();                                                                                \
-        }                                                                                               \
-        free(tmp);                                                                                      \
-}
-
-/* get a png file as string stream */
-void draw_torus2png(graph *draw_torus, int n, int d, unsigned int duration,
-					FILE *out_stream, int max_width, int max_height, int max_dpi,
-					int penwidth, double passed_time){
-        /* only d==2 printing case has been handled */
-        g_assert(d==2);
-
-        /* if no output file has been specified, take stdout */
-        if (out_stream == NULL){
-                out_stream = stdout;
-        }
-        /* calculate the max weight first */
-        double max_weight=0;
-        for (int i=0; i<draw_torus->m; i++){
-                max_weight = fmax(max_weight, draw_torus->edges[i]->weight);
-        }
-        char *graph_gv_str; // need to initialize for ConcatStr not to segfault
-
-        if (asprintf(&graph_gv_str, "graph {\n") < 0){
-                perror("Could not allocate string 'graph {\n' to graph_gv_str, check with gdb or report bug.");
-                abort();
-        }
-        ConcatStr(graph_gv_str, "%ssize=\"%i,%i\";\ndpi=%i;\n",
-                  max_width, max_height, max_dpi);
-        ConcatStr(graph_gv_str, "%snode [shape=point, style=dot, width=.1, height=.1];\n");
-        ConcatStr(graph_gv_str, "%srankdir=LR;\n");
-        /* find all the horizontal vertices that are invisible and serve as
-         * docking points for edges to 'loop' around to the other end (i.e.
-         * open edges) */
-        for (int i=0; i<n; i++){
-                ConcatStr(graph_gv_str, "%sH%i [style=invis];\n", n*i); /* analogously for horizontal connections */
-                ConcatStr(graph_gv_str, "%sH%i [style=invis];\n", n*i+(n-1));
-        }
-
-        for (int i=0; i<n; i++){
-                ConcatStr(graph_gv_str, "%sV%i [style=invis];\n", i); /* first line needs vertical connections to the top */
-                ConcatStr(graph_gv_str, "%sV%i [style=invis];\n", i+int_pow(n, d)-n); /* and last line */
-        }
-
-        /* Do the horizontal connections */ 
-        for (int i=0; i < n; i++){
-
-                edge *looping_edge = vertex_find_connecting_edge(draw_torus->vertices[n*i], n*i+n-1);
-                double looping_weight_ratio=penwidth*looping_edge->weight/passed_time;
-                ConcatStr(graph_gv_str, "%sH%i -- %i[penwidth=%f];\n", n*i, n*i, looping_weight_ratio);
-
-                for (int j=1; j < n; j++){
-                        int cur_vertex_index = n*i+j;
-
-                        edge *connecting_edge = vertex_find_connecting_edge(draw_torus->vertices[cur_vertex_index-1],
-                                                                           cur_vertex_index);
-                        double weight_ratio = penwidth*connecting_edge->weight/passed_time;
-
-                        ConcatStr(graph_gv_str, "%s%i -- %i[penwidth=%f];\n", cur_vertex_index-1, cur_vertex_index, weight_ratio);
+/* order edges by their smaller and then their larger vertex index, used with
+ * qsort in graph_relabel */
+int static edge_cmp(const void *a, const void *b){
+        const edge *e1 = a;
+        const edge *e2 = b;
+        graph_index min1 = e1->v1 < e1->v2 ? e1->v1 : e1->v2;
+        graph_index min2 = e2->v1 < e2->v2 ? e2->v1 : e2->v2;
+        if (min1 != min2){
+                return min1 < min2 ? -1 : 1;
+        }
+        graph_index max1 = e1->v1 < e1->v2 ? e1->v2 : e1->v1;
+        graph_index max2 = e2->v1 < e2->v2 ? e2->v2 : e2->v1;
+        return (max1 > max2) - (max1 < max2);
+}
+
+void graph_relabel(graph *g, const graph_index *order){
+        /* inverse permutation: new index of every current vertex */
+        graph_index *new_index = malloc(g->n*sizeof(graph_index));
+        for (graph_index i=0; i<g->n; i++){
+                new_index[order[i]] = i;
+        }
+
+        /* copy the edges with the new indices into a new pool */
+        edge *new_pool = malloc((g->capacity > 1 ? g->capacity : 1)*sizeof(edge));
+        for (graph_index k=0; k<g->m; k++){
+                edge *e = g->edges[k];
+                new_pool[k] = (edge){.v1=new_index[e->v1], .v2=new_index[e->v2],
+                                     .weight=e->weight};
+        }
+        qsort(new_pool, g->m, sizeof(edge), edge_cmp);
+
+        /* allocate the vertices in the new order and fill their adjacency
+         * arrays in the order of the sorted edges */
+        vertex **new_vertices = malloc(g->n*sizeof(vertex*));
+        for (graph_index i=0; i<g->n; i++){
+                vertex *old = g->vertices[order[i]];
+                new_vertices[i] = vertex_new();
+                new_vertices[i]->local_weight = old->local_weight;
+                new_vertices[i]->edges = malloc(old->dim*sizeof(edge*));
+                new_vertices[i]->capacity = old->dim;
+        }
+        for (graph_index k=0; k<g->m; k++){
+                vertex *v1 = new_vertices[new_pool[k].v1];
+                vertex *v2 = new_vertices[new_pool[k].v2];
+                v1->edges[v1->dim++] = new_pool + k;
+                v2->edges[v2->dim++] = new_pool + k;
+                g->edges[k] = new_pool + k;
+        }
+
+        /* free the old structure */
+        for (graph_index i=0; i<g->n; i++){
+                free(g->vertices[i]->edges);
+                free(g->vertices[i]->lookup);
+                free(g->vertices[i]);
+        }
+        free(g->vertices);
+        free(g->edge_pool);
+        g->vertices = new_vertices;
+        g->edge_pool = new_pool;
+        /* the neighbours got new indices and the edges new positions */
+        for (graph_index i=0; i<g->n; i++){
+                if (g->vertices[i]->dim >= GRAPH_LOOKUP_DEGREE){
+                        lookup_build(g, i);
                 }
-                ConcatStr(graph_gv_str, "%s%i -- H%i[penwidth=%f];\n", n*i+n-1, n*i+n-1, looping_weight_ratio);
         }
+        untrack_topology(g);
+
+        /* compose the labels with the previous relabellings */
+        graph_index *labels = malloc(g->n*sizeof(graph_index));
+        for (graph_index i=0; i<g->n; i++){
+                labels[i] = graph_original_index(g, order[i]);
+        }
+        free(g->labels);
+        g->labels = labels;
+        if (!g->positions){
+                g->positions = malloc(g->n*sizeof(graph_index));
+        }
+        for (graph_index i=0; i<g->n; i++){
+                g->positions[labels[i]] = i;
+        }
+        free(new_index);
+}
 
-        /* Now do the vertical connections and define their ranks as same */ 
-        for (int i=0; i < n; i++){
-                char *same_rank;
-                if (asprintf(&same_rank, "V%i, %i", i, i)<0){
-                        perror("Could not allocate with asprintf to initialize string same_rank, check with gdb or report bug.");
-                        abort();
+/* an edge of a vertex with the key of its other end, see graph_sort_edges */
+typedef struct keyed_edge {
+        graph_index key;
+        edge *e;
+} keyed_edge;
+
+int static keyed_edge_cmp(const void *a, const void *b){
+        graph_index x = ((const keyed_edge*) a)->key;
+        graph_index y = ((const keyed_edge*) b)->key;
+        return (x > y) - (x < y);
+}
+
+void graph_sort_edges(graph *g, const graph_index *keys){
+        graph_index max_dim = 0;
+        for (graph_index i=0; i<g->n; i++){
+                if (g->vertices[i]->dim > max_dim){
+                        max_dim = g->vertices[i]->dim;
+                }
+        }
+        keyed_edge *sorted = malloc((max_dim > 1 ? max_dim : 1)*sizeof(keyed_edge));
+        for (graph_index i=0; i<g->n; i++){
+                vertex *v = g->vertices[i];
+                for (graph_index j=0; j<v->dim; j++){
+                        graph_index other = other_end(v->edges[j], i);
+                        sorted[j] = (keyed_edge){.key=keys ? keys[other]
+                                                           : graph_original_index(g, other),
+                                                 .e=v->edges[j]};
+                }
+                qsort(sorted, v->dim, sizeof(keyed_edge), keyed_edge_cmp);
+                for (graph_index j=0; j<v->dim; j++){
+                        v->edges[j] = sorted[j].e;
+                        if (g->slots){
+                                *edge_slot(g, sorted[j].e - g->edge_pool, i) = j;
+                        }
+                }
+                /* the lookup stores slots */
+                if (v->lookup){
+                        lookup_build(g, i);
                 }
-                
-                
-                edge *looping_edge = vertex_find_connecting_edge(draw_torus->vertices[i], i+n*(n-1));
-                double looping_weight_ratio=penwidth*looping_edge->weight/passed_time;
-                ConcatStr(graph_gv_str, "%sV%i -- %i[penwidth=%f];\n", i, i, looping_weight_ratio);
+        }
+        free(sorted);
+}
+
+graph_index graph_original_index(const graph *g, graph_index i){
+        return g->labels ? g->labels[i] : i;
+}
 
-                for (int j=1; j < n; j++){
-                        int prev_vertex_index=i+n*(j-1);
-                        int cur_vertex_index=i+n*j;
+graph_index graph_current_index(const graph *g, graph_index original){
+        return g->positions ? g->positions[original] : original;
+}
+
+/* write a pow function for integers since the math.h pow uses exp(log(x))
+ * which is not the most precise way of calculating it for integers. Returns 0
+ * if the result does not fit into a graph_index. */
+graph_index static int_pow(graph_index base, graph_index exponent){
+        graph_index result = 1;
+        for (graph_index i=0; i<exponent; i++){
+                if (result > GRAPH_INDEX_MAX/base){
+                        return 0;
+                }
+                result *= base;
+        }
+        return result;
+}
 
-                        edge *connecting_edge = vertex_find_connecting_edge(draw_torus->vertices[prev_vertex_index],
-                                                                           cur_vertex_index);
+int graph_torus_fits(graph_index n, graph_index d){
+        if (n < 1 || d < 1){
+                return 0;
+        }
+        graph_index vertex_count = int_pow(n, d);
+        return vertex_count && vertex_count <= GRAPH_INDEX_MAX/d;
+}
 
-                        double weight_ratio = penwidth*connecting_edge->weight/passed_time;
+/*
+ * The torus is built in closed form instead of with graph_add_edge, giving
+ * the same graph: vertex i gets the edges i*d+j (j<d) to its successor in
+ * dimension j, and since graph_add_edge appends to the adjacency arrays, the
+ * adjacency array of a vertex lists its 2d edges (d to its successors, d
+ * from its predecessors) by increasing index. So every vertex and its
+ * edges only depend on its coordinates, and the vertices are filled in
+ * parallel, every thread writing (and hence first touching) its own range.
+ */
+graph *graph_construct_torus(graph_index n, graph_index d, int init_weight){
+        assert(n>2); /* if n=2 then you get connections like - 0 - 1 - which
+                         is a double edge so no periodic boundary conditions are possible
+                       */
+        /* checked in every build, the sizes below would silently wrap */
+        if (!graph_torus_fits(n, d)){
+                return NULL;
+        }
+        graph_index vertex_count = int_pow(n, d);
+        graph_index edge_count = vertex_count*d;
+        /* strides[j] = n^j */
+        graph_index *strides = malloc((d+1)*sizeof(graph_index));
+        for (graph_index j=0; j<=d; j++){
+                strides[j] = int_pow(n, j);
+        }
 
-                        ConcatStr(graph_gv_str, "%s%i -- %i[penwidth=%f];\n", prev_vertex_index, cur_vertex_index, weight_ratio);
-                        ConcatStr(same_rank, "%s, %i", cur_vertex_index);
+        graph *out = graph_new();
+        out->n = vertex_count;
+        out->m = edge_count;
+        out->capacity = edge_count;
+        out->vertices = malloc(vertex_count*sizeof(vertex*));
+        out->edge_pool = malloc(edge_count*sizeof(edge));
+        out->edges = malloc(edge_count*sizeof(edge*));
+
+        #pragma omp parallel for schedule(static)
+        for (graph_index i=0; i<vertex_count; i++){
+                graph_index adjacent[2*d];
+                for (graph_index j=0; j<d; j++){
+                        /* the coordinate in dimension j decides whether the
+                         * neighbours wrap around the boundary */
+                        graph_index coordinate = (i / strides[j]) % n;
+                        graph_index next = coordinate == n-1 ? i - (n-1)*strides[j]
+                                                             : i + strides[j];
+                        graph_index previous = coordinate == 0 ? i + (n-1)*strides[j]
+                                                               : i - strides[j];
+                        out->edge_pool[i*d+j] = (edge){.v1=i, .v2=next, .weight=init_weight};
+                        out->edges[i*d+j] = out->edge_pool + i*d+j;
+                        adjacent[j] = i*d+j;
+                        adjacent[d+j] = previous*d+j;
+                }
+                /* insertion sort of the 2d edge indices */
+                for (graph_index k=1; k<2*d; k++){
+                        graph_index cur = adjacent[k];
+                        graph_index l = k;
+                        for (; l>0 && adjacent[l-1] > cur; l--){
+                                adjacent[l] = adjacent[l-1];
+                        }
+                        adjacent[l] = cur;
+                }
+                vertex *v = vertex_new();
+                v->dim = 2*d;
+                v->capacity = 2*d;
+                v->local_weight = 2*d*init_weight;
+                v->edges = malloc(2*d*sizeof(edge*));
+                for (graph_index k=0; k<2*d; k++){
+                        v->edges[k] = out->edge_pool + adjacent[k];
                 }
-                ConcatStr(graph_gv_str, "%s%i -- V%i[penwidth=%f];\n", i+n*(n-1), i+n*(n-1), looping_weight_ratio);
-                ConcatStr(same_rank, "%s, %i, V%i", i+n*(n-1), i+n*(n-1));
-                ConcatStr(graph_gv_str, "%s{ rank=same; %s};\n", same_rank);
-                free(same_rank);
-        }
-        ConcatStr(graph_gv_str, "%s}");
-        
-        /** BEGIN GRAPHVIZ CONVERSION **/
-        Agraph_t *g = agmemread(graph_gv_str); /* read the graph from memory */
-        GVC_t *gvc = gvContext();
-
-        gvLayout(gvc, g, "dot"); /* layout the gv file using dot */
-
-        for (int i=0; i<duration; i++){
-                gvRender(gvc, g, "png", out_stream); /* and convert it to png */
-        }
-        free(graph_gv_str);
-        gvFreeLayout(gvc, g);
-        agclose(g);
-        gvFreeContext(gvc);
+                out->vertices[i] = v;
+        }
+        /* the lookups read the edges of the neighbours, so only once all
+         * vertices are filled */
+        if (2*d >= GRAPH_LOOKUP_DEGREE){
+                #pragma omp parallel for schedule(static)
+                for (graph_index i=0; i<vertex_count; i++){
+                        lookup_build(out, i);
+                }
+        }
+        free(strides);
+        return out;
 }
@@ -96,8 +96,8 @@ void test_remove_edge(struct vfixture *vf, gconstpointer ignored){
         g_assert_false(vf->v->edges[0] == vf->e1); /* vf->v->edges[0] should be invalid */
 }
 
-/** \brief The large case needed to executed the insides of the for-loop in
- * rm_i_th_edge. (see \ref vertex_rm_edge_from_neighbourhood) */
+/** \brief The large case where the last edge moves into the hole (see \ref
+ * vertex_rm_edge_from_neighbourhood). */
 void test_remove_edge_large(struct vfixture *vf, gconstpointer ignored){
         /* add_edge has been tested above, so can safely be used */
         vertex_add_edge_to_neighbourhood(vf->v, vf->e2);
@@ -2,8 +2,10 @@
  * \brief Glib testing based test code for \ref weightedgraph.h.*/
 
 #include <glib.h>
+#include <stdlib.h>
 
 #include "weightedgraph.h"
+#include "ordering.h"
 
 /** \brief Fixture around the \ref graph struct. */
 struct gfixture{
@@ -111,6 +113,23 @@ void test_remove_invalid_edge(struct gfixture *gf, gconstpointer ignored){
         g_assert_cmpint(gf->g->edges[0]->weight, ==, 1);
 }
 
+/** \brief Test that removing an edge moves the last edge into its place in
+ * the pool and keeps the adjacency arrays pointing to the pool. */
+void test_remove_moves_last_edge(struct gfixture *gf, gconstpointer ignored){
+        graph_add_edge(gf->g, 0, 1, 1);
+        graph_add_edge(gf->g, 3, 4, 5);
+        graph_rm_edge(gf->g, 0, 1);
+
+        g_assert_cmpint(gf->g->m, ==, 2);
+        g_assert_true(gf->g->edges[0] == gf->g->edge_pool);
+        g_assert_true(gf->g->edges[1] == gf->g->edge_pool+1);
+        g_assert_cmpint(gf->g->edges[0]->v1, ==, 2);
+        g_assert_cmpint(gf->g->edges[1]->v1, ==, 3);
+        g_assert_true(vertex_find_connecting_edge(gf->g->vertices[4], 3) == gf->g->edges[1]);
+        g_assert_cmpint(gf->g->vertices[0]->dim, ==, 0);
+        g_assert_cmpint(gf->g->vertices[1]->dim, ==, 0);
+}
+
 /** \brief Assert that invalid v1 to \ref graph_rm_edge fails. */
 void test_rm_invalid_v1_vertex_edge(struct gfixture *gf, gconstpointer ignored){
         /* try removing an edge where v1 is larger than the amount of vertices */
@@ -215,6 +234,406 @@ void test_graph_construct_torus(struct gfixture *gf, gconstpointer ignored){
         g_assert_true(vertex_find_connecting_edge(gf->g->vertices[8], 7));
 }
 
+/** \brief Check that the closed form construction gives exactly the graph of
+ * adding the edges one by one with graph_add_edge (the original
+ * construction), i.e. the same edge order and adjacency arrays. */
+void test_graph_construct_torus_serial(struct gfixture *gf, gconstpointer ignored){
+        int sizes[][2] = {{3, 1}, {3, 2}, {4, 2}, {5, 3}, {3, 4}, {7, 2}};
+        for (int k=0; k<6; k++){
+                int n = sizes[k][0], d = sizes[k][1];
+                graph *fast = graph_construct_torus(n, d, 2);
+
+                graph *serial = graph_new();
+                graph_index count = 1;
+                for (int j=0; j<d; j++){
+                        count *= n;
+                }
+                graph_add_n_vertices(serial, count);
+                for (graph_index i=0; i<count; i++){
+                        graph_index stride = 1;
+                        for (int j=0; j<d; j++){
+                                graph_index offset = i - (i % (stride*n));
+                                graph_add_edge(serial, i, (i + stride) % (stride*n) + offset, 2);
+                                stride *= n;
+                        }
+                }
+
+                g_assert_cmpint(fast->n, ==, serial->n);
+                g_assert_cmpint(fast->m, ==, serial->m);
+                for (graph_index i=0; i<fast->m; i++){
+                        g_assert_cmpint(fast->edges[i]->v1, ==, serial->edges[i]->v1);
+                        g_assert_cmpint(fast->edges[i]->v2, ==, serial->edges[i]->v2);
+                        g_assert_cmpfloat(fast->edges[i]->weight, ==, serial->edges[i]->weight);
+                        g_assert_true(fast->edges[i] == fast->edge_pool + i);
+                }
+                for (graph_index i=0; i<fast->n; i++){
+                        vertex *a = fast->vertices[i];
+                        vertex *b = serial->vertices[i];
+                        g_assert_cmpint(a->dim, ==, b->dim);
+                        g_assert_cmpfloat(a->local_weight, ==, b->local_weight);
+                        for (graph_index j=0; j<a->dim; j++){
+                                g_assert_cmpint(a->edges[j] - fast->edge_pool, ==,
+                                                b->edges[j] - serial->edge_pool);
+                        }
+                }
+                graph_free(fast);
+                graph_free(serial);
+        }
+}
+
+/** \brief Check that tori whose edges do not fit into a graph_index are
+ * refused in every build instead of wrapping around. */
+void test_graph_construct_torus_overflow(struct gfixture *gf, gconstpointer ignored){
+        g_assert_true(graph_torus_fits(800, 3));
+        g_assert_false(graph_torus_fits(0, 2));
+        g_assert_false(graph_torus_fits(3, 0));
+#ifdef GRAPH_INDEX_64
+        g_assert_false(graph_torus_fits(3037000500, 2));
+        g_assert_null(graph_construct_torus(3037000500, 2, 1));
+#else
+        g_assert_false(graph_torus_fits(1300, 3));
+        g_assert_null(graph_construct_torus(1300, 3, 1));
+        /* the 1000^3 vertices fit, their 3*1000^3 edges do not */
+        g_assert_false(graph_torus_fits(1000, 3));
+        g_assert_null(graph_construct_torus(1000, 3, 1));
+#endif
+}
+
+/** \brief Relabel a 3x3 torus with distinct weights in reverse order and check
+ * that the structure is preserved under the original indices. */
+void test_graph_relabel(struct gfixture *gf, gconstpointer ignored){
+        free(gf->g);
+        gf->g = graph_construct_torus(3, 2, 1);
+        /* remember the weight of every edge by its original vertices */
+        int weights[9][9] = {{0}};
+        for (int i=0; i<gf->g->m; i++){
+                edge *e = gf->g->edges[i];
+                e->weight = i+1;
+                weights[e->v1][e->v2] = weights[e->v2][e->v1] = i+1;
+        }
+
+        graph_index order[9] = {8, 7, 6, 5, 4, 3, 2, 1, 0};
+        graph_relabel(gf->g, order);
+        g_assert_cmpint(gf->g->n, ==, 9);
+        g_assert_cmpint(gf->g->m, ==, 18);
+
+        for (int i=0; i<9; i++){
+                g_assert_cmpint(graph_original_index(gf->g, i), ==, 8-i);
+                g_assert_cmpint(graph_current_index(gf->g, 8-i), ==, i);
+                g_assert_cmpint(gf->g->vertices[i]->dim, ==, 4);
+        }
+        for (int a=0; a<9; a++){
+                for (int b=0; b<9; b++){
+                        if (a == b){
+                                continue;
+                        }
+                        edge *e = vertex_find_connecting_edge(gf->g->vertices[graph_current_index(gf->g, a)],
+                                                              graph_current_index(gf->g, b));
+                        if (weights[a][b]){
+                                g_assert_true(e);
+                                g_assert_cmpint(e->weight, ==, weights[a][b]);
+                        }
+                        else {
+                                g_assert_false(e);
+                        }
+                }
+        }
+        /* the edges are sorted by their smaller vertex */
+        for (int i=1; i<gf->g->m; i++){
+                edge *prev = gf->g->edges[i-1];
+                edge *cur = gf->g->edges[i];
+                g_assert_cmpint(MIN(prev->v1, prev->v2), <=, MIN(cur->v1, cur->v2));
+        }
+
+        /* relabelling again composes the labels */
+        graph_relabel(gf->g, order);
+        for (int i=0; i<9; i++){
+                g_assert_cmpint(graph_original_index(gf->g, i), ==, i);
+        }
+}
+
+/** \brief Check that o is a permutation of 0, ..., size-1. */
+/** \brief Sort the adjacency of the centre of a star (with a lookup and
+ * tracked slots) by the original indices and by reversed keys, after which
+ * the lookup finds the edges and removals still move the right edges. */
+void test_graph_sort_edges(struct gfixture *gf, gconstpointer ignored){
+        graph_add_n_vertices(gf->g, 21);
+        for (graph_index i=20; i>0; i--){
+                graph_add_edge(gf->g, 0, i, i);
+        }
+        graph_rm_edge(gf->g, 0, 20);
+        graph_add_edge(gf->g, 20, 0, 20);
+
+        graph_sort_edges(gf->g, NULL);
+        vertex *centre = gf->g->vertices[0];
+        for (graph_index j=0; j<centre->dim; j++){
+                g_assert_cmpint(centre->edges[j]->weight, ==, j+1);
+        }
+        graph_index keys[21];
+        for (graph_index i=0; i<21; i++){
+                keys[i] = 21-i;
+        }
+        graph_sort_edges(gf->g, keys);
+        for (graph_index j=0; j<centre->dim; j++){
+                g_assert_cmpint(centre->edges[j]->weight, ==, 20-j);
+        }
+        for (graph_index i=1; i<=20; i++){
+                g_assert_cmpint(graph_find_edge(gf->g, 0, i)->weight, ==, i);
+        }
+        graph_rm_edge(gf->g, 0, 20);
+        graph_rm_edge(gf->g, 7, 0);
+        g_assert_cmpint(centre->dim, ==, 18);
+        for (graph_index i=1; i<20; i++){
+                edge *e = graph_find_edge(gf->g, 0, i);
+                if (i == 7){
+                        g_assert_null(e);
+                }
+                else {
+                        g_assert_cmpint(e->weight, ==, i);
+                }
+        }
+}
+
+void static assert_permutation(graph_index *o, int size){
+        char *seen = calloc(size, 1);
+        for (int i=0; i<size; i++){
+                g_assert_cmpint(o[i], >=, 0);
+                g_assert_cmpint(o[i], <, size);
+                g_assert_false(seen[o[i]]);
+                seen[o[i]] = 1;
+        }
+        free(seen);
+}
+
+/** \brief Test the morton order on a 4x4 torus and that it gives permutations
+ * for other sizes. */
+void test_morton_order(struct gfixture *gf, gconstpointer ignored){
+        graph_index *o = torus_morton_order(4, 2);
+        int expected[8] = {0, 1, 4, 5, 2, 3, 6, 7};
+        for (int i=0; i<8; i++){
+                g_assert_cmpint(o[i], ==, expected[i]);
+        }
+        free(o);
+
+        o = torus_morton_order(5, 3);
+        assert_permutation(o, 125);
+        free(o);
+}
+
+/** \brief Check that consecutive vertices of the hilbert order on tori of side
+ * length a power of two are lattice neighbours (without wrapping). */
+void test_hilbert_order(struct gfixture *gf, gconstpointer ignored){
+        int sizes[3][2] = {{8, 2}, {4, 3}, {2, 4}};
+        for (int s=0; s<3; s++){
+                int n = sizes[s][0];
+                int d = sizes[s][1];
+                int count = 1;
+                for (int j=0; j<d; j++){
+                        count *= n;
+                }
+                graph_index *o = torus_hilbert_order(n, d);
+                assert_permutation(o, count);
+                for (int i=1; i<count; i++){
+                        int distance = 0;
+                        int a = o[i-1];
+                        int b = o[i];
+                        for (int j=0; j<d; j++){
+                                distance += abs(a % n - b % n);
+                                a /= n;
+                                b /= n;
+                        }
+                        g_assert_cmpint(distance, ==, 1);
+                }
+                free(o);
+        }
+
+}
+
+/** \brief Check that the reverse Cuthill-McKee order is a permutation and
+ * reduces the bandwidth of a torus. */
+void test_rcm_order(struct gfixture *gf, gconstpointer ignored){
+        free(gf->g);
+        gf->g = graph_construct_torus(6, 3, 1);
+        graph_index *o = graph_rcm_order(gf->g);
+        assert_permutation(o, gf->g->n);
+
+        int before = 0;
+        for (int i=0; i<gf->g->m; i++){
+                before = MAX(before, abs(gf->g->edges[i]->v1 - gf->g->edges[i]->v2));
+        }
+        graph_relabel(gf->g, o);
+        free(o);
+        int after = 0;
+        for (int i=0; i<gf->g->m; i++){
+                after = MAX(after, abs(gf->g->edges[i]->v1 - gf->g->edges[i]->v2));
+        }
+        g_assert_cmpint(after, <, before);
+}
+
+/** \brief Check reading an edge list with comments, a repeated edge and a
+ * self-edge as well as the rejection of a malformed line. */
+void test_read_edge_list(struct gfixture *gf, gconstpointer ignored){
+        free(gf->g);
+        FILE *in = tmpfile();
+        fputs("# a path with a chord\n0 1\n1 2 # comment\n\n  2 4\n1 0\n3 3\n0 2\n", in);
+        rewind(in);
+        gf->g = graph_read_edge_list(in, 2);
+        fclose(in);
+
+        g_assert_nonnull(gf->g);
+        g_assert_cmpint(gf->g->n, ==, 5);
+        g_assert_cmpint(gf->g->m, ==, 4);
+        g_assert_cmpint(gf->g->vertices[0]->dim, ==, 2);
+        g_assert_cmpint(gf->g->vertices[3]->dim, ==, 0);
+        g_assert_nonnull(vertex_find_connecting_edge(gf->g->vertices[4], 2));
+        g_assert_cmpint(gf->g->vertices[1]->local_weight, ==, 4);
+
+        /* weights in a third column */
+        in = tmpfile();
+        fputs("# time 3 events 10\n0 1 2.5\n1 2\n", in);
+        rewind(in);
+        graph *weighted = graph_read_edge_list(in, 1);
+        fclose(in);
+        g_assert_nonnull(weighted);
+        g_assert_cmpfloat(weighted->edges[0]->weight, ==, 2.5);
+        g_assert_cmpfloat(weighted->edges[1]->weight, ==, 1);
+        g_assert_cmpfloat(weighted->vertices[1]->local_weight, ==, 3.5);
+        graph_free(weighted);
+
+        in = tmpfile();
+        fputs("0 1\n1 x\n", in);
+        rewind(in);
+        g_assert_null(graph_read_edge_list(in, 1));
+        fclose(in);
+        in = tmpfile();
+        fputs("0 1 2 3\n", in);
+        rewind(in);
+        g_assert_null(graph_read_edge_list(in, 1));
+        fclose(in);
+}
+
+/** \brief Hook counting the changes of every kind and remembering the last
+ * one. */
+struct change_log {
+        int counts[3]; /**< \brief The number of changes of every kind. */
+        graph_change last; /**< \brief The last change. */
+};
+
+/** \brief The \ref graph_hook filling a change_log. */
+void static log_change(void *data, graph *g, const graph_change *change){
+        struct change_log *log = data;
+        log->counts[change->kind]++;
+        log->last = *change;
+}
+
+/** \brief Check that edges keep their ids while other edges are removed, that
+ * the freed ids are reused and that the hooks see every change. */
+void test_edge_ids(struct gfixture *gf, gconstpointer ignored){
+        struct change_log log = {{0}};
+        graph_add_hook(gf->g, log_change, &log);
+        g_assert_cmpint(graph_add_edge(gf->g, 0, 1, 1), ==, 1);
+        g_assert_cmpint(graph_add_edge(gf->g, 1, 2, 1), ==, 2);
+        g_assert_cmpint(graph_add_edge(gf->g, 1, 2, 1), ==, -1);
+        g_assert_cmpint(log.counts[GRAPH_EDGE_ADDED], ==, 2);
+        g_assert_cmpint(graph_edge_id(gf->g, 2), ==, 2);
+
+        /* edge 0 (2-3) is replaced by the last edge (1-2) */
+        graph_rm_edge(gf->g, 3, 2);
+        g_assert_cmpint(log.counts[GRAPH_EDGE_REMOVED], ==, 1);
+        g_assert_cmpint(log.counts[GRAPH_EDGE_MOVED], ==, 1);
+        g_assert_cmpint(log.last.from, ==, 2);
+        g_assert_cmpint(log.last.index, ==, 0);
+        g_assert_cmpint(log.last.id, ==, 2);
+        g_assert_null(graph_edge_by_id(gf->g, 0));
+        g_assert_true(graph_edge_by_id(gf->g, 2) == gf->g->edges[0]);
+        g_assert_true(graph_edge_by_id(gf->g, 1) == graph_find_edge(gf->g, 1, 0));
+        g_assert_cmpint(graph_edge_id(gf->g, 0), ==, 2);
+
+        /* the freed id comes back */
+        g_assert_cmpint(graph_add_edge(gf->g, 3, 4, 5), ==, 0);
+        g_assert_cmpint(gf->g->n_ids, ==, 3);
+        g_assert_cmpfloat(graph_edge_by_id(gf->g, 0)->weight, ==, 5);
+
+        graph_remove_hook(gf->g, log_change, &log);
+        graph_rm_edge(gf->g, 3, 4);
+        g_assert_cmpint(log.counts[GRAPH_EDGE_REMOVED], ==, 1);
+}
+
+/** \brief Check the slots, lookups, ids and local weights of g against the
+ * adjacency matrix adjacent (n x n, the weight or 0). */
+void static check_topology(graph *g, const double *adjacent){
+        graph_index n = g->n;
+        graph_index m = 0;
+        for (graph_index i=0; i<n; i++){
+                vertex *v = g->vertices[i];
+                double local_weight = 0;
+                graph_index dim = 0;
+                for (graph_index j=0; j<n; j++){
+                        edge *e = graph_find_edge(g, i, j);
+                        g_assert_true((e != NULL) == (adjacent[i*n+j] > 0));
+                        g_assert_true(e == vertex_find_connecting_edge(v, j) || i == j);
+                        if (e){
+                                g_assert_cmpfloat(e->weight, ==, adjacent[i*n+j]);
+                                local_weight += e->weight;
+                                dim++;
+                        }
+                }
+                g_assert_cmpint(v->dim, ==, dim);
+                g_assert_cmpfloat(v->local_weight, ==, local_weight);
+                g_assert_true(v->lookup != NULL || v->dim < GRAPH_LOOKUP_DEGREE);
+                m += dim;
+        }
+        g_assert_cmpint(g->m, ==, m/2);
+        for (graph_index k=0; k<g->m; k++){
+                edge *e = g->edges[k];
+                g_assert_true(e == g->edge_pool + k);
+                g_assert_true(graph_edge_by_id(g, graph_edge_id(g, k)) == e);
+                if (g->slots){
+                        g_assert_true(g->vertices[e->v1]->edges[g->slots[2*k]] == e);
+                        g_assert_true(g->vertices[e->v2]->edges[g->slots[2*k+1]] == e);
+                }
+        }
+}
+
+/** \brief Add and remove random edges of a graph with vertices of large
+ * degree (using their lookups) and compare it with an adjacency matrix. */
+void test_random_topology(struct gfixture *gf, gconstpointer ignored){
+        const graph_index n = 40;
+        double *adjacent = calloc(n*n, sizeof(double));
+        graph_add_n_vertices(gf->g, n);
+        /* a hub connected to everything gets a lookup from the start */
+        for (graph_index j=1; j<n; j++){
+                graph_add_edge(gf->g, 0, j, 1);
+                adjacent[j] = adjacent[j*n] = 1;
+        }
+        check_topology(gf->g, adjacent);
+        unsigned int state = 12345;
+        for (int step=0; step<20000; step++){
+                state = state*1103515245 + 12345;
+                graph_index a = (state >> 8) % n;
+                state = state*1103515245 + 12345;
+                graph_index b = (state >> 8) % n;
+                if (a == b){
+                        continue;
+                }
+                if (adjacent[a*n+b] > 0){
+                        graph_rm_edge(gf->g, a, b);
+                        adjacent[a*n+b] = adjacent[b*n+a] = 0;
+                }
+                else {
+                        int weight = 1 + step % 7;
+                        g_assert_cmpint(graph_add_edge(gf->g, a, b, weight), >=, 0);
+                        adjacent[a*n+b] = adjacent[b*n+a] = weight;
+                }
+                if (step % 1000 == 0){
+                        check_topology(gf->g, adjacent);
+                }
+        }
+        check_topology(gf->g, adjacent);
+        g_assert_cmpint(gf->g->n_ids, <=, n*(n-1)/2);
+        free(adjacent);
+}
+
 /** \brief Add all the tests to the test runner. */
 int main(int argc, char **argv){
         g_test_init(&argc, &argv, NULL);
@@ -227,26 +646,56 @@ int main(int argc, char **argv){
                    graph_setup_w_5_vertices, test_add_new_edge, graph_teardown);
         g_test_add("/graph_add_edge/add existing edge", struct gfixture, NULL,
                    graph_setup_w_5_vertices, test_add_existing_edge, graph_teardown);
+        /* the invalid calls fail on assertions, which --disable-assertions removes */
+#ifndef NDEBUG
         g_test_add("/graph_add_edge/test invalid v1 vertex adding", struct gfixture, NULL,
                    graph_setup_w_5_vertices, test_add_invalid_v1_vertex_edge, graph_teardown);
         g_test_add("/graph_add_edge/test invalid v2 vertex adding", struct gfixture, NULL,
                    graph_setup_w_5_vertices, test_add_invalid_v2_vertex_edge, graph_teardown);
+#endif
 
         /* Tests for graph_rm_edge */
         g_test_add("/graph_rm_edge/remove existing edge", struct gfixture, NULL,
                    graph_setup_w_5_vert_1_edge, test_remove_valid_edge, graph_teardown);
         g_test_add("/graph_rm_edge/remove non-existing edge", struct gfixture, NULL,
                    graph_setup_w_5_vert_1_edge, test_remove_invalid_edge, graph_teardown);
+        g_test_add("/graph_rm_edge/remove moves last edge", struct gfixture, NULL,
+                   graph_setup_w_5_vert_1_edge, test_remove_moves_last_edge, graph_teardown);
+#ifndef NDEBUG
         g_test_add("/graph_rm_edge/remove invalid v1 edge", struct gfixture, NULL,
                    graph_setup_w_5_vert_1_edge, test_rm_invalid_v1_vertex_edge,
                    graph_teardown);
         g_test_add("/graph_rm_edge/remove invalid v2 edge", struct gfixture, NULL,
                    graph_setup_w_5_vert_1_edge, test_rm_invalid_v2_vertex_edge,
                    graph_teardown);
+#endif
+        g_test_add("/graph_rm_edge/stable edge ids and hooks", struct gfixture, NULL,
+                   graph_setup_w_5_vert_1_edge, test_edge_ids, graph_teardown);
+        g_test_add("/graph_rm_edge/random topology changes", struct gfixture, NULL,
+                   graph_setup, test_random_topology, graph_teardown);
 
         /* Test for torus construction */
         g_test_add("/graph_construct_torus/construct 3x3 torus", struct gfixture, NULL,
                    graph_setup, test_graph_construct_torus, graph_teardown);
+        g_test_add("/graph_construct_torus/same as serial construction", struct gfixture, NULL,
+                   graph_setup, test_graph_construct_torus_serial, graph_teardown);
+        g_test_add("/graph_construct_torus/refuse overflow", struct gfixture, NULL,
+                   graph_setup, test_graph_construct_torus_overflow, graph_teardown);
+
+        /* Tests for relabelling and orders */
+        g_test_add("/graph_relabel/relabel 3x3 torus", struct gfixture, NULL,
+                   graph_setup, test_graph_relabel, graph_teardown);
+        g_test_add("/graph_sort_edges/sort star by keys", struct gfixture, NULL,
+                   graph_setup, test_graph_sort_edges, graph_teardown);
+        g_test_add("/ordering/morton", struct gfixture, NULL,
+                   graph_setup, test_morton_order, graph_teardown);
+        g_test_add("/ordering/hilbert", struct gfixture, NULL,
+                   graph_setup, test_hilbert_order, graph_teardown);
+        g_test_add("/ordering/rcm", struct gfixture, NULL,
+                   graph_setup, test_rcm_order, graph_teardown);
+
+        g_test_add("/graph_read_edge_list/read edge list", struct gfixture, NULL,
+                   graph_setup, test_read_edge_list, graph_teardown);
 
         return g_test_run();
 }
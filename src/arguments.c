@@ -0,0 +1,546 @@
+#define _GNU_SOURCE
+
+#include <argp.h>
+#include <stdlib.h>
+#include <string.h> //strcmp
+
+#include "glauber_dynamics.h"
+
+/** begin initial argument parsing code **/
+const char *argp_program_version = "glauber_dynamics 0.9";
+const char *argp_program_bug_address = "yannick.couzinie@uniroma3.it";
+
+/* Program documentation. */
+static char doc[] =
+  "General simulation code which simulates Poisson point process clocks "\
+  "put on vertices which, when ringing, perform a certain update which can "\
+  "easily be adapted by writing a custom update rule. Graphs are output using "\
+  "graphviz and the code naturally facilitates piping into ffmpeg for rendering "\
+  "videos.";
+
+/* long only options without a short key */
+enum long_only_keys {
+        KEY_SERIES = 256,
+        KEY_SERIES_INTERVAL,
+        KEY_SERIES_FORMAT,
+        KEY_SERIES_EDGES,
+        KEY_SERIES_FIXATION,
+        KEY_BATCH_SIZE,
+        KEY_ORDER,
+        KEY_GRAPH,
+        KEY_WINDOW,
+        KEY_RATE_EXPONENT,
+        KEY_TAU_LEAP,
+        KEY_LEAP_EPSILON,
+        KEY_PREFETCH_DISTANCE,
+        KEY_PIN,
+        KEY_LOD,
+        KEY_INSPECT,
+        KEY_COUPLE,
+        KEY_CLUSTERS,
+        KEY_SEED,
+        KEY_RNG,
+        KEY_CORRELATION,
+        KEY_FRAME_CHANGE,
+        KEY_FRAME_CHANGE_MAX,
+        KEY_FRAME_MAX_INTERVAL,
+        KEY_RECORD_TRACE,
+        KEY_REPLAY,
+        KEY_SKIP_AHEAD,
+        KEY_AUTOTUNE
+};
+
+static struct argp_option options[] = {
+		  {"alpha",			'a',	"double",	0,					"Set the alpha parameter for the update rules. The default is 0.5."},
+		  {"rate-exponent",	KEY_RATE_EXPONENT,	"double",	0,		"Let the clock of every vertex ring at rate local_weight^rate-exponent "\
+								    				   						"instead of 1. With positive exponents the number of events grows "\
+								    				   						"exponentially (explodes in finite time above 1). The default is 0."},
+		  {"tau-leap",	KEY_TAU_LEAP,	"double",	0,					"Approximate the dynamics by tau-leaps of length at most tau-leap "\
+								    				   						"instead of running every event. The default is 0 (exact)."},
+		  {"leap-epsilon",	KEY_LEAP_EPSILON,	"double",	0,			"Bound of the relative change of a weight in one tau-leap, which chooses "\
+								    				   						"the leap lengths. The default is 0.03."},
+		  {"num",			'n',	"int",		0,						"Set the number of vertices per dimension (i.e. on torus we have n^d vertices). "\
+							      										"The default is 10."},	
+		  {"dim",			'd',	"int",		0,						"Set the dimension of the lattice. The default is 2."},
+		  {"max-time",		'm',	"int",		0,						"Maximum time to run the simulation for. The default is 10000."},
+          {"quiet",			'q',	0, 			0,					 	"Do not output video frames to stdout." },
+		  {"silent", 		's',	0,			OPTION_ALIAS},
+		  {"init-frame", 	'i',	"FILENAME",	OPTION_ARG_OPTIONAL,	"Save a frame of the system state after 10 time steps in init.png "\
+						         										"or in FILENAME.png if supplied."},
+          {"output",		'o', 	"FILENAME", 0,  					"Output the final state to FILENAME.png instead of final.png." },
+		  {"width",			'w',	"int",		0, 						"Set the max width for the frames in inches (graphviz option). The default is 5."},
+		  {"height",		'h',	"int",		0, 						"Set the max height for the frames in inches (graphviz option). The default is 5."},
+		  {"dpi",			'r',	"int",		0, 						"Set the max dpi (dots per inch, i.e. resolution) for the frames (graphviz option). "\
+							    				   						"The default is 200."},
+		  {"frame-density",	'f',	"int",		0, 						"Save a frame only every frame-density time units. Serves as coarse graining to reduce "\
+							    				   						"output video size. The default is 1 (i.e. approximately every full time unit a frame is saved)."},
+		  {"frame-change",	KEY_FRAME_CHANGE,	"double",	0,		"Check the state every frame-density time units but only save a frame once "\
+								    				   						"the penwidths changed by frame-change on average per edge since the last "\
+								    				   						"frame, the frame then lasts for the time since. The default is 0 (off)."},
+		  {"frame-change-max",	KEY_FRAME_CHANGE_MAX,	"double",	0,	"Like frame-change for the largest change of the penwidth of an edge. "\
+								    				   						"The default is 0 (off)."},
+		  {"frame-max-interval",	KEY_FRAME_MAX_INTERVAL,	"double",	0,	"Save a frame at least every frame-max-interval time units with "\
+								    				   						"frame-change or frame-change-max. The default is 100."},
+		  {"lod",		KEY_LOD,	"mean|max|direction",	0,		"Draw the frames from blocks of vertices matching the pixels, showing the "\
+								    				   						"mean or maximal weight of each block or the mean coloured by the "\
+								    				   						"direction of its heavier edges. Frames of large tori then take time "\
+								    				   						"proportional to the image size. Only for d=2."},
+		  {"max-penwidth",	'p',	"int",		0, 						"Maximum penwidth used to draw the highest weighted edge (graphviz option). The default is 10."},
+		  {"graph",		KEY_GRAPH,	"FILENAME",	0,					"Simulate on the graph given as edge list in FILENAME (lines 'v1 v2' or "\
+								    				   						"'v1 v2 weight', '#' starts a comment) instead of the torus. Frames can "\
+								    				   						"only be drawn for tori."},
+		  {"window",		KEY_WINDOW,	"double",	0,					"Length of the synchronisation windows of glauber_dynamics_mpi. The default is 1."},
+		  {"order",		KEY_ORDER,	"none|morton|hilbert|rcm",	0,	"Renumber the vertices along a locality preserving order before the "\
+								    				   						"simulation (output keeps the original numbering). The default is none."},
+		  {"pin",		KEY_PIN,	0,	0,					"Pin every thread (every process of glauber_dynamics_mpi) to its own CPU "\
+								    				   						"and keep its part of the graph on its NUMA node."},
+		  {"inspect",		KEY_INSPECT,	"SOCKET",	0,					"Answer queries about the running simulation (time, rate, observables, "\
+								    				   						"weights, frames, dumps) on the UNIX domain socket SOCKET, e.g. "\
+								    				   						"'echo observables | nc -U SOCKET'."},
+		  {"couple",		KEY_COUPLE,	"ALPHA[:WEIGHT],...",	0,		"Run replicas with the given alpha (and initial weight) on the same random "\
+								    				   						"numbers as the main run and add the differences of their observables to "\
+								    				   						"the time series. Example: --couple 0.6,0.5:2."},
+		  {"clusters",		KEY_CLUSTERS,	"FILENAME",	0,					"After the run write the clusters of the dominant edges of the vertices "\
+								    				   						"(sizes, and spanning and wrapping clusters of tori) to FILENAME. With "\
+								    				   						"--graph and -m 0 the weights of the file are analysed."},
+		  {"correlation",	KEY_CORRELATION,	"FILENAME",	0,			"Write the correlation functions, structure factors and correlation "\
+								    				   						"lengths of the edge weights of every direction of the torus to FILENAME, "\
+								    				   						"for the final state and with --series at every record."},
+		  {"seed",		KEY_SEED,	"int",	0,					"Seed of the random numbers, runs with equal seeds and options are equal. "\
+								    				   						"The default is a seed from the entropy of the system (printed to stderr)."},
+		  {"rng",		KEY_RNG,	"pcg|philox",	0,				"Random numbers of the clocks: sequential pcg32 streams or a Philox stream "\
+								    				   						"per vertex, which gives the same trajectory for any batch size, order "\
+								    				   						"and number of processes of glauber_dynamics_mpi. The default is pcg."},
+		  {"record-trace",	KEY_RECORD_TRACE,	"FILENAME",	0,		"Write the time, vertex and changed edge of every event bit-packed to "\
+								    				   						"FILENAME, so that --replay can repeat the run (with other frames or "\
+								    				   						"analyses) without simulating it."},
+		  {"replay",		KEY_REPLAY,	"FILENAME",	0,					"Run the events of the trace FILENAME written by --record-trace instead "\
+								    				   						"of drawing them. The graph options (num, dim, graph, order) have to be "\
+								    				   						"the ones of the recorded run."},
+		  {"skip-ahead",	KEY_SKIP_AHEAD,	"double",	0,				"Apply the events of vertices that change their heaviest edge with at least "\
+								    				   						"this probability in bulk and draw only the others, exactly. Speeds up "\
+								    				   						"late alpha > 1 runs with rare frames, in (0.5, 1), e.g. 0.999. The "\
+								    				   						"default is 0 (off)."},
+		  {"batch-size",	KEY_BATCH_SIZE,	"int",	0,					"Number of events generated ahead and handed to the update rule at once. "\
+								    				   						"The default is 1024."},
+		  {"prefetch-distance",	KEY_PREFETCH_DISTANCE,	"int",	0,		"Number of events between the stages of prefetching the memory of "\
+								    				   						"upcoming events. The default is 2."},
+		  {"autotune",	KEY_AUTOTUNE,	"FILENAME",	OPTION_ARG_OPTIONAL,	"Use the batch-size, prefetch-distance and instruction set of the edge "\
+								    				   						"choice measured to be the fastest for this CPU and kind of graph, "\
+								    				   						"measuring them in about a second on first use and saving them in the "\
+								    				   						"profile FILENAME (default $GLAUBER_AUTOTUNE_PROFILE or "\
+								    				   						"~/.cache/glauber_autotune). batch-size and prefetch-distance given "\
+								    				   						"explicitly are kept."},
+		  {"series",		KEY_SERIES,	"FILENAME",	0,					"Write a time series of observables (max weight, weight quantiles, fixated "\
+								    				   						"vertices and sampled edge weights) to FILENAME."},
+		  {"series-interval",	KEY_SERIES_INTERVAL,	"double",	0,		"Simulation time between two records of the time series. The default is 1."},
+		  {"series-format",	KEY_SERIES_FORMAT,	"csv|binary",	0,			"Format of the time series file. The default is csv."},
+		  {"series-edges",	KEY_SERIES_EDGES,	"int",	0,				"Number of edges (sampled at equal strides) whose weights are added to "\
+								    				   						"every record of the time series. The default is 0."},
+		  {"series-fixation",	KEY_SERIES_FIXATION,	"double",	0,		"Fraction of the local weight the heaviest edge of a vertex has to carry "\
+								    				   						"for the vertex to count as fixated in the time series. The default is 0.9."},
+                  { 0 }
+};
+
+/* use that the strto functions return the remaining string part after parsing
+ * and check that that part is empty otherwise return error messages. Only to
+ * be used inside parse_opt */
+void static check_input(char *remaining_str, char *error_msg, struct argp_state *state){
+        /* use that non-empty strings have length >0 and are thus true */
+        if (strlen(remaining_str)){
+                argp_error(state, "%s", error_msg);
+        }
+}
+
+/* parse the comma separated ALPHA[:WEIGHT] replicas of --couple */
+void static parse_couple(char *arg, struct arguments *args, struct argp_state *state){
+        char *remaining_str;
+        for (char *item = strtok(arg, ","); item; item = strtok(NULL, ",")){
+                int k = args->n_coupled++;
+                args->coupled_alpha = realloc(args->coupled_alpha,
+                                              args->n_coupled*sizeof(double));
+                args->coupled_weight = realloc(args->coupled_weight,
+                                               args->n_coupled*sizeof(int));
+                args->coupled_alpha[k] = strtod(item, &remaining_str);
+                args->coupled_weight[k] = 1;
+                if (*remaining_str == ':'){
+                        args->coupled_weight[k] = (int) strtol(remaining_str+1,
+                                                               &remaining_str, 10);
+                        if (args->coupled_weight[k] < 1){
+                                argp_error(state, "The initial weights of couple have to be positive.");
+                        }
+                }
+                check_input(remaining_str,
+                            "False input for couple, only input ALPHA[:WEIGHT] separated by commas. Example: --couple 0.6,0.5:2.",
+                            state);
+        }
+}
+
+/* Parse a single option. */
+static error_t parse_opt (int key, char *arg, struct argp_state *state)
+{
+        /* Get the input argument from argp_parse, which we
+         * know is a pointer to our arguments structure. */
+        struct arguments *args = state->input;
+
+        char *remaining_str; /* use this to check the input */
+
+		switch (key){
+				case 'q': case 's':
+				  		args->silent = 1;
+						break;
+				case 'a':
+						args->alpha = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for alpha (a), only input doubles. Example: -a 0.5.",
+                                    state);
+						break;
+				case 'f':
+						args->frame_density = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for frame-density (f), only doubles. "
+                                    "Example: -f 1.",
+                                    state);
+						break;
+				case KEY_FRAME_CHANGE:
+						args->frame_change = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for frame-change, only input doubles. Example: --frame-change 0.05.",
+                                    state);
+						break;
+				case KEY_FRAME_CHANGE_MAX:
+						args->frame_change_max = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for frame-change-max, only input doubles. Example: --frame-change-max 1.",
+                                    state);
+						break;
+				case KEY_FRAME_MAX_INTERVAL:
+						args->frame_max_interval = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for frame-max-interval, only input doubles. Example: --frame-max-interval 100.",
+                                    state);
+                        if (args->frame_max_interval <= 0){
+                                argp_error(state, "frame-max-interval has to be positive.");
+                        }
+						break;
+				case 'n':
+						args->n = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for num (n), only input integers. Example: -n 10.",
+                                    state);
+						break;
+				case 'd':
+						args->d = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for dim (d), only input integers. Example: -d 2.",
+                                    state);
+						break;
+				case 'm':
+						args->max_time = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for max_time (m), only input integers. Example: -m 10000.",
+                                    state);
+						break;
+				case 'i':
+                        args->do_init = 1;
+						args->init_fname = arg;
+						break;
+				case 'o':
+				  		args->output = arg;
+						break;
+				case 'w':
+						args->width = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for width (w), only input integers. Example: -w 5.",
+                                    state);
+						break;
+				case 'h':
+						args->height = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for height (h), only input integers. Example: -h 5.",
+                                    state);
+						break;
+				case 'r':
+						args->dpi = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for dpi (r), only input integers. Example: -r 200.",
+                                    state);
+						break;
+				case 'p':
+						args->penwidth = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for penwidth (p), only input integers. Example: -p 1.",
+                                    state);
+						break;
+				case KEY_RATE_EXPONENT:
+						args->rate_exponent = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for rate-exponent, only input doubles. Example: --rate-exponent 1.",
+                                    state);
+						break;
+				case KEY_TAU_LEAP:
+						args->tau_leap = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for tau-leap, only input doubles. Example: --tau-leap 10.",
+                                    state);
+                        if (args->tau_leap < 0){
+                                argp_error(state, "tau-leap must not be negative.");
+                        }
+						break;
+				case KEY_LEAP_EPSILON:
+						args->leap_epsilon = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for leap-epsilon, only input doubles. Example: --leap-epsilon 0.03.",
+                                    state);
+                        if (args->leap_epsilon <= 0){
+                                argp_error(state, "leap-epsilon has to be positive.");
+                        }
+						break;
+				case KEY_GRAPH:
+						args->graph_fname = arg;
+						break;
+				case KEY_WINDOW:
+						args->window = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for window, only input doubles. Example: --window 0.5.",
+                                    state);
+                        if (args->window <= 0){
+                                argp_error(state, "window has to be positive.");
+                        }
+						break;
+				case KEY_ORDER:
+						if (!strcmp(arg, "none")){
+								args->order = ORDER_NONE;
+						}
+						else if (!strcmp(arg, "morton")){
+								args->order = ORDER_MORTON;
+						}
+						else if (!strcmp(arg, "hilbert")){
+								args->order = ORDER_HILBERT;
+						}
+						else if (!strcmp(arg, "rcm")){
+								args->order = ORDER_RCM;
+						}
+						else {
+								argp_error(state, "False input for order, only none, morton, hilbert or rcm.");
+						}
+						break;
+				case KEY_PIN:
+						args->pin = 1;
+						break;
+				case KEY_LOD:
+						if (!strcmp(arg, "mean")){
+								args->lod = LOD_MEAN;
+						}
+						else if (!strcmp(arg, "max")){
+								args->lod = LOD_MAX;
+						}
+						else if (!strcmp(arg, "direction")){
+								args->lod = LOD_DIRECTION;
+						}
+						else {
+								argp_error(state, "False input for lod, only mean, max or direction.");
+						}
+						break;
+				case KEY_INSPECT:
+						args->inspect_fname = arg;
+						break;
+				case KEY_COUPLE:
+						parse_couple(arg, args, state);
+						break;
+				case KEY_CLUSTERS:
+						args->clusters_fname = arg;
+						break;
+				case KEY_CORRELATION:
+						args->correlation_fname = arg;
+						break;
+				case KEY_RECORD_TRACE:
+						args->record_fname = arg;
+						break;
+				case KEY_REPLAY:
+						args->replay_fname = arg;
+						break;
+				case KEY_SKIP_AHEAD:
+						args->skip_ahead = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for skip-ahead, only input doubles. Example: --skip-ahead 0.999.",
+                                    state);
+                        if (args->skip_ahead <= 0.5 || args->skip_ahead >= 1){
+                                argp_error(state, "skip-ahead has to be in (0.5, 1).");
+                        }
+						break;
+				case KEY_SEED:
+						args->seed = strtoull(arg, &remaining_str, 0);
+                        check_input(remaining_str,
+                                    "False input for seed, only input non-negative integers. Example: --seed 42.",
+                                    state);
+                        if (arg[0] == '-'){
+                                argp_error(state, "seed must not be negative.");
+                        }
+                        args->seed_given = 1;
+						break;
+				case KEY_RNG:
+						if (!strcmp(arg, "pcg")){
+								args->rng = GLAUBER_RNG_PCG;
+						}
+						else if (!strcmp(arg, "philox")){
+								args->rng = GLAUBER_RNG_PHILOX;
+						}
+						else {
+								argp_error(state, "False input for rng, only pcg or philox.");
+						}
+						break;
+				case KEY_BATCH_SIZE:
+						args->batch_size = (int) strtol(arg, &remaining_str, 10);
+						args->batch_size_given = 1;
+                        check_input(remaining_str,
+                                    "False input for batch-size, only input integers. Example: --batch-size 1024.",
+                                    state);
+                        if (args->batch_size < 1){
+                                argp_error(state, "batch-size has to be positive.");
+                        }
+						break;
+				case KEY_PREFETCH_DISTANCE:
+						args->prefetch_distance = (int) strtol(arg, &remaining_str, 10);
+						args->prefetch_distance_given = 1;
+                        check_input(remaining_str,
+                                    "False input for prefetch-distance, only input integers. Example: --prefetch-distance 2.",
+                                    state);
+                        if (args->prefetch_distance < 1){
+                                argp_error(state, "prefetch-distance has to be positive.");
+                        }
+						break;
+				case KEY_AUTOTUNE:
+						args->autotune = 1;
+						args->autotune_fname = arg;
+						break;
+				case KEY_SERIES:
+						args->series_fname = arg;
+						break;
+				case KEY_SERIES_INTERVAL:
+						args->series_interval = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for series-interval, only input doubles. Example: --series-interval 0.5.",
+                                    state);
+                        if (args->series_interval <= 0){
+                                argp_error(state, "series-interval has to be positive.");
+                        }
+						break;
+				case KEY_SERIES_FORMAT:
+						if (!strcmp(arg, "csv")){
+								args->series_type = SERIES_CSV;
+						}
+						else if (!strcmp(arg, "binary")){
+								args->series_type = SERIES_BINARY;
+						}
+						else {
+								argp_error(state, "False input for series-format, only csv or binary.");
+						}
+						break;
+				case KEY_SERIES_EDGES:
+						args->series_edges = (int) strtol(arg, &remaining_str, 10);
+                        check_input(remaining_str,
+                                    "False input for series-edges, only input integers. Example: --series-edges 100.",
+                                    state);
+						break;
+				case KEY_SERIES_FIXATION:
+						args->series_fixation = strtod(arg, &remaining_str);
+                        check_input(remaining_str,
+                                    "False input for series-fixation, only input doubles. Example: --series-fixation 0.9.",
+                                    state);
+						break;
+				case ARGP_KEY_END:
+						if (!args->graph_fname && !graph_torus_fits(args->n, args->d)){
+#ifdef GRAPH_INDEX_64
+								argp_error(state, "The torus n^d is too large for 64 bit indices.");
+#else
+								argp_error(state, "The torus n^d is too large for 32 bit indices, it needs --enable-large-graphs.");
+#endif
+						}
+						if (args->graph_fname && !args->silent){
+								argp_error(state, "Frames can only be drawn for tori, use --quiet with --graph.");
+						}
+						if (args->graph_fname && (args->order == ORDER_MORTON ||
+						                          args->order == ORDER_HILBERT)){
+								argp_error(state, "The morton and hilbert orders are only defined for tori.");
+						}
+						if (args->lod != LOD_NONE && args->d != 2){
+								argp_error(state, "The lod frames are only defined for d=2.");
+						}
+						if (args->n_coupled && (args->rate_exponent != 0 || args->tau_leap > 0)){
+								argp_error(state, "couple only works with exact events at rate 1.");
+						}
+						if ((args->record_fname || args->replay_fname) && args->tau_leap > 0){
+								argp_error(state, "Traces are only recorded and replayed with exact events.");
+						}
+						if (args->replay_fname && (args->record_fname || args->n_coupled)){
+								argp_error(state, "replay runs neither coupled replicas nor another recording.");
+						}
+						if (args->rng == GLAUBER_RNG_PHILOX && args->rate_exponent != 0){
+								argp_error(state, "The philox clocks only ring at rate 1.");
+						}
+						if (args->skip_ahead > 0 && (args->rate_exponent != 0 || args->tau_leap > 0 ||
+						                             args->rng != GLAUBER_RNG_PCG || args->n_coupled ||
+						                             args->record_fname || args->replay_fname)){
+								argp_error(state, "skip-ahead only runs uncoupled exact events at rate 1 with the pcg clocks and without traces.");
+						}
+						break;
+				default:
+						return ARGP_ERR_UNKNOWN;
+				}
+				return 0;
+		}
+
+static struct argp argp = { options, parse_opt, NULL, doc };
+
+void arguments_parse(int argc, char **argv, arguments *args){
+        args->silent=0;
+        args->pin=0;
+		args->init_fname="DO NOT INIT";
+        args->do_init=0;
+		args->output="final.png";
+		args->alpha=0.5;
+		args->rate_exponent=0;
+		args->tau_leap=0;
+		args->leap_epsilon=0.03;
+		args->n=10;
+		args->d=2;
+		args->max_time=10000;
+		args->width=5;
+		args->height=5;
+		args->dpi=200;
+		args->frame_density=1.0;
+		args->frame_change=0;
+		args->frame_change_max=0;
+		args->frame_max_interval=100;
+		args->penwidth=10;
+		args->batch_size=1024;
+		args->batch_size_given=0;
+		args->prefetch_distance=DEFAULT_PREFETCH_DISTANCE;
+		args->prefetch_distance_given=0;
+		args->autotune=0;
+		args->autotune_fname=NULL;
+		args->order=ORDER_NONE;
+		args->lod=LOD_NONE;
+		args->series_fname=NULL;
+		args->series_interval=1.0;
+		args->series_type=SERIES_CSV;
+		args->series_edges=0;
+		args->series_fixation=0.9;
+		args->graph_fname=NULL;
+		args->inspect_fname=NULL;
+		args->clusters_fname=NULL;
+		args->correlation_fname=NULL;
+		args->record_fname=NULL;
+		args->replay_fname=NULL;
+		args->skip_ahead=0;
+		args->n_coupled=0;
+		args->coupled_alpha=NULL;
+		args->coupled_weight=NULL;
+		args->window=1.0;
+		args->seed=0;
+		args->seed_given=0;
+		args->rng=GLAUBER_RNG_PCG;
+
+		argp_parse (&argp, argc, argv, 0, 0, args);
+}
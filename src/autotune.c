@@ -0,0 +1,332 @@
+#define _GNU_SOURCE // asprintf, getline, mkstemp and clock_gettime
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "autotune.h"
+
+/* the candidates, the defaults of the program are the first ones tried */
+static const int batch_sizes[] = {GLAUBER_DEFAULT_BATCH_SIZE, 256, 4096, 16384};
+static const int prefetch_distances[] = {DEFAULT_PREFETCH_DISTANCE, 1, 4, 8};
+
+char *autotune_default_profile(void){
+        const char *name = getenv("GLAUBER_AUTOTUNE_PROFILE");
+        if (name && *name){
+                return strdup(name);
+        }
+        char *dir = NULL;
+        const char *cache = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        if (cache && *cache){
+                dir = strdup(cache);
+        }
+        else if (home && *home){
+                if (asprintf(&dir, "%s/.cache", home) < 0){
+                        return NULL;
+                }
+        }
+        else {
+                return NULL;
+        }
+        /* a missing directory is reported when the profile is written */
+        mkdir(dir, 0755);
+        char *profile;
+        if (asprintf(&profile, "%s/glauber_autotune", dir) < 0){
+                profile = NULL;
+        }
+        free(dir);
+        return profile;
+}
+
+/* replace the tabs and newlines of s, which separate the fields of the
+ * profile */
+void static plain(char *s){
+        for (; *s; s++){
+                if (*s == '\t' || *s == '\n'){
+                        *s = ' ';
+                }
+        }
+}
+
+/* the model name of the first CPU, unknown if it cannot be read */
+void static cpu_model(char *model, size_t size){
+        snprintf(model, size, "unknown");
+        FILE *in = fopen("/proc/cpuinfo", "r");
+        if (!in){
+                return;
+        }
+        char *line = NULL;
+        size_t capacity = 0;
+        while (getline(&line, &capacity, in) > 0){
+                char *colon = strchr(line, ':');
+                if (!strncmp(line, "model name", 10) && colon){
+                        colon += strspn(colon + 1, " ") + 1;
+                        colon[strcspn(colon, "\n")] = 0;
+                        snprintf(model, size, "%s", colon);
+                        break;
+                }
+        }
+        free(line);
+        fclose(in);
+}
+
+void autotune_key(const graph *g, const rule_interface *rule,
+                  const char *graph_class, char *key){
+        char model[128], name[64], class[32];
+        cpu_model(model, sizeof(model));
+        snprintf(name, sizeof(name), "%s", rule->name);
+        snprintf(class, sizeof(class), "%s", graph_class);
+        plain(model);
+        plain(name);
+        plain(class);
+        graph_index degree = 0;
+        for (graph_index v=0; v<g->n; v++){
+                if (g->vertices[v]->dim > degree){
+                        degree = g->vertices[v]->dim;
+                }
+        }
+        /* sizes within a factor of two share their parameters */
+        int size = 0;
+        while (size < 63 && ((uint64_t) 1 << size) < (uint64_t) g->n){
+                size++;
+        }
+        snprintf(key, AUTOTUNE_KEY_LENGTH, "%s\t%s\t%s\t%lld\t%d", model, name,
+                 class, (long long) degree, size);
+}
+
+/* whether line is the one of key, then its config is read into config */
+int static parse_line(const char *line, const char *key, autotune_config *config){
+        size_t length = strlen(key);
+        if (strncmp(line, key, length) || line[length] != '\t'){
+                return 0;
+        }
+        /* the three numbers have to end the line, otherwise key is only the
+         * start of a longer key */
+        int simd, end = 0;
+        autotune_config read;
+        if (sscanf(line + length, "%d %d %d %n", &read.batch_size,
+                   &read.prefetch_distance, &simd, &end) != 3 || line[length + end] ||
+            read.batch_size <= 0 || read.prefetch_distance <= 0 ||
+            simd < SIMD_DEFAULT || simd > SIMD_AVX512){
+                return 0;
+        }
+        read.simd = simd;
+        *config = read;
+        return 1;
+}
+
+int autotune_lookup(const char *profile, const char *key,
+                    autotune_config *config){
+        FILE *in = fopen(profile, "r");
+        if (!in){
+                return 0;
+        }
+        char *line = NULL;
+        size_t capacity = 0;
+        int found = 0;
+        while (!found && getline(&line, &capacity, in) > 0){
+                found = parse_line(line, key, config);
+        }
+        free(line);
+        fclose(in);
+        return found;
+}
+
+int autotune_store(const char *profile, const char *key,
+                   const autotune_config *config){
+        /* hosts sharing the profile take turns through a lock on a file next
+         * to it (fcntl locks also work over NFS), so none loses the line of
+         * another, and the new profile is moved over the old one, so that
+         * readers always see a complete profile */
+        char *lock_name, *temporary;
+        if (asprintf(&lock_name, "%s.lock", profile) < 0){
+                return -1;
+        }
+        if (asprintf(&temporary, "%s.XXXXXX", profile) < 0){
+                free(lock_name);
+                return -1;
+        }
+        int lock = open(lock_name, O_RDWR | O_CREAT, 0644);
+        struct flock whole = {.l_type=F_WRLCK, .l_whence=SEEK_SET, .l_start=0, .l_len=0};
+        int fd = -1;
+        if (lock >= 0){
+                /* without locks (e.g. ENOLCK) the profile is written anyway */
+                while (fcntl(lock, F_SETLKW, &whole) < 0 && errno == EINTR){
+                        /* interrupted by a signal, wait again */
+                }
+                fd = mkstemp(temporary);
+        }
+        if (fd < 0){
+                if (lock >= 0){
+                        close(lock);
+                }
+                free(lock_name);
+                free(temporary);
+                return -1;
+        }
+        FILE *out = fdopen(fd, "w");
+        FILE *in = fopen(profile, "r");
+        if (in){
+                char *line = NULL;
+                size_t capacity = 0;
+                autotune_config old;
+                while (getline(&line, &capacity, in) > 0){
+                        if (!parse_line(line, key, &old)){
+                                fputs(line, out);
+                        }
+                }
+                free(line);
+                fclose(in);
+        }
+        fprintf(out, "%s\t%d\t%d\t%d\n", key, config->batch_size,
+                config->prefetch_distance, config->simd);
+        int failed = ferror(out);
+        failed = fclose(out) || failed;
+        /* mkstemp creates the file only readable by its owner */
+        failed = failed || chmod(temporary, 0644) || rename(temporary, profile);
+        if (failed){
+                remove(temporary);
+        }
+        /* closing the lock file releases the lock */
+        close(lock);
+        free(lock_name);
+        free(temporary);
+        return failed ? -1 : 0;
+}
+
+/* a copy of the topology and the weights of g */
+graph static *copy_graph(const graph *g){
+        graph *copy = graph_new();
+        graph_add_n_vertices(copy, g->n);
+        for (graph_index i=0; i<g->m; i++){
+                const edge *e = g->edges[i];
+                graph_add_edge(copy, e->v1, e->v2, 1);
+                copy->edges[i]->weight = e->weight;
+        }
+        for (graph_index v=0; v<g->n; v++){
+                copy->vertices[v]->local_weight = g->vertices[v]->local_weight;
+        }
+        return copy;
+}
+
+double static seconds_since(const struct timespec *start){
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec - start->tv_sec + 1e-9*(now.tv_nsec - start->tv_nsec);
+}
+
+/* the runs of a measurement, on one copy of the graph */
+struct bench {
+        const graph *g;
+        graph *work;
+        const rule_interface *rule;
+        const update_params *params;
+};
+
+/* give the copy the weights of the graph again, rules changing the topology
+ * need a new copy */
+void static reset_work(struct bench *bench){
+        const graph *g = bench->g;
+        if (bench->rule->changes_topology){
+                graph_free(bench->work);
+                bench->work = copy_graph(g);
+                return;
+        }
+        memcpy(bench->work->edge_pool, g->edge_pool, g->m*sizeof(edge));
+        for (graph_index v=0; v<g->n; v++){
+                bench->work->vertices[v]->local_weight = g->vertices[v]->local_weight;
+        }
+}
+
+/* the fastest of three timed runs of events events with config after one run
+ * to warm the caches up */
+double static time_config(struct bench *bench, const autotune_config *config,
+                          int64_t events){
+        update_params tuned = *bench->params;
+        tuned.prefetch_distance = config->prefetch_distance;
+        categorical_set_level(config->simd);
+        reset_work(bench);
+        glauber_context *ctx = glauber_new(bench->work, bench->rule, &tuned, 1,
+                                           config->batch_size);
+        glauber_step(ctx, events);
+        double best = INFINITY;
+        for (int k=0; k<3; k++){
+                struct timespec start;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                glauber_step(ctx, events);
+                double elapsed = seconds_since(&start);
+                if (elapsed < best){
+                        best = elapsed;
+                }
+        }
+        glauber_release(ctx);
+        return best;
+}
+
+/* replace best by the candidate if it is clearly faster */
+void static consider(struct bench *bench, const autotune_config *candidate,
+                     int64_t events, autotune_config *best, double *best_time){
+        double elapsed = time_config(bench, candidate, events);
+        if (elapsed < 0.95*(*best_time)){
+                *best = *candidate;
+                *best_time = elapsed;
+        }
+}
+
+void autotune_measure(const graph *g, const rule_interface *rule,
+                      const update_params *params, double seconds,
+                      autotune_config *config){
+        struct bench bench = {.g=g, .work=copy_graph(g), .rule=rule, .params=params};
+        simd_level previous = categorical_set_level(SIMD_DEFAULT);
+        *config = (autotune_config){.batch_size=batch_sizes[0],
+                                    .prefetch_distance=prefetch_distances[0],
+                                    .simd=SIMD_DEFAULT};
+        /* calibrate the runs to the wanted duration */
+        int64_t events = 1024;
+        double best_time = time_config(&bench, config, events);
+        while (best_time < seconds && events < ((int64_t) 1 << 30)){
+                events *= 2;
+                best_time = time_config(&bench, config, events);
+        }
+
+        autotune_config candidate = *config;
+        for (simd_level level=SIMD_SCALAR; level<=simd_supported(); level++){
+                candidate.simd = level;
+                consider(&bench, &candidate, events, config, &best_time);
+        }
+        candidate = *config;
+        for (size_t k=1; k<sizeof(batch_sizes)/sizeof(int); k++){
+                candidate.batch_size = batch_sizes[k];
+                consider(&bench, &candidate, events, config, &best_time);
+        }
+        candidate = *config;
+        for (size_t k=1; k<sizeof(prefetch_distances)/sizeof(int); k++){
+                candidate.prefetch_distance = prefetch_distances[k];
+                consider(&bench, &candidate, events, config, &best_time);
+        }
+        categorical_set_level(previous);
+        graph_free(bench.work);
+}
+
+int autotune(const char *profile, const graph *g, const rule_interface *rule,
+             const update_params *params, const char *graph_class,
+             autotune_config *config){
+        char *name = profile ? strdup(profile) : autotune_default_profile();
+        char key[AUTOTUNE_KEY_LENGTH];
+        autotune_key(g, rule, graph_class, key);
+        if (name && autotune_lookup(name, key, config)){
+                free(name);
+                return 1;
+        }
+        autotune_measure(g, rule, params, AUTOTUNE_SECONDS, config);
+        int stored = name ? autotune_store(name, key, config) : -1;
+        free(name);
+        return stored;
+}
@@ -0,0 +1,386 @@
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "clusters.h"
+
+/* the other end of the dominant edge of every vertex, -1 for vertices
+ * without edges */
+void static dominant_ends(const graph *g, const double *weights,
+                          graph_index *other){
+        #pragma omp parallel for schedule(static)
+        for (graph_index v=0; v<g->n; v++){
+                const vertex *vert = g->vertices[v];
+                graph_index best = -1;
+                double best_weight = 0;
+                for (graph_index j=0; j<vert->dim; j++){
+                        graph_index index = vert->edges[j] - g->edge_pool;
+                        double weight = weights ? weights[index] : vert->edges[j]->weight;
+                        if (best < 0 || weight > best_weight ||
+                            (weight == best_weight && index < best)){
+                                best = index;
+                                best_weight = weight;
+                        }
+                }
+                if (best < 0){
+                        other[v] = -1;
+                        continue;
+                }
+                const edge *e = g->edge_pool + best;
+                other[v] = e->v1 == v ? e->v2 : e->v1;
+        }
+}
+
+/*
+ * The union-find links a root only to a smaller root with a compare and swap
+ * and find only shortens paths (halving them), so the parent of every vertex
+ * only decreases. Threads may therefore find and unite concurrently without
+ * locks: a failed compare and swap means the root got linked meanwhile and
+ * the union is retried from the new roots, a lost halving is harmless. The
+ * root of every set is its smallest vertex.
+ */
+graph_index static find(_Atomic graph_index *parent, graph_index v){
+        while (1){
+                graph_index p = atomic_load_explicit(&parent[v], memory_order_relaxed);
+                if (p == v){
+                        return v;
+                }
+                graph_index grandparent = atomic_load_explicit(&parent[p], memory_order_relaxed);
+                if (grandparent != p){
+                        atomic_compare_exchange_weak_explicit(&parent[v], &p, grandparent,
+                                                              memory_order_relaxed,
+                                                              memory_order_relaxed);
+                }
+                v = grandparent;
+        }
+}
+
+void static unite(_Atomic graph_index *parent, graph_index a, graph_index b){
+        while (1){
+                a = find(parent, a);
+                b = find(parent, b);
+                if (a == b){
+                        return;
+                }
+                if (a < b){
+                        graph_index swap = a;
+                        a = b;
+                        b = swap;
+                }
+                graph_index expected = a;
+                if (atomic_compare_exchange_strong_explicit(&parent[a], &expected, b,
+                                                            memory_order_relaxed,
+                                                            memory_order_relaxed)){
+                        return;
+                }
+        }
+}
+
+/* the root of every vertex in labels after uniting the vertices with the
+ * other ends of their dominant edges for which keep (if not NULL) is set */
+void static union_find(graph_index n, const graph_index *other,
+                       const unsigned char *keep, graph_index *labels){
+        _Atomic graph_index *parent = malloc((n ? n : 1)*sizeof(_Atomic graph_index));
+        #pragma omp parallel
+        {
+                #pragma omp for schedule(static)
+                for (graph_index v=0; v<n; v++){
+                        atomic_init(&parent[v], v);
+                }
+                #pragma omp for schedule(static)
+                for (graph_index v=0; v<n; v++){
+                        if (other[v] >= 0 && (!keep || keep[v])){
+                                unite(parent, v, other[v]);
+                        }
+                }
+                #pragma omp for schedule(static)
+                for (graph_index v=0; v<n; v++){
+                        labels[v] = find(parent, v);
+                }
+        }
+        free(parent);
+}
+
+/* the coordinates of the vertex with original index i on the torus */
+void static torus_coordinates(graph_index i, graph_index n, int d,
+                              graph_index *coordinates){
+        for (int k=0; k<d; k++){
+                coordinates[k] = i%n;
+                i /= n;
+        }
+}
+
+/* the step from the vertex with original index a to the one with original
+ * index b, i.e. its axis, its direction (+1 or -1, 0 if they are not
+ * neighbours) and whether it crosses the periodic boundary */
+int static torus_step(graph_index a, graph_index b, graph_index n, int d,
+                      int *axis, int *across){
+        int direction = 0;
+        for (int k=0; k<d; k++){
+                graph_index ca = a%n, cb = b%n;
+                a /= n;
+                b /= n;
+                if (ca == cb){
+                        continue;
+                }
+                if (direction){
+                        return 0;
+                }
+                *axis = k;
+                if (cb == (ca+1)%n){
+                        direction = 1;
+                        *across = ca == n-1;
+                }
+                else if (ca == (cb+1)%n){
+                        direction = -1;
+                        *across = ca == 0;
+                }
+                else {
+                        return 0;
+                }
+        }
+        return direction;
+}
+
+/* the number of clusters per axis spanning the torus cut open at its
+ * periodic boundary, -1 if a dominant edge is not an edge of the torus */
+int static count_spanning(const graph *g, const graph_index *other,
+                          graph_index n, int d, graph_index *spanning){
+        unsigned char *keep = malloc(g->n ? g->n : 1);
+        int lattice = 1;
+        #pragma omp parallel for schedule(static) reduction(&&:lattice)
+        for (graph_index v=0; v<g->n; v++){
+                int axis, across = 0;
+                keep[v] = 0;
+                if (other[v] < 0){
+                        continue;
+                }
+                if (!torus_step(graph_original_index(g, v),
+                                graph_original_index(g, other[v]), n, d, &axis, &across)){
+                        lattice = 0;
+                }
+                keep[v] = !across;
+        }
+        if (!lattice){
+                free(keep);
+                return -1;
+        }
+        graph_index *labels = malloc((g->n ? g->n : 1)*sizeof(graph_index));
+        union_find(g->n, other, keep, labels);
+        free(keep);
+
+        /* bit 2k of a root is set if its piece touches layer 0 of axis k and
+         * bit 2k+1 if it touches layer n-1 */
+        uint32_t *faces = calloc(g->n ? g->n : 1, sizeof(uint32_t));
+        graph_index coordinates[CLUSTERS_MAX_DIM];
+        for (graph_index v=0; v<g->n; v++){
+                torus_coordinates(graph_original_index(g, v), n, d, coordinates);
+                for (int k=0; k<d; k++){
+                        if (coordinates[k] == 0){
+                                faces[labels[v]] |= UINT32_C(1) << 2*k;
+                        }
+                        if (coordinates[k] == n-1){
+                                faces[labels[v]] |= UINT32_C(1) << (2*k+1);
+                        }
+                }
+        }
+        for (int k=0; k<d; k++){
+                spanning[k] = 0;
+        }
+        for (graph_index v=0; v<g->n; v++){
+                for (int k=0; k<d; k++){
+                        spanning[k] += ((faces[v] >> 2*k) & 3) == 3;
+                }
+        }
+        free(faces);
+        free(labels);
+        return 0;
+}
+
+/* the number of clusters per axis whose lift covers at least n layers, found
+ * by walking every tree down from the smaller vertex of its mutual pair */
+void static count_wrapping(const graph *g, const graph_index *other,
+                           graph_index n, int d, graph_index *wrapping){
+        /* the children of every vertex, i.e. the vertices whose dominant edge
+         * leads to it, except for the root of a tree */
+        graph_index *start = calloc(g->n+1, sizeof(graph_index));
+        graph_index *children = malloc((g->n ? g->n : 1)*sizeof(graph_index));
+        for (graph_index v=0; v<g->n; v++){
+                if (other[v] >= 0 && !(other[other[v]] == v && v < other[v])){
+                        start[other[v]+1]++;
+                }
+        }
+        for (graph_index v=0; v<g->n; v++){
+                start[v+1] += start[v];
+        }
+        graph_index *fill = malloc((g->n ? g->n : 1)*sizeof(graph_index));
+        for (graph_index v=0; v<g->n; v++){
+                fill[v] = start[v];
+        }
+        for (graph_index v=0; v<g->n; v++){
+                if (other[v] >= 0 && !(other[other[v]] == v && v < other[v])){
+                        children[fill[other[v]]++] = v;
+                }
+        }
+        free(fill);
+
+        for (int k=0; k<d; k++){
+                wrapping[k] = 0;
+        }
+        #pragma omp parallel
+        {
+                graph_index local[CLUSTERS_MAX_DIM] = {0};
+                /* the vertices to visit and their lifted coordinates */
+                graph_index capacity = 64;
+                graph_index *stack = malloc(capacity*sizeof(graph_index));
+                int64_t *lift = malloc(capacity*d*sizeof(int64_t));
+                #pragma omp for schedule(dynamic, 1024)
+                for (graph_index root=0; root<g->n; root++){
+                        if (other[root] < 0 || other[other[root]] != root || root > other[root]){
+                                continue;
+                        }
+                        int64_t low[CLUSTERS_MAX_DIM] = {0}, high[CLUSTERS_MAX_DIM] = {0};
+                        graph_index top = 0;
+                        stack[top] = root;
+                        for (int k=0; k<d; k++){
+                                lift[k] = 0;
+                        }
+                        top++;
+                        while (top){
+                                top--;
+                                graph_index v = stack[top];
+                                int64_t position[CLUSTERS_MAX_DIM];
+                                for (int k=0; k<d; k++){
+                                        position[k] = lift[top*d + k];
+                                        low[k] = position[k] < low[k] ? position[k] : low[k];
+                                        high[k] = position[k] > high[k] ? position[k] : high[k];
+                                }
+                                for (graph_index j=start[v]; j<start[v+1]; j++){
+                                        graph_index child = children[j];
+                                        int axis = 0, across;
+                                        int direction = torus_step(graph_original_index(g, v),
+                                                                   graph_original_index(g, child),
+                                                                   n, d, &axis, &across);
+                                        if (top == capacity){
+                                                capacity *= 2;
+                                                stack = realloc(stack, capacity*sizeof(graph_index));
+                                                lift = realloc(lift, capacity*d*sizeof(int64_t));
+                                        }
+                                        stack[top] = child;
+                                        for (int k=0; k<d; k++){
+                                                lift[top*d + k] = position[k] + (k == axis ? direction : 0);
+                                        }
+                                        top++;
+                                }
+                        }
+                        for (int k=0; k<d; k++){
+                                local[k] += high[k] - low[k] + 1 >= n;
+                        }
+                }
+                for (int k=0; k<d; k++){
+                        #pragma omp atomic
+                        wrapping[k] += local[k];
+                }
+                free(stack);
+                free(lift);
+        }
+        free(children);
+        free(start);
+}
+
+cluster_analysis *clusters_analyse(const graph *g, const double *weights,
+                                   int n, int d){
+        cluster_analysis *clusters = malloc(sizeof(cluster_analysis));
+        *clusters = (cluster_analysis){.n_vertices=g->n, .d=0};
+        graph_index *other = malloc((g->n ? g->n : 1)*sizeof(graph_index));
+        dominant_ends(g, weights, other);
+        clusters->labels = malloc((g->n ? g->n : 1)*sizeof(graph_index));
+        union_find(g->n, other, NULL, clusters->labels);
+
+        /* the size of every cluster at its root, then the number of clusters
+         * of every size */
+        graph_index *size = calloc(g->n ? g->n : 1, sizeof(graph_index));
+        for (graph_index v=0; v<g->n; v++){
+                size[clusters->labels[v]]++;
+        }
+        double squares = 0;
+        for (graph_index v=0; v<g->n; v++){
+                graph_index s = size[v];
+                if (!s){
+                        continue;
+                }
+                clusters->n_clusters++;
+                squares += (double) s*s;
+                if (s > clusters->largest){
+                        clusters->second = clusters->largest;
+                        clusters->largest = s;
+                }
+                else if (s > clusters->second){
+                        clusters->second = s;
+                }
+        }
+        clusters->mean_size = g->n ? squares/g->n : 0;
+        graph_index *of_size = calloc(clusters->largest+1, sizeof(graph_index));
+        for (graph_index v=0; v<g->n; v++){
+                of_size[size[v]] += size[v] > 0;
+        }
+        free(size);
+        for (graph_index s=1; s<=clusters->largest; s++){
+                clusters->n_sizes += of_size[s] > 0;
+        }
+        clusters->sizes = malloc((clusters->n_sizes ? clusters->n_sizes : 1)*sizeof(graph_index));
+        clusters->counts = malloc((clusters->n_sizes ? clusters->n_sizes : 1)*sizeof(graph_index));
+        for (graph_index s=1, i=0; s<=clusters->largest; s++){
+                if (of_size[s]){
+                        clusters->sizes[i] = s;
+                        clusters->counts[i++] = of_size[s];
+                }
+        }
+        free(of_size);
+
+        /* the geometry only for tori, whose vertex count is checked first */
+        graph_index vertices = 1;
+        for (int k=0; n >= 3 && k<d && k<CLUSTERS_MAX_DIM && vertices <= g->n; k++){
+                vertices *= n;
+        }
+        if (n >= 3 && d >= 1 && d <= CLUSTERS_MAX_DIM && vertices == g->n &&
+            !count_spanning(g, other, n, d, clusters->spanning)){
+                clusters->d = d;
+                count_wrapping(g, other, n, d, clusters->wrapping);
+        }
+        free(other);
+        return clusters;
+}
+
+void clusters_free(cluster_analysis *clusters){
+        free(clusters->labels);
+        free(clusters->sizes);
+        free(clusters->counts);
+        free(clusters);
+}
+
+void clusters_write(const cluster_analysis *clusters, FILE *out, double t){
+        fprintf(out, "# dominant edge clusters at time %.17g\n", t);
+        fprintf(out, "vertices %" PRIgi "\n", clusters->n_vertices);
+        fprintf(out, "clusters %" PRIgi "\n", clusters->n_clusters);
+        fprintf(out, "largest %" PRIgi "\n", clusters->largest);
+        fprintf(out, "second %" PRIgi "\n", clusters->second);
+        fprintf(out, "mean_size %.17g\n", clusters->mean_size);
+        if (clusters->d){
+                fprintf(out, "spanning");
+                for (int k=0; k<clusters->d; k++){
+                        fprintf(out, " %" PRIgi, clusters->spanning[k]);
+                }
+                fprintf(out, "\nwrapping");
+                for (int k=0; k<clusters->d; k++){
+                        fprintf(out, " %" PRIgi, clusters->wrapping[k]);
+                }
+                fprintf(out, "\n");
+        }
+        fprintf(out, "sizes %" PRIgi "\n", clusters->n_sizes);
+        for (graph_index i=0; i<clusters->n_sizes; i++){
+                fprintf(out, "%" PRIgi " %" PRIgi "\n", clusters->sizes[i],
+                        clusters->counts[i]);
+        }
+}
@@ -0,0 +1,186 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "correlation.h"
+
+correlation_analysis *correlation_new(int n, int d){
+        correlation_analysis *corr = malloc(sizeof(correlation_analysis));
+        corr->n = n;
+        corr->d = d;
+        corr->n_distances = n/2 + 1;
+        corr->mean = calloc(d, sizeof(double));
+        corr->variance = calloc(d, sizeof(double));
+        corr->correlation = calloc(d*d*corr->n_distances, sizeof(double));
+        corr->structure = calloc(d*d*corr->n_distances, sizeof(double));
+        corr->length = calloc(d*d, sizeof(double));
+        corr->plan = fft_plan_new(n, d);
+        return corr;
+}
+
+void correlation_free(correlation_analysis *corr){
+        free(corr->mean);
+        free(corr->variance);
+        free(corr->correlation);
+        free(corr->structure);
+        free(corr->length);
+        fft_plan_free(corr->plan);
+        free(corr);
+}
+
+/* the direction of the edge between the sites a and b and its site (the one
+ * the edge leaves in positive direction), -1 if they are no neighbours */
+int static edge_site(const correlation_analysis *corr, graph_index a,
+                     graph_index b, graph_index *site){
+        graph_index n = corr->n;
+        graph_index stride = 1;
+        int axis = -1;
+        for (int j=0; j<corr->d; j++){
+                graph_index da = (a/stride) % n;
+                graph_index db = (b/stride) % n;
+                if (da != db){
+                        if (axis >= 0){
+                                return -1;
+                        }
+                        axis = j;
+                        if (db == (da+1) % n){
+                                *site = a;
+                        }
+                        else if (da == (db+1) % n){
+                                *site = b;
+                        }
+                        else {
+                                return -1;
+                        }
+                }
+                stride *= n;
+        }
+        return axis;
+}
+
+/* the distance along a profile at which it first drops below 1/e */
+double static decay_length(const double *profile, int n_distances){
+        double threshold = exp(-1);
+        for (int r=1; r<n_distances; r++){
+                if (profile[r] < threshold){
+                        return r-1 + (profile[r-1] - threshold)/(profile[r-1] - profile[r]);
+                }
+        }
+        return n_distances-1;
+}
+
+/*
+ * The fields of the directions are transformed one after the other in the
+ * array of the plan: filled from the edges, centred, transformed forward,
+ * replaced by the squared moduli (n^d times the structure factor) and
+ * transformed backward, which gives (n^d)^2 times the covariance at every
+ * distance.
+ */
+int correlation_analyse(correlation_analysis *corr, const graph *g,
+                        const double *weights){
+        int d = corr->d;
+        graph_index size = 1;
+        for (int j=0; j<d; j++){
+                size *= corr->n;
+        }
+        if (g->n != size || corr->n < 3){
+                return -1;
+        }
+        int lattice = 1;
+        #pragma omp parallel for schedule(static) reduction(&&:lattice)
+        for (graph_index i=0; i<g->m; i++){
+                graph_index site;
+                const edge *e = g->edges[i];
+                lattice = lattice && edge_site(corr, graph_original_index(g, e->v1),
+                                               graph_original_index(g, e->v2), &site) >= 0;
+        }
+        if (!lattice){
+                return -1;
+        }
+
+        double complex *data = fft_data(corr->plan);
+        for (int k=0; k<d; k++){
+                #pragma omp parallel for schedule(static)
+                for (graph_index x=0; x<size; x++){
+                        data[x] = 0;
+                }
+                #pragma omp parallel for schedule(static)
+                for (graph_index i=0; i<g->m; i++){
+                        graph_index site;
+                        const edge *e = g->edges[i];
+                        if (edge_site(corr, graph_original_index(g, e->v1),
+                                      graph_original_index(g, e->v2), &site) == k){
+                                data[site] = weights ? weights[i] : e->weight;
+                        }
+                }
+                double sum = 0;
+                #pragma omp parallel for schedule(static) reduction(+:sum)
+                for (graph_index x=0; x<size; x++){
+                        sum += creal(data[x]);
+                }
+                double mean = sum/size;
+                double squares = 0;
+                #pragma omp parallel for schedule(static) reduction(+:squares)
+                for (graph_index x=0; x<size; x++){
+                        data[x] -= mean;
+                        squares += creal(data[x])*creal(data[x]);
+                }
+                corr->mean[k] = mean;
+                corr->variance[k] = squares/size;
+
+                fft_execute(corr->plan, -1);
+                #pragma omp parallel for schedule(static)
+                for (graph_index x=0; x<size; x++){
+                        data[x] = creal(data[x])*creal(data[x]) + cimag(data[x])*cimag(data[x]);
+                }
+                graph_index stride = 1;
+                for (int j=0; j<d; j++){
+                        double *structure = corr->structure + (k*d + j)*corr->n_distances;
+                        for (int q=0; q<corr->n_distances; q++){
+                                structure[q] = creal(data[q*stride])/size;
+                        }
+                        stride *= corr->n;
+                }
+
+                fft_execute(corr->plan, 1);
+                stride = 1;
+                for (int j=0; j<d; j++){
+                        double *profile = corr->correlation + (k*d + j)*corr->n_distances;
+                        for (int r=0; r<corr->n_distances; r++){
+                                profile[r] = corr->variance[k] > 0
+                                        ? creal(data[r*stride])/((double) size*size*corr->variance[k])
+                                        : 0;
+                        }
+                        corr->length[k*d + j] = corr->variance[k] > 0
+                                ? decay_length(profile, corr->n_distances) : 0;
+                        stride *= corr->n;
+                }
+        }
+        return 0;
+}
+
+void correlation_write(const correlation_analysis *corr, FILE *out, double t){
+        int d = corr->d;
+        fprintf(out, "# weight correlations at time %.17g\n", t);
+        for (int k=0; k<d; k++){
+                fprintf(out, "mean %d %.17g\n", k, corr->mean[k]);
+                fprintf(out, "variance %d %.17g\n", k, corr->variance[k]);
+                fprintf(out, "length %d", k);
+                for (int j=0; j<d; j++){
+                        fprintf(out, " %.17g", corr->length[k*d + j]);
+                }
+                fprintf(out, "\n");
+                for (int j=0; j<d; j++){
+                        const double *profiles[2] = {
+                                corr->correlation + (k*d + j)*corr->n_distances,
+                                corr->structure + (k*d + j)*corr->n_distances};
+                        const char *names[2] = {"correlation", "structure"};
+                        for (int p=0; p<2; p++){
+                                fprintf(out, "%s %d %d", names[p], k, j);
+                                for (int r=0; r<corr->n_distances; r++){
+                                        fprintf(out, " %.17g", profiles[p][r]);
+                                }
+                                fprintf(out, "\n");
+                        }
+                }
+        }
+}
@@ -0,0 +1,226 @@
+#define _GNU_SOURCE // M_PI
+#include <math.h>
+#include <stdlib.h>
+
+#include "fft.h"
+
+#ifdef WITH_FFTW
+/* with complex.h included first fftw_complex is double complex */
+#include <fftw3.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+struct fft_plan {
+        graph_index size;
+        double complex *data;
+        fftw_plan forward;
+        fftw_plan backward;
+};
+
+fft_plan *fft_plan_new(int n, int d){
+#if defined(_OPENMP) && defined(WITH_FFTW_THREADS)
+        static int threads_ready = 0;
+        if (!threads_ready){
+                threads_ready = fftw_init_threads();
+        }
+        if (threads_ready){
+                fftw_plan_with_nthreads(omp_get_max_threads());
+        }
+#endif
+        fft_plan *plan = malloc(sizeof(fft_plan));
+        int *dims = malloc(d*sizeof(int));
+        plan->size = 1;
+        for (int j=0; j<d; j++){
+                dims[j] = n;
+                plan->size *= n;
+        }
+        plan->data = fftw_malloc(plan->size*sizeof(double complex));
+        /* all axes have length n, so the order of the axes does not matter */
+        plan->forward = fftw_plan_dft(d, dims, plan->data, plan->data,
+                                      FFTW_FORWARD, FFTW_ESTIMATE);
+        plan->backward = fftw_plan_dft(d, dims, plan->data, plan->data,
+                                       FFTW_BACKWARD, FFTW_ESTIMATE);
+        free(dims);
+        return plan;
+}
+
+void fft_plan_free(fft_plan *plan){
+        fftw_destroy_plan(plan->forward);
+        fftw_destroy_plan(plan->backward);
+        fftw_free(plan->data);
+        free(plan);
+}
+
+void fft_execute(fft_plan *plan, int sign){
+        fftw_execute(sign < 0 ? plan->forward : plan->backward);
+}
+
+#else
+
+struct fft_plan {
+        int n;
+        int d;
+        graph_index size;
+        double complex *data;
+        int m; /* the power-of-2 length of the radix-2 transforms */
+        double complex *twiddles; /* exp(-2 pi i k/m) for k < m/2 */
+        /* Bluestein (if n is not a power of 2): the chirp exp(pi i j^2/n) for
+         * j < n and the transform of the chirp wrapped around to length m */
+        double complex *chirp;
+        double complex *chirp_transform;
+};
+
+/* in place radix-2 transform of length m, sign -1 forward and +1 backward */
+void static radix2(double complex *a, int m, const double complex *twiddles,
+                   int sign){
+        /* bit reversal permutation */
+        for (int i=1, j=0; i<m; i++){
+                int bit = m >> 1;
+                for (; j & bit; bit >>= 1){
+                        j ^= bit;
+                }
+                j ^= bit;
+                if (i < j){
+                        double complex swap = a[i];
+                        a[i] = a[j];
+                        a[j] = swap;
+                }
+        }
+        for (int len=2; len<=m; len <<= 1){
+                int step = m/len;
+                for (int start=0; start<m; start+=len){
+                        for (int k=0; k<len/2; k++){
+                                double complex w = twiddles[k*step];
+                                if (sign > 0){
+                                        w = conj(w);
+                                }
+                                double complex u = a[start+k];
+                                double complex v = a[start+k+len/2]*w;
+                                a[start+k] = u + v;
+                                a[start+k+len/2] = u - v;
+                        }
+                }
+        }
+}
+
+/* transform one line of length n, scratch has room for m numbers */
+void static transform_line(const fft_plan *plan, double complex *line,
+                           double complex *scratch, int sign){
+        int n = plan->n;
+        if (!plan->chirp){
+                radix2(line, n, plan->twiddles, sign);
+                return;
+        }
+        /*
+         * With q x = (q^2 + x^2 - (q-x)^2)/2 the forward transform is
+         * X(q) = conj(c_q) sum_x (line_x conj(c_x)) c_{q-x} for the chirp c,
+         * a convolution which is done with power-of-2 transforms. The
+         * backward transform is the conjugate of the forward transform of the
+         * conjugate.
+         */
+        for (int x=0; x<n; x++){
+                double complex value = sign > 0 ? conj(line[x]) : line[x];
+                scratch[x] = value*conj(plan->chirp[x]);
+        }
+        for (int x=n; x<plan->m; x++){
+                scratch[x] = 0;
+        }
+        radix2(scratch, plan->m, plan->twiddles, -1);
+        for (int k=0; k<plan->m; k++){
+                scratch[k] *= plan->chirp_transform[k];
+        }
+        radix2(scratch, plan->m, plan->twiddles, 1);
+        for (int q=0; q<n; q++){
+                double complex value = conj(plan->chirp[q])*scratch[q]/plan->m;
+                line[q] = sign > 0 ? conj(value) : value;
+        }
+}
+
+fft_plan *fft_plan_new(int n, int d){
+        fft_plan *plan = malloc(sizeof(fft_plan));
+        plan->n = n;
+        plan->d = d;
+        plan->size = 1;
+        for (int j=0; j<d; j++){
+                plan->size *= n;
+        }
+        plan->data = malloc(plan->size*sizeof(double complex));
+        plan->chirp = plan->chirp_transform = NULL;
+        plan->m = 1;
+        while (plan->m < n){
+                plan->m <<= 1;
+        }
+        if (plan->m != n){
+                /* the linear convolution of two lengths n fits into 2n-1 */
+                while (plan->m < 2*n-1){
+                        plan->m <<= 1;
+                }
+        }
+        plan->twiddles = malloc((plan->m/2 + 1)*sizeof(double complex));
+        for (int k=0; k<plan->m/2; k++){
+                plan->twiddles[k] = cexp(-2*M_PI*I*k/plan->m);
+        }
+        if (plan->m != n){
+                plan->chirp = malloc(n*sizeof(double complex));
+                plan->chirp_transform = calloc(plan->m, sizeof(double complex));
+                for (int j=0; j<n; j++){
+                        /* j^2 mod 2n keeps the angle small and exact */
+                        long long square = (long long) j*j % (2*n);
+                        plan->chirp[j] = cexp(M_PI*I*square/n);
+                        /* the chirp is even, c_{-j} sits at m-j */
+                        plan->chirp_transform[j] = plan->chirp[j];
+                        if (j){
+                                plan->chirp_transform[plan->m-j] = plan->chirp[j];
+                        }
+                }
+                radix2(plan->chirp_transform, plan->m, plan->twiddles, -1);
+        }
+        return plan;
+}
+
+void fft_plan_free(fft_plan *plan){
+        free(plan->data);
+        free(plan->twiddles);
+        free(plan->chirp);
+        free(plan->chirp_transform);
+        free(plan);
+}
+
+/*
+ * The transform along all axes is the transform along every axis in turn.
+ * Along axis j the sites x + k n^j, k < n, form a line, the lines of an axis
+ * are independent and transformed by the threads in parallel, each gathering
+ * its line into contiguous scratch space.
+ */
+void fft_execute(fft_plan *plan, int sign){
+        int n = plan->n;
+        graph_index lines = plan->size/n;
+        graph_index stride = 1;
+        for (int j=0; j<plan->d; j++){
+                #pragma omp parallel
+                {
+                        double complex *line = malloc((n + plan->m)*sizeof(double complex));
+                        double complex *scratch = line + n;
+                        #pragma omp for schedule(static)
+                        for (graph_index l=0; l<lines; l++){
+                                graph_index start = (l/stride)*stride*n + l%stride;
+                                for (int k=0; k<n; k++){
+                                        line[k] = plan->data[start + k*stride];
+                                }
+                                transform_line(plan, line, scratch, sign);
+                                for (int k=0; k<n; k++){
+                                        plan->data[start + k*stride] = line[k];
+                                }
+                        }
+                        free(line);
+                }
+                stride *= n;
+        }
+}
+
+#endif
+
+double complex *fft_data(fft_plan *plan){
+        return plan->data;
+}
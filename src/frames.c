@@ -0,0 +1,131 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frames.h"
+
+frame_tracker *frames_new(graph *g, double penwidth, double t){
+        frame_tracker *frames = malloc(sizeof(frame_tracker));
+        *frames = (frame_tracker){.g=g, .penwidth=penwidth, .capacity=g->capacity};
+        frames->stamps = calloc(frames->capacity, sizeof(unsigned int));
+        frames->drift = malloc(frames->capacity*sizeof(double));
+        for (graph_index i=0; i<g->m; i++){
+                frames->total += g->edges[i]->weight;
+                frames->max_weight = fmax(frames->max_weight, g->edges[i]->weight);
+        }
+        frames_reset(frames, t);
+        return frames;
+}
+
+void frames_free(frame_tracker *frames){
+        free(frames->stamps);
+        free(frames->drift);
+        free(frames);
+}
+
+/* make room for the edges up to index i (the pool of the graph grew) */
+void static grow(frame_tracker *frames, graph_index i){
+        if (i < frames->capacity){
+                return;
+        }
+        graph_index capacity = frames->g->capacity > i ? frames->g->capacity : 2*i + 1;
+        frames->stamps = realloc(frames->stamps, capacity*sizeof(unsigned int));
+        frames->drift = realloc(frames->drift, capacity*sizeof(double));
+        memset(frames->stamps + frames->capacity, 0,
+               (capacity - frames->capacity)*sizeof(unsigned int));
+        frames->capacity = capacity;
+}
+
+/* the change of the weight of edges[i] since the last frame, 0 if it did
+ * not change since */
+double static *drift(frame_tracker *frames, graph_index i){
+        grow(frames, i);
+        if (frames->stamps[i] != frames->epoch){
+                frames->stamps[i] = frames->epoch;
+                frames->drift[i] = 0;
+        }
+        return &frames->drift[i];
+}
+
+/*
+ * Only the deltas are summed, e->weight is not the weight before the delta if
+ * a batch of events changed e several times (cf. glauber_add_observer).
+ */
+void frames_observe(void *data, const graph *g, const edge *e, double delta){
+        frame_tracker *frames = data;
+        double *d = drift(frames, e - g->edge_pool);
+        frames->l1 += fabs(*d + delta) - fabs(*d);
+        *d += delta;
+        frames->linf = fmax(frames->linf, fabs(*d));
+        frames->total += delta;
+        frames->max_weight = fmax(frames->max_weight, e->weight);
+}
+
+/*
+ * An added edge was not in the last frame (weight 0 there), a removed one is
+ * not in the next, its deviation becomes its weight at the last frame. The
+ * drift of a moved edge moves with it, stamp 0 marks a free place.
+ */
+void frames_topology(void *data, graph *g, const graph_change *change){
+        frame_tracker *frames = data;
+        (void) g;
+        graph_index i = change->index;
+        double weight = change->edge.weight;
+        if (change->kind == GRAPH_EDGE_ADDED){
+                grow(frames, i);
+                frames->stamps[i] = frames->epoch;
+                frames->drift[i] = weight;
+                frames->l1 += fabs(weight);
+                frames->linf = fmax(frames->linf, fabs(weight));
+                frames->total += weight;
+                frames->max_weight = fmax(frames->max_weight, weight);
+        }
+        else if (change->kind == GRAPH_EDGE_REMOVED){
+                double d = *drift(frames, i);
+                frames->l1 += fabs(weight - d) - fabs(d);
+                frames->linf = fmax(frames->linf, fabs(weight - d));
+                frames->total -= weight;
+                frames->stamps[i] = 0;
+        }
+        else {
+                grow(frames, i);
+                frames->stamps[i] = frames->stamps[change->from];
+                frames->drift[i] = frames->drift[change->from];
+                frames->stamps[change->from] = 0;
+        }
+}
+
+void frames_change(const frame_tracker *frames, double t, double *mean,
+                   double *max){
+        double t0 = frames->frame_time;
+        if (t0 <= 0 || t <= 0){
+                *mean = *max = INFINITY;
+                return;
+        }
+        double dilution = fabs(1/t - 1/t0);
+        /* the sum may drift slightly below 0 by rounding */
+        double l1 = fmax(frames->l1, 0)/t + frames->frame_total*dilution;
+        *mean = frames->g->m ? frames->penwidth*l1/frames->g->m : 0;
+        *max = frames->penwidth*(frames->linf/t + frames->frame_max*dilution);
+}
+
+int frames_due(const frame_tracker *frames, double t, double mean_threshold,
+               double max_threshold){
+        double mean, max;
+        frames_change(frames, t, &mean, &max);
+        return (mean_threshold > 0 && mean >= mean_threshold) ||
+               (max_threshold > 0 && max >= max_threshold);
+}
+
+void frames_reset(frame_tracker *frames, double t){
+        frames->frame_time = t;
+        /* stamps of the wrapped epoch could look current */
+        if (++frames->epoch == 0){
+                memset(frames->stamps, 0, frames->capacity*sizeof(unsigned int));
+                frames->epoch = 1;
+        }
+        frames->l1 = 0;
+        frames->linf = 0;
+        frames->frame_total = frames->total;
+        frames->frame_max = frames->max_weight;
+}
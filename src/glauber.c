@@ -0,0 +1,1048 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "glauber.h"
+#include "philox.h"
+#include "sampling.h"
+#include "tau_leap.h"
+
+struct glauber_context {
+        graph *g;
+        rule_instance *rule;
+        /* use three different rngs for the exponential clocks, the vertex
+         * choosing and the update rule which ensures their independence */
+        pcg32_random_t exponential_rng, uniform_rng, update_rng;
+        uint64_t seed;
+        glauber_rng rng;
+        double t; /* current time */
+        int64_t events; /* events run so far */
+        /* odd while the state is written, see glauber_read_begin */
+        _Atomic uint64_t sequence;
+        /* incremented with every change of the topology */
+        _Atomic uint64_t topology;
+
+        /* events drawn ahead, [next, filled) are pending */
+        int batch_size;
+        double *times;
+        graph_index *vertex_indices;
+        double *uniforms;
+        int next;
+        int filled;
+
+        /* the clock rates of the vertices if the rule has a rate entry, NULL
+         * if all clocks ring at rate 1 */
+        rate_tree *rates;
+
+        /* with GLAUBER_RNG_PHILOX the next event of the clock of every vertex
+         * (its time, its uniform and the number of events of the clock before
+         * it) and a binary min-heap of the vertices by the time of their next
+         * event, NULL otherwise */
+        double *clock_times;
+        double *clock_uniforms;
+        uint64_t *clock_counts;
+        graph_index *heap;
+
+        /* scratch space and statistics of tau-leaping, created by the first
+         * leap */
+        tau_leap *leap;
+        int64_t leaps;
+        int64_t leap_events;
+        double leap_deviation;
+
+        /* called after every weight change, see glauber_add_observer */
+        int n_observers;
+        glauber_observer *observers;
+        void **observer_data;
+        /* the slots changed by observed events and the weights of the vertex
+         * before an observed event */
+        graph_index *slots;
+        int slots_size;
+        double *before;
+        graph_index before_size;
+
+        /* the trace the events are written to (see glauber_record_trace) or
+         * read from instead of drawing them (see glauber_replay_trace), and
+         * the slots of the events read ahead */
+        trace_writer *trace_out;
+        trace_reader *trace_in;
+        double trace_increment;
+        graph_index *trace_slots;
+
+        /* with skip-ahead (see glauber_set_skip_ahead) the fast vertices,
+         * whose events change their leading edge with probability at least
+         * 1 - skip_miss, apply the events sure to do so in bulk: for every
+         * vertex the slot of its leading edge and the vertex at its other
+         * end if it is fast (both -1 otherwise), the probability of its other edges when it became fast, which
+         * bounds the current one, and the time up to which its sure events
+         * were applied. The other events, all events of the slow vertices
+         * and the uncertain ones of the fast vertices, are drawn one at a
+         * time: the slow vertices, which ring at rate 1, from the list slow
+         * (slow_positions[v] the position of v in it, -1 if v is fast) and
+         * the fast ones with their rates in skip_rates. */
+        double skip_miss;
+        graph_index *lead_slots;
+        graph_index *lead_ends;
+        double *lead_miss;
+        double *synced;
+        rate_tree *skip_rates;
+        graph_index *slow;
+        graph_index *slow_positions;
+        graph_index n_slow;
+
+        /* the contexts running on the events of this one (see glauber_couple)
+         * and the one whose events this one runs on */
+        int n_followers;
+        glauber_context **followers;
+        glauber_context *leader;
+};
+
+/* get an exponential random variable */
+static double exponential_rand(glauber_context *ctx, double lambda_rate){
+        /* first generate a 'double' using the recipe in the docs for the C
+         * implementation */
+        double unif_dbl = ldexp(pcg32_random_r(&ctx->exponential_rng), -32);
+        /* for the following line consider that -log(U)/lambda_rate with U
+         * uniform on [0, 1) gives an exponential distribution */
+        return - log(unif_dbl)/lambda_rate;
+}
+
+void static skip_reconsider(glauber_context *ctx, graph_index v1, graph_index v2,
+                           double now);
+
+/*
+ * Keep the samplers valid when the rule (or anybody else) adds or removes
+ * edges: the rates of the two vertices of the edge change and the tau-leap
+ * tables, laid out by the degrees of the vertices, are rebuilt by the next
+ * leap. Events at rate 1 only name vertices, so they stay valid. A pending
+ * rated event was drawn with the old total rate (at infinity if it was 0) and
+ * skip-ahead rates follow the leading edges, so those are dropped and redrawn
+ * from the current time, which the memorylessness of the clocks allows. The
+ * rated event whose run changes the topology is replaced after it anyway.
+ */
+void static topology_changed(void *data, graph *g, const graph_change *change){
+        glauber_context *ctx = data;
+        atomic_fetch_add_explicit(&ctx->topology, 1, memory_order_relaxed);
+        if (change->kind == GRAPH_EDGE_MOVED){
+                return;
+        }
+        if (ctx->rates){
+                double (*rate)(const graph*, graph_index, const update_params*) =
+                        ctx->rule->rule->rate;
+                rate_tree_set(ctx->rates, change->edge.v1,
+                              rate(g, change->edge.v1, &ctx->rule->params));
+                rate_tree_set(ctx->rates, change->edge.v2,
+                              rate(g, change->edge.v2, &ctx->rule->params));
+                /* the sequence is odd while events run */
+                if (!(atomic_load_explicit(&ctx->sequence, memory_order_relaxed) & 1)){
+                        ctx->next = ctx->filled = 0;
+                }
+        }
+        if (ctx->leap){
+                tau_leap_free(ctx->leap);
+                ctx->leap = NULL;
+        }
+        if (ctx->skip_rates){
+                /* between the runs all sure events are applied */
+                skip_reconsider(ctx, change->edge.v1, change->edge.v2, ctx->t);
+                ctx->next = ctx->filled = 0;
+        }
+}
+
+glauber_context *glauber_new(graph *g, const rule_interface *rule,
+                             const update_params *params, uint64_t seed,
+                             int batch_size){
+        glauber_context *ctx = malloc(sizeof(glauber_context));
+        if (batch_size <= 0){
+                batch_size = GLAUBER_DEFAULT_BATCH_SIZE;
+        }
+        *ctx = (glauber_context){.g=g, .seed=seed, .rng=GLAUBER_RNG_PCG,
+                                 .t=0, .events=0,
+                                 .batch_size=batch_size, .next=0, .filled=0,
+                                 .leap=NULL, .leaps=0, .leap_events=0,
+                                 .leap_deviation=0, .n_observers=0,
+                                 .observers=NULL, .observer_data=NULL,
+                                 .slots=NULL, .slots_size=0, .before=NULL,
+                                 .before_size=0, .n_followers=0, .followers=NULL,
+                                 .leader=NULL, .clock_times=NULL,
+                                 .clock_uniforms=NULL, .clock_counts=NULL,
+                                 .heap=NULL, .trace_out=NULL, .trace_in=NULL,
+                                 .trace_slots=NULL, .lead_slots=NULL,
+                                 .lead_ends=NULL, .lead_miss=NULL, .synced=NULL,
+                                 .skip_rates=NULL, .slow=NULL,
+                                 .slow_positions=NULL, .n_slow=0};
+        atomic_init(&ctx->sequence, 0);
+        atomic_init(&ctx->topology, 0);
+        ctx->rule = rule_instance_new(rule, g, params);
+        ctx->rates = NULL;
+        if (rule->rate){
+                ctx->rates = rate_tree_new(g->n);
+                for (graph_index i=0; i<g->n; i++){
+                        rate_tree_set(ctx->rates, i,
+                                      rule->rate(g, i, &ctx->rule->params));
+                }
+        }
+        pcg32_srandom_r(&ctx->exponential_rng, seed, 0);
+        pcg32_srandom_r(&ctx->uniform_rng, seed, 1);
+        pcg32_srandom_r(&ctx->update_rng, seed, 2);
+        ctx->times = malloc(batch_size*sizeof(double));
+        ctx->vertex_indices = malloc(batch_size*sizeof(graph_index));
+        ctx->uniforms = malloc(batch_size*sizeof(double));
+        graph_add_hook(g, topology_changed, ctx);
+        return ctx;
+}
+
+glauber_context *glauber_new_torus(int n, int d, double alpha, uint64_t seed){
+        update_params params = {.alpha=alpha};
+        graph *g = graph_construct_torus(n, d, 1);
+        if (!g){
+                return NULL;
+        }
+        return glauber_new(g, &polya_rule, &params, seed, 0);
+}
+
+graph *glauber_release(glauber_context *ctx){
+        graph *g = ctx->g;
+        graph_remove_hook(g, topology_changed, ctx);
+        ctx->g = NULL;
+        glauber_free(ctx);
+        return g;
+}
+
+void glauber_free(glauber_context *ctx){
+        rule_instance_free(ctx->rule);
+        if (ctx->g){
+                graph_free(ctx->g);
+        }
+        if (ctx->rates){
+                rate_tree_free(ctx->rates);
+        }
+        if (ctx->leap){
+                tau_leap_free(ctx->leap);
+        }
+        free(ctx->times);
+        free(ctx->vertex_indices);
+        free(ctx->uniforms);
+        free(ctx->observers);
+        free(ctx->observer_data);
+        free(ctx->before);
+        free(ctx->slots);
+        free(ctx->followers);
+        free(ctx->clock_times);
+        free(ctx->clock_uniforms);
+        free(ctx->clock_counts);
+        free(ctx->heap);
+        free(ctx->trace_slots);
+        free(ctx->lead_slots);
+        free(ctx->lead_ends);
+        free(ctx->lead_miss);
+        free(ctx->synced);
+        free(ctx->slow);
+        free(ctx->slow_positions);
+        if (ctx->skip_rates){
+                rate_tree_free(ctx->skip_rates);
+        }
+        free(ctx);
+}
+
+/*
+ * For the implementation of poisson clocks on every vertex use that the
+ * time between events of a Poisson point process of rate 1 is the exponential
+ * distribution with rate 1. Furthermore, for n vertices with independent
+ * exponential distribution clocks {exp_i}_{i\in [0,...,n-1]} on them the
+ * next time something fires has distribution min({exp_i}) which is again
+ * exponentially distributed with rate n (i.e. the sum of rates).
+ *
+ * Hence, we can take a single exponential time and then choose the vector
+ * uniformly which is less computatinally intensive than putting an exponential
+ * clock on every vertex and managing their order.
+ *
+ * The randomness does not depend on the state, so the event times, the chosen
+ * vertices and the uniforms for the update rule are generated for a whole
+ * batch of events ahead.
+ *
+ * With state dependent rates the same holds with the total rate instead of n
+ * and the vertex chosen proportional to its rate, see draw_rated_event.
+ */
+void static draw_rated_event(glauber_context *ctx);
+void static draw_skip_event(glauber_context *ctx);
+void static draw_clocks(glauber_context *ctx);
+void static read_trace(glauber_context *ctx);
+
+void static draw_batch(glauber_context *ctx){
+        if (ctx->trace_in){
+                read_trace(ctx);
+                return;
+        }
+        if (ctx->rates){
+                draw_rated_event(ctx);
+                return;
+        }
+        if (ctx->skip_rates){
+                draw_skip_event(ctx);
+                return;
+        }
+        if (ctx->clock_times){
+                draw_clocks(ctx);
+                return;
+        }
+        double next_time = ctx->filled ? ctx->times[ctx->filled-1] : ctx->t;
+        for (int i=0; i<ctx->batch_size; i++){
+                next_time += exponential_rand(ctx, (double) ctx->g->n);
+                ctx->times[i] = next_time;
+                /* it generates strictly smaller than bound so g->n is fine */
+                ctx->vertex_indices[i] = index_boundedrand_r(&ctx->uniform_rng,
+                                                             ctx->g->n);
+                /* generate a double using the recipe in the docs */
+                ctx->uniforms[i] = ldexp(pcg32_random_r(&ctx->update_rng), -32);
+        }
+        ctx->next = 0;
+        ctx->filled = ctx->batch_size;
+}
+
+/*
+ * The rates change with every event, so only the next event is drawn. Its time
+ * and vertex stay valid until it is run since nothing else changes the state.
+ * If all rates are 0 the next event is at infinity.
+ */
+void static draw_rated_event(glauber_context *ctx){
+        double total = rate_tree_total(ctx->rates);
+        double now = ctx->filled ? ctx->times[ctx->filled-1] : ctx->t;
+        ctx->times[0] = total > 0 ? now + exponential_rand(ctx, total) : INFINITY;
+        /* the uniform on [0, total) chooses the vertex by its rate */
+        double x = ldexp(pcg32_random_r(&ctx->uniform_rng), -32)*total;
+        ctx->vertex_indices[0] = total > 0 ? rate_tree_find(ctx->rates, x) : 0;
+        ctx->uniforms[0] = ldexp(pcg32_random_r(&ctx->update_rng), -32);
+        ctx->next = 0;
+        ctx->filled = 1;
+}
+
+/* the same with the slow vertices of skip-ahead at rate 1 in front of the
+ * rates of the fast ones */
+void static draw_skip_event(glauber_context *ctx){
+        double total = ctx->n_slow + rate_tree_total(ctx->skip_rates);
+        double now = ctx->filled ? ctx->times[ctx->filled-1] : ctx->t;
+        ctx->times[0] = total > 0 ? now + exponential_rand(ctx, total) : INFINITY;
+        double x = ldexp(pcg32_random_r(&ctx->uniform_rng), -32)*total;
+        if (x < ctx->n_slow){
+                ctx->vertex_indices[0] = ctx->slow[(graph_index) x];
+        }
+        else {
+                ctx->vertex_indices[0] = total > 0 ? rate_tree_find(ctx->skip_rates,
+                                                                    x - ctx->n_slow)
+                                                   : 0;
+        }
+        ctx->uniforms[0] = ldexp(pcg32_random_r(&ctx->update_rng), -32);
+        ctx->next = 0;
+        ctx->filled = 1;
+}
+
+/* the next events of the replayed trace, after its end the next event is at
+ * infinity */
+void static read_trace(glauber_context *ctx){
+        int count = trace_read(ctx->trace_in, ctx->g, ctx->times, ctx->vertex_indices,
+                               ctx->trace_slots, ctx->batch_size);
+        if (!count){
+                ctx->times[0] = INFINITY;
+                ctx->vertex_indices[0] = 0;
+                ctx->trace_slots[0] = -1;
+                count = 1;
+        }
+        ctx->next = 0;
+        ctx->filled = count;
+}
+
+/*
+ * With GLAUBER_RNG_PHILOX the clocks of the vertices are kept separately
+ * instead, so that the k-th event of a vertex is the same however the events
+ * are drawn. The heap orders the vertices by the time of their next event and
+ * ties (which have probability 0) by the original index.
+ */
+int static clock_before(const glauber_context *ctx, graph_index a, graph_index b){
+        if (ctx->clock_times[a] != ctx->clock_times[b]){
+                return ctx->clock_times[a] < ctx->clock_times[b];
+        }
+        return graph_original_index(ctx->g, a) < graph_original_index(ctx->g, b);
+}
+
+void static sift_down(glauber_context *ctx, graph_index i){
+        graph_index n = ctx->g->n;
+        graph_index v = ctx->heap[i];
+        while (2*i+1 < n){
+                graph_index child = 2*i+1;
+                if (child+1 < n && clock_before(ctx, ctx->heap[child+1], ctx->heap[child])){
+                        child++;
+                }
+                if (!clock_before(ctx, ctx->heap[child], v)){
+                        break;
+                }
+                ctx->heap[i] = ctx->heap[child];
+                i = child;
+        }
+        ctx->heap[i] = v;
+}
+
+/* draw the next event of the clock of vertex v after time from */
+void static advance_clock(glauber_context *ctx, graph_index v, double from){
+        ctx->clock_times[v] = from + philox_clock(ctx->seed, graph_original_index(ctx->g, v),
+                                                  ctx->clock_counts[v]++,
+                                                  &ctx->clock_uniforms[v]);
+}
+
+/* restart all clocks at the current time, valid by their memorylessness */
+void static restart_clocks(glauber_context *ctx){
+        for (graph_index v=0; v<ctx->g->n; v++){
+                ctx->heap[v] = v;
+                advance_clock(ctx, v, ctx->t);
+        }
+        for (graph_index i=ctx->g->n/2; i-- > 0;){
+                sift_down(ctx, i);
+        }
+}
+
+void static draw_clocks(glauber_context *ctx){
+        for (int i=0; i<ctx->batch_size; i++){
+                graph_index v = ctx->heap[0];
+                ctx->times[i] = ctx->clock_times[v];
+                ctx->vertex_indices[i] = v;
+                ctx->uniforms[i] = ctx->clock_uniforms[v];
+                advance_clock(ctx, v, ctx->clock_times[v]);
+                sift_down(ctx, 0);
+        }
+        ctx->next = 0;
+        ctx->filled = ctx->batch_size;
+}
+
+int glauber_set_rng(glauber_context *ctx, glauber_rng rng){
+        if (ctx->rates || ctx->skip_rates){
+                return -1;
+        }
+        free(ctx->clock_times);
+        free(ctx->clock_uniforms);
+        free(ctx->clock_counts);
+        free(ctx->heap);
+        ctx->clock_times = ctx->clock_uniforms = NULL;
+        ctx->clock_counts = NULL;
+        ctx->heap = NULL;
+        ctx->rng = rng;
+        /* the events drawn ahead came from the previous clocks */
+        ctx->next = ctx->filled = 0;
+        if (rng == GLAUBER_RNG_PHILOX){
+                graph_index n = ctx->g->n;
+                graph_sort_edges(ctx->g, NULL);
+                ctx->clock_times = malloc(n*sizeof(double));
+                ctx->clock_uniforms = malloc(n*sizeof(double));
+                ctx->clock_counts = calloc(n, sizeof(uint64_t));
+                ctx->heap = malloc(n*sizeof(graph_index));
+                restart_clocks(ctx);
+        }
+        return 0;
+}
+
+int glauber_record_trace(glauber_context *ctx, trace_writer *trace){
+        if (trace && (!ctx->rule->rule->increment || ctx->rule->rule->changes_topology ||
+                      ctx->leader || ctx->trace_in || ctx->skip_rates)){
+                return -1;
+        }
+        ctx->trace_out = trace;
+        return 0;
+}
+
+int glauber_replay_trace(glauber_context *ctx, trace_reader *trace){
+        if (trace && (ctx->leader || ctx->n_followers || ctx->trace_out ||
+                      ctx->skip_rates)){
+                return -1;
+        }
+        ctx->trace_in = trace;
+        if (trace){
+                if (trace_flags(trace) & TRACE_SORTED_EDGES){
+                        graph_sort_edges(ctx->g, NULL);
+                }
+                ctx->trace_increment = trace_increment(trace);
+                ctx->trace_slots = realloc(ctx->trace_slots,
+                                           ctx->batch_size*sizeof(graph_index));
+        }
+        /* the events drawn ahead are replaced by the ones of the trace */
+        ctx->next = ctx->filled = 0;
+        return 0;
+}
+
+/* recompute the rates of the vertices of the edge in slot of vertex_index */
+void static update_rates(glauber_context *ctx, graph_index vertex_index,
+                         graph_index slot){
+        if (slot < 0){
+                return;
+        }
+        edge *changed = ctx->g->vertices[vertex_index]->edges[slot];
+        double (*rate)(const graph*, graph_index, const update_params*) =
+                ctx->rule->rule->rate;
+        rate_tree_set(ctx->rates, changed->v1,
+                      rate(ctx->g, changed->v1, &ctx->rule->params));
+        rate_tree_set(ctx->rates, changed->v2,
+                      rate(ctx->g, changed->v2, &ctx->rule->params));
+}
+
+void glauber_add_observer(glauber_context *ctx, glauber_observer observer,
+                          void *data){
+        ctx->observers = realloc(ctx->observers,
+                                 (ctx->n_observers+1)*sizeof(glauber_observer));
+        ctx->observer_data = realloc(ctx->observer_data,
+                                     (ctx->n_observers+1)*sizeof(void*));
+        ctx->observers[ctx->n_observers] = observer;
+        ctx->observer_data[ctx->n_observers] = data;
+        ctx->n_observers++;
+}
+
+void static notify(glauber_context *ctx, const edge *e, double delta){
+        for (int i=0; i<ctx->n_observers; i++){
+                ctx->observers[i](ctx->observer_data[i], ctx->g, e, delta);
+        }
+}
+
+/*
+ * Run the events and report their changes. If the rule changes the weight of
+ * an edge always by the same increment the batch runs as usual, otherwise the
+ * events run one at a time with the weights of the vertex saved before each
+ * of them. Events of rules changing the topology run one at a time as well
+ * since later events of a batch may move the edges in the reported slots, a
+ * slot beyond the edges the vertex had before is a new edge which the hooks
+ * of the graph report instead.
+ */
+void static run_observed(glauber_context *ctx, const graph_index *vertex_indices,
+                         const double *uniforms, int count){
+        graph *g = ctx->g;
+        double increment = ctx->rule->rule->increment;
+        int batched = increment && !ctx->rule->rule->changes_topology;
+        if (count > ctx->slots_size){
+                ctx->slots_size = count;
+                ctx->slots = realloc(ctx->slots, count*sizeof(graph_index));
+        }
+        for (int i=0; i<count;){
+                int run = batched ? count-i : 1;
+                vertex *v = g->vertices[vertex_indices[i]];
+                graph_index dim = v->dim;
+                if (!increment){
+                        if (v->dim > ctx->before_size){
+                                ctx->before_size = v->dim;
+                                ctx->before = realloc(ctx->before,
+                                                      ctx->before_size*sizeof(double));
+                        }
+                        for (graph_index j=0; j<v->dim; j++){
+                                ctx->before[j] = v->edges[j]->weight;
+                        }
+                }
+                rule_apply_batch(ctx->rule, g, vertex_indices+i, uniforms+i, run,
+                                 &ctx->update_rng, ctx->slots+i);
+                for (int j=0; j<run; j++){
+                        graph_index slot = ctx->slots[i+j];
+                        if (slot < 0 || (!batched && slot >= dim)){
+                                continue;
+                        }
+                        edge *e = g->vertices[vertex_indices[i+j]]->edges[slot];
+                        double delta = increment ? increment
+                                                 : e->weight - ctx->before[slot];
+                        if (delta != 0){
+                                notify(ctx, e, delta);
+                        }
+                }
+                if (ctx->rates){
+                        update_rates(ctx, vertex_indices[i+run-1], ctx->slots[i+run-1]);
+                }
+                i += run;
+        }
+}
+
+/* apply the events to the state of ctx, with the changed slots in ctx->slots
+ * if the events are observed or recorded */
+void static apply_events(glauber_context *ctx, const graph_index *vertex_indices,
+                         const double *uniforms, int count){
+        if (ctx->n_observers || ctx->trace_out){
+                run_observed(ctx, vertex_indices, uniforms, count);
+                return;
+        }
+        graph_index slot;
+        /* with rates there is a single pending event whose slot is needed */
+        rule_apply_batch(ctx->rule, ctx->g, vertex_indices, uniforms, count,
+                         &ctx->update_rng, ctx->rates ? &slot : NULL);
+        if (ctx->rates){
+                update_rates(ctx, vertex_indices[count-1], slot);
+        }
+}
+
+/*
+ * Only the simulating thread writes, so the sequence is incremented with plain
+ * stores: to odd before changing the state and back to even afterwards. The
+ * release fence keeps the writes of the state after the first store.
+ */
+void static write_begin(glauber_context *ctx){
+        uint64_t sequence = atomic_load_explicit(&ctx->sequence, memory_order_relaxed);
+        atomic_store_explicit(&ctx->sequence, sequence+1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+}
+
+void static write_end(glauber_context *ctx){
+        uint64_t sequence = atomic_load_explicit(&ctx->sequence, memory_order_relaxed);
+        atomic_store_explicit(&ctx->sequence, sequence+1, memory_order_release);
+}
+
+uint64_t glauber_read_begin(const glauber_context *ctx){
+        return atomic_load_explicit(&ctx->sequence, memory_order_acquire);
+}
+
+int glauber_read_retry(const glauber_context *ctx, uint64_t sequence){
+        atomic_thread_fence(memory_order_acquire);
+        return (sequence & 1) ||
+               atomic_load_explicit(&ctx->sequence, memory_order_relaxed) != sequence;
+}
+
+/* add delta to the weight of e and the local weights of its vertices */
+void static add_weight(graph *g, edge *e, double delta){
+        e->weight += delta;
+        g->vertices[e->v1]->local_weight += delta;
+        g->vertices[e->v2]->local_weight += delta;
+}
+
+/* apply the replayed events first, ..., last-1 by adding the increment */
+void static replay_events(glauber_context *ctx, int first, int last){
+        graph *g = ctx->g;
+        for (int i=first; i<last; i++){
+                graph_index slot = ctx->trace_slots[i];
+                if (slot < 0){
+                        continue;
+                }
+                edge *e = g->vertices[ctx->vertex_indices[i]]->edges[slot];
+                add_weight(g, e, ctx->trace_increment);
+                if (ctx->n_observers){
+                        notify(ctx, e, ctx->trace_increment);
+                }
+        }
+}
+
+/*
+ * Skip-ahead thins the clock of a fast vertex v: a ring whose uniform U lies
+ * below 1 - lead_miss[v] changes the leading edge whatever happened since v
+ * became fast, as long as only the leading edge grew. These sure rings form a
+ * Poisson process of rate 1 - lead_miss[v] that only adds to the leading
+ * edge, so they are applied lazily as a Poisson number of increments, and
+ * only the uncertain rings (rate lead_miss[v], U uniform above the bound) are
+ * drawn as events. Every event on an edge of v other than its leading one
+ * therefore makes v consider its status again, after its sure events up to
+ * then were applied with the old bound.
+ *
+ * The sure events of v change the leading edge (v, u) without notice to u,
+ * which is fine if u is slow (it applies them before each of its events) or
+ * fast with the same leading edge (they only make it more likely), but not if
+ * u is fast with another leading edge. skip_allowed keeps fast neighbours
+ * from growing each other's other edges.
+ */
+
+/* apply the sure events of v (if it is fast) up to the time now */
+void static skip_sync(glauber_context *ctx, graph_index v, double now){
+        graph_index slot = ctx->lead_slots[v];
+        if (slot < 0 || now <= ctx->synced[v]){
+                return;
+        }
+        int64_t count = poisson_rand_r(&ctx->update_rng,
+                                       (1 - ctx->lead_miss[v])*(now - ctx->synced[v]));
+        ctx->synced[v] = now;
+        if (count){
+                edge *e = ctx->g->vertices[v]->edges[slot];
+                double delta = count*ctx->rule->rule->increment;
+                add_weight(ctx->g, e, delta);
+                ctx->events += count;
+                notify(ctx, e, delta);
+        }
+}
+
+/* whether the neighbour u of v over e is fast and leads to v over e (the
+ * slot is only compared for multiple edges between them) */
+int static skip_leads(const glauber_context *ctx, graph_index u, graph_index v,
+                      const edge *e){
+        return ctx->lead_ends[u] == v && ctx->g->vertices[u]->edges[ctx->lead_slots[u]] == e;
+}
+
+/* apply the sure events of the fast vertices growing an edge of v */
+void static skip_sync_around(glauber_context *ctx, graph_index v, double now){
+        vertex *vert = ctx->g->vertices[v];
+        for (graph_index j=0; j<vert->dim; j++){
+                edge *e = vert->edges[j];
+                graph_index u = e->v1 == v ? e->v2 : e->v1;
+                if (u != v && skip_leads(ctx, u, v, e)){
+                        skip_sync(ctx, u, now);
+                }
+        }
+        skip_sync(ctx, v, now);
+}
+
+/* whether v may be fast with the leading edge in slot: every fast neighbour
+ * has to lead to v over the same edge v leads to it over, or neither */
+int static skip_allowed(const glauber_context *ctx, graph_index v, graph_index slot){
+        vertex *vert = ctx->g->vertices[v];
+        for (graph_index j=0; j<vert->dim; j++){
+                edge *e = vert->edges[j];
+                graph_index u = e->v1 == v ? e->v2 : e->v1;
+                if (u != v && ctx->lead_slots[u] >= 0 &&
+                    skip_leads(ctx, u, v, e) != (j == slot)){
+                        return 0;
+                }
+        }
+        return 1;
+}
+
+/* decide whether the slow vertex v becomes fast at the time now */
+void static skip_consider(glauber_context *ctx, graph_index v, double now){
+        graph_index slot;
+        double miss = ctx->rule->rule->leading(ctx->g, v, &ctx->rule->params,
+                                               ctx->rule->state, &slot);
+        graph_index position = ctx->slow_positions[v];
+        if (slot >= 0 && miss <= ctx->skip_miss && skip_allowed(ctx, v, slot)){
+                edge *e = ctx->g->vertices[v]->edges[slot];
+                ctx->lead_slots[v] = slot;
+                ctx->lead_ends[v] = e->v1 == v ? e->v2 : e->v1;
+                ctx->lead_miss[v] = miss;
+                ctx->synced[v] = now;
+                rate_tree_set(ctx->skip_rates, v, miss);
+                if (position >= 0){
+                        graph_index last = ctx->slow[--ctx->n_slow];
+                        ctx->slow[position] = last;
+                        ctx->slow_positions[last] = position;
+                        ctx->slow_positions[v] = -1;
+                }
+        }
+        else if (position < 0){
+                rate_tree_set(ctx->skip_rates, v, 0);
+                ctx->slow_positions[v] = ctx->n_slow;
+                ctx->slow[ctx->n_slow++] = v;
+        }
+}
+
+/* reconsider both vertices of a changed edge whose sure events up to now were
+ * applied, both are slow while the first one is decided */
+void static skip_reconsider(glauber_context *ctx, graph_index v1, graph_index v2,
+                            double now){
+        ctx->lead_slots[v1] = ctx->lead_slots[v2] = -1;
+        ctx->lead_ends[v1] = ctx->lead_ends[v2] = -1;
+        skip_consider(ctx, v1, now);
+        if (v2 != v1){
+                skip_consider(ctx, v2, now);
+        }
+}
+
+/* apply the sure events of all fast vertices up to the time now */
+void static skip_flush(glauber_context *ctx, double now){
+        for (graph_index v=0; v<ctx->g->n; v++){
+                skip_sync(ctx, v, now);
+        }
+}
+
+/* run the drawn event of vertex v at the time now with the uniform unif */
+void static skip_event(glauber_context *ctx, graph_index v, double now, double unif){
+        const rule_interface *rule = ctx->rule->rule;
+        graph *g = ctx->g;
+        skip_sync_around(ctx, v, now);
+        graph_index slot = ctx->lead_slots[v];
+        if (slot < 0){
+                slot = rule->update(g, v, unif, &ctx->rule->params, ctx->rule->state,
+                                    &ctx->update_rng);
+        }
+        else {
+                /* 1 - U is uniform below the bound, the leading edge is
+                 * chosen above the current probability of the others */
+                graph_index lead;
+                double miss = rule->leading(g, v, &ctx->rule->params, ctx->rule->state,
+                                            &lead);
+                double x = unif*ctx->lead_miss[v];
+                if (x >= miss){
+                        add_weight(g, g->vertices[v]->edges[slot], rule->increment);
+                }
+                else {
+                        slot = rule->update_other(g, v, slot, x/miss, &ctx->rule->params,
+                                                  ctx->rule->state, &ctx->update_rng);
+                }
+        }
+        graph_index u = v;
+        if (slot >= 0){
+                edge *e = g->vertices[v]->edges[slot];
+                notify(ctx, e, rule->increment);
+                u = e->v1 == v ? e->v2 : e->v1;
+                skip_sync(ctx, u, now);
+        }
+        skip_reconsider(ctx, v, u, now);
+}
+
+int glauber_set_skip_ahead(glauber_context *ctx, double threshold){
+        const rule_interface *rule = ctx->rule->rule;
+        if (threshold != 0 && (threshold <= 0.5 || threshold >= 1 || !rule->leading ||
+                               !rule->update_other || !rule->increment ||
+                               rule->changes_topology || ctx->rates ||
+                               ctx->clock_times || ctx->leader || ctx->n_followers ||
+                               ctx->trace_out || ctx->trace_in)){
+                return -1;
+        }
+        if (ctx->skip_rates){
+                write_begin(ctx);
+                skip_flush(ctx, ctx->t);
+                write_end(ctx);
+                rate_tree_free(ctx->skip_rates);
+                ctx->skip_rates = NULL;
+        }
+        /* the events drawn ahead came from the previous rates */
+        ctx->next = ctx->filled = 0;
+        if (threshold == 0){
+                return 0;
+        }
+        graph_index n = ctx->g->n;
+        ctx->skip_miss = 1 - threshold;
+        ctx->skip_rates = rate_tree_new(n);
+        ctx->lead_slots = realloc(ctx->lead_slots, n*sizeof(graph_index));
+        ctx->lead_ends = realloc(ctx->lead_ends, n*sizeof(graph_index));
+        ctx->lead_miss = realloc(ctx->lead_miss, n*sizeof(double));
+        ctx->synced = realloc(ctx->synced, n*sizeof(double));
+        ctx->slow = realloc(ctx->slow, n*sizeof(graph_index));
+        ctx->slow_positions = realloc(ctx->slow_positions, n*sizeof(graph_index));
+        ctx->n_slow = 0;
+        for (graph_index v=0; v<n; v++){
+                ctx->lead_slots[v] = ctx->lead_ends[v] = -1;
+                ctx->slow_positions[v] = -1;
+        }
+        for (graph_index v=0; v<n; v++){
+                skip_consider(ctx, v, ctx->t);
+        }
+        return 0;
+}
+
+/* run the pending events next, ..., last-1 on ctx and its followers */
+void static run_pending(glauber_context *ctx, int last){
+        int count = last-ctx->next;
+        write_begin(ctx);
+        if (ctx->trace_in){
+                replay_events(ctx, ctx->next, last);
+        }
+        else if (ctx->skip_rates){
+                for (int i=ctx->next; i<last; i++){
+                        skip_event(ctx, ctx->vertex_indices[i], ctx->times[i],
+                                   ctx->uniforms[i]);
+                }
+        }
+        else {
+                apply_events(ctx, ctx->vertex_indices+ctx->next,
+                             ctx->uniforms+ctx->next, count);
+        }
+        if (ctx->trace_out){
+                trace_write(ctx->trace_out, ctx->g, ctx->times+ctx->next,
+                            ctx->vertex_indices+ctx->next, ctx->slots, count);
+        }
+        ctx->events += count;
+        ctx->t = ctx->times[last-1];
+        write_end(ctx);
+        for (int i=0; i<ctx->n_followers; i++){
+                glauber_context *follower = ctx->followers[i];
+                write_begin(follower);
+                apply_events(follower, ctx->vertex_indices+ctx->next,
+                             ctx->uniforms+ctx->next, count);
+                follower->events += count;
+                follower->t = ctx->t;
+                write_end(follower);
+        }
+        ctx->next = last;
+}
+
+/* set the time of ctx and its followers, with the sure events of skip-ahead
+ * up to then */
+void static advance_time(glauber_context *ctx, double t){
+        write_begin(ctx);
+        ctx->t = t;
+        if (ctx->skip_rates){
+                skip_flush(ctx, t);
+        }
+        write_end(ctx);
+        for (int i=0; i<ctx->n_followers; i++){
+                write_begin(ctx->followers[i]);
+                ctx->followers[i]->t = t;
+                write_end(ctx->followers[i]);
+        }
+}
+
+int glauber_couple(glauber_context *leader, glauber_context *follower){
+        if (leader == follower || leader->leader || follower->leader ||
+            follower->n_followers || leader->rates || follower->rates ||
+            leader->trace_in || follower->trace_in || follower->trace_out ||
+            leader->skip_rates || follower->skip_rates ||
+            leader->rng != follower->rng || leader->g->n != follower->g->n){
+                return -1;
+        }
+        leader->followers = realloc(leader->followers,
+                                    (leader->n_followers+1)*sizeof(glauber_context*));
+        leader->followers[leader->n_followers++] = follower;
+        follower->leader = leader;
+        /* the rule of the follower gets the same extra randomness */
+        follower->update_rng = leader->update_rng;
+        follower->next = follower->filled = 0;
+        write_begin(follower);
+        follower->t = leader->t;
+        write_end(follower);
+        return 0;
+}
+
+void glauber_step(glauber_context *ctx, int64_t n_events){
+        if (ctx->g->n == 0 || ctx->leader){
+                return;
+        }
+        while (n_events > 0){
+                if (ctx->next == ctx->filled){
+                        draw_batch(ctx);
+                }
+                if (ctx->times[ctx->next] == INFINITY){
+                        /* all rates are 0, nothing happens anymore */
+                        break;
+                }
+                int count = ctx->filled-ctx->next;
+                if (count > n_events){
+                        count = n_events;
+                }
+                run_pending(ctx, ctx->next+count);
+                n_events -= count;
+        }
+        if (ctx->skip_rates){
+                /* the state is read at the time of the last event */
+                write_begin(ctx);
+                skip_flush(ctx, ctx->t);
+                write_end(ctx);
+        }
+}
+
+void glauber_run_until(glauber_context *ctx, double t){
+        if (t <= ctx->t || ctx->leader){
+                return;
+        }
+        while (ctx->g->n){
+                if (ctx->next == ctx->filled){
+                        draw_batch(ctx);
+                }
+                /* the pending events before t, the times are increasing */
+                int last = ctx->next;
+                while (last < ctx->filled && ctx->times[last] < t){
+                        last++;
+                }
+                if (last > ctx->next){
+                        run_pending(ctx, last);
+                }
+                if (last < ctx->filled){
+                        break;
+                }
+        }
+        /* by the memorylessness of the clocks the pending events stay valid */
+        advance_time(ctx, t);
+}
+
+/* report the increments of the last leap to the observers */
+void static notify_leap(glauber_context *ctx){
+        for (graph_index v=0; v<ctx->g->n; v++){
+                vertex *vert = ctx->g->vertices[v];
+                for (graph_index j=0; j<vert->dim; j++){
+                        int64_t count = ctx->leap->counts[ctx->leap->offsets[v] + j];
+                        if (count){
+                                notify(ctx, vert->edges[j], count);
+                        }
+                }
+        }
+}
+
+void glauber_leap_until(glauber_context *ctx, double t, double tau_max,
+                        double epsilon){
+        if (ctx->rates || ctx->n_followers || ctx->rule->rule->changes_topology ||
+            ctx->trace_out || ctx->trace_in || ctx->skip_rates){
+                /* the leaps assume that all clocks ring at rate 1 and a fixed
+                 * topology, and their lengths depend on the state, so
+                 * coupled, recorded and replayed runs are exact, as are the
+                 * ones skipping ahead */
+                glauber_run_until(ctx, t);
+                return;
+        }
+        if (t <= ctx->t || ctx->leader){
+                return;
+        }
+        if (!ctx->leap){
+                ctx->leap = tau_leap_new(ctx->g);
+        }
+        /* drop the events drawn ahead, by the memorylessness of the clocks
+         * the exact events can restart from any time */
+        ctx->next = 0;
+        ctx->filled = 0;
+        while (ctx->t < t){
+                double tau = tau_leap_choose(ctx->leap, ctx->g, &ctx->rule->params,
+                                             epsilon);
+                tau = fmin(tau, tau_max);
+                int last = tau >= t - ctx->t;
+                if (last){
+                        tau = t - ctx->t;
+                }
+                uint64_t seed;
+                if (ctx->rng == GLAUBER_RNG_PHILOX){
+                        uint32_t block[4];
+                        philox_block(ctx->seed, UINT64_MAX, ctx->leaps, block);
+                        seed = ((uint64_t) block[0] << 32) | block[1];
+                }
+                else {
+                        seed = ((uint64_t) pcg32_random_r(&ctx->update_rng) << 32) |
+                               pcg32_random_r(&ctx->update_rng);
+                }
+                write_begin(ctx);
+                int64_t events = tau_leap_apply(ctx->leap, ctx->g, &ctx->rule->params,
+                                                tau, seed, &ctx->leap_deviation);
+                if (ctx->n_observers){
+                        notify_leap(ctx);
+                }
+                ctx->events += events;
+                ctx->leap_events += events;
+                ctx->leaps++;
+                ctx->t = last ? t : ctx->t + tau;
+                write_end(ctx);
+        }
+        if (ctx->clock_times){
+                restart_clocks(ctx);
+        }
+}
+
+int64_t glauber_leap_count(const glauber_context *ctx){
+        return ctx->leaps;
+}
+
+double glauber_leap_deviation(const glauber_context *ctx){
+        return ctx->leap_events ? ctx->leap_deviation/ctx->leap_events : 0;
+}
+
+int glauber_changes_topology(const glauber_context *ctx){
+        return ctx->rule->rule->changes_topology;
+}
+
+double glauber_time(const glauber_context *ctx){
+        return ctx->t;
+}
+
+int64_t glauber_event_count(const glauber_context *ctx){
+        return ctx->events;
+}
+
+graph *glauber_graph(glauber_context *ctx){
+        return ctx->g;
+}
+
+graph_index glauber_edge_count(const glauber_context *ctx){
+        return ctx->g->m;
+}
+
+uint64_t glauber_topology_generation(const glauber_context *ctx){
+        return atomic_load_explicit(&ctx->topology, memory_order_relaxed);
+}
+
+const edge *glauber_edges(const glauber_context *ctx){
+        return ctx->g->edge_pool;
+}
+
+const double *glauber_weights(const glauber_context *ctx, size_t *stride){
+        if (stride){
+                *stride = sizeof(edge);
+        }
+        return ctx->g->edge_pool ? &ctx->g->edge_pool->weight : NULL;
+}
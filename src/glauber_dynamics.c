@@ -1,251 +1,454 @@
 #define _GNU_SOURCE //cause stdio.h to include asprintf
 
-#include <argp.h>
+#include <errno.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h> // malloc and free for file handling
-#include <string.h> //strcmp
 
 /* random number generator implementation */
 #include "pcg_variants.h"
 #include "entropy.h"
 
 #include "glauber_dynamics.h"
+#include "ordering.h"
+#include "placement.h"
 
-/* use two different rngs for the exponential clocks and the vertex choosing
- * which ensures their independence, also use them globally for this file */
-pcg32_random_t exponential_rng, uniform_rng, update_rng;
-
-/* get an exponential random variable */
-static double exponential_rand(double lambda_rate){
-        /* first generate a 'double' using the recipe in the docs for the C
-         * implementation */
-        double unif_dbl = ldexp(pcg32_random_r(&exponential_rng), -32); 
-        /* for the following line consider that -log(U)/lambda_rate with U
-         * uniform on [0, 1) gives an exponential distribution */
-        return - log(unif_dbl)/lambda_rate;
+/* analyse and write the correlations of state at time t, graphs which are not
+ * the torus of the analysis only get a comment */
+void static write_correlation(correlation_analysis *corr, FILE *out,
+                              const graph *state, double t){
+        if (correlation_analyse(corr, state, NULL)){
+                fprintf(out, "# not the %d^%d torus at time %.17g\n", corr->n, corr->d, t);
+                return;
+        }
+        correlation_write(corr, out, t);
+}
+
+/* draw the frame of state at time t to stdout, lasting duration */
+void static draw_frame(arguments *args, graph *state, lod_renderer *lod,
+                       double t, double duration){
+        if (lod){
+                lod_draw_png(lod, NULL, round(duration));
+        }
+        else {
+                render_torus_png(state, args->n, args->d, round(duration), NULL,
+                                 args->width, args->height, args->dpi,
+                                 args->penwidth, t);
+        }
+}
+
+/* draw the state at time t into the file fname, which is not created if
+ * there is no renderer */
+void static write_frame(const char *fname, arguments *args, graph *state,
+                        lod_renderer *lod, double t){
+        if (!lod && !render_available()){
+                fprintf(stderr, "%s not written.\n", fname);
+                return;
+        }
+        FILE *out = fopen(fname, "w");
+        if (!out){
+                perror("Could not open the frame file");
+                return;
+        }
+        if (lod){
+                lod_draw_png(lod, out, 1);
+        }
+        else {
+                render_torus_png(state, args->n, args->d, 1, out, args->width,
+                                 args->height, args->dpi, args->penwidth, t);
+        }
+        fclose(out);
 }
 
-/* 
- * For the implementation of poisson clocks on every vertex use that the
- * time between events of a Poisson point process of rate 1 is the exponential
- * distribution with rate 1. Furthermore, for n vertices with independent
- * exponential distribution clocks {exp_i}_{i\in [0,...,n-1]} on them the
- * next time something fires has distribution min({exp_i}) which is again
- * exponentially distributed with rate n (i.e. the sum of rates).
- * 
- * Hence, we can take a single exponential time and then choose the vector
- * uniformly which is less computatinally intensive than putting an exponential
- * clock on every vertex and managing their order.
- *
- * NOTE: The RNG is initialized only here so glauber_dynamics has to be called
- * as the first and only function of this file.
+/*
+ * The events are run by the glauber_context (cf. glauber.h), this only stops
+ * it whenever something has to happen between two events (recording the
+ * series, drawing or checking a frame or reaching threshold_time). With the
+ * frame_tracker the frames are checked every frame_density and drawn when
+ * they changed enough, prev_check and prev_frame coincide otherwise.
  */
-void glauber_dynamics(graph *init_state,
-                      update_rule graph_update,
-                      int threshold_time,
-					  arguments *args){
-        double t = 0; /* time parameter */
-
-        /* start RNG initialization */
-        uint64_t seeds1[2], seeds2[2], seeds3[2];
-        entropy_getbytes((void*)seeds1, sizeof(seeds1));
-        entropy_getbytes((void*)seeds2, sizeof(seeds2));
-        entropy_getbytes((void*)seeds3, sizeof(seeds3));
-        pcg32_srandom_r(&exponential_rng, seeds1[0], seeds1[1]);
-        pcg32_srandom_r(&uniform_rng, seeds2[0], seeds2[1]);
-        pcg32_srandom_r(&update_rng, seeds3[0], seeds3[1]);
-        /* end RNG initialization */
-
-        double prev_frame = 0; // when the previous frame was drawn
+double glauber_dynamics(glauber_context *ctx,
+                        int threshold_time,
+                        arguments *args,
+                        series_writer *series,
+                        lod_renderer *lod,
+                        frame_tracker *frames,
+                        inspect_server *inspect,
+                        correlation_analysis *correlation,
+                        FILE *correlation_out){
+        graph *state = glauber_graph(ctx);
+        double t = glauber_time(ctx);
+        double prev_frame = t; // when the previous frame was drawn
+        double prev_check = t; // when the frames were last checked
+        if (frames){
+                frames_reset(frames, t);
+        }
         while (t < threshold_time){
-                double cur_time = exponential_rand((double) args->n);
-                t += cur_time;
-
-                /* it generates strictly smaller than bound so init_state->n is
-                 * fine. */
-                int chosen_vertex_index = pcg32_boundedrand_r(&uniform_rng,
-                                                              init_state->n);
-
-                /* use the passed graph_update rule to update the graph state */
-                graph_update(init_state, chosen_vertex_index, args->alpha,
-							 &update_rng);
-
-                if (!args->silent && t-prev_frame>args->frame_density){
-						draw_torus2png(init_state, args->n, args->d, round((t-prev_frame)),
-									   NULL, args->width, args->height, args->dpi,
-									   args->penwidth, t);
+                /* the state is the one at time t, so record all the samples
+                 * that are due */
+                if (series){
+                        if (correlation && series_next_time(series) <= t){
+                                write_correlation(correlation, correlation_out, state, t);
+                        }
+                        series_record_until(series, state, t);
+                }
+
+                double stop = threshold_time;
+                if (series){
+                        stop = fmin(stop, series_next_time(series));
+                }
+                if (!args->silent){
+                        stop = fmin(stop, prev_check + args->frame_density);
+                }
+                if (!args->silent && frames){
+                        stop = fmin(stop, prev_frame + args->frame_max_interval);
+                }
+                if (inspect){
+                        /* about INSPECT_POLL_EVENTS events at rate 1 */
+                        stop = fmin(stop, t + (double) INSPECT_POLL_EVENTS/state->n);
+                }
+                if (stop > t && args->tau_leap > 0){
+                        glauber_leap_until(ctx, stop, args->tau_leap,
+                                           args->leap_epsilon);
+                }
+                else if (stop > t){
+                        glauber_run_until(ctx, stop);
+                }
+                else {
+                        /* frame-density <= 0 draws after every event */
+                        glauber_step(ctx, 1);
+                }
+                t = glauber_time(ctx);
+                if (inspect){
+                        inspect_poll(inspect);
+                }
+
+                int due = 0;
+                if (!args->silent && t-prev_check >= args->frame_density){
+                        prev_check = t;
+                        due = !frames || frames_due(frames, t, args->frame_change,
+                                                    args->frame_change_max);
+                }
+                if (!args->silent && frames && t-prev_frame >= args->frame_max_interval){
+                        due = 1;
+                }
+                if (due){
+                        draw_frame(args, state, lod, t, t-prev_frame);
                         prev_frame=t;
+                        prev_check=t;
+                        if (frames){
+                                frames_reset(frames, t);
+                        }
                 }
         }
-
+        /* the frames skipped last still take their time in the video */
+        if (frames && !args->silent && round(t-prev_frame) >= 1){
+                draw_frame(args, state, lod, t, t-prev_frame);
+        }
+        if (series){
+                series_record_until(series, state, t);
+        }
+        return t;
 }
 
-/** begin initial argument parsing code **/
-const char *argp_program_version = "glauber_dynamics 0.9";
-const char *argp_program_bug_address = "yannick.couzinie@uniroma3.it";
-
-/* Program documentation. */
-static char doc[] =
-  "General simulation code which simulates Poisson point process clocks "\
-  "put on vertices which, when ringing, perform a certain update which can "\
-  "easily be adapted by writing a custom update rule. Graphs are output using "\
-  "graphviz and the code naturally facilitates piping into ffmpeg for rendering "\
-  "videos.";
-
-static struct argp_option options[] = {
-		  {"alpha",			'a',	"double",	0,					"Set the alpha parameter for the update rules. The default is 0.5."},
-		  {"num",			'n',	"int",		0,						"Set the number of vertices per dimension (i.e. on torus we have n^d vertices). "\
-							      										"The default is 10."},	
-		  {"dim",			'd',	"int",		0,						"Set the dimension of the lattice. The default is 2."},
-		  {"max-time",		'm',	"int",		0,						"Maximum time to run the simulation for. The default is 10000."},
-          {"quiet",			'q',	0, 			0,					 	"Do not output video frames to stdout." },
-		  {"silent", 		's',	0,			OPTION_ALIAS},
-		  {"init-frame", 	'i',	"FILENAME",	OPTION_ARG_OPTIONAL,	"Save a frame of the system state after 10 time steps in init.png "\
-						         										"or in FILENAME.png if supplied."},
-          {"output",		'o', 	"FILENAME", 0,  					"Output the final state to FILENAME.png instead of final.png." },
-		  {"width",			'w',	"int",		0, 						"Set the max width for the frames in inches (graphviz option). The default is 5."},
-		  {"height",		'h',	"int",		0, 						"Set the max height for the frames in inches (graphviz option). The default is 5."},
-		  {"dpi",			'r',	"int",		0, 						"Set the max dpi (dots per inch, i.e. resolution) for the frames (graphviz option). "\
-							    				   						"The default is 200."},
-		  {"frame-density",	'f',	"int",		0, 						"Save a frame only every frame-density time units. Serves as coarse graining to reduce "\
-							    				   						"output video size. The default is 1 (i.e. approximately every full time unit a frame is saved)."},
-		  {"max-penwidth",	'p',	"int",		0, 						"Maximum penwidth used to draw the highest weighted edge (graphviz option). The default is 10."},
-                  { 0 }
-};
-
-/* use that the strto functions return the remaining string part after parsing
- * and check that that part is empty otherwise return error messages. Only to
- * be used inside parse_opt */
-void static check_input(char *remaining_str, char *error_msg, struct argp_state *state){
-        /* use that non-empty strings have length >0 and are thus true */
-        if (strlen(remaining_str)){
-                argp_error(state, "%s", error_msg);
+/* the torus or the graph of --graph with all weights init_weight, exits if
+ * the graph file cannot be read */
+graph static *build_graph(arguments *args, int init_weight){
+        if (!args->graph_fname){
+                return graph_construct_torus(args->n, args->d, init_weight);
+        }
+        FILE *in = fopen(args->graph_fname, "r");
+        if (!in){
+                perror("Could not open the graph file");
+                exit(EXIT_FAILURE);
+        }
+        graph *g = graph_read_edge_list(in, init_weight);
+        fclose(in);
+        if (!g){
+                fprintf(stderr, "Could not parse the graph file %s\n", args->graph_fname);
+                exit(EXIT_FAILURE);
         }
+        return g;
 }
 
-/* Parse a single option. */
-static error_t parse_opt (int key, char *arg, struct argp_state *state)
-{
-        /* Get the input argument from argp_parse, which we
-         * know is a pointer to our arguments structure. */
-        struct arguments *args = state->input;
-
-        char *remaining_str; /* use this to check the input */
-
-		switch (key){
-				case 'q': case 's':
-				  		args->silent = 1;
-						break;
-				case 'a':
-						args->alpha = strtod(arg, &remaining_str);
-                        check_input(remaining_str,
-                                    "False input for alpha (a), only input doubles. Example: -a 0.5.",
-                                    state);
-						break;
-				case 'f':
-						args->frame_density = strtod(arg, &remaining_str);
-                        check_input(remaining_str,
-                                    "False input for frame-density (f), only doubles. "
-                                    "Example: -f 1.",
-                                    state);
-						break;
-				case 'n':
-						args->n = (int) strtol(arg, &remaining_str, 10);
-                        check_input(remaining_str,
-                                    "False input for num (n), only input integers. Example: -n 10.",
-                                    state);
-						break;
-				case 'd':
-						args->d = (int) strtol(arg, &remaining_str, 10);
-                        check_input(remaining_str,
-                                    "False input for dim (d), only input integers. Example: -d 2.",
-                                    state);
-						break;
-				case 'm':
-						args->max_time = (int) strtol(arg, &remaining_str, 10);
-                        check_input(remaining_str,
-                                    "False input for max_time (m), only input integers. Example: -m 10000.",
-                                    state);
-						break;
-				case 'i':
-                        args->do_init = 1;
-						args->init_fname = arg;
-						break;
-				case 'o':
-				  		args->output = arg;
-						break;
-				case 'w':
-						args->width = (int) strtol(arg, &remaining_str, 10);
-                        check_input(remaining_str,
-                                    "False input for width (w), only input integers. Example: -w 5.",
-                                    state);
-						break;
-				case 'h':
-						args->height = (int) strtol(arg, &remaining_str, 10);
-                        check_input(remaining_str,
-                                    "False input for height (h), only input integers. Example: -h 5.",
-                                    state);
-						break;
-				case 'r':
-						args->dpi = (int) strtol(arg, &remaining_str, 10);
-                        check_input(remaining_str,
-                                    "False input for dpi (r), only input integers. Example: -r 200.",
-                                    state);
-						break;
-				case 'p':
-						args->penwidth = (int) strtol(arg, &remaining_str, 10);
-                        check_input(remaining_str,
-                                    "False input for penwidth (p), only input integers. Example: -p 1.",
-                                    state);
-						break;
-				default:
-						return ARGP_ERR_UNKNOWN;
-				}
-				return 0;
-		}
-
-static struct argp argp = { options, parse_opt, NULL, doc };
-
 int main(int argc, char **argv){
 		arguments args;
-        args.silent=0;
-		args.init_fname="DO NOT INIT";
-        args.do_init=0;
-		args.output="final.png";
-		args.alpha=0.5;
-		args.n=10;
-		args.d=2;
-		args.max_time=10000;
-		args.width=5;
-		args.height=5;
-		args.dpi=200;
-		args.frame_density=1.0;
-		args.penwidth=10;
-
-		argp_parse (&argp, argc, argv, 0, 0, &args);
-
-        graph *torus = graph_construct_torus(args.n, args.d, 1);
-
-		if (args.do_init){
-				glauber_dynamics(torus, polya_update, 10, &args);
+		arguments_parse(argc, argv, &args);
+        /* pin before the graph is built, so that the threads first touch
+         * their parts of it on their own nodes */
+        if (args.pin && placement_pin_threads()){
+                fprintf(stderr, "Could not pin the threads, continuing unpinned.\n");
+        }
+
+        graph *torus = build_graph(&args, 1);
+        /* the replicas of --couple, their events are matched by vertex index
+         * so they get the same order */
+        graph **coupled = malloc(args.n_coupled*sizeof(graph*));
+        for (int k=0; k<args.n_coupled; k++){
+                coupled[k] = build_graph(&args, args.coupled_weight[k]);
+        }
+
+        graph_index *order = NULL;
+        switch (args.order){
+                case ORDER_MORTON:
+                        order = torus_morton_order(args.n, args.d);
+                        break;
+                case ORDER_HILBERT:
+                        order = torus_hilbert_order(args.n, args.d);
+                        break;
+                case ORDER_RCM:
+                        order = graph_rcm_order(torus);
+                        break;
+                default:
+                        break;
+        }
+        if (order){
+                graph_relabel(torus, order);
+                for (int k=0; k<args.n_coupled; k++){
+                        graph_relabel(coupled[k], order);
+                }
+                free(order);
+        }
+        /* the graph from the file (or the relabelled one) was filled by this
+         * thread only, move the parts of the other threads to their nodes */
+        if (args.pin){
+                placement_spread_graph(torus);
+                for (int k=0; k<args.n_coupled; k++){
+                        placement_spread_graph(coupled[k]);
+                }
+        }
+
+        series_writer *series = NULL;
+        if (args.series_fname){
+                series = series_open_coupled(args.series_fname, args.series_type,
+                                             args.series_interval, args.series_edges,
+                                             args.series_fixation, torus, coupled,
+                                             args.n_coupled);
+                if (!series){
+                        perror("Could not open the time series file");
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        /* print a seed from the entropy so the run can be repeated (replays
+         * need none) */
+        uint64_t seed = args.seed;
+        if (!args.seed_given && !args.replay_fname){
+                entropy_getbytes((void*)&seed, sizeof(seed));
+                fprintf(stderr, "seed %" PRIu64 "\n", seed);
+        }
+        /* the rates only have to be tracked if they are not all 1 */
+        const rule_interface *rule = args.rate_exponent != 0 ? &polya_rate_rule
+                                                             : &polya_rule;
+        /* measured once per CPU model and kind of graph, then read from the
+         * profile */
+        if (args.autotune){
+                update_params tune_params = {.alpha=args.alpha,
+                                             .rate_exponent=args.rate_exponent};
+                autotune_config config;
+                if (autotune(args.autotune_fname, torus, rule, &tune_params,
+                             args.graph_fname ? "graph" : "torus", &config) < 0){
+                        fprintf(stderr, "Could not save the autotuning profile.\n");
+                }
+                /* the values given explicitly win */
+                if (!args.batch_size_given){
+                        args.batch_size = config.batch_size;
+                }
+                if (!args.prefetch_distance_given){
+                        args.prefetch_distance = config.prefetch_distance;
+                }
+                categorical_set_level(config.simd);
+                fprintf(stderr, "autotune batch-size %d prefetch-distance %d simd %d\n",
+                        args.batch_size, args.prefetch_distance, config.simd);
+        }
+        update_params params = {.alpha=args.alpha,
+                                .rate_exponent=args.rate_exponent,
+                                .prefetch_distance=args.prefetch_distance};
+        glauber_context *ctx = glauber_new(torus, rule, &params, seed,
+                                           args.batch_size);
+        if (args.rng != GLAUBER_RNG_PCG){
+                glauber_set_rng(ctx, args.rng);
+        }
+        if (args.skip_ahead > 0){
+                glauber_set_skip_ahead(ctx, args.skip_ahead);
+        }
+        glauber_context **followers = malloc(args.n_coupled*sizeof(glauber_context*));
+        for (int k=0; k<args.n_coupled; k++){
+                update_params coupled_params = params;
+                coupled_params.alpha = args.coupled_alpha[k];
+                followers[k] = glauber_new(coupled[k], rule, &coupled_params, seed,
+                                           args.batch_size);
+                if (args.rng != GLAUBER_RNG_PCG){
+                        glauber_set_rng(followers[k], args.rng);
+                }
+                glauber_couple(ctx, followers[k]);
+        }
+
+        /* --record-trace writes the events for later replays, which take
+         * them from the trace instead of the random numbers */
+        trace_writer *trace_out = NULL;
+        if (args.record_fname){
+                trace_out = trace_writer_open(args.record_fname, torus, rule->increment,
+                                              args.rng == GLAUBER_RNG_PHILOX ? TRACE_SORTED_EDGES : 0);
+                if (!trace_out){
+                        perror("Could not open the trace file");
+                        exit(EXIT_FAILURE);
+                }
+                glauber_record_trace(ctx, trace_out);
+        }
+        trace_reader *trace_in = NULL;
+        if (args.replay_fname){
+                trace_in = trace_reader_open(args.replay_fname, torus);
+                if (!trace_in){
+                        if (errno){
+                                perror("Could not open the trace file");
+                        }
+                        else {
+                                fprintf(stderr, "%s is no trace of this graph.\n", args.replay_fname);
+                        }
+                        exit(EXIT_FAILURE);
+                }
+                glauber_replay_trace(ctx, trace_in);
+        }
+
+        /* the frames of large tori are drawn from the blocks of the pixels,
+         * which follow the events */
+        lod_renderer *lod = NULL;
+        if (args.lod != LOD_NONE && !args.graph_fname){
+                int pixels = (args.width < args.height ? args.width : args.height)*args.dpi;
+                lod = lod_new(torus, args.n, pixels, args.lod, NULL);
+                glauber_add_observer(ctx, lod_observe, lod);
+                graph_add_hook(torus, lod_topology, lod);
+        }
+
+        /* the video frames without lod need the rendering module, which is
+         * loaded here rather than at the first frame */
+        if (!args.silent && !lod && !render_available()){
+                fprintf(stderr, "Drawing the frames needs the rendering module, run "
+                                "with -q or --lod.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /* skip the frames that would look like the previous one */
+        frame_tracker *frames = NULL;
+        if (!args.silent && (args.frame_change > 0 || args.frame_change_max > 0)){
+                frames = frames_new(torus, args.penwidth, 0);
+                glauber_add_observer(ctx, frames_observe, frames);
+                graph_add_hook(torus, frames_topology, frames);
+        }
+
+        inspect_server *inspect = NULL;
+        if (args.inspect_fname){
+                int pixels = (args.width < args.height ? args.width : args.height)*args.dpi;
+                inspect = inspect_start(args.inspect_fname, ctx,
+                                        !args.graph_fname && args.d == 2 ? args.n : 0,
+                                        pixels, args.series_fixation);
+                if (!inspect){
+                        perror("Could not open the inspection socket");
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        /* like the clusters, graph files of tori are analysed if n and d
+         * match */
+        correlation_analysis *correlation = NULL;
+        FILE *correlation_out = NULL;
+        if (args.correlation_fname){
+                correlation_out = fopen(args.correlation_fname, "w");
+                if (!correlation_out){
+                        perror("Could not open the correlation file");
+                        exit(EXIT_FAILURE);
+                }
+                correlation = correlation_new(args.n, args.d);
+        }
+
+        double t = 0;
+		if (args.do_init && !args.graph_fname){
+				t = glauber_dynamics(ctx, 10, &args, series, lod, frames, inspect,
+				                     correlation, correlation_out);
 				if (args.init_fname == NULL){
 						args.init_fname = "init.png";
 				}
-				FILE *init_state = fopen(args.init_fname, "w");
-				draw_torus2png(torus, args.n, args.d, 1, init_state,
-							   args.width, args.height, args.dpi,
-							   args.penwidth, 10);
-				fclose(init_state);
+				write_frame(args.init_fname, &args, torus, lod, t);
 		}
 				
-        glauber_dynamics(torus, polya_update, args.max_time-10, &args);
+        t = glauber_dynamics(ctx, args.max_time, &args, series, lod, frames,
+                             inspect, correlation, correlation_out);
+
+        if (inspect){
+                inspect_stop(inspect);
+        }
+        if (series){
+                series_close(series);
+        }
 
-        FILE *final_state = fopen(args.output, "w");
-		draw_torus2png(torus, args.n, args.d, 1, final_state,
-					   args.width, args.height, args.dpi,
-					   args.penwidth, args.max_time);
-        fclose(final_state);
+        if (trace_out && trace_writer_close(trace_out)){
+                perror("Could not write the trace file");
+        }
+        if (trace_in){
+                fprintf(stderr, "replayed %" PRId64 " events\n", glauber_event_count(ctx));
+                trace_reader_close(trace_in);
+        }
+
+        if (args.tau_leap > 0){
+                fprintf(stderr, "tau-leaping: %" PRId64 " leaps, estimated deviation from "
+                                "the exact dynamics %.3g (fraction of misplaced events)\n",
+                        glauber_leap_count(ctx), glauber_leap_deviation(ctx));
+        }
 
-        graph_free(torus);
+        if (args.n_coupled){
+                double values[SERIES_N_OBSERVABLES-1], paired[SERIES_N_OBSERVABLES-1];
+                series_observables(torus, NULL, args.series_fixation, values);
+                for (int k=0; k<args.n_coupled; k++){
+                        series_observables(coupled[k], NULL, args.series_fixation, paired);
+                        fprintf(stderr, "coupled alpha=%g weight=%d minus main: max_weight "
+                                        "%+g, q50 %+g, q90 %+g, fixated %+g\n",
+                                args.coupled_alpha[k], args.coupled_weight[k],
+                                paired[0]-values[0], paired[3]-values[3],
+                                paired[5]-values[5], paired[6]-values[6]);
+                }
+        }
+
+        /* the torus geometry is checked by the analysis, so graph files of
+         * tori get it as well if n and d match */
+        if (args.clusters_fname){
+                FILE *out = fopen(args.clusters_fname, "w");
+                if (!out){
+                        perror("Could not open the clusters file");
+                        exit(EXIT_FAILURE);
+                }
+                cluster_analysis *clusters = clusters_analyse(torus, NULL, args.n, args.d);
+                clusters_write(clusters, out, t);
+                fclose(out);
+                clusters_free(clusters);
+        }
+        if (correlation){
+                write_correlation(correlation, correlation_out, torus, t);
+                fclose(correlation_out);
+                correlation_free(correlation);
+        }
+
+        /* the final frame only exists for tori */
+        if (!args.graph_fname){
+                write_frame(args.output, &args, torus, lod, t);
+        }
+
+        if (lod){
+                graph_remove_hook(torus, lod_topology, lod);
+                lod_free(lod);
+        }
+        if (frames){
+                graph_remove_hook(torus, frames_topology, frames);
+                frames_free(frames);
+        }
+
+        /* the followers are freed after their leader */
+        glauber_free(ctx);
+        for (int k=0; k<args.n_coupled; k++){
+                glauber_free(followers[k]);
+        }
+        free(followers);
+        free(coupled);
+        free(args.coupled_alpha);
+        free(args.coupled_weight);
 }
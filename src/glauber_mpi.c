@@ -0,0 +1,954 @@
+/** \file glauber_mpi.c
+ * \brief Distributed-memory version of \ref glauber_dynamics using MPI.
+ *
+ * The vertices are split into contiguous ranges (\ref partition.h), every
+ * process owns one range and keeps the edges with at least one owned end
+ * (with --graph it only reads these from the file, cf. adjacency_read).
+ * Vertices of other processes adjacent to owned ones are kept as ghosts, the
+ * edges between an owned vertex and a ghost (cut edges) exist on both sides.
+ *
+ * The simulation advances in windows of length --window. Within a window
+ * every process draws the events of its owned vertices ahead (the clocks of
+ * the owned vertices superpose to a clock of rate n_owned, or with --rng
+ * philox every owned vertex runs its own clock keyed by its global index,
+ * which gives the trajectory of the serial simulation with the same seed for
+ * any number of processes). An event at a vertex without ghost neighbours
+ * only reads edges no other process changes, so these are run without
+ * communication. An event at a boundary vertex u at time tau reads the cut
+ * edges of u, which the events of the ghost neighbours of u change. So the
+ * processes first announce the times of all their boundary events to the
+ * neighbouring processes, and an event at u is only run once the outcomes
+ * (the chosen edge) of all announced ghost events before tau are known and
+ * applied. Processes run until they hit such an event, exchange the outcomes
+ * of the boundary events they ran and repeat. The earliest pending event of
+ * all processes can always run, so this makes progress, and the result has
+ * exactly the law of the serial simulation.
+ *
+ * For output the edge weights are gathered on rank 0 which holds a copy of
+ * the whole graph used for the time series and the frames.
+ */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* random number generator implementation */
+#include "pcg_variants.h"
+#include "entropy.h"
+
+#include "glauber_dynamics.h"
+#include "partition.h"
+#include "philox.h"
+#include "placement.h"
+#include "sampling.h"
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* the MPI type of graph_index */
+#ifdef GRAPH_INDEX_64
+#define MPI_GRAPH_INDEX MPI_INT64_T
+#else
+#define MPI_GRAPH_INDEX MPI_INT32_T
+#endif
+
+/* the number of edge records gather_state sends at once */
+#define GATHER_CHUNK (1 << 16)
+
+/* the rngs of this process with the same roles as in glauber_dynamics.c */
+pcg32_random_t exponential_rng, uniform_rng, update_rng;
+
+/* an announced boundary event or its outcome, other is the global index of
+ * the other end of the chosen edge (-1 if none was chosen) */
+typedef struct halo_event {
+        graph_index vertex;
+        graph_index other;
+        double time;
+} halo_event;
+
+/* an edge with global indices as gathered on rank 0 */
+typedef struct edge_record {
+        graph_index v1;
+        graph_index v2;
+        double weight;
+} edge_record;
+
+/* growing array of halo_events to be sent to one process */
+typedef struct halo_buffer {
+        halo_event *events;
+        int n;
+        int capacity;
+} halo_buffer;
+
+/* the announced events of a ghost in the current window, in time order */
+typedef struct ghost_queue {
+        double *times;
+        graph_index *others;
+        int n; /* announced */
+        int resolved; /* outcome received */
+        int applied; /* outcome applied to the local edges */
+        int capacity;
+} ghost_queue;
+
+/* everything a process needs to run its part of the graph */
+typedef struct engine {
+        int rank;
+        int size;
+        graph *g; /* owned vertices 0, ..., n_owned-1 then the ghosts */
+        graph_index lo; /* global index of the first owned vertex */
+        graph_index n_owned;
+        graph_index n_ghosts;
+        graph_index *ghosts; /* sorted global indices of the ghosts */
+        char *boundary; /* whether an owned vertex has a ghost neighbour */
+        graph_index *rank_offsets; /* the processes owning a neighbour of owned */
+        int *ranks;        /* vertex v are ranks[rank_offsets[v]...] */
+        ghost_queue *queues;
+        halo_buffer *send;
+        halo_event *recv;
+        int recv_capacity;
+
+        /* the events of the current window */
+        double *times;
+        graph_index *vertices;
+        double *uniforms;
+        int n_events;
+        int events_capacity;
+
+        /* with --rng philox the next event of every owned vertex (cf.
+         * glauber_set_rng), NULL otherwise */
+        uint64_t seed;
+        double *clock_times;
+        double *clock_uniforms;
+        uint64_t *clock_counts;
+} engine;
+
+/* get an exponential random variable */
+static double exponential_rand(double lambda_rate){
+        double unif_dbl = ldexp(pcg32_random_r(&exponential_rng), -32);
+        return - log(unif_dbl)/lambda_rate;
+}
+
+/* the neighbours of the owned vertices lo, ..., hi-1 in an edge list, those
+ * of lo+v are nbrs[offsets[v]], ..., nbrs[offsets[v+1]-1] */
+typedef struct adjacency {
+        graph_index lo;
+        graph_index *offsets;
+        graph_index *nbrs;
+} adjacency;
+
+/* the other end of an edge of owned vertex v on line line of the edge list */
+typedef struct adjacency_entry {
+        graph_index v;
+        graph_index other;
+        long line;
+} adjacency_entry;
+
+/* order by vertex, neighbour and line */
+int static entry_other_cmp(const void *a, const void *b){
+        const adjacency_entry *x = a;
+        const adjacency_entry *y = b;
+        if (x->v != y->v){
+                return (x->v > y->v) - (x->v < y->v);
+        }
+        if (x->other != y->other){
+                return (x->other > y->other) - (x->other < y->other);
+        }
+        return (x->line > y->line) - (x->line < y->line);
+}
+
+/* order by vertex and line */
+int static entry_line_cmp(const void *a, const void *b){
+        const adjacency_entry *x = a;
+        const adjacency_entry *y = b;
+        if (x->v != y->v){
+                return (x->v > y->v) - (x->v < y->v);
+        }
+        return (x->line > y->line) - (x->line < y->line);
+}
+
+/* read the neighbours of the vertices lo, ..., hi-1 from the edge list fname
+ * (already checked by rank 0) in the order of graph_read_edge_list, i.e.
+ * without self-edges and every neighbour at its first line. Only the edges
+ * of the range are kept, so no process holds the whole graph for it. Returns
+ * NULL if the file cannot be opened. */
+adjacency static *adjacency_read(const char *fname, graph_index lo, graph_index hi){
+        FILE *in = fopen(fname, "r");
+        if (!in){
+                return NULL;
+        }
+        long capacity = 1024;
+        long count = 0;
+        adjacency_entry *entries = malloc(capacity*sizeof(adjacency_entry));
+        char *text = NULL;
+        size_t text_size = 0;
+        for (long line=0; getline(&text, &text_size, in) != -1; line++){
+                char *comment = strchr(text, '#');
+                if (comment){
+                        *comment = '\0';
+                }
+                graph_index ends[2];
+                if (sscanf(text, " %" SCNgi " %" SCNgi, &ends[0], &ends[1]) != 2 ||
+                    ends[0] == ends[1]){
+                        continue; /* empty, comment or self-edge */
+                }
+                for (int k=0; k<2; k++){
+                        if (ends[k] < lo || ends[k] >= hi){
+                                continue;
+                        }
+                        if (count == capacity){
+                                capacity *= 2;
+                                entries = realloc(entries, capacity*sizeof(adjacency_entry));
+                        }
+                        entries[count++] = (adjacency_entry){.v=ends[k] - lo,
+                                                             .other=ends[1-k],
+                                                             .line=line};
+                }
+        }
+        free(text);
+        fclose(in);
+
+        /* keep the first line of every edge */
+        qsort(entries, count, sizeof(adjacency_entry), entry_other_cmp);
+        long unique = 0;
+        for (long i=0; i<count; i++){
+                if (unique == 0 || entries[unique-1].v != entries[i].v ||
+                    entries[unique-1].other != entries[i].other){
+                        entries[unique++] = entries[i];
+                }
+        }
+        qsort(entries, unique, sizeof(adjacency_entry), entry_line_cmp);
+
+        adjacency *adj = malloc(sizeof(adjacency));
+        adj->lo = lo;
+        adj->offsets = calloc(hi - lo + 1, sizeof(graph_index));
+        adj->nbrs = malloc(MAX(unique, 1)*sizeof(graph_index));
+        for (long i=0; i<unique; i++){
+                adj->offsets[entries[i].v + 1]++;
+                adj->nbrs[i] = entries[i].other;
+        }
+        for (graph_index v=0; v<hi - lo; v++){
+                adj->offsets[v+1] += adj->offsets[v];
+        }
+        free(entries);
+        return adj;
+}
+
+void static adjacency_free(adjacency *adj){
+        free(adj->offsets);
+        free(adj->nbrs);
+        free(adj);
+}
+
+/* the neighbours of global vertex v in the torus or, if adj is given, of the
+ * owned vertex v in adj, returns their number */
+graph_index static neighbours(const adjacency *adj, int n, int d, graph_index v,
+                              graph_index *out){
+        if (adj){
+                graph_index first = adj->offsets[v - adj->lo];
+                graph_index count = adj->offsets[v - adj->lo + 1] - first;
+                memcpy(out, adj->nbrs + first, count*sizeof(graph_index));
+                return count;
+        }
+        /* coordinate j of v is the digit of n^j (cf. graph_construct_torus) */
+        graph_index stride = 1;
+        for (int j=0; j<d; j++){
+                graph_index c = (v/stride) % n;
+                out[2*j] = v + ((c+1) % n - c)*stride;
+                out[2*j+1] = v + ((c+n-1) % n - c)*stride;
+                stride *= n;
+        }
+        return 2*d;
+}
+
+int static index_cmp(const void *a, const void *b){
+        graph_index x = *(const graph_index*) a;
+        graph_index y = *(const graph_index*) b;
+        return (x > y) - (x < y);
+}
+
+/* local index of the global vertex v */
+graph_index static local_index(engine *e, graph_index v){
+        if (v >= e->lo && v < e->lo + e->n_owned){
+                return v - e->lo;
+        }
+        graph_index *found = bsearch(&v, e->ghosts, e->n_ghosts, sizeof(graph_index), index_cmp);
+        assert(found);
+        return e->n_owned + (found - e->ghosts);
+}
+
+/* global index of the local vertex v */
+graph_index static global_index(engine *e, graph_index v){
+        return v < e->n_owned ? e->lo + v : e->ghosts[v - e->n_owned];
+}
+
+/* build the local graph of the range of part rank of p. adj holds the
+ * neighbours of the range or is NULL for the n^d torus */
+engine static *engine_new(partition *p, const adjacency *adj, int n, int d, int rank){
+        engine *e = calloc(1, sizeof(engine));
+        e->rank = rank;
+        e->size = p->n_parts;
+        e->lo = p->offsets[rank];
+        e->n_owned = p->offsets[rank+1] - e->lo;
+
+        graph_index max_degree = 2*d;
+        if (adj){
+                max_degree = 0;
+                for (graph_index v=0; v<e->n_owned; v++){
+                        max_degree = MAX(max_degree, adj->offsets[v+1] - adj->offsets[v]);
+                }
+        }
+        graph_index *nbrs = malloc(MAX(max_degree, 1)*sizeof(graph_index));
+
+        /* collect the ghosts */
+        graph_index capacity = 64;
+        e->ghosts = malloc(capacity*sizeof(graph_index));
+        for (graph_index v=e->lo; v<e->lo+e->n_owned; v++){
+                graph_index count = neighbours(adj, n, d, v, nbrs);
+                for (graph_index i=0; i<count; i++){
+                        if (nbrs[i] >= e->lo && nbrs[i] < e->lo + e->n_owned){
+                                continue;
+                        }
+                        if (e->n_ghosts == capacity){
+                                capacity *= 2;
+                                e->ghosts = realloc(e->ghosts, capacity*sizeof(graph_index));
+                        }
+                        e->ghosts[e->n_ghosts++] = nbrs[i];
+                }
+        }
+        qsort(e->ghosts, e->n_ghosts, sizeof(graph_index), index_cmp);
+        graph_index unique = 0;
+        for (graph_index i=0; i<e->n_ghosts; i++){
+                if (unique == 0 || e->ghosts[unique-1] != e->ghosts[i]){
+                        e->ghosts[unique++] = e->ghosts[i];
+                }
+        }
+        e->n_ghosts = unique;
+
+        /* the edges, the boundary flags and the neighbouring processes */
+        e->g = graph_new();
+        graph_add_n_vertices(e->g, e->n_owned + e->n_ghosts);
+        e->boundary = calloc(MAX(e->n_owned, 1), 1);
+        e->rank_offsets = malloc((e->n_owned+1)*sizeof(graph_index));
+        e->ranks = malloc(MAX(e->n_ghosts, 1)*sizeof(int));
+        graph_index n_ranks = 0;
+        graph_index ranks_capacity = MAX(e->n_ghosts, 1);
+        for (graph_index v=0; v<e->n_owned; v++){
+                e->rank_offsets[v] = n_ranks;
+                graph_index count = neighbours(adj, n, d, e->lo + v, nbrs);
+                for (graph_index i=0; i<count; i++){
+                        graph_index w = local_index(e, nbrs[i]);
+                        graph_add_edge(e->g, v, w, 1);
+                        if (w < e->n_owned){
+                                continue;
+                        }
+                        e->boundary[v] = 1;
+                        int owner = partition_owner(p, nbrs[i]);
+                        int seen = 0;
+                        for (graph_index k=e->rank_offsets[v]; k<n_ranks; k++){
+                                seen |= e->ranks[k] == owner;
+                        }
+                        if (!seen){
+                                if (n_ranks == ranks_capacity){
+                                        ranks_capacity *= 2;
+                                        e->ranks = realloc(e->ranks, ranks_capacity*sizeof(int));
+                                }
+                                e->ranks[n_ranks++] = owner;
+                        }
+                }
+        }
+        e->rank_offsets[e->n_owned] = n_ranks;
+        free(nbrs);
+
+        e->queues = calloc(MAX(e->n_ghosts, 1), sizeof(ghost_queue));
+        e->send = calloc(e->size, sizeof(halo_buffer));
+        return e;
+}
+
+void static engine_free(engine *e){
+        for (graph_index i=0; i<e->n_ghosts; i++){
+                free(e->queues[i].times);
+                free(e->queues[i].others);
+        }
+        for (int r=0; r<e->size; r++){
+                free(e->send[r].events);
+        }
+        free(e->queues);
+        free(e->send);
+        free(e->recv);
+        free(e->ghosts);
+        free(e->boundary);
+        free(e->rank_offsets);
+        free(e->ranks);
+        free(e->times);
+        free(e->vertices);
+        free(e->uniforms);
+        free(e->clock_times);
+        free(e->clock_uniforms);
+        free(e->clock_counts);
+        graph_free(e->g);
+        free(e);
+}
+
+/* queue ev for all the processes neighbouring owned vertex v */
+void static halo_push(engine *e, graph_index v, halo_event ev){
+        for (graph_index k=e->rank_offsets[v]; k<e->rank_offsets[v+1]; k++){
+                halo_buffer *b = &e->send[e->ranks[k]];
+                if (b->n == b->capacity){
+                        b->capacity = b->capacity ? 2*b->capacity : 64;
+                        b->events = realloc(b->events, b->capacity*sizeof(halo_event));
+                }
+                b->events[b->n++] = ev;
+        }
+}
+
+/* send the queued halo_events to their processes and receive the ones sent
+ * to this process into e->recv, returns the number received */
+int static halo_exchange(engine *e){
+        int *send_counts = malloc(e->size*sizeof(int));
+        int *recv_counts = malloc(e->size*sizeof(int));
+        int *send_displs = malloc(e->size*sizeof(int));
+        int *recv_displs = malloc(e->size*sizeof(int));
+        int send_total = 0;
+        for (int r=0; r<e->size; r++){
+                send_counts[r] = e->send[r].n*sizeof(halo_event);
+                send_displs[r] = send_total;
+                send_total += send_counts[r];
+        }
+        MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+        int recv_total = 0;
+        for (int r=0; r<e->size; r++){
+                recv_displs[r] = recv_total;
+                recv_total += recv_counts[r];
+        }
+
+        char *packed = malloc(MAX(send_total, 1));
+        for (int r=0; r<e->size; r++){
+                memcpy(packed + send_displs[r], e->send[r].events, send_counts[r]);
+                e->send[r].n = 0;
+        }
+        if (recv_total > e->recv_capacity){
+                e->recv_capacity = recv_total;
+                e->recv = realloc(e->recv, recv_total);
+        }
+        MPI_Alltoallv(packed, send_counts, send_displs, MPI_BYTE,
+                      e->recv, recv_counts, recv_displs, MPI_BYTE, MPI_COMM_WORLD);
+
+        free(packed);
+        free(send_counts);
+        free(recv_counts);
+        free(send_displs);
+        free(recv_displs);
+        return recv_total/sizeof(halo_event);
+}
+
+/* increase the cut edge between ghost x and global vertex other, which is
+ * only stored here if other is owned */
+void static apply_outcome(engine *e, graph_index x, graph_index other){
+        if (other < e->lo || other >= e->lo + e->n_owned){
+                return;
+        }
+        edge *chosen = vertex_find_connecting_edge(e->g->vertices[x], other - e->lo);
+        assert(chosen);
+        chosen->weight++;
+        e->g->vertices[chosen->v1]->local_weight++;
+        e->g->vertices[chosen->v2]->local_weight++;
+}
+
+/* make the cut edges of owned vertex v up to date for an event at tau,
+ * returns 0 if an outcome before tau is still missing */
+int static halo_ready(engine *e, graph_index v, double tau){
+        vertex *cur = e->g->vertices[v];
+        for (graph_index i=0; i<cur->dim; i++){
+                graph_index x = cur->edges[i]->v1 == v ? cur->edges[i]->v2 : cur->edges[i]->v1;
+                if (x < e->n_owned){
+                        continue;
+                }
+                ghost_queue *q = &e->queues[x - e->n_owned];
+                if (q->resolved < q->n && q->times[q->resolved] < tau){
+                        return 0;
+                }
+                /* everything before tau that is applied here happened after
+                 * all the local events that were already run */
+                while (q->applied < q->resolved && q->times[q->applied] < tau){
+                        apply_outcome(e, x, q->others[q->applied]);
+                        q->applied++;
+                }
+        }
+        return 1;
+}
+
+/* append an event to the events of the window */
+void static push_event(engine *e, double time, graph_index v, double uniform){
+        if (e->n_events == e->events_capacity){
+                e->events_capacity = e->events_capacity ? 2*e->events_capacity : 1024;
+                e->times = realloc(e->times, e->events_capacity*sizeof(double));
+                e->vertices = realloc(e->vertices, e->events_capacity*sizeof(graph_index));
+                e->uniforms = realloc(e->uniforms, e->events_capacity*sizeof(double));
+        }
+        e->times[e->n_events] = time;
+        e->vertices[e->n_events] = v;
+        e->uniforms[e->n_events] = uniform;
+        e->n_events++;
+}
+
+/* draw the next event of the clock of owned vertex v after time from */
+void static advance_clock(engine *e, graph_index v, double from){
+        e->clock_times[v] = from + philox_clock(e->seed, e->lo + v, e->clock_counts[v]++,
+                                                &e->clock_uniforms[v]);
+}
+
+/* start the philox clocks of the owned vertices at time 0 */
+void static start_clocks(engine *e, uint64_t seed){
+        e->seed = seed;
+        e->clock_times = malloc(MAX(e->n_owned, 1)*sizeof(double));
+        e->clock_uniforms = malloc(MAX(e->n_owned, 1)*sizeof(double));
+        e->clock_counts = calloc(MAX(e->n_owned, 1), sizeof(uint64_t));
+        for (graph_index v=0; v<e->n_owned; v++){
+                advance_clock(e, v, 0);
+        }
+}
+
+/* an event of a window while the events are sorted */
+typedef struct window_event {
+        double time;
+        graph_index vertex;
+        double uniform;
+} window_event;
+
+/* order by time and ties (of probability 0) by vertex like the serial heap */
+int static window_event_cmp(const void *a, const void *b){
+        const window_event *x = a;
+        const window_event *y = b;
+        if (x->time != y->time){
+                return x->time < y->time ? -1 : 1;
+        }
+        return (x->vertex > y->vertex) - (x->vertex < y->vertex);
+}
+
+/* draw the events of the owned vertices in [t0, t1) */
+void static draw_events(engine *e, double t0, double t1){
+        e->n_events = 0;
+        if (e->n_owned == 0){
+                return;
+        }
+        if (e->clock_times){
+                /* the clocks carry over from the previous window */
+                for (graph_index v=0; v<e->n_owned; v++){
+                        while (e->clock_times[v] < t1){
+                                push_event(e, e->clock_times[v], v, e->clock_uniforms[v]);
+                                advance_clock(e, v, e->clock_times[v]);
+                        }
+                }
+                window_event *sorted = malloc(MAX(e->n_events, 1)*sizeof(window_event));
+                for (int i=0; i<e->n_events; i++){
+                        sorted[i] = (window_event){.time=e->times[i], .vertex=e->vertices[i],
+                                                   .uniform=e->uniforms[i]};
+                }
+                qsort(sorted, e->n_events, sizeof(window_event), window_event_cmp);
+                for (int i=0; i<e->n_events; i++){
+                        e->times[i] = sorted[i].time;
+                        e->vertices[i] = sorted[i].vertex;
+                        e->uniforms[i] = sorted[i].uniform;
+                }
+                free(sorted);
+                return;
+        }
+        double t = t0 + exponential_rand(e->n_owned);
+        while (t < t1){
+                push_event(e, t, index_boundedrand_r(&uniform_rng, e->n_owned),
+                           ldexp(pcg32_random_r(&update_rng), -32));
+                t += exponential_rand(e->n_owned);
+        }
+}
+
+/* run all events of all processes in [t0, t1) */
+void static run_window(engine *e, rule_instance *rule, double t0, double t1){
+        draw_events(e, t0, t1);
+
+        /* announce the boundary events */
+        for (int i=0; i<e->n_events; i++){
+                if (e->boundary[e->vertices[i]]){
+                        halo_push(e, e->vertices[i], (halo_event){
+                                        .vertex=e->lo + e->vertices[i],
+                                        .other=-1, .time=e->times[i]});
+                }
+        }
+        int received = halo_exchange(e);
+        for (int i=0; i<received; i++){
+                ghost_queue *q = &e->queues[local_index(e, e->recv[i].vertex) - e->n_owned];
+                if (q->n == q->capacity){
+                        q->capacity = q->capacity ? 2*q->capacity : 16;
+                        q->times = realloc(q->times, q->capacity*sizeof(double));
+                        q->others = realloc(q->others, q->capacity*sizeof(graph_index));
+                }
+                /* the owner of the ghost sends its events in time order */
+                q->times[q->n++] = e->recv[i].time;
+        }
+
+        int next = 0;
+        int all_done = 0;
+        while (!all_done){
+                while (next < e->n_events){
+                        /* run the events without ghost neighbours in one go */
+                        int last = next;
+                        while (last < e->n_events && !e->boundary[e->vertices[last]]){
+                                last++;
+                        }
+                        if (last > next){
+                                rule_apply_batch(rule, e->g, e->vertices+next,
+                                                 e->uniforms+next, last-next,
+                                                 &update_rng, NULL);
+                                next = last;
+                                continue;
+                        }
+
+                        graph_index v = e->vertices[next];
+                        if (!halo_ready(e, v, e->times[next])){
+                                break;
+                        }
+                        graph_index slot = rule->rule->update(e->g, v, e->uniforms[next],
+                                                      &rule->params, rule->state,
+                                                      &update_rng);
+                        graph_index other = -1;
+                        if (slot >= 0){
+                                edge *chosen = e->g->vertices[v]->edges[slot];
+                                other = global_index(e, chosen->v1 == v ? chosen->v2 : chosen->v1);
+                        }
+                        halo_push(e, v, (halo_event){.vertex=e->lo + v,
+                                                     .other=other,
+                                                     .time=e->times[next]});
+                        next++;
+                }
+
+                received = halo_exchange(e);
+                for (int i=0; i<received; i++){
+                        ghost_queue *q = &e->queues[local_index(e, e->recv[i].vertex) - e->n_owned];
+                        assert(q->resolved < q->n && q->times[q->resolved] == e->recv[i].time);
+                        q->others[q->resolved++] = e->recv[i].other;
+                }
+
+                int done = next == e->n_events;
+                MPI_Allreduce(&done, &all_done, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        }
+
+        /* every process ran all its events and sent all outcomes */
+        for (graph_index i=0; i<e->n_ghosts; i++){
+                ghost_queue *q = &e->queues[i];
+                while (q->applied < q->n){
+                        apply_outcome(e, e->n_owned + i, q->others[q->applied]);
+                        q->applied++;
+                }
+                q->n = q->resolved = q->applied = 0;
+        }
+}
+
+/* write the edges start, ..., start+count-1 of the local graph with their
+ * global indices into records */
+void static fill_records(engine *e, graph_index start, int count,
+                         edge_record *records){
+        for (int i=0; i<count; i++){
+                edge *cur = e->g->edges[start + i];
+                records[i] = (edge_record){.v1=global_index(e, cur->v1),
+                                           .v2=global_index(e, cur->v2),
+                                           .weight=cur->weight};
+        }
+}
+
+/* copy the weights of count gathered records into full, the copies of a cut
+ * edge on both sides have to agree */
+void static merge_records(graph *full, const edge_record *records, int count){
+        for (int i=0; i<count; i++){
+                edge *cur = vertex_find_connecting_edge(full->vertices[records[i].v1],
+                                                        records[i].v2);
+                assert(cur);
+                if (cur->weight == 0){
+                        cur->weight = records[i].weight;
+                        full->vertices[cur->v1]->local_weight += cur->weight;
+                        full->vertices[cur->v2]->local_weight += cur->weight;
+                }
+                else {
+                        assert(cur->weight == records[i].weight);
+                }
+        }
+}
+
+/* copy the edge weights of all processes into full on rank 0. The edges are
+ * sent process by process in chunks of GATHER_CHUNK records, so neither the
+ * int counts of MPI overflow nor rank 0 needs a buffer for all of them */
+void static gather_state(engine *e, graph *full){
+        MPI_Datatype record_type;
+        MPI_Type_contiguous(sizeof(edge_record), MPI_BYTE, &record_type);
+        MPI_Type_commit(&record_type);
+        edge_record *records = malloc(GATHER_CHUNK*sizeof(edge_record));
+        if (e->rank == 0){
+                /* weights are at least 1, so 0 marks edges not seen yet */
+                for (graph_index i=0; i<full->m; i++){
+                        full->edges[i]->weight = 0;
+                }
+                for (graph_index i=0; i<full->n; i++){
+                        full->vertices[i]->local_weight = 0;
+                }
+                for (int r=0; r<e->size; r++){
+                        graph_index m = e->g->m;
+                        if (r > 0){
+                                MPI_Recv(&m, 1, MPI_GRAPH_INDEX, r, 0, MPI_COMM_WORLD,
+                                         MPI_STATUS_IGNORE);
+                        }
+                        for (graph_index start=0; start<m; start+=GATHER_CHUNK){
+                                int count = MIN(m - start, GATHER_CHUNK);
+                                if (r > 0){
+                                        MPI_Recv(records, count, record_type, r, 0,
+                                                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                                }
+                                else {
+                                        fill_records(e, start, count, records);
+                                }
+                                merge_records(full, records, count);
+                        }
+                }
+        }
+        else {
+                MPI_Send(&e->g->m, 1, MPI_GRAPH_INDEX, 0, 0, MPI_COMM_WORLD);
+                for (graph_index start=0; start<e->g->m; start+=GATHER_CHUNK){
+                        int count = MIN(e->g->m - start, GATHER_CHUNK);
+                        fill_records(e, start, count, records);
+                        MPI_Send(records, count, record_type, 0, 0, MPI_COMM_WORLD);
+                }
+        }
+        free(records);
+        MPI_Type_free(&record_type);
+}
+
+/* rank 0 decides whether the state has to be gathered at time t */
+int static output_due(engine *e, double t, double prev_frame, arguments *args,
+                      series_writer *series){
+        int due = 0;
+        if (e->rank == 0){
+                due = (series && series_next_time(series) <= t) ||
+                      (!args->silent && !args->graph_fname &&
+                       t-prev_frame >= args->frame_density);
+        }
+        MPI_Bcast(&due, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        return due;
+}
+
+/* the distributed counterpart of glauber_dynamics, full is only used on
+ * rank 0 */
+double static glauber_mpi(engine *e, rule_instance *rule, graph *full,
+                          double start_time, int threshold_time,
+                          arguments *args, series_writer *series){
+        double t = start_time;
+        double prev_frame = start_time;
+        if (output_due(e, t, prev_frame, args, series)){
+                gather_state(e, full);
+                if (e->rank == 0 && series){
+                        series_record_until(series, full, t);
+                }
+        }
+        while (t < threshold_time){
+                /* end the window at the next output */
+                double t1 = MIN(t + args->window, threshold_time);
+                if (e->rank == 0){
+                        if (series){
+                                t1 = MIN(t1, series_next_time(series));
+                        }
+                        if (!args->silent && !args->graph_fname){
+                                t1 = MIN(t1, prev_frame + args->frame_density);
+                        }
+                }
+                MPI_Bcast(&t1, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+                run_window(e, rule, t, t1);
+                t = t1;
+
+                if (output_due(e, t, prev_frame, args, series)){
+                        gather_state(e, full);
+                        if (e->rank == 0 && series){
+                                series_record_until(series, full, t);
+                        }
+                        if (e->rank == 0 && !args->silent && !args->graph_fname &&
+                            t-prev_frame >= args->frame_density){
+                                render_torus_png(full, args->n, args->d, round(t-prev_frame),
+                                                 NULL, args->width, args->height, args->dpi,
+                                               args->penwidth, t);
+                        }
+                        if (!args->silent && t-prev_frame >= args->frame_density){
+                                prev_frame = t;
+                        }
+                }
+        }
+        return t;
+}
+
+int main(int argc, char **argv){
+        MPI_Init(&argc, &argv);
+        int rank, size;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+        arguments args;
+        arguments_parse(argc, argv, &args);
+        if (args.rate_exponent != 0 || args.tau_leap > 0 || args.lod != LOD_NONE ||
+            args.inspect_fname || args.n_coupled || args.clusters_fname ||
+            args.correlation_fname || args.frame_change > 0 || args.frame_change_max > 0 ||
+            args.record_fname || args.replay_fname || args.skip_ahead > 0 ||
+            args.order != ORDER_NONE || args.autotune){
+                if (rank == 0){
+                        fprintf(stderr, "State dependent rates, tau-leaping, skip-ahead, lod and "
+                                        "adaptive frames, inspection, coupled runs, cluster and "
+                                        "correlation analyses, traces, vertex orders and "
+                                        "autotuning are not supported by glauber_dynamics_mpi.\n");
+                }
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        /* pin the processes of every machine to distinct CPUs before anything
+         * is allocated, so that all their memory is first touched on their
+         * own NUMA nodes */
+        if (args.pin){
+                MPI_Comm local;
+                int local_rank;
+                MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                                    MPI_INFO_NULL, &local);
+                MPI_Comm_rank(local, &local_rank);
+                MPI_Comm_free(&local);
+                if (placement_pin(local_rank)){
+                        fprintf(stderr, "Rank %d could not be pinned, continuing unpinned.\n", rank);
+                }
+        }
+
+        /* rank 0 reads the whole edge list, which it keeps for the output,
+         * and partitions it, every other process only reads the edges of its
+         * range. For the torus rank 0 builds the whole graph after its range */
+        graph *full = NULL;
+        partition *p = NULL;
+        if (args.graph_fname){
+                if (rank == 0){
+                        FILE *in = fopen(args.graph_fname, "r");
+                        if (!in || !(full = graph_read_edge_list(in, 1))){
+                                fprintf(stderr, "Could not read the graph file %s\n", args.graph_fname);
+                                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                        }
+                        fclose(in);
+                        graph_index *degrees = malloc(full->n*sizeof(graph_index));
+                        for (graph_index v=0; v<full->n; v++){
+                                degrees[v] = full->vertices[v]->dim;
+                        }
+                        p = partition_balanced(degrees, full->n, size);
+                        free(degrees);
+                }
+                int partitioned = p != NULL;
+                MPI_Bcast(&partitioned, 1, MPI_INT, 0, MPI_COMM_WORLD);
+                if (partitioned){
+                        if (rank != 0){
+                                p = partition_new(size);
+                        }
+                        MPI_Bcast(p->offsets, size+1, MPI_GRAPH_INDEX, 0, MPI_COMM_WORLD);
+                }
+        }
+        else {
+                p = partition_torus(args.n, args.d, size);
+        }
+        if (!p){
+                if (rank == 0){
+                        fprintf(stderr, "Cannot split the graph into %d parts.\n", size);
+                }
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        adjacency *adj = NULL;
+        if (args.graph_fname){
+                adj = adjacency_read(args.graph_fname, p->offsets[rank], p->offsets[rank+1]);
+                if (!adj){
+                        fprintf(stderr, "Could not read the graph file %s\n", args.graph_fname);
+                        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                }
+        }
+        engine *e = engine_new(p, adj, args.n, args.d, rank);
+        if (adj){
+                adjacency_free(adj);
+        }
+        partition_free(p);
+        if (rank == 0 && !full){
+                full = graph_construct_torus(args.n, args.d, 1);
+        }
+
+        /* rng initialization, all processes share the seed of rank 0 and
+         * every process gets its own streams */
+        uint64_t seed = args.seed;
+        if (!args.seed_given && rank == 0){
+                entropy_getbytes((void*)&seed, sizeof(seed));
+                fprintf(stderr, "seed %" PRIu64 "\n", seed);
+        }
+        MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        pcg32_srandom_r(&exponential_rng, seed, 3*rank);
+        pcg32_srandom_r(&uniform_rng, seed, 3*rank+1);
+        pcg32_srandom_r(&update_rng, seed, 3*rank+2);
+        if (args.rng == GLAUBER_RNG_PHILOX){
+                /* pick the edges in the order of the serial simulation */
+                graph_index *keys = malloc((e->n_owned + e->n_ghosts)*sizeof(graph_index));
+                for (graph_index v=0; v<e->n_owned + e->n_ghosts; v++){
+                        keys[v] = global_index(e, v);
+                }
+                graph_sort_edges(e->g, keys);
+                free(keys);
+                start_clocks(e, seed);
+        }
+
+        series_writer *series = NULL;
+        if (rank == 0 && args.series_fname){
+                series = series_open(args.series_fname, args.series_type,
+                                     args.series_interval, args.series_edges,
+                                     args.series_fixation, full);
+                if (!series){
+                        perror("Could not open the time series file");
+                        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                }
+        }
+
+        update_params params = {.alpha=args.alpha,
+                                .prefetch_distance=args.prefetch_distance};
+        rule_instance *polya = rule_instance_new(&polya_rule, e->g, &params);
+
+        double t = 0;
+        if (args.do_init && !args.graph_fname){
+                t = glauber_mpi(e, polya, full, t, 10, &args, series);
+                gather_state(e, full);
+                if (rank == 0){
+                        if (args.init_fname == NULL){
+                                args.init_fname = "init.png";
+                        }
+                        FILE *init_state = fopen(args.init_fname, "w");
+                        render_torus_png(full, args.n, args.d, 1, init_state,
+                                         args.width, args.height, args.dpi,
+                                         args.penwidth, t);
+                        fclose(init_state);
+                }
+        }
+
+        t = glauber_mpi(e, polya, full, t, args.max_time, &args, series);
+        rule_instance_free(polya);
+        gather_state(e, full);
+
+        if (series){
+                series_close(series);
+        }
+        /* the final frame only exists for tori */
+        if (rank == 0 && !args.graph_fname){
+                FILE *final_state = fopen(args.output, "w");
+                render_torus_png(full, args.n, args.d, 1, final_state,
+                                 args.width, args.height, args.dpi,
+                                 args.penwidth, t);
+                fclose(final_state);
+        }
+
+        if (full){
+                graph_free(full);
+        }
+        engine_free(e);
+        MPI_Finalize();
+}
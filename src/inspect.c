@@ -0,0 +1,519 @@
+#define _GNU_SOURCE // getline, strdup and clock_gettime
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "inspect.h"
+#include "lod.h"
+#include "series.h"
+
+/* the attempts of a sequence locked read before falling back to a snapshot */
+#define INSPECT_READ_ATTEMPTS 64
+
+/* how often (in milliseconds) the server thread checks whether it is stopped */
+#define INSPECT_WAKEUP 200
+
+struct inspect_server {
+        glauber_context *ctx;
+        graph *g;
+        int n;
+        int pixels;
+        double fixation;
+        char *path;
+        int listen_fd;
+        _Atomic int client_fd;
+        _Atomic int done;
+        pthread_t thread;
+
+        /* the snapshot of the weights, copied by the simulating thread in
+         * inspect_poll when requested and counted by epoch */
+        _Atomic int requested;
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+        double *snapshot;
+        graph_index snapshot_size;
+        double snapshot_time;
+        int64_t snapshot_events;
+        uint64_t epoch;
+
+        /* whether edges may be added or removed, in which case the simulating
+         * thread waits in inspect_poll after the copy (held) until the server
+         * has answered (holding), since the server reads the topology */
+        _Atomic int dynamic;
+        int held;
+        int holding;
+
+        /* the state at the previous rate query */
+        int64_t rate_events;
+        double rate_time;
+        struct timespec rate_wall;
+};
+
+/* a consistent copy of the time and the number of events */
+void static read_clock(inspect_server *server, double *t, int64_t *events){
+        while (1){
+                uint64_t sequence = glauber_read_begin(server->ctx);
+                *t = glauber_time(server->ctx);
+                *events = glauber_event_count(server->ctx);
+                if (!glauber_read_retry(server->ctx, sequence)){
+                        return;
+                }
+                sched_yield();
+        }
+}
+
+/* wait for a fresh snapshot from the simulating thread, -1 if the server is
+ * stopped before; does nothing while the simulating thread is held */
+int static take_snapshot(inspect_server *server){
+        if (server->holding){
+                return 0;
+        }
+        pthread_mutex_lock(&server->lock);
+        uint64_t epoch = server->epoch;
+        atomic_store(&server->requested, 1);
+        while (server->epoch == epoch && !atomic_load(&server->done)){
+                pthread_cond_wait(&server->cond, &server->lock);
+        }
+        int taken = server->epoch != epoch;
+        server->holding = taken && server->held;
+        pthread_mutex_unlock(&server->lock);
+        return taken ? 0 : -1;
+}
+
+/* let the simulating thread continue after the answer */
+void static release(inspect_server *server){
+        if (!server->holding){
+                return;
+        }
+        pthread_mutex_lock(&server->lock);
+        server->held = 0;
+        server->holding = 0;
+        pthread_cond_broadcast(&server->cond);
+        pthread_mutex_unlock(&server->lock);
+}
+
+/* the graph hook noting that the topology changes */
+void static topology_changed(void *data, graph *g, const graph_change *change){
+        inspect_server *server = data;
+        (void) g;
+        (void) change;
+        atomic_store(&server->dynamic, 1);
+}
+
+void inspect_poll(inspect_server *server){
+        if (!atomic_load_explicit(&server->requested, memory_order_acquire)){
+                return;
+        }
+        pthread_mutex_lock(&server->lock);
+        graph *g = server->g;
+        if (g->m > server->snapshot_size){
+                server->snapshot_size = g->m;
+                server->snapshot = realloc(server->snapshot, g->m*sizeof(double));
+        }
+        for (graph_index i=0; i<g->m; i++){
+                server->snapshot[i] = g->edges[i]->weight;
+        }
+        server->snapshot_time = glauber_time(server->ctx);
+        server->snapshot_events = glauber_event_count(server->ctx);
+        server->epoch++;
+        atomic_store(&server->requested, 0);
+        server->held = atomic_load(&server->dynamic);
+        pthread_cond_broadcast(&server->cond);
+        while (server->held && !atomic_load(&server->done)){
+                pthread_cond_wait(&server->cond, &server->lock);
+        }
+        pthread_mutex_unlock(&server->lock);
+}
+
+/* consistent copies of the weights of the edges with the given indices, from
+ * the live state if a sequence locked read succeeds, otherwise from a
+ * snapshot */
+int static read_weights(inspect_server *server, const graph_index *indices,
+                        graph_index count, double *weights){
+        for (int attempt=0; !server->holding && attempt<INSPECT_READ_ATTEMPTS; attempt++){
+                uint64_t sequence = glauber_read_begin(server->ctx);
+                for (graph_index i=0; i<count; i++){
+                        weights[i] = server->g->edges[indices[i]]->weight;
+                }
+                if (!glauber_read_retry(server->ctx, sequence)){
+                        return 0;
+                }
+                sched_yield();
+        }
+        if (take_snapshot(server)){
+                return -1;
+        }
+        for (graph_index i=0; i<count; i++){
+                weights[i] = server->snapshot[indices[i]];
+        }
+        return 0;
+}
+
+/* print the edges with the given indices as v1 v2 weight lines */
+void static reply_edges(inspect_server *server, FILE *out,
+                        const graph_index *indices, graph_index count){
+        double *weights = malloc((count ? count : 1)*sizeof(double));
+        if (read_weights(server, indices, count, weights)){
+                fprintf(out, "error stopped\n");
+        }
+        else {
+                for (graph_index i=0; i<count; i++){
+                        const edge *e = server->g->edges[indices[i]];
+                        fprintf(out, "%" PRIgi " %" PRIgi " %.17g\n",
+                                graph_original_index(server->g, e->v1),
+                                graph_original_index(server->g, e->v2), weights[i]);
+                }
+                fprintf(out, "ok\n");
+        }
+        free(weights);
+}
+
+/* the edges of the vertices within distance radius-1 of the original vertex
+ * start, found breadth first */
+void static query_vertex(inspect_server *server, FILE *out, long start,
+                         long radius){
+        graph *g = server->g;
+        if (start < 0 || start >= g->n || radius < 0){
+                fprintf(out, "error no such vertex or negative radius\n");
+                return;
+        }
+        unsigned char *expanded = calloc(g->n, 1);
+        graph_index *queue = malloc(g->n*sizeof(graph_index));
+        graph_index *indices = NULL;
+        graph_index count = 0, capacity = 0;
+        graph_index head = 0, tail = 0, level_end;
+        queue[tail++] = graph_current_index(g, start);
+        expanded[queue[0]] = 1;
+        for (long depth=0; depth<radius && head < tail; depth++){
+                level_end = tail;
+                for (; head<level_end; head++){
+                        vertex *v = g->vertices[queue[head]];
+                        for (graph_index j=0; j<v->dim; j++){
+                                edge *e = v->edges[j];
+                                graph_index other = e->v1 == queue[head] ? e->v2 : e->v1;
+                                /* edges between two expanded vertices are
+                                 * taken by the first of them only */
+                                if (expanded[other] == 2){
+                                        continue;
+                                }
+                                if (count == capacity){
+                                        capacity = capacity ? 2*capacity : 64;
+                                        indices = realloc(indices, capacity*sizeof(graph_index));
+                                }
+                                indices[count++] = e - g->edge_pool;
+                                if (!expanded[other]){
+                                        expanded[other] = 1;
+                                        queue[tail++] = other;
+                                }
+                        }
+                        expanded[queue[head]] = 2;
+                }
+        }
+        reply_edges(server, out, indices, count);
+        free(indices);
+        free(queue);
+        free(expanded);
+}
+
+/* the edges to the right and lower neighbours of a rectangle of the torus */
+void static query_region(inspect_server *server, FILE *out, long row, long col,
+                         long rows, long cols){
+        graph *g = server->g;
+        long n = server->n;
+        if (!n){
+                fprintf(out, "error regions need a 2 dimensional torus\n");
+                return;
+        }
+        if (row < 0 || col < 0 || rows < 0 || cols < 0 || row+rows > n || col+cols > n){
+                fprintf(out, "error the region is not inside the torus\n");
+                return;
+        }
+        long size = 2*rows*cols;
+        graph_index *indices = malloc((size > 0 ? size : 1)*sizeof(graph_index));
+        graph_index count = 0;
+        for (long r=row; r<row+rows; r++){
+                for (long c=col; c<col+cols; c++){
+                        graph_index v = graph_current_index(g, r*n + c);
+                        graph_index right = graph_current_index(g, r*n + (c+1)%n);
+                        graph_index down = graph_current_index(g, ((r+1)%n)*n + c);
+                        edge *e = graph_find_edge(g, v, right);
+                        if (e){
+                                indices[count++] = e - g->edge_pool;
+                        }
+                        e = graph_find_edge(g, v, down);
+                        if (e){
+                                indices[count++] = e - g->edge_pool;
+                        }
+                }
+        }
+        reply_edges(server, out, indices, count);
+        free(indices);
+}
+
+void static query_rate(inspect_server *server, FILE *out){
+        double t;
+        int64_t events;
+        read_clock(server, &t, &events);
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double seconds = (now.tv_sec - server->rate_wall.tv_sec) +
+                         1e-9*(now.tv_nsec - server->rate_wall.tv_nsec);
+        if (seconds <= 0){
+                seconds = 1e-9;
+        }
+        fprintf(out, "events_per_second %.6g time_per_second %.6g\n",
+                (events - server->rate_events)/seconds,
+                (t - server->rate_time)/seconds);
+        fprintf(out, "ok\n");
+        server->rate_events = events;
+        server->rate_time = t;
+        server->rate_wall = now;
+}
+
+void static query_observables(inspect_server *server, FILE *out){
+        if (take_snapshot(server)){
+                fprintf(out, "error stopped\n");
+                return;
+        }
+        double values[SERIES_N_OBSERVABLES-1];
+        series_observables(server->g, server->snapshot, server->fixation, values);
+        fprintf(out, "time %.17g max_weight %.17g", server->snapshot_time, values[0]);
+        const char *names[SERIES_N_QUANTILES] = {"q10", "q25", "q50", "q75", "q90"};
+        for (int q=0; q<SERIES_N_QUANTILES; q++){
+                fprintf(out, " %s %.17g", names[q], values[1+q]);
+        }
+        fprintf(out, " fixated %.17g\n", values[1+SERIES_N_QUANTILES]);
+        fprintf(out, "ok\n");
+}
+
+void static query_frame(inspect_server *server, FILE *out, const char *fname,
+                        const char *mode_name){
+        lod_mode mode = LOD_MEAN;
+        if (!server->n){
+                fprintf(out, "error frames need a 2 dimensional torus\n");
+                return;
+        }
+        if (mode_name && !strcmp(mode_name, "max")){
+                mode = LOD_MAX;
+        }
+        else if (mode_name && !strcmp(mode_name, "direction")){
+                mode = LOD_DIRECTION;
+        }
+        else if (mode_name && strcmp(mode_name, "mean")){
+                fprintf(out, "error unknown mode %s\n", mode_name);
+                return;
+        }
+        FILE *file = fopen(fname, "w");
+        if (!file){
+                fprintf(out, "error %s: %s\n", fname, strerror(errno));
+                return;
+        }
+        if (take_snapshot(server)){
+                fprintf(out, "error stopped\n");
+        }
+        else {
+                lod_renderer *lod = lod_new(server->g, server->n, server->pixels,
+                                            mode, server->snapshot);
+                lod_draw_png(lod, file, 1);
+                lod_free(lod);
+                fprintf(out, "time %.17g\nok\n", server->snapshot_time);
+        }
+        fclose(file);
+}
+
+void static query_dump(inspect_server *server, FILE *out, const char *fname){
+        FILE *file = fopen(fname, "w");
+        if (!file){
+                fprintf(out, "error %s: %s\n", fname, strerror(errno));
+                return;
+        }
+        if (take_snapshot(server)){
+                fprintf(out, "error stopped\n");
+        }
+        else {
+                graph *g = server->g;
+                fprintf(file, "# time %.17g events %" PRId64 "\n",
+                        server->snapshot_time, server->snapshot_events);
+                for (graph_index i=0; i<g->m; i++){
+                        fprintf(file, "%" PRIgi " %" PRIgi " %.17g\n",
+                                graph_original_index(g, g->edges[i]->v1),
+                                graph_original_index(g, g->edges[i]->v2),
+                                server->snapshot[i]);
+                }
+                fprintf(out, "time %.17g\nok\n", server->snapshot_time);
+        }
+        fclose(file);
+}
+
+/* answer the query in line */
+void static answer(inspect_server *server, FILE *out, char *line){
+        char *save;
+        char *command = strtok_r(line, " \t\r\n", &save);
+        char *arg[4];
+        int n_args = 0;
+        for (char *word; n_args<4 && (word = strtok_r(NULL, " \t\r\n", &save));){
+                arg[n_args++] = word;
+        }
+        if (!command){
+                fprintf(out, "error empty query\n");
+                fflush(out);
+                return;
+        }
+        /* hold the simulation while the topology is read */
+        if (atomic_load(&server->dynamic) && strcmp(command, "time") &&
+            strcmp(command, "rate") && take_snapshot(server)){
+                fprintf(out, "error stopped\n");
+        }
+        else if (!strcmp(command, "time")){
+                double t;
+                int64_t events;
+                read_clock(server, &t, &events);
+                fprintf(out, "time %.17g events %" PRId64 "\nok\n", t, events);
+        }
+        else if (!strcmp(command, "rate")){
+                query_rate(server, out);
+        }
+        else if (!strcmp(command, "observables")){
+                query_observables(server, out);
+        }
+        else if (!strcmp(command, "vertex") && n_args >= 1){
+                query_vertex(server, out, strtol(arg[0], NULL, 10),
+                             n_args > 1 ? strtol(arg[1], NULL, 10) : 1);
+        }
+        else if (!strcmp(command, "region") && n_args == 4){
+                query_region(server, out, strtol(arg[0], NULL, 10),
+                             strtol(arg[1], NULL, 10), strtol(arg[2], NULL, 10),
+                             strtol(arg[3], NULL, 10));
+        }
+        else if (!strcmp(command, "frame") && n_args >= 1){
+                query_frame(server, out, arg[0], n_args > 1 ? arg[1] : NULL);
+        }
+        else if (!strcmp(command, "dump") && n_args == 1){
+                query_dump(server, out, arg[0]);
+        }
+        else {
+                fprintf(out, "error unknown query %s\n", command);
+        }
+        release(server);
+        fflush(out);
+}
+
+/* answer the queries of one connection until it is closed */
+void static serve_client(inspect_server *server, int fd){
+        FILE *in = fdopen(fd, "r");
+        FILE *out = fdopen(dup(fd), "w");
+        if (!in || !out){
+                if (in){
+                        fclose(in);
+                }
+                else {
+                        close(fd);
+                }
+                return;
+        }
+        char *line = NULL;
+        size_t size = 0;
+        while (!atomic_load(&server->done) && getline(&line, &size, in) != -1){
+                answer(server, out, line);
+        }
+        free(line);
+        /* under the lock so that inspect_stop never shuts down a reused
+         * descriptor */
+        pthread_mutex_lock(&server->lock);
+        atomic_store(&server->client_fd, -1);
+        fclose(out);
+        fclose(in);
+        pthread_mutex_unlock(&server->lock);
+}
+
+void static *serve(void *arg){
+        inspect_server *server = arg;
+        while (!atomic_load(&server->done)){
+                struct pollfd ready = {.fd=server->listen_fd, .events=POLLIN};
+                if (poll(&ready, 1, INSPECT_WAKEUP) <= 0){
+                        continue;
+                }
+                int fd = accept(server->listen_fd, NULL, NULL);
+                if (fd < 0){
+                        continue;
+                }
+                pthread_mutex_lock(&server->lock);
+                atomic_store(&server->client_fd, fd);
+                pthread_mutex_unlock(&server->lock);
+                serve_client(server, fd);
+        }
+        return NULL;
+}
+
+inspect_server *inspect_start(const char *path, glauber_context *ctx, int n,
+                              int pixels, double fixation){
+        struct sockaddr_un address = {.sun_family=AF_UNIX};
+        if (strlen(path) >= sizeof(address.sun_path)){
+                errno = ENAMETOOLONG;
+                return NULL;
+        }
+        strcpy(address.sun_path, path);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0){
+                return NULL;
+        }
+        unlink(path);
+        if (bind(fd, (struct sockaddr*) &address, sizeof(address)) ||
+            listen(fd, 4)){
+                int error = errno;
+                close(fd);
+                errno = error;
+                return NULL;
+        }
+
+        inspect_server *server = malloc(sizeof(inspect_server));
+        graph *g = glauber_graph(ctx);
+        *server = (inspect_server){.ctx=ctx, .g=g, .n=n, .pixels=pixels,
+                                   .fixation=fixation, .path=strdup(path),
+                                   .listen_fd=fd, .epoch=0};
+        atomic_init(&server->client_fd, -1);
+        atomic_init(&server->done, 0);
+        atomic_init(&server->requested, 0);
+        atomic_init(&server->dynamic, glauber_changes_topology(ctx));
+        server->snapshot_size = g->m ? g->m : 1;
+        server->snapshot = malloc(server->snapshot_size*sizeof(double));
+        graph_add_hook(g, topology_changed, server);
+        pthread_mutex_init(&server->lock, NULL);
+        pthread_cond_init(&server->cond, NULL);
+        read_clock(server, &server->rate_time, &server->rate_events);
+        clock_gettime(CLOCK_MONOTONIC, &server->rate_wall);
+        pthread_create(&server->thread, NULL, serve, server);
+        return server;
+}
+
+void inspect_stop(inspect_server *server){
+        pthread_mutex_lock(&server->lock);
+        atomic_store(&server->done, 1);
+        pthread_cond_broadcast(&server->cond);
+        /* wake a server blocked reading from its client */
+        int client = atomic_load(&server->client_fd);
+        if (client >= 0){
+                shutdown(client, SHUT_RDWR);
+        }
+        pthread_mutex_unlock(&server->lock);
+        pthread_join(server->thread, NULL);
+        graph_remove_hook(server->g, topology_changed, server);
+        close(server->listen_fd);
+        unlink(server->path);
+        pthread_mutex_destroy(&server->lock);
+        pthread_cond_destroy(&server->cond);
+        free(server->snapshot);
+        free(server->path);
+        free(server);
+}
@@ -0,0 +1,349 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lod.h"
+
+/* the largest stored (uncompressed) deflate block */
+#define STORED_BLOCK 65535
+
+lod_renderer *lod_new(graph *g, int n, int pixels, lod_mode mode,
+                      const double *weights){
+        lod_renderer *lod = malloc(sizeof(lod_renderer));
+        if (pixels < 1){
+                pixels = 1;
+        }
+        /* the smallest blocks with at most one block per pixel */
+        int block_size = (n + pixels - 1)/pixels;
+        if (block_size < 1){
+                block_size = 1;
+        }
+        int side = (n + block_size - 1)/block_size;
+        *lod = (lod_renderer){.g=g, .n=n, .mode=mode, .block_size=block_size,
+                              .scale=side ? pixels/side : 1};
+
+        lod->levels = 1;
+        for (int s=side; s>1; s=(s+1)/2){
+                lod->levels++;
+        }
+        lod->sides = malloc(lod->levels*sizeof(int));
+        lod->pyramid = malloc(lod->levels*sizeof(lod_block*));
+        for (int k=0; k<lod->levels; k++){
+                lod->sides[k] = side;
+                lod->pyramid[k] = malloc((size_t) side*side*sizeof(lod_block));
+                side = (side+1)/2;
+        }
+
+        size_t image_side = (size_t) lod->sides[0]*lod->scale;
+        lod->raw = malloc(image_side*(1 + 3*image_side));
+        lod->png = NULL;
+        lod->png_size = 0;
+        lod_rebuild(lod, weights);
+        return lod;
+}
+
+void lod_free(lod_renderer *lod){
+        for (int k=0; k<lod->levels; k++){
+                free(lod->pyramid[k]);
+        }
+        free(lod->pyramid);
+        free(lod->sides);
+        free(lod->raw);
+        free(lod->png);
+        free(lod);
+}
+
+/*
+ * The vertex whose block the edge belongs to, i.e. the one whose right
+ * (direction 0) or lower (direction 1) neighbour is the other end, or -1 if
+ * the edge is not an edge of the torus (e.g. one added by a rewiring rule).
+ */
+graph_index static edge_cell(lod_renderer *lod, const edge *e, int *direction){
+        graph_index a = graph_original_index(lod->g, e->v1);
+        graph_index b = graph_original_index(lod->g, e->v2);
+        graph_index n = lod->n;
+        if (a/n == b/n){
+                *direction = 0;
+                if ((a%n + 1)%n == b%n){
+                        return a;
+                }
+                return (b%n + 1)%n == a%n ? b : -1;
+        }
+        if (a%n == b%n){
+                *direction = 1;
+                if ((a/n + 1)%n == b/n){
+                        return a;
+                }
+                return (b/n + 1)%n == a/n ? b : -1;
+        }
+        return -1;
+}
+
+/* combine the (up to 4) children of block row, col of level k */
+void static aggregate(lod_renderer *lod, int k, int row, int col){
+        lod_block *block = &lod->pyramid[k][row*lod->sides[k] + col];
+        *block = (lod_block){{0, 0}, {0, 0}, {0, 0}};
+        int child_side = lod->sides[k-1];
+        for (int r=2*row; r<2*row+2 && r<child_side; r++){
+                for (int c=2*col; c<2*col+2 && c<child_side; c++){
+                        const lod_block *child = &lod->pyramid[k-1][r*child_side + c];
+                        for (int i=0; i<2; i++){
+                                block->sum[i] += child->sum[i];
+                                block->max[i] = fmax(block->max[i], child->max[i]);
+                                block->count[i] += child->count[i];
+                        }
+                }
+        }
+}
+
+/* recompute the coarser levels from level 0 */
+void static combine_levels(lod_renderer *lod){
+        for (int k=1; k<lod->levels; k++){
+                for (int row=0; row<lod->sides[k]; row++){
+                        for (int col=0; col<lod->sides[k]; col++){
+                                aggregate(lod, k, row, col);
+                        }
+                }
+        }
+        lod->stale = 0;
+}
+
+void lod_rebuild(lod_renderer *lod, const double *weights){
+        int side = lod->sides[0];
+        memset(lod->pyramid[0], 0, (size_t) side*side*sizeof(lod_block));
+        for (graph_index i=0; i<lod->g->m; i++){
+                const edge *e = lod->g->edges[i];
+                double weight = weights ? weights[i] : e->weight;
+                int direction;
+                graph_index cell = edge_cell(lod, e, &direction);
+                if (cell < 0){
+                        continue;
+                }
+                int row = cell/lod->n/lod->block_size;
+                int col = cell%lod->n/lod->block_size;
+                lod_block *block = &lod->pyramid[0][row*side + col];
+                block->sum[direction] += weight;
+                block->max[direction] = fmax(block->max[direction], weight);
+                block->count[direction]++;
+        }
+        combine_levels(lod);
+}
+
+/* recompute the maximum of direction of block row, col of level 0 from the
+ * edges of its vertices */
+void static rescan_max(lod_renderer *lod, int row, int col, int direction){
+        graph_index n = lod->n;
+        double max = 0;
+        for (graph_index r=row*lod->block_size; r<n && r<(row+1)*lod->block_size; r++){
+                for (graph_index c=col*lod->block_size; c<n && c<(col+1)*lod->block_size; c++){
+                        graph_index other = direction ? ((r+1)%n)*n + c : r*n + (c+1)%n;
+                        graph_index v = graph_current_index(lod->g, r*n + c);
+                        edge *e = graph_find_edge(lod->g, v, graph_current_index(lod->g, other));
+                        if (e){
+                                max = fmax(max, e->weight);
+                        }
+                }
+        }
+        lod->pyramid[0][row*lod->sides[0] + col].max[direction] = max;
+}
+
+void lod_observe(void *data, const graph *g, const edge *e, double delta){
+        lod_renderer *lod = data;
+        (void) g;
+        int direction;
+        graph_index cell = edge_cell(lod, e, &direction);
+        if (cell < 0){
+                return;
+        }
+        int row = cell/lod->n/lod->block_size;
+        int col = cell%lod->n/lod->block_size;
+        lod_block *block = &lod->pyramid[0][row*lod->sides[0] + col];
+        block->sum[direction] += delta;
+        if (e->weight >= block->max[direction]){
+                block->max[direction] = e->weight;
+        }
+        else if (delta < 0 && e->weight - delta >= block->max[direction]){
+                /* a decreased maximum cannot be updated in place */
+                rescan_max(lod, row, col, direction);
+        }
+        lod->stale = 1;
+}
+
+void lod_topology(void *data, graph *g, const graph_change *change){
+        lod_renderer *lod = data;
+        (void) g;
+        int direction;
+        graph_index cell = edge_cell(lod, &change->edge, &direction);
+        if (change->kind == GRAPH_EDGE_MOVED || cell < 0){
+                return;
+        }
+        int row = cell/lod->n/lod->block_size;
+        int col = cell%lod->n/lod->block_size;
+        lod_block *block = &lod->pyramid[0][row*lod->sides[0] + col];
+        double weight = change->edge.weight;
+        if (change->kind == GRAPH_EDGE_ADDED){
+                block->sum[direction] += weight;
+                block->max[direction] = fmax(block->max[direction], weight);
+                block->count[direction]++;
+        }
+        else {
+                block->sum[direction] -= weight;
+                block->count[direction]--;
+                if (weight >= block->max[direction]){
+                        rescan_max(lod, row, col, direction);
+                }
+        }
+        lod->stale = 1;
+}
+
+const lod_block *lod_block_at(lod_renderer *lod, int level, int row, int col){
+        if (level > 0 && lod->stale){
+                combine_levels(lod);
+        }
+        return &lod->pyramid[level][row*lod->sides[level] + col];
+}
+
+/* the value of a block the pixels show */
+double static block_value(const lod_renderer *lod, const lod_block *block){
+        if (lod->mode == LOD_MAX){
+                return fmax(block->max[0], block->max[1]);
+        }
+        graph_index count = block->count[0] + block->count[1];
+        return count ? (block->sum[0] + block->sum[1])/count : 0;
+}
+
+/* write value big endian */
+void static put32(unsigned char *p, uint32_t value){
+        p[0] = value >> 24;
+        p[1] = value >> 16;
+        p[2] = value >> 8;
+        p[3] = value;
+}
+
+uint32_t static crc32(const uint32_t *table, const unsigned char *p, size_t len){
+        uint32_t crc = 0xffffffffu;
+        for (size_t i=0; i<len; i++){
+                crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+        }
+        return crc ^ 0xffffffffu;
+}
+
+/* append the chunk whose data of length len already sits after its length
+ * and type at p, returns the end of the chunk */
+unsigned char static *finish_chunk(const uint32_t *table, unsigned char *p,
+                                   const char *type, size_t len){
+        put32(p, len);
+        memcpy(p+4, type, 4);
+        put32(p+8+len, crc32(table, p+4, len+4));
+        return p+12+len;
+}
+
+/* encode the scanlines in lod->raw as PNG into lod->png */
+void static encode_png(lod_renderer *lod, uint32_t side){
+        uint32_t table[256];
+        for (uint32_t i=0; i<256; i++){
+                uint32_t c = i;
+                for (int k=0; k<8; k++){
+                        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[i] = c;
+        }
+        size_t raw_size = (size_t) side*(1 + 3*side);
+        size_t blocks = raw_size/STORED_BLOCK + 1;
+        size_t idat_size = 2 + 5*blocks + raw_size + 4;
+        size_t size = 8 + (12+13) + (12+idat_size) + 12;
+        if (size > lod->png_size){
+                lod->png = realloc(lod->png, size);
+        }
+        lod->png_size = size;
+
+        unsigned char *p = lod->png;
+        memcpy(p, "\x89PNG\r\n\x1a\n", 8);
+        p += 8;
+        /* 8 bit RGB, no interlacing */
+        put32(p+8, side);
+        put32(p+12, side);
+        memcpy(p+16, "\x08\x02\x00\x00\x00", 5);
+        p = finish_chunk(table, p, "IHDR", 13);
+
+        /* a zlib stream of stored deflate blocks */
+        unsigned char *q = p+8;
+        *q++ = 0x78;
+        *q++ = 0x01;
+        uint32_t s1 = 1, s2 = 0;
+        for (size_t done=0; done<raw_size;){
+                size_t len = raw_size-done < STORED_BLOCK ? raw_size-done : STORED_BLOCK;
+                *q++ = done+len == raw_size;
+                q[0] = len & 0xff;
+                q[1] = len >> 8;
+                q[2] = ~len & 0xff;
+                q[3] = (~len >> 8) & 0xff;
+                q += 4;
+                memcpy(q, lod->raw+done, len);
+                /* the Adler-32 sums cannot overflow within 5552 bytes */
+                for (size_t i=0; i<len; i+=5552){
+                        for (size_t j=i; j<len && j<i+5552; j++){
+                                s1 += q[j];
+                                s2 += s1;
+                        }
+                        s1 %= 65521;
+                        s2 %= 65521;
+                }
+                q += len;
+                done += len;
+        }
+        put32(q, (s2 << 16) | s1);
+        q += 4;
+        p = finish_chunk(table, p, "IDAT", q-(p+8));
+        p = finish_chunk(table, p, "IEND", 0);
+        lod->png_size = p - lod->png;
+}
+
+void lod_draw_png(lod_renderer *lod, FILE *out, unsigned int duration){
+        if (!out){
+                out = stdout;
+        }
+        int side = lod->sides[0];
+        const lod_block *blocks = lod->pyramid[0];
+        double top = 0;
+        for (int i=0; i<side*side; i++){
+                top = fmax(top, block_value(lod, &blocks[i]));
+        }
+
+        size_t image_side = (size_t) side*lod->scale;
+        size_t stride = 1 + 3*image_side;
+        for (int row=0; row<side; row++){
+                unsigned char *line = lod->raw + row*lod->scale*stride;
+                line[0] = 0; // no filter
+                for (int col=0; col<side; col++){
+                        const lod_block *block = &blocks[row*side + col];
+                        double x = top > 0 ? block_value(lod, block)/top : 0;
+                        /* white for no weight, black (or the colour of the
+                         * direction) for the largest */
+                        double colour[3] = {0, 0, 0};
+                        if (lod->mode == LOD_DIRECTION){
+                                double total = block->sum[0] + block->sum[1];
+                                double horizontal = total > 0 ? block->sum[0]/total : 0.5;
+                                colour[0] = 255*horizontal;
+                                colour[2] = 255*(1-horizontal);
+                        }
+                        unsigned char *pixel = line + 1 + 3*(size_t) col*lod->scale;
+                        for (int c=0; c<3; c++){
+                                pixel[c] = lround(255 - x*(255 - colour[c]));
+                        }
+                        for (int s=1; s<lod->scale; s++){
+                                memcpy(pixel + 3*s, pixel, 3);
+                        }
+                }
+                /* the other scanlines of the blocks are copies */
+                for (int s=1; s<lod->scale; s++){
+                        memcpy(line + s*stride, line, stride);
+                }
+        }
+        encode_png(lod, image_side);
+        for (unsigned int i=0; i<duration; i++){
+                fwrite(lod->png, 1, lod->png_size, out);
+        }
+        fflush(out);
+}
@@ -0,0 +1,77 @@
+#include <stdlib.h>
+
+#include "partition.h"
+
+partition *partition_new(int n_parts){
+        partition *out = malloc(sizeof(partition));
+        out->n_parts = n_parts;
+        out->offsets = malloc((n_parts+1)*sizeof(graph_index));
+        return out;
+}
+
+partition *partition_torus(int n, int d, int n_parts){
+        if (n_parts < 1 || n_parts > n){
+                return NULL;
+        }
+        graph_index layer = 1;
+        for (int j=0; j<d-1; j++){
+                layer *= n;
+        }
+        partition *out = partition_new(n_parts);
+        for (int p=0; p<=n_parts; p++){
+                /* the first n%n_parts parts get one layer more */
+                int layers = p*(n/n_parts) + (p < n%n_parts ? p : n%n_parts);
+                out->offsets[p] = layers*layer;
+        }
+        return out;
+}
+
+partition *partition_balanced(const graph_index *degrees, graph_index n_vertices,
+                              int n_parts){
+        if (n_parts < 1 || n_parts > n_vertices){
+                return NULL;
+        }
+        double total = 0;
+        for (graph_index v=0; v<n_vertices; v++){
+                total += degrees[v]+1;
+        }
+
+        partition *out = partition_new(n_parts);
+        out->offsets[0] = 0;
+        double prefix = 0;
+        graph_index v = 0;
+        for (int p=1; p<n_parts; p++){
+                /* advance until the prefix reaches the share of the first p
+                 * parts, but leave at least one vertex for the rest */
+                double target = total*p/n_parts;
+                while (v < n_vertices-(n_parts-p) &&
+                       (v < out->offsets[p-1]+1 || prefix+degrees[v]+1 <= target)){
+                        prefix += degrees[v]+1;
+                        v++;
+                }
+                out->offsets[p] = v;
+        }
+        out->offsets[n_parts] = n_vertices;
+        return out;
+}
+
+int partition_owner(const partition *p, graph_index v){
+        /* largest part whose offset is <= v */
+        int lo = 0;
+        int hi = p->n_parts-1;
+        while (lo < hi){
+                int mid = (lo+hi+1)/2;
+                if (p->offsets[mid] <= v){
+                        lo = mid;
+                }
+                else {
+                        hi = mid-1;
+                }
+        }
+        return lo;
+}
+
+void partition_free(partition *p){
+        free(p->offsets);
+        free(p);
+}
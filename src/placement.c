@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/syscall.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "placement.h"
+
+/* the constants of linux/mempolicy.h, which not every system installs */
+#define PLACEMENT_MPOL_BIND 2
+#define PLACEMENT_MPOL_MF_MOVE (1 << 1)
+/* the largest node mbind is called with */
+#define PLACEMENT_MAX_NODES 1024
+
+int placement_nodes(void){
+#ifdef __linux__
+        /* count the node<i> directories */
+        DIR *dir = opendir("/sys/devices/system/node");
+        if (!dir){
+                return 1;
+        }
+        int nodes = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir))){
+                if (!strncmp(entry->d_name, "node", 4) &&
+                    entry->d_name[4] >= '0' && entry->d_name[4] <= '9'){
+                        nodes++;
+                }
+        }
+        closedir(dir);
+        return nodes ? nodes : 1;
+#else
+        return 1;
+#endif
+}
+
+int placement_current_node(void){
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned cpu, node;
+        if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0){
+                return node;
+        }
+#endif
+        return 0;
+}
+
+int placement_bind(void *addr, size_t size, int node){
+#if defined(__linux__) && defined(SYS_mbind)
+        if (node < 0 || node >= PLACEMENT_MAX_NODES || !size){
+                return -1;
+        }
+        uintptr_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t) addr & ~(page-1);
+        uintptr_t end = ((uintptr_t) addr + size + page-1) & ~(page-1);
+        unsigned long mask[PLACEMENT_MAX_NODES/(8*sizeof(unsigned long))] = {0};
+        mask[node/(8*sizeof(unsigned long))] = 1UL << (node % (8*sizeof(unsigned long)));
+        if (syscall(SYS_mbind, start, end-start, PLACEMENT_MPOL_BIND, mask,
+                    PLACEMENT_MAX_NODES, PLACEMENT_MPOL_MF_MOVE) == 0){
+                return 0;
+        }
+#endif
+        return -1;
+}
+
+int placement_pin(int index){
+#ifdef __linux__
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed)){
+                return -1;
+        }
+        int count = CPU_COUNT(&allowed);
+        if (count == 0){
+                return -1;
+        }
+        /* find the (index mod count)-th allowed CPU */
+        int wanted = index % count;
+        for (int cpu=0; cpu<CPU_SETSIZE; cpu++){
+                if (CPU_ISSET(cpu, &allowed) && wanted-- == 0){
+                        cpu_set_t single;
+                        CPU_ZERO(&single);
+                        CPU_SET(cpu, &single);
+                        return sched_setaffinity(0, sizeof(single), &single) ? -1 : 0;
+                }
+        }
+#endif
+        return -1;
+}
+
+int placement_pin_threads(void){
+        int failed = 0;
+#ifdef _OPENMP
+        /* the threads of the pool are reused by all later parallel regions */
+        #pragma omp parallel reduction(|:failed)
+        failed |= placement_pin(omp_get_thread_num());
+#else
+        failed = placement_pin(0);
+#endif
+        return failed ? -1 : 0;
+}
+
+/* bind the part of the array of count elements of the given size that the
+ * thread-th of threads threads processes in a statically scheduled loop */
+void static bind_slice(void *array, graph_index count, size_t size,
+                       int thread, int threads, int node){
+        graph_index first = (graph_index) ((int64_t) count*thread/threads);
+        graph_index last = (graph_index) ((int64_t) count*(thread+1)/threads);
+        if (last > first){
+                placement_bind((char*) array + first*size, (last-first)*size, node);
+        }
+}
+
+void placement_spread_graph(graph *g){
+        if (placement_nodes() < 2){
+                return;
+        }
+#ifdef _OPENMP
+        #pragma omp parallel
+        {
+                int thread = omp_get_thread_num();
+                int threads = omp_get_num_threads();
+                int node = placement_current_node();
+                bind_slice(g->vertices, g->n, sizeof(vertex*), thread, threads, node);
+                bind_slice(g->edges, g->m, sizeof(edge*), thread, threads, node);
+                bind_slice(g->edge_pool, g->m, sizeof(edge), thread, threads, node);
+        }
+#else
+        /* a single thread works on everything */
+        int node = placement_current_node();
+        bind_slice(g->vertices, g->n, sizeof(vertex*), 0, 1, node);
+        bind_slice(g->edges, g->m, sizeof(edge*), 0, 1, node);
+        bind_slice(g->edge_pool, g->m, sizeof(edge), 0, 1, node);
+#endif
+}
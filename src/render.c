@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef WITHOUT_RENDER
+#include <dlfcn.h>
+#endif
+
+#include "render.h"
+
+#ifndef RENDER_MODULE
+#define RENDER_MODULE "glauber_render.so"
+#endif
+
+typedef void (*draw_function)(graph *draw_torus, int n, int d,
+                              unsigned int duration, FILE *out_stream,
+                              int max_width, int max_height, int max_dpi,
+                              int penwidth, double passed_time);
+
+/* the draw_torus2png of the module, it stays loaded until the process ends */
+static draw_function draw = NULL;
+static int loaded = 0;
+
+int render_available(void){
+#ifdef WITHOUT_RENDER
+        if (!loaded){
+                loaded = 1;
+                fprintf(stderr, "This build draws no graphviz frames (use --lod or "
+                                "glauber_dynamics).\n");
+        }
+        return 0;
+#else
+        if (loaded){
+                return draw != NULL;
+        }
+        loaded = 1;
+        const char *names[3] = {getenv("GLAUBER_RENDER_MODULE"), RENDER_MODULE,
+                                "glauber_render.so"};
+        for (int i=0; i<3; i++){
+                if (!names[i]){
+                        continue;
+                }
+                void *module = dlopen(names[i], RTLD_NOW | RTLD_LOCAL);
+                if (module){
+                        draw = (draw_function) dlsym(module, "draw_torus2png");
+                        if (draw){
+                                return 1;
+                        }
+                        dlclose(module);
+                }
+        }
+        const char *reason = dlerror();
+        fprintf(stderr, "Could not load the rendering module %s: %s\n",
+                names[0] ? names[0] : RENDER_MODULE,
+                reason ? reason : "no draw_torus2png");
+        return 0;
+#endif
+}
+
+int render_torus_png(graph *draw_torus, int n, int d, unsigned int duration,
+                     FILE *out_stream, int max_width, int max_height,
+                     int max_dpi, int penwidth, double passed_time){
+        if (!render_available()){
+                return -1;
+        }
+        draw(draw_torus, n, d, duration, out_stream, max_width, max_height,
+             max_dpi, penwidth, passed_time);
+        return 0;
+}
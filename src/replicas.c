@@ -0,0 +1,458 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define REPLICAS_X86 1
+#endif
+
+#include "replicas.h"
+
+/* the table of weight^alpha is only grown up to this size (as the one of the
+ * polya rule), beyond it the events fall back to pow */
+#define REPLICAS_MAX_POWERS (1 << 24)
+
+struct replica_set {
+        int lanes;
+        double alpha;
+        double t;
+        graph_index n, m;
+        /* the edges of vertex v are in the slots offsets[v], ...,
+         * offsets[v+1]-1 of rows, which holds i*lanes for edge i, i.e. the
+         * start of its row of weights */
+        graph_index *offsets;
+        int64_t *rows;
+        graph_index max_degree;
+        double *weights;
+        /* powers[w] = pow(w, alpha), all weights are below n_powers while
+         * tabled is set */
+        double *powers;
+        long n_powers;
+        int tabled;
+        simd_level level;
+        /* the streams of glauber_new for every lane, the first one draws the
+         * numbers of events, the next event of every lane and the events it
+         * has left before the time run to */
+        pcg32_random_t *count_rngs, *uniform_rngs, *update_rngs;
+        graph_index *next_vertices;
+        double *next_uniforms;
+        int64_t *remaining;
+        int64_t *events;
+        uint32_t threshold; /* the rejection threshold of the vertex draws */
+        /* scratch: the lanes with a due event, and the cumulative sums of
+         * the powers, the weights and their indices in weights of the slots
+         * of a group of lanes */
+        int *due;
+        double *sums, *slot_weights;
+        int64_t *slot_indices;
+};
+
+/* make room in the table for the weight w, give up on the table if it would
+ * grow too large */
+void static grow_powers(replica_set *set, double w){
+        if (w < set->n_powers){
+                return;
+        }
+        if (w >= REPLICAS_MAX_POWERS){
+                set->tabled = 0;
+                return;
+        }
+        long new_size = set->n_powers ? set->n_powers : 64;
+        while (new_size <= w){
+                new_size *= 2;
+        }
+        set->powers = realloc(set->powers, new_size*sizeof(double));
+        for (long i=set->n_powers; i<new_size; i++){
+                set->powers[i] = pow(i, set->alpha);
+        }
+        set->n_powers = new_size;
+}
+
+/* draw the vertex and the uniform of the next event of lane */
+void static draw_next(replica_set *set, int lane){
+        if ((uint64_t) set->n > UINT32_MAX){
+                set->next_vertices[lane] = index_boundedrand_r(&set->uniform_rngs[lane],
+                                                               set->n);
+        }
+        else {
+                /* pcg32_boundedrand_r with the rejection threshold computed
+                 * once */
+                uint32_t r;
+                do {
+                        r = pcg32_random_r(&set->uniform_rngs[lane]);
+                } while (r < set->threshold);
+                set->next_vertices[lane] = r % (uint32_t) set->n;
+        }
+        /* the double of the recipe in the pcg docs, scaled by a
+         * multiplication instead of ldexp */
+        set->next_uniforms[lane] = pcg32_random_r(&set->update_rngs[lane])*0x1p-32;
+}
+
+replica_set *replicas_new(const graph *g, int lanes, double alpha,
+                          uint64_t seed){
+        replica_set *set = calloc(1, sizeof(replica_set));
+        set->lanes = lanes;
+        set->alpha = alpha;
+        set->n = g->n;
+        set->m = g->m;
+        set->threshold = g->n && (uint64_t) g->n <= UINT32_MAX ? -(uint32_t) g->n % (uint32_t) g->n : 0;
+        set->offsets = malloc((g->n+1)*sizeof(graph_index));
+        set->offsets[0] = 0;
+        for (graph_index v=0; v<g->n; v++){
+                graph_index dim = g->vertices[v]->dim;
+                set->offsets[v+1] = set->offsets[v] + dim;
+                if (dim > set->max_degree){
+                        set->max_degree = dim;
+                }
+        }
+        set->rows = malloc((set->offsets[g->n] ? set->offsets[g->n] : 1)*sizeof(int64_t));
+        for (graph_index v=0; v<g->n; v++){
+                vertex *cur = g->vertices[v];
+                for (graph_index j=0; j<cur->dim; j++){
+                        set->rows[set->offsets[v]+j] = (int64_t) (cur->edges[j] - g->edge_pool)*lanes;
+                }
+        }
+
+        set->weights = malloc((g->m ? g->m : 1)*lanes*sizeof(double));
+        set->tabled = 1;
+        double max_weight = 0;
+        for (graph_index i=0; i<g->m; i++){
+                double w = g->edges[i]->weight;
+                if (w != floor(w) || w < 0){
+                        set->tabled = 0;
+                }
+                max_weight = fmax(max_weight, w);
+                for (int l=0; l<lanes; l++){
+                        set->weights[i*lanes + l] = w;
+                }
+        }
+        if (set->tabled){
+                grow_powers(set, max_weight);
+        }
+        set->level = simd_supported();
+
+        set->count_rngs = malloc(lanes*sizeof(pcg32_random_t));
+        set->uniform_rngs = malloc(lanes*sizeof(pcg32_random_t));
+        set->update_rngs = malloc(lanes*sizeof(pcg32_random_t));
+        set->next_vertices = malloc(lanes*sizeof(graph_index));
+        set->next_uniforms = malloc(lanes*sizeof(double));
+        set->remaining = malloc(lanes*sizeof(int64_t));
+        set->events = calloc(lanes, sizeof(int64_t));
+        set->due = malloc(lanes*sizeof(int));
+        /* 8 lanes of the blocks of four slots covering the largest degree */
+        size_t scratch = ((set->max_degree + 3)/4*4 + 4)*8;
+        set->sums = malloc(scratch*sizeof(double));
+        set->slot_weights = malloc(scratch*sizeof(double));
+        set->slot_indices = malloc(scratch*sizeof(int64_t));
+        for (int l=0; l<lanes; l++){
+                pcg32_srandom_r(&set->count_rngs[l], seed + l, 0);
+                pcg32_srandom_r(&set->uniform_rngs[l], seed + l, 1);
+                pcg32_srandom_r(&set->update_rngs[l], seed + l, 2);
+        }
+        return set;
+}
+
+void replicas_free(replica_set *set){
+        free(set->offsets);
+        free(set->rows);
+        free(set->weights);
+        free(set->powers);
+        free(set->count_rngs);
+        free(set->uniform_rngs);
+        free(set->update_rngs);
+        free(set->next_vertices);
+        free(set->next_uniforms);
+        free(set->remaining);
+        free(set->events);
+        free(set->due);
+        free(set->sums);
+        free(set->slot_weights);
+        free(set->slot_indices);
+        free(set);
+}
+
+simd_level replicas_set_simd(replica_set *set, simd_level level){
+        simd_level supported = simd_supported();
+        set->level = level < supported ? level : supported;
+        return set->level;
+}
+
+/* the event of one lane, with pow for weights outside of the table */
+void static apply_scalar(replica_set *set, int lane){
+        graph_index v = set->next_vertices[lane];
+        graph_index first = set->offsets[v];
+        graph_index dim = set->offsets[v+1] - first;
+        if (!dim){
+                return;
+        }
+        double *powers = set->sums;
+        for (graph_index j=0; j<dim; j++){
+                double w = set->weights[set->rows[first+j] + lane];
+                powers[j] = set->tabled ? set->powers[(long) w] : pow(w, set->alpha);
+        }
+        graph_index slot = categorical_choose_level(SIMD_SCALAR, powers, dim,
+                                                    set->next_uniforms[lane]);
+        double w = ++set->weights[set->rows[first+slot] + lane];
+        if (set->tabled){
+                grow_powers(set, w);
+        }
+}
+
+#ifdef REPLICAS_X86
+/* the events of up to 4 lanes. The powers of slot j of lane k are summed in
+ * sums[4*j + k], block by block of four slots as in block_sums of sampling.c
+ * with zero powers padding the vertices of smaller degree, and the index and
+ * weight of the slot are kept to increment the chosen one */
+__attribute__((target("avx2")))
+void static apply_avx2(replica_set *set, const int *lanes, int count){
+        int64_t lane[4] = {0}, first[4] = {0}, dim[4] = {0};
+        double unif[4] = {0};
+        graph_index max_dim = 0;
+        for (int k=0; k<count; k++){
+                graph_index v = set->next_vertices[lanes[k]];
+                lane[k] = lanes[k];
+                first[k] = set->offsets[v];
+                dim[k] = set->offsets[v+1] - set->offsets[v];
+                unif[k] = set->next_uniforms[lanes[k]];
+                if (dim[k] > max_dim){
+                        max_dim = dim[k];
+                }
+        }
+        __m256i lane_v = _mm256_loadu_si256((__m256i*) lane);
+        __m256i first_v = _mm256_loadu_si256((__m256i*) first);
+        __m256i dim_v = _mm256_loadu_si256((__m256i*) dim);
+        __m256i last_v = _mm256_sub_epi64(dim_v, _mm256_set1_epi64x(1));
+        __m256d zero = _mm256_setzero_pd();
+        __m256d carry = zero, total = zero, chosen_weight = zero;
+        __m256i chosen = _mm256_setzero_si256();
+        double *sums = set->sums, *weights = set->slot_weights;
+        int64_t *indices = set->slot_indices;
+        for (graph_index j=0; j<max_dim; j+=4){
+                __m256d p[4], s[4];
+                __m256i last[4];
+                for (int k=0; k<4; k++){
+                        __m256i slot = _mm256_set1_epi64x(j+k);
+                        __m256i mask = _mm256_cmpgt_epi64(dim_v, slot);
+                        __m256i row = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(),
+                                                                  (const long long*) set->rows,
+                                                                  _mm256_add_epi64(first_v, slot),
+                                                                  mask, 8);
+                        __m256i index = _mm256_add_epi64(row, lane_v);
+                        __m256d w = _mm256_mask_i64gather_pd(zero, set->weights, index,
+                                                             _mm256_castsi256_pd(mask), 8);
+                        p[k] = _mm256_mask_i32gather_pd(zero, set->powers,
+                                                        _mm256_cvttpd_epi32(w),
+                                                        _mm256_castsi256_pd(mask), 8);
+                        _mm256_storeu_si256((__m256i*) (indices + 4*(j+k)), index);
+                        _mm256_storeu_pd(weights + 4*(j+k), w);
+                        /* the last slot is chosen if no sum passes x */
+                        last[k] = _mm256_cmpeq_epi64(last_v, slot);
+                        chosen = _mm256_blendv_epi8(chosen, index, last[k]);
+                        chosen_weight = _mm256_blendv_pd(chosen_weight, w,
+                                                         _mm256_castsi256_pd(last[k]));
+                }
+                __m256d a1 = _mm256_add_pd(p[1], p[0]);
+                __m256d a2 = _mm256_add_pd(p[2], p[1]);
+                __m256d a3 = _mm256_add_pd(p[3], p[2]);
+                s[0] = _mm256_add_pd(carry, p[0]);
+                s[1] = _mm256_add_pd(carry, a1);
+                s[2] = _mm256_add_pd(carry, _mm256_add_pd(a2, p[0]));
+                s[3] = _mm256_add_pd(carry, _mm256_add_pd(a3, a1));
+                for (int k=0; k<4; k++){
+                        _mm256_storeu_pd(sums + 4*(j+k), s[k]);
+                        total = _mm256_blendv_pd(total, s[k], _mm256_castsi256_pd(last[k]));
+                }
+                carry = s[3];
+        }
+        /* invert the sums at unif times the sum of all slots of every lane */
+        __m256d x = _mm256_mul_pd(_mm256_loadu_pd(unif), total);
+        __m256i open = _mm256_cmpgt_epi64(dim_v, _mm256_setzero_si256());
+        for (graph_index j=0; j<max_dim && !_mm256_testz_si256(open, open); j++){
+                __m256i below = _mm256_castpd_si256(_mm256_cmp_pd(x, _mm256_loadu_pd(sums + 4*j),
+                                                                  _CMP_LT_OQ));
+                __m256i found = _mm256_and_si256(_mm256_and_si256(below, open),
+                                                 _mm256_cmpgt_epi64(dim_v, _mm256_set1_epi64x(j)));
+                chosen = _mm256_blendv_epi8(chosen, _mm256_loadu_si256((__m256i*) (indices + 4*j)),
+                                            found);
+                chosen_weight = _mm256_blendv_pd(chosen_weight, _mm256_loadu_pd(weights + 4*j),
+                                                 _mm256_castsi256_pd(found));
+                open = _mm256_andnot_si256(found, open);
+        }
+        int64_t index[4];
+        double w[4];
+        _mm256_storeu_si256((__m256i*) index, chosen);
+        _mm256_storeu_pd(w, _mm256_add_pd(chosen_weight, _mm256_set1_pd(1)));
+        for (int k=0; k<count; k++){
+                if (dim[k]){
+                        set->weights[index[k]] = w[k];
+                        grow_powers(set, w[k]);
+                }
+        }
+}
+
+/* the events of up to 8 lanes as apply_avx2, with a scatter for the
+ * increments */
+__attribute__((target("avx512f")))
+void static apply_avx512(replica_set *set, const int *lanes, int count){
+        int64_t lane[8] = {0}, first[8] = {0}, dim[8] = {0};
+        double unif[8] = {0};
+        graph_index max_dim = 0;
+        for (int k=0; k<count; k++){
+                graph_index v = set->next_vertices[lanes[k]];
+                lane[k] = lanes[k];
+                first[k] = set->offsets[v];
+                dim[k] = set->offsets[v+1] - set->offsets[v];
+                unif[k] = set->next_uniforms[lanes[k]];
+                if (dim[k] > max_dim){
+                        max_dim = dim[k];
+                }
+        }
+        __m512i lane_v = _mm512_loadu_si512(lane);
+        __m512i first_v = _mm512_loadu_si512(first);
+        __m512i dim_v = _mm512_loadu_si512(dim);
+        __m512i last_v = _mm512_sub_epi64(dim_v, _mm512_set1_epi64(1));
+        __m512d zero = _mm512_setzero_pd();
+        __m512d carry = zero, total = zero, chosen_weight = zero;
+        __m512i chosen = _mm512_setzero_si512();
+        double *sums = set->sums, *weights = set->slot_weights;
+        int64_t *indices = set->slot_indices;
+        for (graph_index j=0; j<max_dim; j+=4){
+                __m512d p[4], s[4];
+                __mmask8 last[4];
+                for (int k=0; k<4; k++){
+                        __m512i slot = _mm512_set1_epi64(j+k);
+                        __mmask8 mask = _mm512_cmpgt_epi64_mask(dim_v, slot);
+                        __m512i row = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), mask,
+                                                                  _mm512_add_epi64(first_v, slot),
+                                                                  set->rows, 8);
+                        __m512i index = _mm512_add_epi64(row, lane_v);
+                        __m512d w = _mm512_mask_i64gather_pd(zero, mask, index, set->weights, 8);
+                        p[k] = _mm512_mask_i32gather_pd(zero, mask, _mm512_cvttpd_epi32(w),
+                                                        set->powers, 8);
+                        _mm512_storeu_si512(indices + 8*(j+k), index);
+                        _mm512_storeu_pd(weights + 8*(j+k), w);
+                        last[k] = _mm512_cmpeq_epi64_mask(last_v, slot);
+                        chosen = _mm512_mask_mov_epi64(chosen, last[k], index);
+                        chosen_weight = _mm512_mask_mov_pd(chosen_weight, last[k], w);
+                }
+                __m512d a1 = _mm512_add_pd(p[1], p[0]);
+                __m512d a2 = _mm512_add_pd(p[2], p[1]);
+                __m512d a3 = _mm512_add_pd(p[3], p[2]);
+                s[0] = _mm512_add_pd(carry, p[0]);
+                s[1] = _mm512_add_pd(carry, a1);
+                s[2] = _mm512_add_pd(carry, _mm512_add_pd(a2, p[0]));
+                s[3] = _mm512_add_pd(carry, _mm512_add_pd(a3, a1));
+                for (int k=0; k<4; k++){
+                        _mm512_storeu_pd(sums + 8*(j+k), s[k]);
+                        total = _mm512_mask_mov_pd(total, last[k], s[k]);
+                }
+                carry = s[3];
+        }
+        __m512d x = _mm512_mul_pd(_mm512_loadu_pd(unif), total);
+        __mmask8 active = _mm512_cmpgt_epi64_mask(dim_v, _mm512_setzero_si512());
+        __mmask8 open = active;
+        for (graph_index j=0; j<max_dim && open; j++){
+                __mmask8 found = _mm512_mask_cmp_pd_mask(open & _mm512_cmpgt_epi64_mask(dim_v, _mm512_set1_epi64(j)),
+                                                         x, _mm512_loadu_pd(sums + 8*j),
+                                                         _CMP_LT_OQ);
+                chosen = _mm512_mask_loadu_epi64(chosen, found, indices + 8*j);
+                chosen_weight = _mm512_mask_loadu_pd(chosen_weight, found, weights + 8*j);
+                open &= ~found;
+        }
+        __m512d w = _mm512_add_pd(chosen_weight, _mm512_set1_pd(1));
+        /* the lanes are different, so are the indices of the scatter */
+        _mm512_mask_i64scatter_pd(set->weights, active, chosen, w, 8);
+        if (active){
+                grow_powers(set, _mm512_mask_reduce_max_pd(active, w));
+        }
+}
+#endif
+
+/* apply the events of the count lanes, the lanes after the table was given
+ * up on with pow */
+void static apply(replica_set *set, const int *lanes, int count){
+        int i = 0;
+#ifdef REPLICAS_X86
+        if (set->level == SIMD_AVX512){
+                for (; i<count && set->tabled; i+=8){
+                        apply_avx512(set, lanes+i, count-i < 8 ? count-i : 8);
+                }
+        }
+        else if (set->level == SIMD_AVX2){
+                for (; i<count && set->tabled; i+=4){
+                        apply_avx2(set, lanes+i, count-i < 4 ? count-i : 4);
+                }
+        }
+#endif
+        for (; i<count; i++){
+                apply_scalar(set, lanes[i]);
+        }
+}
+
+/*
+ * The clocks of all vertices ring at rate 1, so the events of a lane form a
+ * Poisson process of rate n independent of the state, and the vertices and
+ * uniforms of its events do not depend on their times. Hence it suffices to
+ * draw the number of events of every lane up to t, which is Poisson with mean
+ * n times the elapsed time, and to apply them in order, which needs no
+ * exponential times (and their logarithms) at all.
+ */
+void replicas_run_until(replica_set *set, double t){
+        if (t <= set->t){
+                return;
+        }
+        for (int l=0; l<set->lanes; l++){
+                set->remaining[l] = poisson_rand_r(&set->count_rngs[l],
+                                                   set->n*(t - set->t));
+        }
+        while (1){
+                int count = 0;
+                for (int l=0; l<set->lanes; l++){
+                        if (set->remaining[l]){
+                                set->due[count++] = l;
+                        }
+                }
+                if (!count){
+                        break;
+                }
+                for (int i=0; i<count; i++){
+                        draw_next(set, set->due[i]);
+                }
+                apply(set, set->due, count);
+                for (int i=0; i<count; i++){
+                        set->remaining[set->due[i]]--;
+                        set->events[set->due[i]]++;
+                }
+        }
+        set->t = t;
+}
+
+double replicas_time(const replica_set *set){
+        return set->t;
+}
+
+int replicas_lanes(const replica_set *set){
+        return set->lanes;
+}
+
+int64_t replicas_event_count(const replica_set *set, int lane){
+        return set->events[lane];
+}
+
+const double *replicas_weights(const replica_set *set){
+        return set->weights;
+}
+
+void replicas_copy_lane(const replica_set *set, int lane, graph *g){
+        for (graph_index i=0; i<set->m; i++){
+                g->edges[i]->weight = set->weights[i*set->lanes + lane];
+        }
+        for (graph_index v=0; v<g->n; v++){
+                vertex *cur = g->vertices[v];
+                cur->local_weight = 0;
+                for (graph_index j=0; j<cur->dim; j++){
+                        cur->local_weight += cur->edges[j]->weight;
+                }
+        }
+}
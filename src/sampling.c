@@ -0,0 +1,370 @@
+#include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SAMPLING_X86 1
+#endif
+
+#include "sampling.h"
+
+graph_index index_boundedrand_r(pcg32_random_t *rng, graph_index bound){
+        if ((uint64_t) bound <= UINT32_MAX){
+                return pcg32_boundedrand_r(rng, (uint32_t) bound);
+        }
+        uint64_t range = bound;
+        uint64_t x = ((uint64_t) pcg32_random_r(rng) << 32) | pcg32_random_r(rng);
+        __uint128_t product = (__uint128_t) x*range;
+        uint64_t low = (uint64_t) product;
+        if (low < range){
+                /* reject the 2^64 mod range lowest values of low so that every
+                 * result has the same number of preimages */
+                uint64_t threshold = -range % range;
+                while (low < threshold){
+                        x = ((uint64_t) pcg32_random_r(rng) << 32) | pcg32_random_r(rng);
+                        product = (__uint128_t) x*range;
+                        low = (uint64_t) product;
+                }
+        }
+        return (graph_index) (product >> 64);
+}
+
+/* uniform double on [0, 1) using the recipe in the pcg docs */
+double static unif_rand(pcg32_random_t *rng){
+        return ldexp(pcg32_random_r(rng), -32);
+}
+
+int64_t poisson_rand_r(pcg32_random_t *rng, double mean){
+        if (mean <= 0){
+                return 0;
+        }
+        if (mean < 10){
+                /* walk the cumulative distribution until it passes a uniform */
+                double u = unif_rand(rng);
+                double p = exp(-mean);
+                double cumulative = p;
+                int64_t k = 0;
+                while (u >= cumulative && p > 0){
+                        k++;
+                        p *= mean/k;
+                        cumulative += p;
+                }
+                return k;
+        }
+        double slam = sqrt(mean);
+        double loglam = log(mean);
+        double b = 0.931 + 2.53*slam;
+        double a = -0.059 + 0.02483*b;
+        double invalpha = 1.1239 + 1.1328/(b - 3.4);
+        double vr = 0.9277 - 3.6224/(b - 2);
+        while (1){
+                double u = unif_rand(rng) - 0.5;
+                double v = unif_rand(rng);
+                double us = 0.5 - fabs(u);
+                int64_t k = (int64_t) floor((2*a/us + b)*u + mean + 0.43);
+                if (us >= 0.07 && v <= vr){
+                        return k;
+                }
+                if (k < 0 || (us < 0.013 && v > us)){
+                        continue;
+                }
+                if (log(v) + log(invalpha) - log(a/(us*us) + b) <=
+                    -mean + k*loglam - lgamma(k + 1)){
+                        return k;
+                }
+        }
+}
+
+simd_level simd_supported(void){
+#ifdef SAMPLING_X86
+        if (__builtin_cpu_supports("avx512f")){
+                return SIMD_AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")){
+                return SIMD_AVX2;
+        }
+#endif
+        return SIMD_SCALAR;
+}
+
+/* the cumulative sums of the block of four weights w (zero padded) starting
+ * with carry, added in the order of the vector kernels: a = w + (w shifted by
+ * one lane), b = a + (a shifted by two lanes), sums = carry + b */
+void static block_sums(const double w[4], double carry, double sums[4]){
+        double a1 = w[1] + w[0];
+        double a2 = w[2] + w[1];
+        double a3 = w[3] + w[2];
+        sums[0] = carry + w[0];
+        sums[1] = carry + a1;
+        sums[2] = carry + (a2 + w[0]);
+        sums[3] = carry + (a3 + a1);
+}
+
+graph_index static categorical_choose_scalar(const double *weights,
+                                             graph_index count, double unif){
+        double w[4], sums[4];
+        /* first pass for the total, second pass for the search */
+        double carry = 0;
+        double total = 0;
+        for (graph_index i=0; i<count; i+=4){
+                for (int k=0; k<4; k++){
+                        w[k] = i+k < count ? weights[i+k] : 0;
+                }
+                block_sums(w, carry, sums);
+                carry = sums[3];
+                total = sums[count-i < 4 ? count-i-1 : 3];
+        }
+        double x = unif*total;
+        carry = 0;
+        for (graph_index i=0; i<count; i+=4){
+                for (int k=0; k<4; k++){
+                        w[k] = i+k < count ? weights[i+k] : 0;
+                }
+                block_sums(w, carry, sums);
+                for (int k=0; k<4 && i+k<count; k++){
+                        if (x < sums[k]){
+                                return i+k;
+                        }
+                }
+                carry = sums[3];
+        }
+        return count-1;
+}
+
+#ifdef SAMPLING_X86
+/* the cumulative sums of the block of four weights in w starting with carry,
+ * cf. block_sums */
+__attribute__((target("avx2")))
+__m256d static block_sums_avx2(__m256d w, __m256d carry){
+        __m256d zero = _mm256_setzero_pd();
+        /* [0, w0, w1, w2] */
+        __m256d shifted = _mm256_blend_pd(_mm256_permute4x64_pd(w, _MM_SHUFFLE(2, 1, 0, 0)),
+                                          zero, 1);
+        __m256d a = _mm256_add_pd(w, shifted);
+        /* [0, 0, a0, a1] */
+        shifted = _mm256_permute2f128_pd(a, a, 0x08);
+        return _mm256_add_pd(carry, _mm256_add_pd(a, shifted));
+}
+
+__attribute__((target("avx2")))
+graph_index static categorical_choose_avx2(const double *weights,
+                                           graph_index count, double unif){
+        __m256d carry = _mm256_setzero_pd();
+        __m256d sums = carry;
+        graph_index i = 0;
+        for (; i+4<=count; i+=4){
+                sums = block_sums_avx2(_mm256_loadu_pd(weights+i), carry);
+                carry = _mm256_permute4x64_pd(sums, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        int tail = count-i;
+        __m256i tail_mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(tail),
+                                               _mm256_setr_epi64x(0, 1, 2, 3));
+        double last[4];
+        if (tail){
+                sums = block_sums_avx2(_mm256_maskload_pd(weights+i, tail_mask), carry);
+        }
+        _mm256_storeu_pd(last, sums);
+        double total = last[tail ? tail-1 : 3];
+
+        __m256d x = _mm256_set1_pd(unif*total);
+        carry = _mm256_setzero_pd();
+        for (i=0; i+4<=count; i+=4){
+                sums = block_sums_avx2(_mm256_loadu_pd(weights+i), carry);
+                int found = _mm256_movemask_pd(_mm256_cmp_pd(x, sums, _CMP_LT_OQ));
+                if (found){
+                        return i + __builtin_ctz(found);
+                }
+                carry = _mm256_permute4x64_pd(sums, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        if (tail){
+                sums = block_sums_avx2(_mm256_maskload_pd(weights+i, tail_mask), carry);
+                int found = _mm256_movemask_pd(_mm256_cmp_pd(x, sums, _CMP_LT_OQ)) &
+                            ((1 << tail) - 1);
+                if (found){
+                        return i + __builtin_ctz(found);
+                }
+        }
+        return count-1;
+}
+
+/* the cumulative sums of the two blocks of four weights in w, the first
+ * starting with carry and the second with the last sum of the first */
+__attribute__((target("avx512f")))
+__m512d static block_sums_avx512(__m512d w, __m512d carry){
+        /* [0, w0, w1, w2, 0, w4, w5, w6] */
+        __m512d shifted = _mm512_maskz_permutexvar_pd(0xee, _mm512_setr_epi64(0, 0, 1, 2, 0, 4, 5, 6), w);
+        __m512d a = _mm512_add_pd(w, shifted);
+        /* [0, 0, a0, a1, 0, 0, a4, a5] */
+        shifted = _mm512_maskz_permutexvar_pd(0xcc, _mm512_setr_epi64(0, 0, 0, 1, 0, 0, 4, 5), a);
+        __m512d b = _mm512_add_pd(a, shifted);
+        __m512d sums = _mm512_add_pd(carry, b);
+        __m512d middle = _mm512_permutexvar_pd(_mm512_set1_epi64(3), sums);
+        return _mm512_mask_add_pd(sums, 0xf0, middle, b);
+}
+
+__attribute__((target("avx512f")))
+graph_index static categorical_choose_avx512(const double *weights,
+                                             graph_index count, double unif){
+        __m512i last_lane = _mm512_set1_epi64(7);
+        __m512d carry = _mm512_setzero_pd();
+        __m512d sums = carry;
+        graph_index i = 0;
+        for (; i+8<=count; i+=8){
+                sums = block_sums_avx512(_mm512_loadu_pd(weights+i), carry);
+                carry = _mm512_permutexvar_pd(last_lane, sums);
+        }
+        int tail = count-i;
+        __mmask8 tail_mask = (1 << tail) - 1;
+        if (tail){
+                sums = block_sums_avx512(_mm512_maskz_loadu_pd(tail_mask, weights+i), carry);
+        }
+        double last[8];
+        _mm512_storeu_pd(last, sums);
+        double total = last[tail ? tail-1 : 7];
+
+        __m512d x = _mm512_set1_pd(unif*total);
+        carry = _mm512_setzero_pd();
+        for (i=0; i+8<=count; i+=8){
+                sums = block_sums_avx512(_mm512_loadu_pd(weights+i), carry);
+                __mmask8 found = _mm512_cmp_pd_mask(x, sums, _CMP_LT_OQ);
+                if (found){
+                        return i + __builtin_ctz(found);
+                }
+                carry = _mm512_permutexvar_pd(last_lane, sums);
+        }
+        if (tail){
+                sums = block_sums_avx512(_mm512_maskz_loadu_pd(tail_mask, weights+i), carry);
+                __mmask8 found = _mm512_mask_cmp_pd_mask(tail_mask, x, sums, _CMP_LT_OQ);
+                if (found){
+                        return i + __builtin_ctz(found);
+                }
+        }
+        return count-1;
+}
+#endif
+
+graph_index categorical_choose_level(simd_level level, const double *weights,
+                                     graph_index count, double unif){
+        if (count <= 0){
+                return -1;
+        }
+#ifdef SAMPLING_X86
+        if (level == SIMD_AVX512){
+                return categorical_choose_avx512(weights, count, unif);
+        }
+        if (level == SIMD_AVX2){
+                return categorical_choose_avx2(weights, count, unif);
+        }
+#endif
+        return categorical_choose_scalar(weights, count, unif);
+}
+
+/* the level set by categorical_set_level, shared by all contexts of the
+ * process, so it is atomic (relaxed, it only selects among equal kernels) */
+static _Atomic int categorical_level = SIMD_DEFAULT;
+
+simd_level categorical_set_level(simd_level level){
+        simd_level supported = simd_supported();
+        return atomic_exchange_explicit(&categorical_level,
+                                        level < supported ? level : supported,
+                                        memory_order_relaxed);
+}
+
+graph_index categorical_choose(const double *weights, graph_index count,
+                               double unif){
+        /* the vector kernels only pay off from two registers of weights */
+        if (count < 8){
+                return categorical_choose_scalar(weights, count, unif);
+        }
+        int level = atomic_load_explicit(&categorical_level, memory_order_relaxed);
+        if (level == SIMD_DEFAULT){
+                /* determined once, concurrent calls store the same value */
+                static _Atomic int supported = -1;
+                int best = atomic_load_explicit(&supported, memory_order_relaxed);
+                if (best < 0){
+                        best = simd_supported();
+                        atomic_store_explicit(&supported, best, memory_order_relaxed);
+                }
+                /* the chain of carries limits both kernels to about the same
+                 * number of weights per cycle, so the shorter setup of AVX2
+                 * wins for large counts */
+                level = best == SIMD_AVX512 && count > 32 ? SIMD_AVX2 : best;
+        }
+        return categorical_choose_level(level, weights, count, unif);
+}
+
+rate_tree *rate_tree_new(graph_index n){
+        rate_tree *t = malloc(sizeof(rate_tree));
+        *t = (rate_tree){.n=n, .top=1, .updates=0};
+        t->rates = calloc(n ? n : 1, sizeof(double));
+        t->tree = calloc(n+1, sizeof(double));
+        while (2*t->top <= n){
+                t->top *= 2;
+        }
+        return t;
+}
+
+void rate_tree_free(rate_tree *t){
+        free(t->rates);
+        free(t->tree);
+        free(t);
+}
+
+/* rebuild the tree from the rates in O(n) by pushing every node into its
+ * parent */
+void static rate_tree_rebuild(rate_tree *t){
+        for (graph_index i=1; i<=t->n; i++){
+                t->tree[i] = t->rates[i-1];
+        }
+        for (graph_index i=1; i<=t->n; i++){
+                graph_index parent = i + (i & -i);
+                if (parent <= t->n){
+                        t->tree[parent] += t->tree[i];
+                }
+        }
+        t->updates = 0;
+}
+
+void rate_tree_set(rate_tree *t, graph_index i, double rate){
+        assert(i >= 0 && i < t->n && rate >= 0);
+        double delta = rate - t->rates[i];
+        t->rates[i] = rate;
+        if (++t->updates >= t->n){
+                rate_tree_rebuild(t);
+                return;
+        }
+        for (graph_index j=i+1; j<=t->n; j += j & -j){
+                t->tree[j] += delta;
+        }
+}
+
+double rate_tree_total(const rate_tree *t){
+        double total = 0;
+        for (graph_index j=t->n; j>0; j -= j & -j){
+                total += t->tree[j];
+        }
+        return total;
+}
+
+graph_index rate_tree_find(const rate_tree *t, double x){
+        /* descend from the largest power of two, pos is the number of indices
+         * whose cumulative rate is known to be <= x */
+        graph_index pos = 0;
+        for (graph_index step=t->top; step>0; step /= 2){
+                if (pos+step <= t->n && t->tree[pos+step] <= x){
+                        pos += step;
+                        x -= t->tree[pos];
+                }
+        }
+        if (pos >= t->n){
+                pos = t->n-1;
+        }
+        /* only rounding at the very end of the range ends up on an index of
+         * rate 0, go back to the last index of positive rate */
+        while (pos > 0 && t->rates[pos] == 0){
+                pos--;
+        }
+        return pos;
+}
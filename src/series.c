@@ -0,0 +1,344 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "series.h"
+
+/* size of one of the two output buffers, a record never gets split between
+ * them so the buffers are enlarged if a single record does not fit */
+#define SERIES_BUFFER_SIZE (1 << 20)
+
+/* the quantiles of the weight histogram written in every record */
+static const double quantiles[SERIES_N_QUANTILES] = {0.1, 0.25, 0.5, 0.75, 0.9};
+
+struct series_writer {
+        FILE *out;
+        series_format format;
+        double interval;
+        double next_time;
+        double fixation;
+
+        /* stable ids of the sampled edges (cf. graph_edge_id) */
+        int n_sampled;
+        graph_index *sampled;
+
+        /* the replicas run on the same random numbers whose differences to
+         * the sampled graph are recorded (cf. glauber_couple) */
+        int n_coupled;
+        graph **coupled;
+
+        /* reused scratch space for the histogram and the current record */
+        long *histogram;
+        long histogram_size;
+        int n_fields;
+        double *record;
+
+        /* double buffering: the simulation formats into buffers[active] while
+         * the background thread writes buffers[pending] (if pending != -1) */
+        char *buffers[2];
+        size_t capacity;
+        size_t fill;
+        int active;
+        int pending;
+        size_t pending_size;
+        int done;
+        pthread_t thread;
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+};
+
+/* background thread: wait for a buffer to be handed over and write it */
+void static *series_write_loop(void *arg){
+        series_writer *s = arg;
+        pthread_mutex_lock(&s->lock);
+        while (1){
+                while (s->pending == -1 && !s->done){
+                        pthread_cond_wait(&s->cond, &s->lock);
+                }
+                if (s->pending == -1){
+                        /* done and nothing left to write */
+                        break;
+                }
+                int to_write = s->pending;
+                size_t size = s->pending_size;
+                pthread_mutex_unlock(&s->lock);
+
+                if (fwrite(s->buffers[to_write], 1, size, s->out) != size){
+                        perror("Could not write time series");
+                }
+
+                pthread_mutex_lock(&s->lock);
+                s->pending = -1;
+                pthread_cond_broadcast(&s->cond);
+        }
+        pthread_mutex_unlock(&s->lock);
+        return NULL;
+}
+
+/* hand the active buffer over to the background thread and continue on the
+ * other one, only blocks if the background thread is still busy */
+void static series_swap_buffers(series_writer *s){
+        pthread_mutex_lock(&s->lock);
+        while (s->pending != -1){
+                pthread_cond_wait(&s->cond, &s->lock);
+        }
+        s->pending = s->active;
+        s->pending_size = s->fill;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+
+        s->active ^= 1;
+        s->fill = 0;
+}
+
+/* upper bound of the bytes one record takes in the buffer */
+size_t static series_record_size(series_writer *s){
+        if (s->format == SERIES_BINARY){
+                return s->n_fields*sizeof(double);
+        }
+        /* "%.17g" needs at most 24 characters, plus separator */
+        return s->n_fields*26 + 2;
+}
+
+/* append raw bytes to the active buffer, the caller makes sure they fit */
+void static series_append(series_writer *s, const void *data, size_t size){
+        if (s->fill + size > s->capacity){
+                series_swap_buffers(s);
+        }
+        memcpy(s->buffers[s->active] + s->fill, data, size);
+        s->fill += size;
+}
+
+/* the weight of edge i of state, from weights if it is not NULL */
+double static inline series_weight(graph *state, const double *weights,
+                                   graph_index i){
+        return weights ? weights[i] : state->edges[i]->weight;
+}
+
+/* compute max_weight, the quantiles and fixated into values using the
+ * histogram scratch space */
+void static observe_weights(graph *state, const double *weights, double fixation,
+                            long **histogram, long *histogram_size,
+                            double *values){
+        double max_weight = 0;
+        for (graph_index i=0; i<state->m; i++){
+                max_weight = fmax(max_weight, series_weight(state, weights, i));
+        }
+        values[0] = max_weight;
+
+        /* the weights are integer counts so a histogram with unit bins gives
+         * the exact quantiles in O(m + max_weight) */
+        long bins = (long) max_weight + 1;
+        if (bins > *histogram_size){
+                *histogram = realloc(*histogram, bins*sizeof(long));
+                *histogram_size = bins;
+        }
+        memset(*histogram, 0, bins*sizeof(long));
+        for (graph_index i=0; i<state->m; i++){
+                long bin = (long) series_weight(state, weights, i);
+                (*histogram)[bin < 0 ? 0 : bin]++;
+        }
+        long cumulative = 0;
+        long bin = 0;
+        for (int q=0; q<SERIES_N_QUANTILES; q++){
+                double target = quantiles[q]*state->m;
+                while (bin < bins && cumulative + (*histogram)[bin] < target){
+                        cumulative += (*histogram)[bin];
+                        bin++;
+                }
+                values[1+q] = bin;
+        }
+
+        graph_index fixated = 0;
+        for (graph_index i=0; i<state->n; i++){
+                vertex *v = state->vertices[i];
+                double leading = 0;
+                double local_weight = 0;
+                for (graph_index j=0; j<v->dim; j++){
+                        double w = series_weight(state, weights,
+                                                 v->edges[j] - state->edge_pool);
+                        leading = fmax(leading, w);
+                        local_weight += w;
+                }
+                if (v->dim && leading >= fixation*local_weight){
+                        fixated++;
+                }
+        }
+        values[1+SERIES_N_QUANTILES] = fixated;
+}
+
+void series_observables(graph *state, const double *weights, double fixation,
+                        double *values){
+        long *histogram = NULL;
+        long histogram_size = 0;
+        observe_weights(state, weights, fixation, &histogram, &histogram_size,
+                        values);
+        free(histogram);
+}
+
+/* compute all the observables of state into s->record (except the time) */
+void static series_observe(series_writer *s, graph *state){
+        double *record = s->record;
+        observe_weights(state, NULL, s->fixation, &s->histogram,
+                        &s->histogram_size, record+1);
+        for (int i=0; i<s->n_sampled; i++){
+                edge *e = graph_edge_by_id(state, s->sampled[i]);
+                record[SERIES_N_OBSERVABLES+i] = e ? e->weight : NAN;
+        }
+        /* the paired differences follow the sampled weights */
+        double *paired = record + SERIES_N_OBSERVABLES + s->n_sampled;
+        for (int k=0; k<s->n_coupled; k++){
+                observe_weights(s->coupled[k], NULL, s->fixation, &s->histogram,
+                                &s->histogram_size, paired);
+                for (int i=0; i<SERIES_N_OBSERVABLES-1; i++){
+                        paired[i] -= record[1+i];
+                }
+                paired += SERIES_N_OBSERVABLES-1;
+        }
+}
+
+/* format s->record into the buffer */
+void static series_emit(series_writer *s){
+        if (s->format == SERIES_BINARY){
+                series_append(s, s->record, s->n_fields*sizeof(double));
+                return;
+        }
+        size_t max_size = series_record_size(s);
+        if (s->fill + max_size > s->capacity){
+                series_swap_buffers(s);
+        }
+        char *line = s->buffers[s->active] + s->fill;
+        size_t len = 0;
+        for (int i=0; i<s->n_fields; i++){
+                len += sprintf(line+len, i ? ",%.17g" : "%.17g", s->record[i]);
+        }
+        line[len++] = '\n';
+        s->fill += len;
+}
+
+series_writer *series_open(const char *fname, series_format format,
+                           double interval, int sampled_edges,
+                           double fixation, graph *g){
+        return series_open_coupled(fname, format, interval, sampled_edges,
+                                   fixation, g, NULL, 0);
+}
+
+series_writer *series_open_coupled(const char *fname, series_format format,
+                                   double interval, int sampled_edges,
+                                   double fixation, graph *g, graph **coupled,
+                                   int n_coupled){
+        FILE *out = fopen(fname, "wb");
+        if (!out){
+                return NULL;
+        }
+        series_writer *s = malloc(sizeof(series_writer));
+        *s = (series_writer){.out=out, .format=format, .interval=interval,
+                             .next_time=0, .fixation=fixation,
+                             .active=0, .pending=-1, .done=0,
+                             .n_coupled=n_coupled};
+        s->coupled = malloc(n_coupled*sizeof(graph*));
+        if (n_coupled){
+                memcpy(s->coupled, coupled, n_coupled*sizeof(graph*));
+        }
+
+        /* sample the edges at equal strides which spreads them over the whole
+         * torus and keeps the choice reproducible */
+        s->n_sampled = sampled_edges < g->m ? sampled_edges : g->m;
+        s->sampled = malloc(s->n_sampled*sizeof(graph_index));
+        for (int i=0; i<s->n_sampled; i++){
+                s->sampled[i] = graph_edge_id(g, (graph_index) ((int64_t) i*g->m/s->n_sampled));
+        }
+
+        s->n_fields = SERIES_N_OBSERVABLES + s->n_sampled +
+                      n_coupled*(SERIES_N_OBSERVABLES-1);
+        s->record = malloc(s->n_fields*sizeof(double));
+
+        s->capacity = SERIES_BUFFER_SIZE;
+        if (s->capacity < 4*series_record_size(s)){
+                s->capacity = 4*series_record_size(s);
+        }
+        s->buffers[0] = malloc(s->capacity);
+        s->buffers[1] = malloc(s->capacity);
+
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->cond, NULL);
+
+        /* the header goes through the buffer as well so that the file is only
+         * touched by the background thread */
+        if (format == SERIES_BINARY){
+                uint32_t n_fields = s->n_fields;
+                series_append(s, "GDSERIES", 8);
+                series_append(s, &n_fields, sizeof(n_fields));
+        }
+        else {
+                char field[64];
+                const char *names = "time,max_weight,q10,q25,q50,q75,q90,fixated";
+                series_append(s, names, strlen(names));
+                for (int i=0; i<s->n_sampled; i++){
+                        edge *e = graph_edge_by_id(g, s->sampled[i]);
+                        int len = snprintf(field, sizeof(field), ",w%" PRIgi "_%" PRIgi,
+                                           graph_original_index(g, e->v1),
+                                           graph_original_index(g, e->v2));
+                        series_append(s, field, len);
+                }
+                static const char *observables[SERIES_N_OBSERVABLES-1] = {
+                        "max_weight", "q10", "q25", "q50", "q75", "q90", "fixated"};
+                for (int k=0; k<n_coupled; k++){
+                        for (int i=0; i<SERIES_N_OBSERVABLES-1; i++){
+                                int len = snprintf(field, sizeof(field), ",d%d_%s",
+                                                   k+1, observables[i]);
+                                series_append(s, field, len);
+                        }
+                }
+                series_append(s, "\n", 1);
+        }
+
+        if (pthread_create(&s->thread, NULL, series_write_loop, s)){
+                perror("Could not start time series writer thread");
+                abort();
+        }
+        return s;
+}
+
+double series_next_time(series_writer *s){
+        return s->next_time;
+}
+
+void series_record_until(series_writer *s, graph *state, double t){
+        if (s->next_time > t){
+                return;
+        }
+        /* the state did not change since the last event, so observe it once
+         * for all the due times */
+        series_observe(s, state);
+        while (s->next_time <= t){
+                s->record[0] = s->next_time;
+                series_emit(s);
+                s->next_time += s->interval;
+        }
+}
+
+void series_close(series_writer *s){
+        if (s->fill){
+                series_swap_buffers(s);
+        }
+        pthread_mutex_lock(&s->lock);
+        s->done = 1;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        pthread_join(s->thread, NULL);
+
+        fclose(s->out);
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->cond);
+        free(s->buffers[0]);
+        free(s->buffers[1]);
+        free(s->sampled);
+        free(s->coupled);
+        free(s->record);
+        free(s->histogram);
+        free(s);
+}
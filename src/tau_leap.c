@@ -0,0 +1,125 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "sampling.h"
+#include "tau_leap.h"
+
+tau_leap *tau_leap_new(const graph *g){
+        tau_leap *leap = malloc(sizeof(tau_leap));
+        leap->offsets = malloc((g->n+1)*sizeof(graph_index));
+        leap->offsets[0] = 0;
+        for (graph_index v=0; v<g->n; v++){
+                leap->offsets[v+1] = leap->offsets[v] + g->vertices[v]->dim;
+        }
+        graph_index slots = leap->offsets[g->n];
+        leap->probs = malloc((slots ? slots : 1)*sizeof(double));
+        leap->counts = malloc((slots ? slots : 1)*sizeof(int64_t));
+        leap->mean_change = malloc((g->m ? g->m : 1)*sizeof(double));
+        return leap;
+}
+
+void tau_leap_free(tau_leap *leap){
+        free(leap->offsets);
+        free(leap->probs);
+        free(leap->counts);
+        free(leap->mean_change);
+        free(leap);
+}
+
+/* the polya probabilities of the edges of v with the current weights */
+void static vertex_probs(const vertex *v, double alpha, double *probs){
+        double normalisation = 0;
+        for (graph_index i=0; i<v->dim; i++){
+                probs[i] = pow(v->edges[i]->weight, alpha);
+                normalisation += probs[i];
+        }
+        for (graph_index i=0; i<v->dim; i++){
+                probs[i] /= normalisation;
+        }
+}
+
+double tau_leap_choose(tau_leap *leap, graph *g, const update_params *params,
+                       double epsilon){
+        #pragma omp parallel for schedule(static)
+        for (graph_index v=0; v<g->n; v++){
+                vertex_probs(g->vertices[v], params->alpha,
+                             leap->probs + leap->offsets[v]);
+        }
+
+        /* every clock rings at rate 1, so the increments of an edge are
+         * Poisson with mean tau times the sum of its probabilities at both of
+         * its vertices, which is also the variance */
+        for (graph_index e=0; e<g->m; e++){
+                leap->mean_change[e] = 0;
+        }
+        for (graph_index v=0; v<g->n; v++){
+                vertex *cur = g->vertices[v];
+                for (graph_index i=0; i<cur->dim; i++){
+                        leap->mean_change[cur->edges[i] - g->edge_pool] +=
+                                leap->probs[leap->offsets[v] + i];
+                }
+        }
+
+        double tau = INFINITY;
+        for (graph_index e=0; e<g->m; e++){
+                double mu = leap->mean_change[e];
+                if (mu <= 0){
+                        continue;
+                }
+                /* the mean change tau*mu stays below bound, which is at least
+                 * 1, so the variance tau*mu stays below bound^2 as well */
+                double bound = fmax(epsilon*g->edge_pool[e].weight, 1);
+                tau = fmin(tau, bound/mu);
+        }
+        return tau;
+}
+
+int64_t tau_leap_apply(tau_leap *leap, graph *g, const update_params *params,
+                       double tau, uint64_t seed, double *deviation){
+        #pragma omp parallel for schedule(static)
+        for (graph_index v=0; v<g->n; v++){
+                pcg32_random_t rng;
+                pcg32_srandom_r(&rng, seed, v);
+                for (graph_index s=leap->offsets[v]; s<leap->offsets[v+1]; s++){
+                        leap->counts[s] = poisson_rand_r(&rng, tau*leap->probs[s]);
+                }
+        }
+
+        /* an edge gets increments from both of its vertices, so apply them in
+         * one thread */
+        int64_t events = 0;
+        for (graph_index v=0; v<g->n; v++){
+                vertex *cur = g->vertices[v];
+                for (graph_index i=0; i<cur->dim; i++){
+                        int64_t count = leap->counts[leap->offsets[v] + i];
+                        edge *e = cur->edges[i];
+                        e->weight += count;
+                        g->vertices[e->v1]->local_weight += count;
+                        g->vertices[e->v2]->local_weight += count;
+                        events += count;
+                }
+        }
+
+        double estimate = 0;
+        #pragma omp parallel for schedule(static) reduction(+:estimate)
+        for (graph_index v=0; v<g->n; v++){
+                vertex *cur = g->vertices[v];
+                const double *frozen = leap->probs + leap->offsets[v];
+                double normalisation = 0;
+                int64_t vertex_events = 0;
+                for (graph_index i=0; i<cur->dim; i++){
+                        normalisation += pow(cur->edges[i]->weight, params->alpha);
+                        vertex_events += leap->counts[leap->offsets[v] + i];
+                }
+                double distance = 0;
+                for (graph_index i=0; i<cur->dim; i++){
+                        double p = pow(cur->edges[i]->weight, params->alpha)/normalisation;
+                        distance += fabs(p - frozen[i]);
+                }
+                /* the total variation distance is half the l1 distance, of
+                 * which on average half applies over the leap */
+                estimate += vertex_events*distance/4;
+        }
+        *deviation += estimate;
+        return events;
+}
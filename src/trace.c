@@ -0,0 +1,240 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+static const char magic[8] = "GDTRACE1";
+
+struct trace_writer {
+        FILE *out;
+        int vertex_bits;
+        uint64_t previous; /* the bits of the time of the previous event */
+        /* the words of the current chunk and the bits not yet in a word */
+        uint64_t *words;
+        uint32_t n_words;
+        uint32_t capacity;
+        uint64_t pending;
+        int pending_bits;
+        uint32_t count; /* the events of the current chunk */
+        int failed;
+};
+
+struct trace_reader {
+        FILE *in;
+        int vertex_bits;
+        unsigned int flags;
+        double increment;
+        uint64_t previous;
+        uint64_t *words;
+        uint32_t n_words;
+        uint32_t capacity;
+        uint32_t position; /* the word read from */
+        int offset; /* the bits of words[position] already read */
+        uint32_t remaining; /* the events left in the current chunk */
+        int ended;
+};
+
+/* the number of bits needed for the values 0, ..., x */
+int static width(uint64_t x){
+        int bits = 0;
+        while (bits < 64 && x >> bits){
+                bits++;
+        }
+        return bits;
+}
+
+/* append the lowest bits of value (the others are 0) */
+void static put(trace_writer *trace, uint64_t value, int bits){
+        if (!bits){
+                return;
+        }
+        trace->pending |= value << trace->pending_bits;
+        if (trace->pending_bits + bits < 64){
+                trace->pending_bits += bits;
+                return;
+        }
+        if (trace->n_words == trace->capacity){
+                trace->capacity = trace->capacity ? 2*trace->capacity : 1024;
+                trace->words = realloc(trace->words, trace->capacity*sizeof(uint64_t));
+        }
+        trace->words[trace->n_words++] = trace->pending;
+        int used = 64 - trace->pending_bits;
+        trace->pending = used < 64 ? value >> used : 0;
+        trace->pending_bits = bits - used;
+}
+
+void static write_chunk(trace_writer *trace){
+        if (trace->pending_bits){
+                /* pad the last word */
+                put(trace, 0, 64 - trace->pending_bits);
+        }
+        uint32_t sizes[2] = {trace->count, trace->n_words};
+        if (fwrite(sizes, sizeof(uint32_t), 2, trace->out) != 2 ||
+            fwrite(trace->words, sizeof(uint64_t), trace->n_words, trace->out) != trace->n_words){
+                trace->failed = 1;
+        }
+        trace->n_words = 0;
+        trace->count = 0;
+}
+
+trace_writer *trace_writer_open(const char *fname, const graph *g,
+                                double increment, unsigned int flags){
+        FILE *out = fopen(fname, "wb");
+        if (!out){
+                return NULL;
+        }
+        trace_writer *trace = calloc(1, sizeof(trace_writer));
+        trace->out = out;
+        trace->vertex_bits = g->n ? width(g->n-1) : 0;
+        uint64_t header[3] = {g->n, g->m, flags};
+        if (fwrite(magic, 1, sizeof(magic), out) != sizeof(magic) ||
+            fwrite(header, sizeof(uint64_t), 3, out) != 3 ||
+            fwrite(&increment, sizeof(double), 1, out) != 1){
+                trace->failed = 1;
+        }
+        return trace;
+}
+
+void trace_write(trace_writer *trace, const graph *g, const double *times,
+                 const graph_index *vertex_indices, const graph_index *slots,
+                 int count){
+        for (int i=0; i<count; i++){
+                uint64_t bits;
+                memcpy(&bits, &times[i], sizeof(bits));
+                uint64_t delta = bits - trace->previous;
+                trace->previous = bits;
+                int length = width(delta);
+                put(trace, length, 6);
+                put(trace, delta, length);
+                graph_index v = vertex_indices[i];
+                put(trace, v, trace->vertex_bits);
+                put(trace, slots[i] + 1, width(g->vertices[v]->dim));
+                if (++trace->count == TRACE_CHUNK_EVENTS){
+                        write_chunk(trace);
+                }
+        }
+}
+
+int trace_writer_close(trace_writer *trace){
+        if (trace->count){
+                write_chunk(trace);
+        }
+        int failed = trace->failed || ferror(trace->out);
+        failed = fclose(trace->out) || failed;
+        free(trace->words);
+        free(trace);
+        return failed ? -1 : 0;
+}
+
+trace_reader *trace_reader_open(const char *fname, const graph *g){
+        FILE *in = fopen(fname, "rb");
+        if (!in){
+                return NULL;
+        }
+        char start[sizeof(magic)];
+        uint64_t header[3];
+        double increment;
+        if (fread(start, 1, sizeof(start), in) != sizeof(start) ||
+            memcmp(start, magic, sizeof(magic)) ||
+            fread(header, sizeof(uint64_t), 3, in) != 3 ||
+            fread(&increment, sizeof(double), 1, in) != 1 ||
+            header[0] != (uint64_t) g->n || header[1] != (uint64_t) g->m){
+                fclose(in);
+                errno = 0;
+                return NULL;
+        }
+        trace_reader *trace = calloc(1, sizeof(trace_reader));
+        trace->in = in;
+        trace->vertex_bits = g->n ? width(g->n-1) : 0;
+        trace->flags = header[2];
+        trace->increment = increment;
+        return trace;
+}
+
+unsigned int trace_flags(const trace_reader *trace){
+        return trace->flags;
+}
+
+double trace_increment(const trace_reader *trace){
+        return trace->increment;
+}
+
+/* load the next chunk, 0 at the end of the file */
+int static read_chunk(trace_reader *trace){
+        uint32_t sizes[2];
+        if (fread(sizes, sizeof(uint32_t), 2, trace->in) != 2){
+                return 0;
+        }
+        if (sizes[1] > trace->capacity){
+                trace->capacity = sizes[1];
+                trace->words = realloc(trace->words, trace->capacity*sizeof(uint64_t));
+        }
+        if (fread(trace->words, sizeof(uint64_t), sizes[1], trace->in) != sizes[1]){
+                return 0;
+        }
+        trace->n_words = sizes[1];
+        trace->remaining = sizes[0];
+        trace->position = 0;
+        trace->offset = 0;
+        return 1;
+}
+
+/* the next bits (0 past the end of the chunk) */
+uint64_t static get(trace_reader *trace, int bits){
+        if (!bits){
+                return 0;
+        }
+        uint64_t word = trace->position < trace->n_words ? trace->words[trace->position] : 0;
+        uint64_t value = word >> trace->offset;
+        int available = 64 - trace->offset;
+        if (bits < available){
+                trace->offset += bits;
+        }
+        else {
+                trace->position++;
+                if (bits > available && trace->position < trace->n_words){
+                        value |= trace->words[trace->position] << available;
+                }
+                trace->offset = bits - available;
+        }
+        return bits < 64 ? value & ((UINT64_C(1) << bits) - 1) : value;
+}
+
+int trace_read(trace_reader *trace, const graph *g, double *times,
+               graph_index *vertex_indices, graph_index *slots, int count){
+        int i = 0;
+        while (i < count && !trace->ended){
+                if (!trace->remaining && !read_chunk(trace)){
+                        trace->ended = 1;
+                        break;
+                }
+                uint64_t delta = get(trace, get(trace, 6));
+                uint64_t v = get(trace, trace->vertex_bits);
+                if (v >= (uint64_t) g->n){
+                        trace->ended = 1;
+                        break;
+                }
+                graph_index dim = g->vertices[v]->dim;
+                graph_index slot = (graph_index) get(trace, width(dim)) - 1;
+                if (slot >= dim){
+                        trace->ended = 1;
+                        break;
+                }
+                trace->previous += delta;
+                memcpy(&times[i], &trace->previous, sizeof(double));
+                vertex_indices[i] = v;
+                slots[i] = slot;
+                trace->remaining--;
+                i++;
+        }
+        return i;
+}
+
+void trace_reader_close(trace_reader *trace){
+        fclose(trace->in);
+        free(trace->words);
+        free(trace);
+}
@@ -1,41 +1,274 @@
-#include <glib.h>
+#include <assert.h>
 #include <math.h>
 #include <stdlib.h>
 
+#include "sampling.h"
 #include "update_rules.h"
 
-/* See paper Yannick Couzinie and Christian Hirsch */
-void static polya_update_func(graph *state, int vertex_index, double alpha,
-                              pcg32_random_t *rng){
-        g_assert(vertex_index < state->n);
+rule_instance *rule_instance_new(const rule_interface *rule, graph *g,
+                                 const update_params *params){
+        rule_instance *out = malloc(sizeof(rule_instance));
+        *out = (rule_instance){.rule=rule, .params=*params, .state=NULL, .g=g};
+        if (rule->init){
+                out->state = rule->init(g, &out->params);
+        }
+        if (rule->topology){
+                graph_add_hook(g, rule->topology, out->state);
+        }
+        return out;
+}
+
+void rule_instance_free(rule_instance *instance){
+        if (instance->rule->topology){
+                graph_remove_hook(instance->g, instance->rule->topology, instance->state);
+        }
+        if (instance->rule->free){
+                instance->rule->free(instance->state);
+        }
+        free(instance);
+}
+
+void rule_apply_batch(rule_instance *instance, graph *state,
+                      const graph_index *vertex_indices, const double *uniforms,
+                      int count, pcg32_random_t *rng, graph_index *slots){
+        const rule_interface *rule = instance->rule;
+        if (rule->update_batch){
+                rule->update_batch(state, vertex_indices, uniforms, count,
+                                   &instance->params, instance->state, rng,
+                                   slots);
+                return;
+        }
+        for (int i=0; i<count; i++){
+                graph_index slot = rule->update(state, vertex_indices[i], uniforms[i],
+                                                &instance->params, instance->state, rng);
+                if (slots){
+                        slots[i] = slot;
+                }
+        }
+}
+
+/* the table of weight^alpha is only grown up to this size, larger weights
+ * fall back to pow */
+#define POLYA_MAX_POWERS (1 << 24)
+
+/* per-rule state of the polya rule */
+typedef struct polya_cache {
+        double alpha; /* the alpha the table was computed for */
+        double *powers; /* powers[w] = pow(w, alpha) */
+        long n_powers;
+        double *scratch; /* the weights^alpha of the vertices of large degree */
+        graph_index scratch_size;
+} polya_cache;
+
+void static *polya_init(graph *state, const update_params *params){
+        polya_cache *cache = malloc(sizeof(polya_cache));
+        *cache = (polya_cache){.alpha=params->alpha, .powers=NULL, .n_powers=0,
+                               .scratch=NULL, .scratch_size=0};
+        return cache;
+}
+
+void static polya_free(void *rule_state){
+        polya_cache *cache = rule_state;
+        free(cache->powers);
+        free(cache->scratch);
+        free(cache);
+}
 
+/* scratch space of the cache for size weights */
+double static *polya_scratch(polya_cache *cache, graph_index size){
+        if (size > cache->scratch_size){
+                cache->scratch = realloc(cache->scratch, size*sizeof(double));
+                cache->scratch_size = size;
+        }
+        return cache->scratch;
+}
+
+/* pow(weight, alpha) using the table for integer weights. The table entries are
+ * computed by pow as well so the result is identical to calling pow. */
+double static polya_power(polya_cache *cache, double weight, double alpha){
+        long w = (long) weight;
+        if (!cache || cache->alpha != alpha || w != weight || w < 0 ||
+            w >= POLYA_MAX_POWERS){
+                return pow(weight, alpha);
+        }
+        if (w >= cache->n_powers){
+                long new_size = cache->n_powers ? cache->n_powers : 64;
+                while (new_size <= w){
+                        new_size *= 2;
+                }
+                cache->powers = realloc(cache->powers, new_size*sizeof(double));
+                for (long i=cache->n_powers; i<new_size; i++){
+                        cache->powers[i] = pow(i, alpha);
+                }
+                cache->n_powers = new_size;
+        }
+        return cache->powers[w];
+}
+
+/* the weights^alpha of up to this degree are kept on the stack if there is no
+ * rule state to hold them */
+#define POLYA_STACK_DEGREE 64
+
+/* choose an edge of vertex_index with probability proportional to its
+ * weight^alpha, never the one in slot excluded (-1 to allow all), and
+ * increment it */
+graph_index static polya_choose(graph *state, graph_index vertex_index,
+                                double unif_dbl, const update_params *params,
+                                polya_cache *cache, graph_index excluded){
+        assert(vertex_index < state->n);
+
+        double alpha = params->alpha;
         vertex *chosen_vertex = state->vertices[vertex_index];
-        /* generate a double (using the recipe in the docs) and choose the edge
-         * by adding their weights (starting from the first in state->edges)
-         * until the sum goes over the generated uniform value. This
-         * corresponds to choosing an edge with probability
-         * edge->weight/vertex->local_weight */
-        double unif_dbl = ldexp(pcg32_random_r(rng), -32); 
-
-        double weight_sum = 0;
-        double scaled_local_weight = 0;
-        /* calculate the normalization constant once for the vertex */
-        for (int i=0; i < chosen_vertex->dim; i++){
-                scaled_local_weight += pow(chosen_vertex->edges[i]->weight, alpha);
-        }
-
-        for (int i=0; i < chosen_vertex->dim; i++){
-                edge *cur_edge = chosen_vertex->edges[i];
-                double normal_weight = pow(cur_edge->weight, alpha)/scaled_local_weight;
-                if (weight_sum < unif_dbl && (weight_sum + normal_weight) > unif_dbl){
-                        /* this edge is chosen so increment its weights */
-                        cur_edge->weight++;
-                        chosen_vertex->local_weight++;
-                        return;
-                }
-                weight_sum += normal_weight;
-        }
-        abort(); /* this for loop should definitely not run without hitting return */
+        if (chosen_vertex->dim == 0){
+                return -1;
+        }
+        double stack_powers[POLYA_STACK_DEGREE];
+        double *powers = stack_powers;
+        if (chosen_vertex->dim > POLYA_STACK_DEGREE){
+                powers = cache ? polya_scratch(cache, chosen_vertex->dim)
+                               : malloc(chosen_vertex->dim*sizeof(double));
+        }
+        for (graph_index i=0; i < chosen_vertex->dim; i++){
+                powers[i] = polya_power(cache, chosen_vertex->edges[i]->weight, alpha);
+        }
+        if (excluded >= 0){
+                powers[excluded] = 0;
+        }
+        /* choose the edge with probability edge->weight^alpha/(sum of the
+         * local weights^alpha) by inverting the cumulative sums at the
+         * uniform, vectorised for large degrees */
+        graph_index i = categorical_choose(powers, chosen_vertex->dim, unif_dbl);
+        if (powers != stack_powers && !cache){
+                free(powers);
+        }
+
+        /* increment the weight of the chosen edge and the local weights of
+         * both of its vertices */
+        edge *cur_edge = chosen_vertex->edges[i];
+        cur_edge->weight++;
+        state->vertices[cur_edge->v1]->local_weight++;
+        state->vertices[cur_edge->v2]->local_weight++;
+        return i;
+}
+
+/* See paper Yannick Couzinie and Christian Hirsch */
+graph_index static polya_update_event(graph *state, graph_index vertex_index,
+                                      double unif_dbl, const update_params *params,
+                                      void *rule_state, pcg32_random_t *rng){
+        return polya_choose(state, vertex_index, unif_dbl, params, rule_state, -1);
+}
+
+/* the heaviest edge, whose weight^alpha outweighs the sum of the others */
+double static polya_leading(const graph *state, graph_index vertex_index,
+                            const update_params *params, void *rule_state,
+                            graph_index *slot){
+        vertex *v = state->vertices[vertex_index];
+        *slot = -1;
+        if (v->dim == 0){
+                return 1;
+        }
+        graph_index lead = 0;
+        for (graph_index i=1; i<v->dim; i++){
+                if (v->edges[i]->weight > v->edges[lead]->weight){
+                        lead = i;
+                }
+        }
+        *slot = lead;
+        if (v->dim == 1){
+                return 0;
+        }
+        if (params->alpha < 0){
+                return 1;
+        }
+        /* the others are summed separately, 1 - p would lose the digits of
+         * the small probability */
+        double others = 0;
+        for (graph_index i=0; i<v->dim; i++){
+                if (i != lead){
+                        others += polya_power(rule_state, v->edges[i]->weight, params->alpha);
+                }
+        }
+        double leading = polya_power(rule_state, v->edges[lead]->weight, params->alpha);
+        return others/(leading + others);
+}
+
+graph_index static polya_update_other(graph *state, graph_index vertex_index,
+                                      graph_index slot, double unif_dbl,
+                                      const update_params *params, void *rule_state,
+                                      pcg32_random_t *rng){
+        return polya_choose(state, vertex_index, unif_dbl, params, rule_state, slot);
+}
+
+void static polya_update_batch(graph *state, const graph_index *vertex_indices,
+                               const double *uniforms, int count,
+                               const update_params *params, void *rule_state,
+                               pcg32_random_t *rng, graph_index *slots){
+        int d = params->prefetch_distance > 0 ? params->prefetch_distance
+                                              : DEFAULT_PREFETCH_DISTANCE;
+        for (int i=0; i<count; i++){
+                /* the vertices are known ahead, so walk the chain of loads of
+                 * the upcoming events one link per stage, the earlier links
+                 * have been requested d events ago */
+                if (i+4*d < count){
+                        __builtin_prefetch(&state->vertices[vertex_indices[i+4*d]]);
+                }
+                if (i+3*d < count){
+                        __builtin_prefetch(state->vertices[vertex_indices[i+3*d]]);
+                }
+                if (i+2*d < count){
+                        __builtin_prefetch(state->vertices[vertex_indices[i+2*d]]->edges);
+                }
+                if (i+d < count){
+                        vertex *ahead = state->vertices[vertex_indices[i+d]];
+                        for (graph_index j=0; j<ahead->dim; j++){
+                                __builtin_prefetch(ahead->edges[j], 1);
+                        }
+                }
+                graph_index slot = polya_update_event(state, vertex_indices[i], uniforms[i],
+                                                      params, rule_state, rng);
+                if (slots){
+                        slots[i] = slot;
+                }
+        }
+}
+
+const rule_interface polya_rule = {
+        .name = "polya",
+        .init = polya_init,
+        .free = polya_free,
+        .update = polya_update_event,
+        .update_batch = polya_update_batch,
+        .leading = polya_leading,
+        .update_other = polya_update_other,
+        .increment = 1
+};
+
+double static polya_rate(const graph *state, graph_index vertex_index,
+                         const update_params *params){
+        double local_weight = state->vertices[vertex_index]->local_weight;
+        /* a vertex without weight cannot change anything */
+        if (local_weight <= 0){
+                return 0;
+        }
+        return pow(local_weight, params->rate_exponent);
+}
+
+const rule_interface polya_rate_rule = {
+        .name = "polya-rate",
+        .init = polya_init,
+        .free = polya_free,
+        .update = polya_update_event,
+        .update_batch = polya_update_batch,
+        .rate = polya_rate,
+        .increment = 1
+};
+
+void static polya_update_func(graph *state, graph_index vertex_index, double alpha,
+                              pcg32_random_t *rng){
+        /* generate a double using the recipe in the docs */
+        double unif_dbl = ldexp(pcg32_random_r(rng), -32);
+        update_params params = {.alpha=alpha};
+        polya_update_event(state, vertex_index, unif_dbl, &params, NULL, rng);
 }
 
 update_rule polya_update = &polya_update_func;
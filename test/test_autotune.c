@@ -0,0 +1,175 @@
+/** \file test_autotune.c
+ * \brief Glib testing based test code for \ref autotune.h */
+#define _GNU_SOURCE // mkstemp and fork
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "autotune.h"
+
+/** \brief A temporary file name, removed by the caller. */
+void static temporary(char *fname){
+        strcpy(fname, "test_autotune_XXXXXX");
+        close(mkstemp(fname));
+}
+
+/** \brief Remove a profile and its lock file. */
+void static remove_profile(const char *fname){
+        char lock[80];
+        snprintf(lock, sizeof(lock), "%s.lock", fname);
+        remove(lock);
+        remove(fname);
+}
+
+/** \brief Check that the keys tell the rules, classes, degrees and sizes
+ * apart, but not sizes within a factor of two. */
+void test_autotune_key(void){
+        char a[AUTOTUNE_KEY_LENGTH], b[AUTOTUNE_KEY_LENGTH];
+        graph *small = graph_construct_torus(9, 2, 1);
+        graph *large = graph_construct_torus(10, 2, 1);
+        graph *cube = graph_construct_torus(5, 3, 1);
+        autotune_key(small, &polya_rule, "torus", a);
+        autotune_key(large, &polya_rule, "torus", b);
+        g_assert_cmpstr(a, ==, b);
+        autotune_key(small, &polya_rate_rule, "torus", b);
+        g_assert_cmpstr(a, !=, b);
+        autotune_key(small, &polya_rule, "graph", b);
+        g_assert_cmpstr(a, !=, b);
+        autotune_key(cube, &polya_rule, "torus", b);
+        g_assert_cmpstr(a, !=, b);
+        /* tabs separate the fields */
+        autotune_key(small, &polya_rule, "a\ttorus", b);
+        int tabs = 0;
+        for (char *c=b; *c; c++){
+                tabs += *c == '\t';
+        }
+        g_assert_cmpint(tabs, ==, 4);
+        graph_free(small);
+        graph_free(large);
+        graph_free(cube);
+}
+
+/** \brief Store configs of several keys, replace one and read them back. */
+void test_autotune_profile(void){
+        char fname[64];
+        temporary(fname);
+        autotune_config config;
+        g_assert_cmpint(autotune_lookup(fname, "a\t1", &config), ==, 0);
+        autotune_config a = {.batch_size=256, .prefetch_distance=4, .simd=SIMD_AVX2};
+        autotune_config b = {.batch_size=4096, .prefetch_distance=1, .simd=SIMD_SCALAR};
+        g_assert_cmpint(autotune_store(fname, "a\t1", &a), ==, 0);
+        g_assert_cmpint(autotune_store(fname, "a\t12", &b), ==, 0);
+        g_assert_cmpint(autotune_store(fname, "a\t1", &b), ==, 0);
+        g_assert_cmpint(autotune_store(fname, "b", &a), ==, 0);
+        g_assert_cmpint(autotune_lookup(fname, "a\t1", &config), ==, 1);
+        g_assert_cmpint(config.batch_size, ==, b.batch_size);
+        g_assert_cmpint(config.prefetch_distance, ==, b.prefetch_distance);
+        g_assert_cmpint(config.simd, ==, b.simd);
+        g_assert_cmpint(autotune_lookup(fname, "a\t12", &config), ==, 1);
+        g_assert_cmpint(config.batch_size, ==, b.batch_size);
+        g_assert_cmpint(autotune_lookup(fname, "b", &config), ==, 1);
+        g_assert_cmpint(config.batch_size, ==, a.batch_size);
+        g_assert_cmpint(config.simd, ==, a.simd);
+        g_assert_cmpint(autotune_lookup(fname, "a", &config), ==, 0);
+        /* keys that start another key replace only their own line */
+        g_assert_cmpint(autotune_store(fname, "a", &a), ==, 0);
+        g_assert_cmpint(autotune_lookup(fname, "a\t1", &config), ==, 1);
+        g_assert_cmpint(config.batch_size, ==, b.batch_size);
+        g_assert_cmpint(autotune_lookup(fname, "a", &config), ==, 1);
+        g_assert_cmpint(config.batch_size, ==, a.batch_size);
+
+        /* every key has one line */
+        FILE *in = fopen(fname, "r");
+        int lines = 0;
+        for (int c; (c = fgetc(in)) != EOF;){
+                lines += c == '\n';
+        }
+        fclose(in);
+        g_assert_cmpint(lines, ==, 4);
+        remove_profile(fname);
+        g_assert_cmpint(autotune_store("no/such/directory/profile", "a", &a), ==, -1);
+}
+
+/** \brief Let several processes store their own keys in the same profile
+ * at the same time and check that no line is lost. */
+void test_autotune_concurrent(void){
+        char fname[64];
+        temporary(fname);
+        int processes = 6, keys = 30;
+        pid_t children[6];
+        for (int p=0; p<processes; p++){
+                children[p] = fork();
+                if (!children[p]){
+                        for (int k=0; k<keys; k++){
+                                char key[32];
+                                snprintf(key, sizeof(key), "%d\t%d", p, k);
+                                autotune_config config = {.batch_size=1 + k,
+                                                          .prefetch_distance=1 + p,
+                                                          .simd=SIMD_SCALAR};
+                                if (autotune_store(fname, key, &config)){
+                                        _exit(1);
+                                }
+                        }
+                        _exit(0);
+                }
+        }
+        for (int p=0; p<processes; p++){
+                int status;
+                waitpid(children[p], &status, 0);
+                g_assert_true(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        }
+        for (int p=0; p<processes; p++){
+                for (int k=0; k<keys; k++){
+                        char key[32];
+                        snprintf(key, sizeof(key), "%d\t%d", p, k);
+                        autotune_config config;
+                        g_assert_cmpint(autotune_lookup(fname, key, &config), ==, 1);
+                        g_assert_cmpint(config.batch_size, ==, 1 + k);
+                        g_assert_cmpint(config.prefetch_distance, ==, 1 + p);
+                }
+        }
+        remove_profile(fname);
+}
+
+/** \brief Measure a small torus, check that the result is one of the
+ * candidates and that the second call reads it from the profile. */
+void test_autotune_measure(void){
+        char fname[64];
+        temporary(fname);
+        remove(fname);
+        graph *g = graph_construct_torus(16, 2, 1);
+        update_params params = {.alpha=1.5};
+        simd_level level = categorical_set_level(SIMD_SCALAR);
+        autotune_config measured, read;
+        g_assert_cmpint(autotune(fname, g, &polya_rule, &params, "torus", &measured), ==, 0);
+        g_assert_cmpint(measured.batch_size, >=, 256);
+        g_assert_cmpint(measured.prefetch_distance, >=, 1);
+        g_assert_cmpint(measured.simd, >=, SIMD_DEFAULT);
+        g_assert_cmpint(measured.simd, <=, simd_supported());
+        /* the graph and the level are left as they were */
+        for (graph_index i=0; i<g->m; i++){
+                g_assert_cmpfloat(g->edges[i]->weight, ==, 1);
+        }
+        g_assert_cmpint(categorical_set_level(level), ==, SIMD_SCALAR);
+
+        g_assert_cmpint(autotune(fname, g, &polya_rule, &params, "torus", &read), ==, 1);
+        g_assert_cmpint(read.batch_size, ==, measured.batch_size);
+        g_assert_cmpint(read.prefetch_distance, ==, measured.prefetch_distance);
+        g_assert_cmpint(read.simd, ==, measured.simd);
+        graph_free(g);
+        remove_profile(fname);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/autotune/key", test_autotune_key);
+        g_test_add_func("/autotune/profile", test_autotune_profile);
+        g_test_add_func("/autotune/concurrent", test_autotune_concurrent);
+        g_test_add_func("/autotune/measure", test_autotune_measure);
+        return g_test_run();
+}
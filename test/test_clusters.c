@@ -0,0 +1,191 @@
+/** \file test_clusters.c
+ * \brief Glib testing based test code for \ref clusters.h */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clusters.h"
+
+/** \brief Check the clusters of a small graph: the path 0-1-2-3 whose
+ * middle edge is light splits into two pairs, vertex 4 has no edges, and
+ * passing weights instead of the ones of the graph joins the path. */
+void test_clusters_sizes(void){
+        graph *g = graph_new();
+        graph_add_n_vertices(g, 5);
+        graph_add_edge(g, 0, 1, 3);
+        graph_add_edge(g, 1, 2, 1);
+        graph_add_edge(g, 2, 3, 3);
+        cluster_analysis *clusters = clusters_analyse(g, NULL, 0, 0);
+        g_assert_cmpint(clusters->n_clusters, ==, 3);
+        g_assert_cmpint(clusters->largest, ==, 2);
+        g_assert_cmpint(clusters->second, ==, 2);
+        g_assert_cmpfloat(clusters->mean_size, ==, 9.0/5);
+        g_assert_cmpint(clusters->labels[1], ==, 0);
+        g_assert_cmpint(clusters->labels[3], ==, 2);
+        g_assert_cmpint(clusters->labels[4], ==, 4);
+        g_assert_cmpint(clusters->n_sizes, ==, 2);
+        g_assert_cmpint(clusters->sizes[0], ==, 1);
+        g_assert_cmpint(clusters->counts[0], ==, 1);
+        g_assert_cmpint(clusters->sizes[1], ==, 2);
+        g_assert_cmpint(clusters->counts[1], ==, 2);
+        g_assert_cmpint(clusters->d, ==, 0);
+        clusters_free(clusters);
+
+        /* 2 dominates at 1 and 2, 0 and 3 only have one edge */
+        double weights[3] = {3, 5, 3};
+        clusters = clusters_analyse(g, weights, 0, 0);
+        g_assert_cmpint(clusters->n_clusters, ==, 2);
+        g_assert_cmpint(clusters->largest, ==, 4);
+        g_assert_cmpint(clusters->second, ==, 1);
+        g_assert_cmpint(clusters->labels[3], ==, 0);
+
+        FILE *out = tmpfile();
+        clusters_write(clusters, out, 2.5);
+        rewind(out);
+        char line[128];
+        g_assert_nonnull(fgets(line, sizeof(line), out));
+        g_assert_true(g_str_has_prefix(line, "# dominant edge clusters at time 2.5"));
+        int found = 0;
+        while (fgets(line, sizeof(line), out)){
+                found += !strcmp(line, "largest 4\n") || !strcmp(line, "sizes 2\n") ||
+                         !strcmp(line, "4 1\n");
+        }
+        g_assert_cmpint(found, ==, 3);
+        fclose(out);
+        clusters_free(clusters);
+        graph_free(g);
+}
+
+/** \brief The 5 x 5 torus vertices with only the edges of row 0, the edge
+ * from column c to c+1 with weight weights[c] (0 for no edge). */
+static graph *row_graph(const int *weights){
+        graph *g = graph_new();
+        graph_add_n_vertices(g, 25);
+        for (int c=0; c<5; c++){
+                if (weights[c]){
+                        graph_add_edge(g, c, (c+1)%5, weights[c]);
+                }
+        }
+        return g;
+}
+
+/** \brief Check spanning and wrapping on a 5 x 5 torus: a path along row 0
+ * spans and wraps axis 0, the same path across the periodic boundary only
+ * wraps, a shorter path does neither and a graph which is not a torus is not
+ * analysed as one. */
+void test_clusters_torus(void){
+        int inside[5] = {10, 11, 12, 13, 9};
+        int across[5] = {12, 13, 9, 10, 11};
+        int shorter[5] = {10, 11, 12, 0, 0};
+        int *rows[3] = {inside, across, shorter};
+        int spanning[3] = {1, 0, 0};
+        int wrapping[3] = {1, 1, 0};
+        for (int i=0; i<3; i++){
+                graph *g = row_graph(rows[i]);
+                cluster_analysis *clusters = clusters_analyse(g, NULL, 5, 2);
+                g_assert_cmpint(clusters->d, ==, 2);
+                g_assert_cmpint(clusters->largest, ==, i < 2 ? 5 : 4);
+                g_assert_cmpint(clusters->n_clusters, ==, i < 2 ? 21 : 22);
+                g_assert_cmpint(clusters->spanning[0], ==, spanning[i]);
+                g_assert_cmpint(clusters->wrapping[0], ==, wrapping[i]);
+                g_assert_cmpint(clusters->spanning[1], ==, 0);
+                g_assert_cmpint(clusters->wrapping[1], ==, 0);
+                clusters_free(clusters);
+                graph_free(g);
+        }
+
+        /* the vertical direction of a full torus */
+        graph *g = graph_construct_torus(6, 2, 1);
+        for (graph_index i=0; i<g->m; i++){
+                edge *e = g->edges[i];
+                if (e->v1%6 == e->v2%6){
+                        e->weight = 2;
+                }
+        }
+        cluster_analysis *clusters = clusters_analyse(g, NULL, 6, 2);
+        g_assert_cmpint(clusters->d, ==, 2);
+        g_assert_cmpint(clusters->spanning[0], ==, 0);
+        g_assert_cmpint(clusters->wrapping[0], ==, 0);
+        g_assert_cmpint(clusters->wrapping[1], <=, 6);
+        for (graph_index v=0; v<g->n; v++){
+                g_assert_cmpint(clusters->labels[v]%6, ==, v%6);
+        }
+        clusters_free(clusters);
+
+        /* with another side length the graph is not a torus */
+        clusters = clusters_analyse(g, NULL, 4, 2);
+        g_assert_cmpint(clusters->d, ==, 0);
+        clusters_free(clusters);
+        graph_free(g);
+}
+
+/** \brief Check that the concurrent union-find finds the same clusters as
+ * following the dominant edges on a large random graph. */
+void test_clusters_random(void){
+        graph *g = graph_new();
+        graph_index n = 20000;
+        graph_add_n_vertices(g, n);
+        srand(3);
+        for (graph_index i=0; i<3*n; i++){
+                graph_index v1 = rand()%n, v2 = rand()%n;
+                if (v1 != v2){
+                        graph_add_edge(g, v1, v2, 1 + rand()%50);
+                }
+        }
+        cluster_analysis *clusters = clusters_analyse(g, NULL, 0, 0);
+        graph_index total = 0;
+        for (graph_index i=0; i<clusters->n_sizes; i++){
+                total += clusters->sizes[i]*clusters->counts[i];
+        }
+        g_assert_cmpint(total, ==, n);
+        /* every vertex is in the cluster of the end of its dominant edge */
+        for (graph_index v=0; v<n; v++){
+                vertex *vert = g->vertices[v];
+                edge *best = NULL;
+                for (graph_index j=0; j<vert->dim; j++){
+                        edge *e = vert->edges[j];
+                        if (!best || e->weight > best->weight ||
+                            (e->weight == best->weight && e < best)){
+                                best = e;
+                        }
+                }
+                if (best){
+                        g_assert_cmpint(clusters->labels[best->v1], ==, clusters->labels[best->v2]);
+                }
+                g_assert_cmpint(clusters->labels[v], <=, v);
+                g_assert_cmpint(clusters->labels[clusters->labels[v]], ==, clusters->labels[v]);
+        }
+        /* a tree per cluster: the dominant edges are one less than the vertices */
+        graph_index distinct = 0;
+        for (graph_index i=0; i<g->m; i++){
+                edge *e = g->edges[i];
+                int dominant = 0;
+                for (int end=0; end<2; end++){
+                        vertex *vert = g->vertices[end ? e->v2 : e->v1];
+                        edge *best = NULL;
+                        for (graph_index j=0; j<vert->dim; j++){
+                                edge *f = vert->edges[j];
+                                if (!best || f->weight > best->weight ||
+                                    (f->weight == best->weight && f < best)){
+                                        best = f;
+                                }
+                        }
+                        dominant |= best == e;
+                }
+                distinct += dominant;
+        }
+        g_assert_cmpint(distinct, ==, n - clusters->n_clusters);
+        clusters_free(clusters);
+        graph_free(g);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/clusters/sizes", test_clusters_sizes);
+        g_test_add_func("/clusters/torus", test_clusters_torus);
+        g_test_add_func("/clusters/random", test_clusters_random);
+        return g_test_run();
+}
@@ -0,0 +1,144 @@
+/** \file test_correlation.c
+ * \brief Glib testing based test code for \ref correlation.h and \ref fft.h */
+#define _GNU_SOURCE // M_PI
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "correlation.h"
+
+/** \brief Check the transforms against the sums of their definition for
+ * powers of 2 (radix-2) and other side lengths (Bluestein), and that the
+ * backward transform inverts the forward one up to the factor n^d. */
+void test_fft_naive(void){
+        int sides[3] = {8, 6, 5};
+        srand(5);
+        for (int s=0; s<3; s++){
+                for (int d=1; d<=3; d++){
+                        int n = sides[s];
+                        graph_index size = 1;
+                        for (int j=0; j<d; j++){
+                                size *= n;
+                        }
+                        fft_plan *plan = fft_plan_new(n, d);
+                        double complex *data = fft_data(plan);
+                        double complex *input = malloc(size*sizeof(double complex));
+                        for (graph_index x=0; x<size; x++){
+                                input[x] = data[x] = rand()/(double) RAND_MAX - I*(rand() % 3);
+                        }
+                        fft_execute(plan, -1);
+                        for (graph_index q=0; q<size; q++){
+                                double complex expected = 0;
+                                for (graph_index x=0; x<size; x++){
+                                        /* q.x of the digits in base n */
+                                        long long dot = 0;
+                                        graph_index qq = q, xx = x;
+                                        for (int j=0; j<d; j++){
+                                                dot += (qq % n)*(xx % n);
+                                                qq /= n;
+                                                xx /= n;
+                                        }
+                                        expected += input[x]*cexp(-2*M_PI*I*(dot % n)/n);
+                                }
+                                g_assert_cmpfloat(cabs(data[q] - expected), <, 1e-9*size);
+                        }
+                        fft_execute(plan, 1);
+                        for (graph_index x=0; x<size; x++){
+                                g_assert_cmpfloat(cabs(data[x]/size - input[x]), <, 1e-12*size);
+                        }
+                        free(input);
+                        fft_plan_free(plan);
+                }
+        }
+}
+
+/** \brief Plant a cosine along axis 0 in the horizontal weights of a
+ * relabelled 12 x 12 torus and constant vertical weights, and check the
+ * means, variances, correlations, structure factors and lengths. */
+void test_correlation_planted(void){
+        int n = 12;
+        graph *g = graph_construct_torus(n, 2, 1);
+        graph_index order[144];
+        for (graph_index i=0; i<144; i++){
+                order[i] = (i*5) % 144;
+        }
+        graph_relabel(g, order);
+        for (graph_index i=0; i<g->m; i++){
+                edge *e = g->edges[i];
+                graph_index a = graph_original_index(g, e->v1);
+                graph_index b = graph_original_index(g, e->v2);
+                if (a/n == b/n){
+                        /* horizontal, the site is the left end */
+                        graph_index left = (b % n == (a+1) % n) ? a : b;
+                        e->weight = 10 + cos(2*M_PI*(left % n)/n);
+                }
+                else {
+                        e->weight = 5;
+                }
+        }
+        correlation_analysis *corr = correlation_new(n, 2);
+        g_assert_cmpint(correlation_analyse(corr, g, NULL), ==, 0);
+        g_assert_cmpfloat_with_epsilon(corr->mean[0], 10, 1e-12);
+        g_assert_cmpfloat_with_epsilon(corr->variance[0], 0.5, 1e-12);
+        g_assert_cmpfloat(corr->mean[1], ==, 5);
+        g_assert_cmpfloat(corr->variance[1], ==, 0);
+        g_assert_cmpint(corr->n_distances, ==, 7);
+        for (int r=0; r<7; r++){
+                /* direction 0 along axis 0 and along axis 1 */
+                g_assert_cmpfloat_with_epsilon(corr->correlation[r], cos(2*M_PI*r/n), 1e-9);
+                g_assert_cmpfloat_with_epsilon(corr->correlation[7 + r], 1, 1e-9);
+                g_assert_cmpfloat(corr->correlation[14 + r], ==, 0);
+                g_assert_cmpfloat_with_epsilon(corr->structure[r], r == 1 ? 36 : 0, 1e-9);
+                g_assert_cmpfloat_with_epsilon(corr->structure[7 + r], 0, 1e-9);
+        }
+        /* cos(2 pi r/12) drops below 1/e between r = 2 and 3 */
+        g_assert_cmpfloat(corr->length[0], >, 2);
+        g_assert_cmpfloat(corr->length[0], <, 3);
+        g_assert_cmpfloat(corr->length[1], ==, 6);
+        g_assert_cmpfloat(corr->length[2], ==, 0);
+
+        FILE *out = tmpfile();
+        correlation_write(corr, out, 4);
+        rewind(out);
+        char line[4096];
+        g_assert_nonnull(fgets(line, sizeof(line), out));
+        g_assert_true(g_str_has_prefix(line, "# weight correlations at time 4"));
+        int found = 0;
+        while (fgets(line, sizeof(line), out)){
+                found += g_str_has_prefix(line, "mean 1 5\n") ||
+                         g_str_has_prefix(line, "length 1 0 0\n") ||
+                         g_str_has_prefix(line, "structure 0 1 ");
+        }
+        g_assert_cmpint(found, ==, 3);
+        fclose(out);
+
+        /* the weights can also be passed separately */
+        double *weights = malloc(g->m*sizeof(double));
+        for (graph_index i=0; i<g->m; i++){
+                weights[i] = 3;
+        }
+        g_assert_cmpint(correlation_analyse(corr, g, weights), ==, 0);
+        g_assert_cmpfloat(corr->mean[0], ==, 3);
+        g_assert_cmpfloat(corr->variance[0], ==, 0);
+        free(weights);
+        correlation_free(corr);
+
+        /* neither another side length nor an edge across the torus */
+        corr = correlation_new(10, 2);
+        g_assert_cmpint(correlation_analyse(corr, g, NULL), ==, -1);
+        correlation_free(corr);
+        corr = correlation_new(n, 2);
+        graph_add_edge(g, graph_current_index(g, 0), graph_current_index(g, 13), 1);
+        g_assert_cmpint(correlation_analyse(corr, g, NULL), ==, -1);
+        correlation_free(corr);
+        graph_free(g);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/correlation/fft", test_fft_naive);
+        g_test_add_func("/correlation/planted cosine", test_correlation_planted);
+        return g_test_run();
+}
@@ -0,0 +1,148 @@
+/** \file test_frames.c
+ * \brief Glib testing based test code for \ref frames.h */
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "glauber.h"
+#include "frames.h"
+
+/** \brief Check the bounds after a few changes of one edge and the reset. */
+void test_frames_bounds(void){
+        graph *g = graph_construct_torus(4, 2, 1);
+        frame_tracker *frames = frames_new(g, 10, 2);
+        double mean, max;
+        frames_change(frames, 2, &mean, &max);
+        g_assert_cmpfloat(mean, ==, 0);
+        g_assert_cmpfloat(max, ==, 0);
+
+        edge *e = g->edges[5];
+        e->weight += 3;
+        frames_observe(frames, g, e, 3);
+        e->weight -= 1;
+        frames_observe(frames, g, e, -1);
+        g_assert_cmpfloat(frames->l1, ==, 2);
+        /* the largest deviation since the frame, not the current one */
+        g_assert_cmpfloat(frames->linf, ==, 3);
+        frames_change(frames, 2, &mean, &max);
+        g_assert_cmpfloat_with_epsilon(mean, 10*(2/2.)/32, 1e-12);
+        g_assert_cmpfloat_with_epsilon(max, 10*3/2., 1e-12);
+        /* the time dilutes all 32 edges of weight 1 at the frame */
+        frames_change(frames, 4, &mean, &max);
+        g_assert_cmpfloat_with_epsilon(mean, 10*(2/4. + 32*0.25)/32, 1e-12);
+        g_assert_cmpfloat_with_epsilon(max, 10*(3/4. + 0.25), 1e-12);
+        g_assert_true(frames_due(frames, 4, 2, 0));
+        g_assert_false(frames_due(frames, 4, 3, 0));
+        g_assert_true(frames_due(frames, 4, 0, 10));
+        g_assert_false(frames_due(frames, 4, 0, 11));
+        g_assert_false(frames_due(frames, 4, 0, 0));
+
+        frames_reset(frames, 4);
+        frames_change(frames, 4, &mean, &max);
+        g_assert_cmpfloat(mean, ==, 0);
+        g_assert_cmpfloat(max, ==, 0);
+        g_assert_cmpfloat(frames->frame_total, ==, 34);
+        g_assert_cmpfloat(frames->frame_max, ==, 4);
+        /* the edge takes its new snapshot on its next change */
+        e->weight += 1;
+        frames_observe(frames, g, e, 1);
+        g_assert_cmpfloat(frames->l1, ==, 1);
+
+        /* nothing bounds the change from a frame at time 0 */
+        frames_reset(frames, 0);
+        frames_change(frames, 1, &mean, &max);
+        g_assert_true(isinf(mean) && isinf(max));
+        frames_free(frames);
+        graph_free(g);
+}
+
+/** \brief Check that the bounds hold for the true change of the penwidths of
+ * a simulation with events and tau-leaps. */
+void test_frames_simulation(void){
+        graph *g = graph_construct_torus(12, 2, 1);
+        update_params params = {.alpha=0.5};
+        glauber_context *ctx = glauber_new(g, &polya_rule, &params, 3, 0);
+        glauber_run_until(ctx, 1);
+        frame_tracker *frames = frames_new(g, 10, 1);
+        glauber_add_observer(ctx, frames_observe, frames);
+        double *snapshot = malloc(g->m*sizeof(double));
+        double t0 = 1;
+        for (int k=1; k<=8; k++){
+                for (graph_index i=0; i<g->m; i++){
+                        snapshot[i] = g->edges[i]->weight;
+                }
+                double t = t0*(1 + 0.5*k);
+                if (k % 2){
+                        glauber_run_until(ctx, t);
+                }
+                else {
+                        glauber_leap_until(ctx, t, 1, 0.03);
+                }
+                double sum = 0, largest = 0;
+                for (graph_index i=0; i<g->m; i++){
+                        double change = fabs(10*g->edges[i]->weight/t - 10*snapshot[i]/t0);
+                        sum += change;
+                        largest = fmax(largest, change);
+                }
+                double mean, max;
+                frames_change(frames, t, &mean, &max);
+                g_assert_cmpfloat(sum/g->m, <=, mean + 1e-9);
+                g_assert_cmpfloat(largest, <=, max + 1e-9);
+                /* the changed weights themselves are followed exactly */
+                double l1 = 0;
+                for (graph_index i=0; i<g->m; i++){
+                        l1 += fabs(g->edges[i]->weight - snapshot[i]);
+                }
+                g_assert_cmpfloat_with_epsilon(frames->l1, l1, 1e-9);
+                frames_reset(frames, t);
+                t0 = t;
+        }
+        free(snapshot);
+        frames_free(frames);
+        glauber_free(ctx);
+}
+
+/** \brief Check that added, removed and moved edges are accounted for. */
+void test_frames_topology(void){
+        graph *g = graph_construct_torus(4, 2, 1);
+        frame_tracker *frames = frames_new(g, 10, 1);
+        graph_add_hook(g, frames_topology, frames);
+
+        /* the last edge moves into the place of the removed one */
+        graph_index last = g->m-1;
+        edge *moved = g->edges[last];
+        graph_index v1 = moved->v1, v2 = moved->v2;
+        moved->weight = 2;
+        frames_observe(frames, g, moved, 1);
+        g_assert_cmpfloat(frames->l1, ==, 1);
+        graph_rm_edge(g, g->edges[0]->v1, g->edges[0]->v2);
+        g_assert_cmpfloat(frames->l1, ==, 2);
+        edge *e = graph_find_edge(g, v1, v2);
+        g_assert_true(e == g->edges[0]);
+        e->weight = 3;
+        frames_observe(frames, g, e, 1);
+        /* the moved edge kept its snapshot of weight 1 */
+        g_assert_cmpfloat(frames->l1, ==, 3);
+
+        graph_add_edge(g, 0, 10, 4);
+        g_assert_cmpfloat(frames->l1, ==, 7);
+        g_assert_cmpfloat(frames->linf, ==, 4);
+        g_assert_cmpfloat(frames->total, ==, 32 - 1 + 2 + 4);
+        graph_rm_edge(g, 0, 10);
+        g_assert_cmpfloat(frames->l1, ==, 3);
+        g_assert_cmpfloat(frames->total, ==, 32 - 1 + 2);
+
+        graph_remove_hook(g, frames_topology, frames);
+        frames_free(frames);
+        graph_free(g);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/frames/bounds", test_frames_bounds);
+        g_test_add_func("/frames/simulation", test_frames_simulation);
+        g_test_add_func("/frames/topology", test_frames_topology);
+        return g_test_run();
+}
@@ -0,0 +1,564 @@
+/** \file test_glauber.c
+ * \brief Glib testing based test code for \ref glauber.h */
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "glauber.h"
+#include "philox.h"
+
+/** \brief The weight of edge i read through the strided view. */
+double static weight_at(const double *weights, size_t stride, graph_index i){
+        return *(const double*) ((const char*) weights + i*stride);
+}
+
+/** \brief Check that every event adds one to the total weight, that the
+ * weight view follows the graph and that a released graph can be run again. */
+void test_glauber_step(void){
+        glauber_context *ctx = glauber_new_torus(5, 2, 0.5, 7);
+        glauber_step(ctx, 3000);
+        g_assert_cmpint(glauber_event_count(ctx), ==, 3000);
+
+        size_t stride;
+        const double *weights = glauber_weights(ctx, &stride);
+        graph *g = glauber_graph(ctx);
+        double total = 0;
+        for (graph_index i=0; i<glauber_edge_count(ctx); i++){
+                g_assert_cmpfloat(weight_at(weights, stride, i), ==, g->edges[i]->weight);
+                g_assert_cmpfloat(glauber_edges(ctx)[i].weight, ==, g->edges[i]->weight);
+                total += weight_at(weights, stride, i);
+        }
+        g_assert_cmpfloat(total, ==, 50 + 3000);
+
+        /* a released graph keeps its state and can be run by another
+         * context (the freed one no longer follows it) */
+        g_assert_true(glauber_release(ctx) == g);
+        update_params params = {.alpha=0.5};
+        ctx = glauber_new(g, &polya_rule, &params, 7, 0);
+        glauber_step(ctx, 100);
+        graph_add_edge(g, 0, 12, 1);
+        g_assert_cmpuint(glauber_topology_generation(ctx), ==, 1);
+        total = 0;
+        for (graph_index i=0; i<g->m; i++){
+                total += g->edges[i]->weight;
+        }
+        g_assert_cmpfloat(total, ==, 50 + 3100 + 1);
+        glauber_free(ctx);
+}
+
+/** \brief Check that run_until stops at the time and that stepping the same
+ * number of events gives the same state. */
+void test_glauber_run_until(void){
+        glauber_context *a = glauber_new_torus(5, 2, 0.5, 11);
+        glauber_context *b = glauber_new_torus(5, 2, 0.5, 11);
+        glauber_run_until(a, 3.5);
+        g_assert_cmpfloat(glauber_time(a), ==, 3.5);
+        glauber_run_until(a, 60);
+        glauber_step(b, glauber_event_count(a));
+        g_assert_cmpfloat(glauber_time(b), <, 60);
+
+        const edge *ea = glauber_edges(a);
+        const edge *eb = glauber_edges(b);
+        for (graph_index i=0; i<glauber_edge_count(a); i++){
+                g_assert_cmpfloat(ea[i].weight, ==, eb[i].weight);
+        }
+        /* the events pending after run_until are the next ones of b */
+        glauber_step(a, 10);
+        glauber_step(b, 10);
+        g_assert_cmpfloat(glauber_time(a), ==, glauber_time(b));
+        glauber_free(a);
+        glauber_free(b);
+}
+
+/** \brief Run a context in a thread. */
+void static *run_context(void *ctx){
+        glauber_run_until(ctx, 200);
+        return NULL;
+}
+
+/** \brief Check that contexts with the same seed running concurrently in
+ * different threads give the same result. */
+void test_glauber_concurrent(void){
+        glauber_context *ctx[4];
+        pthread_t threads[4];
+        for (int i=0; i<4; i++){
+                ctx[i] = glauber_new_torus(6, 2, 1.5, 3);
+                pthread_create(&threads[i], NULL, run_context, ctx[i]);
+        }
+        for (int i=0; i<4; i++){
+                pthread_join(threads[i], NULL);
+        }
+        for (int i=1; i<4; i++){
+                g_assert_cmpint(glauber_event_count(ctx[i]), ==, glauber_event_count(ctx[0]));
+                for (graph_index j=0; j<glauber_edge_count(ctx[0]); j++){
+                        g_assert_cmpfloat(glauber_edges(ctx[i])[j].weight, ==,
+                                          glauber_edges(ctx[0])[j].weight);
+                }
+        }
+        for (int i=0; i<4; i++){
+                glauber_free(ctx[i]);
+        }
+}
+
+/** \brief Check that with state dependent rates the total weight still
+ * grows by one per event and that the rates follow the local weights: with
+ * rate exponent 2 the heavy vertices take nearly all the events. */
+void test_glauber_rates(void){
+        update_params params = {.alpha=0.5, .rate_exponent=2};
+        glauber_context *ctx = glauber_new(graph_construct_torus(6, 2, 1),
+                                           &polya_rate_rule, &params, 5, 0);
+        /* the events explode in finite time, so only run a short time */
+        glauber_run_until(ctx, 0.001);
+        g_assert_cmpfloat(glauber_time(ctx), ==, 0.001);
+        glauber_step(ctx, 4000);
+        g_assert_cmpint(glauber_event_count(ctx), >=, 4000);
+
+        graph *g = glauber_graph(ctx);
+        double total = 0;
+        for (graph_index i=0; i<glauber_edge_count(ctx); i++){
+                total += glauber_edges(ctx)[i].weight;
+        }
+        g_assert_cmpfloat(total, ==, 72 + glauber_event_count(ctx));
+
+        /* with rate exponent 2 the events concentrate, so the heaviest vertex
+         * carries far more than the average local weight 2*total/n */
+        double heaviest = 0;
+        for (graph_index i=0; i<g->n; i++){
+                heaviest = fmax(heaviest, g->vertices[i]->local_weight);
+        }
+        g_assert_cmpfloat(heaviest, >, 3*2*total/g->n);
+        glauber_free(ctx);
+}
+
+/** \brief Check that a rule whose rates are all 0 never runs an event, until
+ * an edge is added between the runs. */
+void test_glauber_zero_rates(void){
+        update_params params = {.alpha=0.5, .rate_exponent=1};
+        /* the graph without edges has local weight 0 everywhere */
+        graph *g = graph_new();
+        graph_add_n_vertices(g, 4);
+        glauber_context *ctx = glauber_new(g, &polya_rate_rule, &params, 5, 0);
+        glauber_step(ctx, 10);
+        glauber_run_until(ctx, 3);
+        g_assert_cmpint(glauber_event_count(ctx), ==, 0);
+        g_assert_cmpfloat(glauber_time(ctx), ==, 3);
+
+        /* an edge added between the runs gives its vertices rate 1, the
+         * pending event at infinity is redrawn (the rates grow with the
+         * weight, so the events grow exponentially, run only shortly) */
+        g_assert_cmpuint(glauber_topology_generation(ctx), ==, 0);
+        graph_add_edge(glauber_graph(ctx), 0, 1, 1);
+        g_assert_cmpuint(glauber_topology_generation(ctx), ==, 1);
+        glauber_run_until(ctx, 6);
+        g_assert_cmpint(glauber_event_count(ctx), >, 0);
+        g_assert_cmpfloat(glauber_time(ctx), ==, 6);
+        g_assert_cmpfloat(graph_find_edge(g, 0, 1)->weight, ==,
+                          1 + glauber_event_count(ctx));
+        glauber_free(ctx);
+}
+
+/** \brief Check that tau-leaping keeps the total weight equal to the number
+ * of events, runs about n events per time unit and that a smaller error
+ * bound gives more leaps and a smaller estimated deviation. */
+void test_glauber_leap(void){
+        double deviation[2];
+        int64_t leaps[2];
+        double epsilon[2] = {0.1, 0.01};
+        for (int i=0; i<2; i++){
+                glauber_context *ctx = glauber_new_torus(10, 2, 1.5, 9);
+                glauber_leap_until(ctx, 100, 50, epsilon[i]);
+                g_assert_cmpfloat(glauber_time(ctx), ==, 100);
+
+                int64_t events = glauber_event_count(ctx);
+                /* 10000 expected events, five standard deviations */
+                g_assert_cmpint(llabs(events - 10000), <, 500);
+                double total = 0;
+                for (graph_index j=0; j<glauber_edge_count(ctx); j++){
+                        total += glauber_edges(ctx)[j].weight;
+                }
+                g_assert_cmpfloat(total, ==, 200 + events);
+
+                deviation[i] = glauber_leap_deviation(ctx);
+                leaps[i] = glauber_leap_count(ctx);
+                g_assert_cmpfloat(deviation[i], >, 0);
+                g_assert_cmpfloat(deviation[i], <, 1);
+
+                /* the exact events continue from the leaped state */
+                glauber_step(ctx, 10);
+                g_assert_cmpint(glauber_event_count(ctx), ==, events + 10);
+                glauber_free(ctx);
+        }
+        g_assert_cmpint(leaps[1], >, leaps[0]);
+        g_assert_cmpfloat(deviation[1], <, deviation[0]);
+}
+
+/** \brief Observer adding up the changes of the weights. */
+void static sum_changes(void *data, const graph *g, const edge *e, double delta){
+        *(double*) data += delta;
+}
+
+/** \brief Check that observers see every change and do not change the
+ * simulation. */
+void test_glauber_observer(void){
+        glauber_context *plain = glauber_new_torus(8, 2, 0.5, 11);
+        glauber_context *observed = glauber_new_torus(8, 2, 0.5, 11);
+        double changes = 0;
+        glauber_add_observer(observed, sum_changes, &changes);
+        glauber_run_until(plain, 50);
+        glauber_run_until(observed, 50);
+        g_assert_cmpint(glauber_event_count(observed), ==, glauber_event_count(plain));
+        g_assert_cmpfloat(changes, ==, glauber_event_count(observed));
+        for (graph_index i=0; i<glauber_edge_count(plain); i++){
+                g_assert_cmpfloat(glauber_edges(observed)[i].weight, ==,
+                                  glauber_edges(plain)[i].weight);
+        }
+        glauber_leap_until(observed, 60, 1, 0.03);
+        g_assert_cmpfloat(changes, ==, glauber_event_count(observed));
+        glauber_free(plain);
+        glauber_free(observed);
+
+        /* without a constant increment the weights are compared */
+        rule_interface rule = polya_rule;
+        rule.increment = 0;
+        update_params params = {.alpha=0.5};
+        observed = glauber_new(graph_construct_torus(8, 2, 1), &rule, &params, 11, 0);
+        changes = 0;
+        glauber_add_observer(observed, sum_changes, &changes);
+        glauber_run_until(observed, 50);
+        g_assert_cmpfloat(changes, ==, glauber_event_count(observed));
+        glauber_free(observed);
+}
+
+/** \brief What the rewiring rule saw: the added and removed edges and the
+ * events of vertices without edges. */
+typedef struct rewire_counts {
+        int changes;
+        int isolated_events;
+} rewire_counts;
+
+static rewire_counts rewire_seen;
+
+/** \brief Topology hook of the rewiring rule counting the changes. */
+void static count_changes(void *data, graph *g, const graph_change *change){
+        if (change->kind != GRAPH_EDGE_MOVED){
+                ((rewire_counts*) data)->changes++;
+        }
+}
+
+/** \brief The state of the rewiring rule is \ref rewire_seen. */
+void static *rewire_init(graph *state, const update_params *params){
+        rewire_seen = (rewire_counts){0};
+        return &rewire_seen;
+}
+
+/** \brief Event of the rewiring rule: the edge in slot unif*dim of the
+ * vertex gains one, unless it has weight 1 and can be moved from its other
+ * end to a random vertex not adjacent yet. */
+graph_index static rewire_update(graph *state, graph_index vertex_index,
+                                 double unif, const update_params *params,
+                                 void *rule_state, pcg32_random_t *rng){
+        vertex *v = state->vertices[vertex_index];
+        if (!v->dim){
+                ((rewire_counts*) rule_state)->isolated_events++;
+                return -1;
+        }
+        graph_index slot = (graph_index) (unif*v->dim);
+        edge *e = v->edges[slot];
+        graph_index target = pcg32_boundedrand_r(rng, state->n);
+        if (e->weight == 1 && target != vertex_index &&
+            !graph_find_edge(state, vertex_index, target)){
+                graph_index other = e->v1 == vertex_index ? e->v2 : e->v1;
+                graph_rm_edge(state, vertex_index, other);
+                graph_add_edge(state, vertex_index, target, 1);
+                return -1;
+        }
+        e->weight++;
+        state->vertices[e->v1]->local_weight++;
+        state->vertices[e->v2]->local_weight++;
+        return slot;
+}
+
+/** \brief The clocks of the rewiring rule ring at the local weight. */
+double static rewire_rate(const graph *state, graph_index vertex_index,
+                          const update_params *params){
+        return state->vertices[vertex_index]->local_weight;
+}
+
+/** \brief Check that a rule adding and removing edges during its events
+ * keeps the graph consistent, that its topology hook sees the changes, that
+ * observers see exactly the weight changes and that the rates follow the
+ * rewired vertices (isolated vertices never get an event). */
+void test_glauber_rewire(void){
+        rule_interface rule = {.name="rewire", .init=rewire_init,
+                               .update=rewire_update, .rate=rewire_rate,
+                               .topology=count_changes, .changes_topology=1};
+        update_params params = {.alpha=1};
+        graph *g = graph_construct_torus(6, 2, 1);
+        glauber_context *ctx = glauber_new(g, &rule, &params, 17, 0);
+        g_assert_true(glauber_changes_topology(ctx));
+        double changes = 0;
+        glauber_add_observer(ctx, sum_changes, &changes);
+        glauber_step(ctx, 3000);
+        glauber_leap_until(ctx, glauber_time(ctx) + 0.5, 1, 0.03);
+        g_assert_cmpint(glauber_leap_count(ctx), ==, 0);
+        g_assert_cmpint(glauber_event_count(ctx), >, 3000);
+
+        g_assert_cmpint(g->m, ==, 72);
+        double total = 0;
+        for (graph_index i=0; i<g->m; i++){
+                g_assert_true(g->edges[i] == &g->edge_pool[i]);
+                g_assert_true(graph_find_edge(g, g->edges[i]->v1, g->edges[i]->v2) == g->edges[i]);
+                total += g->edges[i]->weight;
+        }
+        g_assert_cmpfloat(total, ==, 72 + changes);
+        for (graph_index i=0; i<g->n; i++){
+                double local_weight = 0;
+                for (graph_index j=0; j<g->vertices[i]->dim; j++){
+                        local_weight += g->vertices[i]->edges[j]->weight;
+                }
+                g_assert_cmpfloat(local_weight, ==, g->vertices[i]->local_weight);
+        }
+        /* every rewiring removes one edge and adds one */
+        g_assert_cmpint(rewire_seen.changes, >, 0);
+        g_assert_cmpint(rewire_seen.changes % 2, ==, 0);
+        g_assert_cmpuint(glauber_topology_generation(ctx), >=, rewire_seen.changes);
+        g_assert_cmpint(rewire_seen.isolated_events, ==, 0);
+        glauber_free(ctx);
+}
+
+/** \brief Check that a follower with the same parameters repeats its leader
+ * exactly (also with an observer), that another alpha gives another state at
+ * the same time and event count, and which contexts cannot be coupled. */
+void test_glauber_couple(void){
+        glauber_context *leader = glauber_new_torus(8, 2, 0.5, 13);
+        glauber_context *same = glauber_new_torus(8, 2, 0.5, 99);
+        glauber_context *other = glauber_new_torus(8, 2, 1.5, 99);
+        double changes = 0;
+        glauber_add_observer(same, sum_changes, &changes);
+        g_assert_cmpint(glauber_couple(leader, same), ==, 0);
+        g_assert_cmpint(glauber_couple(leader, other), ==, 0);
+        g_assert_cmpint(glauber_couple(leader, same), ==, -1);
+        g_assert_cmpint(glauber_couple(same, other), ==, -1);
+
+        glauber_step(leader, 500);
+        glauber_run_until(leader, 40);
+        glauber_leap_until(leader, 50, 1, 0.03);
+        /* followers only move with their leader */
+        glauber_run_until(same, 60);
+        g_assert_cmpfloat(glauber_time(same), ==, 50);
+        g_assert_cmpfloat(glauber_time(other), ==, 50);
+        g_assert_cmpint(glauber_event_count(same), ==, glauber_event_count(leader));
+        g_assert_cmpint(glauber_event_count(other), ==, glauber_event_count(leader));
+        g_assert_cmpfloat(changes, ==, glauber_event_count(same));
+        int differ = 0;
+        for (graph_index i=0; i<glauber_edge_count(leader); i++){
+                g_assert_cmpfloat(glauber_edges(same)[i].weight, ==,
+                                  glauber_edges(leader)[i].weight);
+                differ |= glauber_edges(other)[i].weight != glauber_edges(leader)[i].weight;
+        }
+        g_assert_true(differ);
+        glauber_free(leader);
+        glauber_free(same);
+        glauber_free(other);
+
+        update_params params = {.alpha=0.5, .rate_exponent=1};
+        glauber_context *rated = glauber_new(graph_construct_torus(8, 2, 1),
+                                             &polya_rate_rule, &params, 5, 0);
+        glauber_context *small = glauber_new_torus(4, 2, 0.5, 5);
+        leader = glauber_new_torus(8, 2, 0.5, 5);
+        g_assert_cmpint(glauber_couple(leader, rated), ==, -1);
+        g_assert_cmpint(glauber_couple(leader, small), ==, -1);
+        glauber_free(leader);
+        glauber_free(rated);
+        glauber_free(small);
+}
+
+/** \brief A Philox simulation of the polya rule on the 6 x 6 torus with the
+ * given batch size, relabelled in reverse order if reverse. */
+static glauber_context *philox_torus(int batch_size, int reverse){
+        graph *g = graph_construct_torus(6, 2, 1);
+        if (reverse){
+                graph_index order[36];
+                for (graph_index i=0; i<36; i++){
+                        order[i] = 35-i;
+                }
+                graph_relabel(g, order);
+        }
+        update_params params = {.alpha=1.5};
+        glauber_context *ctx = glauber_new(g, &polya_rule, &params, 21, batch_size);
+        g_assert_cmpint(glauber_set_rng(ctx, GLAUBER_RNG_PHILOX), ==, 0);
+        return ctx;
+}
+
+/** \brief Check that the Philox clocks give the same trajectory for any
+ * batch size, vertex order and split of the run, and that the first event is
+ * the earliest first event of the vertex streams. */
+void test_glauber_philox(void){
+        glauber_context *a = philox_torus(1024, 0);
+        glauber_context *b = philox_torus(7, 1);
+        glauber_step(a, 1);
+        double first = INFINITY;
+        for (graph_index v=0; v<36; v++){
+                double uniform;
+                first = fmin(first, philox_clock(21, v, 0, &uniform));
+        }
+        g_assert_cmpfloat(glauber_time(a), ==, first);
+
+        glauber_run_until(a, 150);
+        glauber_run_until(b, 40);
+        glauber_run_until(b, 150);
+        g_assert_cmpint(glauber_event_count(a), ==, glauber_event_count(b));
+        graph *ga = glauber_graph(a);
+        graph *gb = glauber_graph(b);
+        for (graph_index i=0; i<ga->m; i++){
+                edge *e = ga->edges[i];
+                edge *f = graph_find_edge(gb, graph_current_index(gb, e->v1),
+                                          graph_current_index(gb, e->v2));
+                g_assert_nonnull(f);
+                g_assert_cmpfloat(e->weight, ==, f->weight);
+        }
+        glauber_free(a);
+        glauber_free(b);
+
+        update_params params = {.alpha=0.5, .rate_exponent=1};
+        glauber_context *rated = glauber_new(graph_construct_torus(4, 2, 1),
+                                             &polya_rate_rule, &params, 5, 0);
+        g_assert_cmpint(glauber_set_rng(rated, GLAUBER_RNG_PHILOX), ==, -1);
+        glauber_free(rated);
+}
+
+/** \brief The sum of the squared weights and the largest weight of ctx. */
+void static concentration(glauber_context *ctx, double *squares, double *max){
+        *squares = *max = 0;
+        for (graph_index i=0; i<glauber_edge_count(ctx); i++){
+                double w = glauber_edges(ctx)[i].weight;
+                *squares += w*w;
+                *max = fmax(*max, w);
+        }
+}
+
+/** \brief Check that skipping ahead keeps the weights, the local weights and
+ * the observers consistent, gives Poisson increments on edges whose vertices
+ * have no other edge and the distribution of the exact events. */
+void test_glauber_skip_ahead(void){
+        update_params params = {.alpha=2};
+        glauber_context *ctx = glauber_new(graph_construct_torus(8, 2, 1), &polya_rule,
+                                           &params, 13, 0);
+        double changes = 0;
+        glauber_add_observer(ctx, sum_changes, &changes);
+        g_assert_cmpint(glauber_set_skip_ahead(ctx, 0.6), ==, 0);
+        glauber_run_until(ctx, 100);
+        /* 6400 expected events, five standard deviations */
+        g_assert_cmpint(llabs(glauber_event_count(ctx) - 6400), <, 400);
+        /* the drawn events are the uncertain ones, the others come on top */
+        glauber_step(ctx, 1000);
+        g_assert_cmpint(glauber_event_count(ctx), >, 7400);
+        graph *g = glauber_graph(ctx);
+        double total = 0;
+        for (graph_index i=0; i<g->m; i++){
+                total += g->edges[i]->weight;
+        }
+        g_assert_cmpfloat(total, ==, 128 + glauber_event_count(ctx));
+        g_assert_cmpfloat(changes, ==, glauber_event_count(ctx));
+        /* removed edges are followed between the runs */
+        graph_rm_edge(g, 0, 1);
+        graph_rm_edge(g, 9, 10);
+        glauber_run_until(ctx, 150);
+        for (graph_index v=0; v<g->n; v++){
+                double local = 0;
+                for (graph_index j=0; j<g->vertices[v]->dim; j++){
+                        local += g->vertices[v]->edges[j]->weight;
+                }
+                g_assert_cmpfloat(g->vertices[v]->local_weight, ==, local);
+        }
+        g_assert_cmpint(glauber_set_skip_ahead(ctx, 0), ==, 0);
+        glauber_run_until(ctx, 110);
+        glauber_free(ctx);
+
+        /* two separate edges whose events are all sure, every weight is 1
+         * plus a Poisson variable with mean 2t */
+        double sum = 0, sum_squares = 0;
+        for (int k=0; k<1000; k++){
+                graph *pairs = graph_construct_torus(4, 1, 1);
+                graph_rm_edge(pairs, 1, 2);
+                graph_rm_edge(pairs, 3, 0);
+                ctx = glauber_new(pairs, &polya_rule, &params, k, 0);
+                glauber_set_skip_ahead(ctx, 0.9);
+                glauber_run_until(ctx, 5);
+                for (graph_index i=0; i<2; i++){
+                        double w = glauber_edges(ctx)[i].weight - 1;
+                        sum += w;
+                        sum_squares += w*w;
+                }
+                glauber_free(ctx);
+        }
+        double mean = sum/2000;
+        g_assert_cmpfloat(fabs(mean - 10), <, 5*sqrt(10/2000.));
+        g_assert_cmpfloat(fabs(sum_squares/2000 - mean*mean - 10), <, 1.5);
+
+        /* the concentration of the weights on small tori with and without
+         * skipping, within five standard errors of the difference */
+        int runs = 3000;
+        double moments[2][4] = {{0}};
+        for (int skip=0; skip<2; skip++){
+                for (int k=0; k<runs; k++){
+                        ctx = glauber_new(graph_construct_torus(3, 2, 1), &polya_rule,
+                                          &params, 1000*skip + k, 0);
+                        if (skip){
+                                glauber_set_skip_ahead(ctx, 0.6);
+                        }
+                        glauber_run_until(ctx, 10);
+                        double squares, max;
+                        concentration(ctx, &squares, &max);
+                        moments[skip][0] += squares;
+                        moments[skip][1] += squares*squares;
+                        moments[skip][2] += max;
+                        moments[skip][3] += max*max;
+                        glauber_free(ctx);
+                }
+        }
+        for (int j=0; j<4; j+=2){
+                double m[2], variance = 0;
+                for (int skip=0; skip<2; skip++){
+                        m[skip] = moments[skip][j]/runs;
+                        variance += (moments[skip][j+1]/runs - m[skip]*m[skip])/runs;
+                }
+                g_assert_cmpfloat(fabs(m[1] - m[0]), <, 5*sqrt(variance));
+        }
+
+        /* refused for rates, philox clocks and coupled runs */
+        ctx = glauber_new_torus(4, 2, 2, 1);
+        g_assert_cmpint(glauber_set_skip_ahead(ctx, 0.5), ==, -1);
+        glauber_set_rng(ctx, GLAUBER_RNG_PHILOX);
+        g_assert_cmpint(glauber_set_skip_ahead(ctx, 0.9), ==, -1);
+        glauber_set_rng(ctx, GLAUBER_RNG_PCG);
+        g_assert_cmpint(glauber_set_skip_ahead(ctx, 0.9), ==, 0);
+        g_assert_cmpint(glauber_set_rng(ctx, GLAUBER_RNG_PHILOX), ==, -1);
+        glauber_context *other = glauber_new_torus(4, 2, 2, 1);
+        g_assert_cmpint(glauber_couple(ctx, other), ==, -1);
+        glauber_free(other);
+        glauber_free(ctx);
+        params.rate_exponent = 1;
+        ctx = glauber_new(graph_construct_torus(4, 2, 1), &polya_rate_rule, &params, 1, 0);
+        g_assert_cmpint(glauber_set_skip_ahead(ctx, 0.9), ==, -1);
+        glauber_free(ctx);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/glauber/step", test_glauber_step);
+        g_test_add_func("/glauber/run until", test_glauber_run_until);
+        g_test_add_func("/glauber/concurrent contexts", test_glauber_concurrent);
+        g_test_add_func("/glauber/rates", test_glauber_rates);
+        g_test_add_func("/glauber/zero rates", test_glauber_zero_rates);
+        g_test_add_func("/glauber/tau leap", test_glauber_leap);
+        g_test_add_func("/glauber/observer", test_glauber_observer);
+        g_test_add_func("/glauber/couple", test_glauber_couple);
+        g_test_add_func("/glauber/rewiring rule", test_glauber_rewire);
+        g_test_add_func("/glauber/philox", test_glauber_philox);
+        g_test_add_func("/glauber/skip ahead", test_glauber_skip_ahead);
+        return g_test_run();
+}
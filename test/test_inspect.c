@@ -0,0 +1,170 @@
+/** \file test_inspect.c
+ * \brief Glib testing based test code for \ref inspect.h */
+#define _GNU_SOURCE // getline
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "inspect.h"
+
+/** \brief A simulation running in its own thread, polling the server. */
+typedef struct running {
+        glauber_context *ctx;
+        inspect_server *server;
+        _Atomic int stop;
+} running;
+
+/** \brief Run the simulation in small steps until stopped. */
+void static *simulate(void *arg){
+        running *r = arg;
+        while (!atomic_load(&r->stop)){
+                glauber_run_until(r->ctx, glauber_time(r->ctx) + 0.5);
+                inspect_poll(r->server);
+        }
+        return NULL;
+}
+
+/** \brief Send the query and return the lines of the answer (without the
+ * final ok or error line, whose first word is stored in status). */
+static GPtrArray *query(FILE *in, FILE *out, const char *line, char *status){
+        fprintf(out, "%s\n", line);
+        fflush(out);
+        GPtrArray *lines = g_ptr_array_new_with_free_func(free);
+        char *answer = NULL;
+        size_t size = 0;
+        while (getline(&answer, &size, in) != -1){
+                if (!strcmp(answer, "ok\n") || !strncmp(answer, "error", 5)){
+                        strncpy(status, answer, 5);
+                        status[answer[0] == 'o' ? 2 : 5] = '\0';
+                        break;
+                }
+                g_ptr_array_add(lines, strdup(answer));
+        }
+        free(answer);
+        return lines;
+}
+
+/** \brief Check the answers of all queries while the simulation runs. */
+void test_inspect_queries(void){
+        char dir[] = "/tmp/test_inspect_XXXXXX";
+        g_assert_nonnull(mkdtemp(dir));
+        char *socket_path = g_strdup_printf("%s/sock", dir);
+        char *dump_path = g_strdup_printf("%s/dump.txt", dir);
+        char *frame_path = g_strdup_printf("%s/frame.png", dir);
+
+        running r = {.ctx=glauber_new_torus(20, 2, 0.5, 3)};
+        atomic_init(&r.stop, 0);
+        r.server = inspect_start(socket_path, r.ctx, 20, 40, 0.9);
+        g_assert_nonnull(r.server);
+        pthread_t thread;
+        pthread_create(&thread, NULL, simulate, &r);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un address = {.sun_family=AF_UNIX};
+        strcpy(address.sun_path, socket_path);
+        g_assert_cmpint(connect(fd, (struct sockaddr*) &address, sizeof(address)), ==, 0);
+        FILE *in = fdopen(fd, "r");
+        FILE *out = fdopen(dup(fd), "w");
+        char status[6];
+
+        GPtrArray *lines = query(in, out, "time", status);
+        g_assert_cmpstr(status, ==, "ok");
+        g_assert_cmpint(lines->len, ==, 1);
+        g_assert_true(g_str_has_prefix(g_ptr_array_index(lines, 0), "time "));
+        g_ptr_array_free(lines, TRUE);
+
+        lines = query(in, out, "rate", status);
+        g_assert_cmpstr(status, ==, "ok");
+        g_ptr_array_free(lines, TRUE);
+
+        lines = query(in, out, "observables", status);
+        g_assert_cmpstr(status, ==, "ok");
+        g_assert_nonnull(strstr(g_ptr_array_index(lines, 0), "fixated"));
+        g_ptr_array_free(lines, TRUE);
+
+        /* the 4 edges of vertex 0, and 4 + 4*3 edges within distance 1 */
+        lines = query(in, out, "vertex 0", status);
+        g_assert_cmpstr(status, ==, "ok");
+        g_assert_cmpint(lines->len, ==, 4);
+        double total = 0;
+        for (guint i=0; i<lines->len; i++){
+                long v1, v2;
+                double w;
+                g_assert_cmpint(sscanf(g_ptr_array_index(lines, i), "%ld %ld %lf",
+                                       &v1, &v2, &w), ==, 3);
+                g_assert_true(v1 == 0 || v2 == 0);
+                g_assert_cmpfloat(w, >=, 1);
+                total += w;
+        }
+        g_assert_cmpfloat(total, >=, 4);
+        g_ptr_array_free(lines, TRUE);
+        lines = query(in, out, "vertex 0 2", status);
+        g_assert_cmpint(lines->len, ==, 16);
+        g_ptr_array_free(lines, TRUE);
+
+        lines = query(in, out, "region 18 18 2 2", status);
+        g_assert_cmpstr(status, ==, "ok");
+        g_assert_cmpint(lines->len, ==, 8);
+        g_ptr_array_free(lines, TRUE);
+
+        char *line = g_strdup_printf("dump %s", dump_path);
+        lines = query(in, out, line, status);
+        g_assert_cmpstr(status, ==, "ok");
+        g_ptr_array_free(lines, TRUE);
+        g_free(line);
+        FILE *dump = fopen(dump_path, "r");
+        int n_lines = 0;
+        for (int c; (c = fgetc(dump)) != EOF;){
+                n_lines += c == '\n';
+        }
+        fclose(dump);
+        g_assert_cmpint(n_lines, ==, 800 + 1);
+
+        line = g_strdup_printf("frame %s direction", frame_path);
+        lines = query(in, out, line, status);
+        g_assert_cmpstr(status, ==, "ok");
+        g_ptr_array_free(lines, TRUE);
+        g_free(line);
+        FILE *frame = fopen(frame_path, "r");
+        char signature[4];
+        g_assert_cmpint(fread(signature, 1, 4, frame), ==, 4);
+        g_assert_cmpint(memcmp(signature, "\x89PNG", 4), ==, 0);
+        fclose(frame);
+
+        lines = query(in, out, "region 19 0 2 1", status);
+        g_assert_cmpstr(status, ==, "error");
+        g_ptr_array_free(lines, TRUE);
+        lines = query(in, out, "unknown", status);
+        g_assert_cmpstr(status, ==, "error");
+        g_ptr_array_free(lines, TRUE);
+
+        /* stopping with a connected client must not block */
+        atomic_store(&r.stop, 1);
+        pthread_join(thread, NULL);
+        inspect_stop(r.server);
+        g_assert_false(g_file_test(socket_path, G_FILE_TEST_EXISTS));
+        fclose(in);
+        fclose(out);
+        glauber_free(r.ctx);
+
+        unlink(dump_path);
+        unlink(frame_path);
+        rmdir(dir);
+        g_free(socket_path);
+        g_free(dump_path);
+        g_free(frame_path);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/inspect/queries", test_inspect_queries);
+        return g_test_run();
+}
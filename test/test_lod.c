@@ -0,0 +1,126 @@
+/** \file test_lod.c
+ * \brief Glib testing based test code for \ref lod.h */
+
+#include <glib.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glauber.h"
+#include "lod.h"
+#include "ordering.h"
+
+/** \brief Check that every block of every level of lod equals the one of a
+ * pyramid built from scratch. */
+void static assert_pyramid_fresh(lod_renderer *lod){
+        lod_renderer *fresh = lod_new(lod->g, lod->n,
+                                      lod->sides[0]*lod->scale, lod->mode, NULL);
+        g_assert_cmpint(fresh->levels, ==, lod->levels);
+        for (int k=0; k<lod->levels; k++){
+                for (int row=0; row<lod->sides[k]; row++){
+                        for (int col=0; col<lod->sides[k]; col++){
+                                const lod_block *a = lod_block_at(lod, k, row, col);
+                                const lod_block *b = lod_block_at(fresh, k, row, col);
+                                for (int i=0; i<2; i++){
+                                        g_assert_cmpfloat(fabs(a->sum[i] - b->sum[i]), <, 1e-6);
+                                        g_assert_cmpfloat(a->max[i], ==, b->max[i]);
+                                        g_assert_cmpint(a->count[i], ==, b->count[i]);
+                                }
+                        }
+                }
+        }
+        lod_free(fresh);
+}
+
+/** \brief Check the blocks of a torus whose side is not a multiple of the
+ * block size. */
+void test_lod_blocks(void){
+        graph *g = graph_construct_torus(37, 2, 1);
+        g->edges[0]->weight = 5;
+        lod_renderer *lod = lod_new(g, 37, 8, LOD_MEAN, NULL);
+        g_assert_cmpint(lod->block_size, ==, 5);
+        g_assert_cmpint(lod->sides[0], ==, 8);
+        g_assert_cmpint(lod->levels, ==, 4);
+        g_assert_cmpint(lod->scale, ==, 1);
+        /* the last blocks only hold 2 columns (or rows) of vertices */
+        const lod_block *corner = lod_block_at(lod, 0, 7, 7);
+        g_assert_cmpint(corner->count[0], ==, 4);
+        g_assert_cmpint(corner->count[1], ==, 4);
+        const lod_block *top = lod_block_at(lod, 3, 0, 0);
+        g_assert_cmpint(top->count[0] + top->count[1], ==, g->m);
+        g_assert_cmpfloat(top->sum[0] + top->sum[1], ==, g->m + 4);
+        g_assert_cmpfloat(fmax(top->max[0], top->max[1]), ==, 5);
+        lod_free(lod);
+        graph_free(g);
+}
+
+/** \brief Check that the pyramid follows the events, tau-leaps and
+ * decreasing weights of a relabelled torus. */
+void test_lod_observe(void){
+        graph *g = graph_construct_torus(21, 2, 1);
+        graph_index *order = graph_rcm_order(g);
+        graph_relabel(g, order);
+        free(order);
+        update_params params = {.alpha=0.5};
+        glauber_context *ctx = glauber_new(g, &polya_rule, &params, 7, 0);
+        lod_renderer *lod = lod_new(g, 21, 10, LOD_MAX, NULL);
+        glauber_add_observer(ctx, lod_observe, lod);
+
+        glauber_run_until(ctx, 20);
+        assert_pyramid_fresh(lod);
+        glauber_leap_until(ctx, 30, 1, 0.03);
+        assert_pyramid_fresh(lod);
+
+        /* lower the heaviest edge, the maximum has to be found again */
+        edge *heaviest = g->edges[0];
+        for (graph_index i=0; i<g->m; i++){
+                if (g->edges[i]->weight > heaviest->weight){
+                        heaviest = g->edges[i];
+                }
+        }
+        heaviest->weight -= 10;
+        lod_observe(lod, g, heaviest, -10);
+        assert_pyramid_fresh(lod);
+
+        lod_free(lod);
+        glauber_free(ctx);
+}
+
+/** \brief Check the size and the chunks of a frame. */
+void test_lod_png(void){
+        graph *g = graph_construct_torus(10, 2, 1);
+        g->edges[3]->weight = 4;
+        lod_renderer *lod = lod_new(g, 10, 35, LOD_DIRECTION, NULL);
+        g_assert_cmpint(lod->scale, ==, 3);
+        FILE *out = tmpfile();
+        lod_draw_png(lod, out, 2);
+        g_assert_cmpint(ftell(out), ==, 2*lod->png_size);
+
+        const unsigned char *png = lod->png;
+        g_assert_cmpint(memcmp(png, "\x89PNG\r\n\x1a\n", 8), ==, 0);
+        g_assert_cmpint(memcmp(png+12, "IHDR", 4), ==, 0);
+        /* 30 x 30 pixels */
+        g_assert_cmpint(png[16+3], ==, 30);
+        g_assert_cmpint(png[20+3], ==, 30);
+        g_assert_cmpint(memcmp(png+lod->png_size-8, "IEND", 4), ==, 0);
+        /* the block of the heavy vertical edge 3 (from vertex 1 down) is
+         * darker than the others and blue */
+        const unsigned char *heavy = lod->raw + 1 + 3*3*1;
+        const unsigned char *light = lod->raw + 1 + 3*3*5;
+        g_assert_cmpint(heavy[0] + heavy[1] + heavy[2], <, light[0] + light[1] + light[2]);
+        g_assert_cmpint(heavy[2], >, heavy[0]);
+        g_assert_cmpint(light[2], ==, light[0]);
+        fclose(out);
+        lod_free(lod);
+        graph_free(g);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/lod/blocks", test_lod_blocks);
+        g_test_add_func("/lod/observe", test_lod_observe);
+        g_test_add_func("/lod/png", test_lod_png);
+        return g_test_run();
+}
@@ -0,0 +1,51 @@
+/** \file test_partition.c
+ * \brief Glib testing based test code for \ref partition.h */
+
+#include <glib.h>
+
+#include "partition.h"
+
+/** \brief Check that the slabs of a 10x10 torus cover whole layers. */
+void test_partition_torus(void){
+        partition *p = partition_torus(10, 2, 3);
+        g_assert_nonnull(p);
+        int expected[4] = {0, 40, 70, 100};
+        for (int i=0; i<4; i++){
+                g_assert_cmpint(p->offsets[i], ==, expected[i]);
+        }
+        g_assert_cmpint(partition_owner(p, 0), ==, 0);
+        g_assert_cmpint(partition_owner(p, 39), ==, 0);
+        g_assert_cmpint(partition_owner(p, 40), ==, 1);
+        g_assert_cmpint(partition_owner(p, 99), ==, 2);
+        partition_free(p);
+
+        g_assert_null(partition_torus(10, 2, 11));
+}
+
+/** \brief Check that the degree balanced partition splits the cost evenly
+ * and never leaves a part empty. */
+void test_partition_balanced(void){
+        /* costs 1 1 1 1 4 4 1 1 1 1, total 16 */
+        graph_index degrees[10] = {0, 0, 0, 0, 3, 3, 0, 0, 0, 0};
+        partition *p = partition_balanced(degrees, 10, 2);
+        g_assert_cmpint(p->offsets[1], ==, 5);
+        g_assert_cmpint(partition_owner(p, 4), ==, 0);
+        g_assert_cmpint(partition_owner(p, 5), ==, 1);
+        partition_free(p);
+
+        /* one very heavy vertex in front */
+        graph_index heavy[4] = {100, 0, 0, 0};
+        p = partition_balanced(heavy, 4, 4);
+        for (int i=0; i<=4; i++){
+                g_assert_cmpint(p->offsets[i], ==, i);
+        }
+        partition_free(p);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/partition/torus slabs", test_partition_torus);
+        g_test_add_func("/partition/degree balanced", test_partition_balanced);
+        return g_test_run();
+}
@@ -0,0 +1,55 @@
+/** \file test_placement.c
+ * \brief Glib testing based test code for \ref placement.h */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "placement.h"
+
+/** \brief Check that the node of the current thread is one of the nodes. */
+void test_nodes(void){
+        int nodes = placement_nodes();
+        g_assert_cmpint(nodes, >=, 1);
+        g_assert_cmpint(placement_current_node(), >=, 0);
+        g_assert_cmpint(placement_current_node(), <, nodes);
+}
+
+/** \brief Check that binding memory to the current node keeps its content
+ * and that invalid nodes are rejected. */
+void test_bind(void){
+        size_t size = 1 << 20;
+        char *buffer = malloc(size);
+        memset(buffer, 7, size);
+        /* binding may not be permitted (e.g. in containers), which is fine as
+         * long as nothing breaks */
+        placement_bind(buffer+3, size-3, placement_current_node());
+        for (size_t i=0; i<size; i++){
+                g_assert_cmpint(buffer[i], ==, 7);
+        }
+        g_assert_cmpint(placement_bind(buffer, size, -1), ==, -1);
+        free(buffer);
+}
+
+/** \brief Check that pinning to the first CPU keeps running on a node and
+ * that spreading a graph keeps it intact. */
+void test_pin(void){
+        if (placement_pin(0) == 0){
+                g_assert_cmpint(placement_current_node(), <, placement_nodes());
+        }
+        graph *g = graph_new();
+        graph_add_n_vertices(g, 3);
+        graph_add_edge(g, 0, 1, 2);
+        placement_spread_graph(g);
+        g_assert_cmpint(g->edges[0]->weight, ==, 2);
+        graph_free(g);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/placement/nodes", test_nodes);
+        g_test_add_func("/placement/bind", test_bind);
+        g_test_add_func("/placement/pin", test_pin);
+        return g_test_run();
+}
@@ -0,0 +1,141 @@
+/** \file test_replicas.c
+ * \brief Glib testing based test code for \ref replicas.h */
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "replicas.h"
+#include "update_rules.h"
+
+/** \brief A torus with an isolated vertex, a vertex of degree 8 and a few
+ * other degrees, the same on every call. */
+graph static *irregular_graph(void){
+        graph *g = graph_construct_torus(6, 2, 1);
+        graph_rm_edge(g, 0, 1);
+        graph_rm_edge(g, 0, 5);
+        graph_rm_edge(g, 0, 6);
+        graph_rm_edge(g, 0, 30);
+        for (graph_index v=20; v<25; v++){
+                graph_add_edge(g, 14, v, 1 + v % 3);
+        }
+        graph_add_edge(g, 3, 33, 4);
+        return g;
+}
+
+/** \brief Run the events of lane of a set with seed on h with the update of
+ * the \ref polya_rule, drawing them from the streams of the lane up to each
+ * of the count times.
+ *
+ * \returns The number of events. */
+int64_t static reference_lane(graph *h, double alpha, uint64_t seed, int lane,
+                              const double *times, int count){
+        update_params params = {.alpha=alpha};
+        pcg32_random_t count_rng, uniform_rng, update_rng;
+        pcg32_srandom_r(&count_rng, seed + lane, 0);
+        pcg32_srandom_r(&uniform_rng, seed + lane, 1);
+        pcg32_srandom_r(&update_rng, seed + lane, 2);
+        int64_t events = 0;
+        double t = 0;
+        for (int k=0; k<count; k++){
+                int64_t due = poisson_rand_r(&count_rng, h->n*(times[k] - t));
+                for (int64_t i=0; i<due; i++){
+                        graph_index v = index_boundedrand_r(&uniform_rng, h->n);
+                        double unif = ldexp(pcg32_random_r(&update_rng), -32);
+                        polya_rule.update(h, v, unif, &params, NULL, NULL);
+                }
+                events += due;
+                t = times[k];
+        }
+        return events;
+}
+
+/** \brief Check that every lane of every instruction set (11 lanes, so the
+ * groups of 4 and 8 have tails) applies exactly the events of its streams
+ * with the \ref polya_rule. */
+void test_replicas_reference(void){
+        double alpha = 1.5;
+        double times[2] = {10, 30};
+        graph *g = irregular_graph();
+        int lanes = 11;
+        graph *h[11];
+        int64_t events[11];
+        for (int l=0; l<lanes; l++){
+                h[l] = irregular_graph();
+                events[l] = reference_lane(h[l], alpha, 7, l, times, 2);
+        }
+        for (simd_level level=SIMD_SCALAR; level<=simd_supported(); level++){
+                replica_set *set = replicas_new(g, lanes, alpha, 7);
+                g_assert_cmpint(replicas_set_simd(set, level), ==, level);
+                g_assert_cmpint(replicas_lanes(set), ==, lanes);
+                replicas_run_until(set, 10);
+                replicas_run_until(set, 30);
+                /* going back in time does nothing */
+                replicas_run_until(set, 20);
+                g_assert_cmpfloat(replicas_time(set), ==, 30);
+                const double *weights = replicas_weights(set);
+                for (int l=0; l<lanes; l++){
+                        g_assert_cmpint(replicas_event_count(set, l), ==, events[l]);
+                        for (graph_index i=0; i<g->m; i++){
+                                g_assert_cmpfloat(weights[i*lanes + l], ==, h[l]->edges[i]->weight);
+                        }
+                }
+                replicas_free(set);
+        }
+
+        /* the copy of a lane has its weights and the sums of them as local
+         * weights */
+        replica_set *set = replicas_new(g, lanes, alpha, 7);
+        replicas_run_until(set, 10);
+        replicas_run_until(set, 30);
+        replicas_copy_lane(set, 4, g);
+        for (graph_index i=0; i<g->m; i++){
+                g_assert_cmpfloat(g->edges[i]->weight, ==, h[4]->edges[i]->weight);
+        }
+        vertex *hub = g->vertices[14];
+        double local = 0;
+        for (graph_index j=0; j<hub->dim; j++){
+                local += hub->edges[j]->weight;
+        }
+        g_assert_cmpint(hub->dim, ==, 8);
+        g_assert_cmpfloat(hub->local_weight, ==, local);
+        g_assert_cmpfloat(g->vertices[0]->local_weight, ==, 0);
+        replicas_free(set);
+        for (int l=0; l<lanes; l++){
+                graph_free(h[l]);
+        }
+        graph_free(g);
+}
+
+/** \brief Check the lanes with weights outside of the table of powers, which
+ * evaluate pow, against the reference. */
+void test_replicas_fractional(void){
+        double alpha = 0.7;
+        double t = 15;
+        graph *g = graph_construct_torus(5, 2, 1);
+        g->edges[3]->weight = 0.25;
+        int lanes = 5;
+        replica_set *set = replicas_new(g, lanes, alpha, 2);
+        replicas_run_until(set, t);
+        for (int l=0; l<lanes; l++){
+                graph *h = graph_construct_torus(5, 2, 1);
+                h->edges[3]->weight = 0.25;
+                g_assert_cmpint(replicas_event_count(set, l), ==,
+                                reference_lane(h, alpha, 2, l, &t, 1));
+                for (graph_index i=0; i<g->m; i++){
+                        g_assert_cmpfloat(replicas_weights(set)[i*lanes + l], ==,
+                                          h->edges[i]->weight);
+                }
+                graph_free(h);
+        }
+        replicas_free(set);
+        graph_free(g);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/replicas/reference", test_replicas_reference);
+        g_test_add_func("/replicas/fractional", test_replicas_fractional);
+        return g_test_run();
+}
@@ -0,0 +1,230 @@
+/** \file test_sampling.c
+ * \brief Glib testing based test code for \ref sampling.h */
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "philox.h"
+#include "sampling.h"
+
+/** \brief Check that small bounds give the stream of pcg32_boundedrand_r. */
+void test_bounded_small(void){
+        pcg32_random_t rng1, rng2;
+        pcg32_srandom_r(&rng1, 1, 1);
+        pcg32_srandom_r(&rng2, 1, 1);
+        for (int i=0; i<1000; i++){
+                graph_index bound = 1 + i*7919;
+                g_assert_cmpint(index_boundedrand_r(&rng1, bound), ==,
+                                pcg32_boundedrand_r(&rng2, bound));
+        }
+}
+
+/** \brief Check the range of indices above 2^32 and that the high and low
+ * halves of the range are both hit. */
+void test_bounded_large(void){
+#ifdef GRAPH_INDEX_64
+        pcg32_random_t rng;
+        pcg32_srandom_r(&rng, 1, 1);
+        graph_index bound = ((graph_index) 3 << 32) + 17;
+        int upper = 0;
+        for (int i=0; i<1000; i++){
+                graph_index x = index_boundedrand_r(&rng, bound);
+                g_assert_cmpint(x, >=, 0);
+                g_assert_cmpint(x, <, bound);
+                upper += x >= bound/2;
+        }
+        g_assert_cmpint(upper, >, 400);
+        g_assert_cmpint(upper, <, 600);
+#endif
+}
+
+/** \brief Check the total and the cumulative search of the rate tree
+ * against sums over the rates, including updates and indices of rate 0. */
+void test_rate_tree_find(void){
+        graph_index n = 37;
+        double rates[37];
+        rate_tree *t = rate_tree_new(n);
+        for (graph_index i=0; i<n; i++){
+                rates[i] = i % 5 == 0 ? 0 : 1 + i % 3;
+                rate_tree_set(t, i, rates[i]);
+        }
+        /* change some rates, enough to trigger a rebuild */
+        for (graph_index i=0; i<2*n; i+=3){
+                rates[i % n] = (i % 4) * 0.5;
+                rate_tree_set(t, i % n, rates[i % n]);
+        }
+        double total = 0;
+        for (graph_index i=0; i<n; i++){
+                total += rates[i];
+        }
+        g_assert_cmpfloat(fabs(rate_tree_total(t) - total), <, 1e-12);
+
+        double cumulative = 0;
+        for (graph_index i=0; i<n; i++){
+                if (rates[i] > 0){
+                        g_assert_cmpint(rate_tree_find(t, cumulative), ==, i);
+                        g_assert_cmpint(rate_tree_find(t, cumulative + rates[i]/2), ==, i);
+                }
+                cumulative += rates[i];
+        }
+        /* x at the end of the range lands on the last positive rate */
+        graph_index last = n-1;
+        while (rates[last] == 0){
+                last--;
+        }
+        g_assert_cmpint(rate_tree_find(t, total), ==, last);
+        rate_tree_free(t);
+}
+
+/** \brief Check that the indices are chosen proportional to their rates. */
+void test_rate_tree_distribution(void){
+        pcg32_random_t rng;
+        pcg32_srandom_r(&rng, 3, 3);
+        rate_tree *t = rate_tree_new(4);
+        rate_tree_set(t, 0, 1);
+        rate_tree_set(t, 1, 0);
+        rate_tree_set(t, 2, 3);
+        rate_tree_set(t, 3, 4);
+        int counts[4] = {0};
+        for (int i=0; i<80000; i++){
+                double x = ldexp(pcg32_random_r(&rng), -32)*rate_tree_total(t);
+                counts[rate_tree_find(t, x)]++;
+        }
+        g_assert_cmpint(counts[1], ==, 0);
+        g_assert_cmpint(abs(counts[0] - 10000), <, 500);
+        g_assert_cmpint(abs(counts[2] - 30000), <, 800);
+        g_assert_cmpint(abs(counts[3] - 40000), <, 800);
+        rate_tree_free(t);
+}
+
+/** \brief Check mean and variance of the Poisson numbers for a mean of the
+ * inversion and one of the rejection method. */
+void test_poisson(void){
+        pcg32_random_t rng;
+        pcg32_srandom_r(&rng, 4, 4);
+        double means[] = {0, 2.5, 40};
+        for (int m=0; m<3; m++){
+                int samples = 40000;
+                double sum = 0, sum_sq = 0;
+                for (int i=0; i<samples; i++){
+                        int64_t k = poisson_rand_r(&rng, means[m]);
+                        g_assert_cmpint(k, >=, 0);
+                        sum += k;
+                        sum_sq += (double) k*k;
+                }
+                double mean = sum/samples;
+                double variance = sum_sq/samples - mean*mean;
+                /* five standard errors of the mean */
+                g_assert_cmpfloat(fabs(mean - means[m]), <=, 5*sqrt(means[m]/samples));
+                g_assert_cmpfloat(fabs(variance - means[m]), <=, 0.05*means[m]);
+        }
+}
+
+/** \brief Check that all supported levels of the categorical kernel choose
+ * the same index, also for uniforms right at the cumulative sums and for all
+ * tail lengths. */
+void test_categorical_levels(void){
+        pcg32_random_t rng;
+        pcg32_srandom_r(&rng, 5, 5);
+        simd_level supported = simd_supported();
+        double weights[70];
+        for (graph_index count=1; count<=70; count++){
+                for (graph_index i=0; i<count; i++){
+                        /* integer weights to a power like the polya rule */
+                        weights[i] = pow(1 + pcg32_boundedrand_r(&rng, 50), 0.7);
+                }
+                double total = 0;
+                for (graph_index i=0; i<count; i++){
+                        total += weights[i];
+                }
+                for (int j=0; j<200+count; j++){
+                        double unif = ldexp(pcg32_random_r(&rng), -32);
+                        if (j < count){
+                                /* right at a boundary of the sequential sums */
+                                double partial = 0;
+                                for (graph_index i=0; i<j; i++){
+                                        partial += weights[i];
+                                }
+                                unif = partial/total;
+                        }
+                        graph_index expected = categorical_choose_level(SIMD_SCALAR, weights,
+                                                                        count, unif);
+                        g_assert_cmpint(expected, >=, 0);
+                        g_assert_cmpint(expected, <, count);
+                        for (simd_level level=SIMD_AVX2; level<=supported; level++){
+                                g_assert_cmpint(categorical_choose_level(level, weights, count, unif),
+                                                ==, expected);
+                        }
+                        /* every level set for the process, including
+                         * AVX-512 for large counts */
+                        for (simd_level level=SIMD_DEFAULT; level<=supported; level++){
+                                g_assert_cmpint(categorical_set_level(level), ==, SIMD_DEFAULT);
+                                g_assert_cmpint(categorical_choose(weights, count, unif), ==, expected);
+                                g_assert_cmpint(categorical_set_level(SIMD_DEFAULT), ==, level);
+                        }
+                }
+        }
+        g_assert_cmpint(categorical_choose(weights, 0, 0.5), ==, -1);
+}
+
+/** \brief Check that the categorical kernel chooses proportional to the
+ * weights and never an index of weight 0. */
+void test_categorical_distribution(void){
+        double weights[12] = {1, 0, 2, 0, 0, 3, 1, 1, 0, 0, 2, 0};
+        int counts[12] = {0};
+        for (int i=0; i<10000; i++){
+                counts[categorical_choose(weights, 12, (i + 0.5)/10000)]++;
+        }
+        for (int i=0; i<12; i++){
+                g_assert_cmpint(abs(counts[i] - (int) (10000*weights[i]/10)), <=, 1);
+        }
+        g_assert_cmpint(categorical_choose(weights, 12, 0), ==, 0);
+}
+
+/** \brief Check Philox4x32-10 against the known answers of its reference
+ * implementation and that the clock values are in range. */
+void test_philox(void){
+        uint32_t ctrs[3][4] = {{0, 0, 0, 0},
+                               {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                               {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+        uint32_t keys[3][2] = {{0, 0}, {0xffffffff, 0xffffffff},
+                               {0xa4093822, 0x299f31d0}};
+        uint32_t answers[3][4] = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+                                  {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+                                  {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+        for (int i=0; i<3; i++){
+                uint32_t out[4];
+                philox4x32_10(ctrs[i], keys[i], out);
+                for (int j=0; j<4; j++){
+                        g_assert_cmpuint(out[j], ==, answers[i][j]);
+                }
+        }
+
+        /* the mean of the exponential times is 1 */
+        double sum = 0;
+        for (uint64_t k=0; k<100000; k++){
+                double uniform;
+                double time = philox_clock(42, k % 7, k, &uniform);
+                g_assert_cmpfloat(time, >, 0);
+                g_assert_true(isfinite(time));
+                g_assert_cmpfloat(uniform, >=, 0);
+                g_assert_cmpfloat(uniform, <, 1);
+                sum += time;
+        }
+        g_assert_cmpfloat(fabs(sum/100000 - 1), <, 0.02);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/sampling/bounded small", test_bounded_small);
+        g_test_add_func("/sampling/bounded large", test_bounded_large);
+        g_test_add_func("/sampling/rate tree find", test_rate_tree_find);
+        g_test_add_func("/sampling/rate tree distribution", test_rate_tree_distribution);
+        g_test_add_func("/sampling/poisson", test_poisson);
+        g_test_add_func("/sampling/categorical levels", test_categorical_levels);
+        g_test_add_func("/sampling/categorical distribution", test_categorical_distribution);
+        g_test_add_func("/sampling/philox", test_philox);
+        return g_test_run();
+}
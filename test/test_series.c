@@ -0,0 +1,168 @@
+/** \file test_series.c
+ * \brief Glib testing based test code for \ref series.h */
+#define _GNU_SOURCE // mkstemp
+
+#include <glib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "series.h"
+
+/** \brief Test fixture used for testing the \ref series_writer. */
+struct sfixture{
+        graph *g; /**< \brief The graph whose observables are recorded. */
+        char fname[64]; /**< \brief The temporary file the series is written to. */
+};
+
+/** \brief Increase the weight of e by amount keeping the local weights of
+ * its vertices consistent. */
+void static add_weight(graph *g, edge *e, double amount){
+        e->weight += amount;
+        g->vertices[e->v1]->local_weight += amount;
+        g->vertices[e->v2]->local_weight += amount;
+}
+
+/** \brief Setup for the sfixture.
+ *
+ * Sets up the 3x3 torus (cf. \ref test_update_rules.c) where the first nine
+ * edges have weight 3 and edge 0 has weight 83, such that the weight histogram
+ * has nine entries 1, eight entries 3 and one entry 83 and both vertices of
+ * edge 0 carry 83/90 > 0.9 of their local weight on it. */
+void series_setup(struct sfixture *sf, gconstpointer test_data){
+        sf->g = graph_construct_torus(3, 2, 1);
+        for (int i=0; i<9; i++){
+                add_weight(sf->g, sf->g->edges[i], 2);
+        }
+        add_weight(sf->g, sf->g->edges[0], 80);
+        strcpy(sf->fname, "test_series_XXXXXX");
+        close(mkstemp(sf->fname));
+}
+
+/** \brief Teardown function for the sfixture. */
+void series_teardown(struct sfixture *sf, gconstpointer test_data){
+        remove(sf->fname);
+        graph_free(sf->g);
+}
+
+/** \brief Check the header and the records of a csv series. */
+void test_series_csv(struct sfixture *sf, gconstpointer ignored){
+        series_writer *s = series_open(sf->fname, SERIES_CSV, 0.5, 2, 0.9, sf->g);
+        g_assert_nonnull(s);
+        /* records at 0, 0.5 and 1 are due */
+        series_record_until(s, sf->g, 1.2);
+        g_assert_cmpfloat(series_next_time(s), ==, 1.5);
+        series_close(s);
+
+        FILE *in = fopen(sf->fname, "r");
+        char line[256];
+        g_assert_nonnull(fgets(line, sizeof(line), in));
+        g_assert_cmpstr(line, ==, "time,max_weight,q10,q25,q50,q75,q90,fixated,w0_1,w4_7\n");
+
+        double expected_time[3] = {0, 0.5, 1};
+        for (int i=0; i<3; i++){
+                double record[SERIES_N_OBSERVABLES+2];
+                g_assert_nonnull(fgets(line, sizeof(line), in));
+                char *cur = line;
+                for (int j=0; j<SERIES_N_OBSERVABLES+2; j++){
+                        record[j] = strtod(cur, &cur);
+                        cur++; /* skip the separator */
+                }
+                g_assert_cmpfloat(record[0], ==, expected_time[i]);
+                g_assert_cmpfloat(record[1], ==, 83);
+                g_assert_cmpfloat(record[2], ==, 1);
+                g_assert_cmpfloat(record[3], ==, 1);
+                g_assert_cmpfloat(record[4], ==, 1);
+                g_assert_cmpfloat(record[5], ==, 3);
+                g_assert_cmpfloat(record[6], ==, 3);
+                g_assert_cmpfloat(record[7], ==, 2);
+                g_assert_cmpfloat(record[8], ==, 83);
+                g_assert_cmpfloat(record[9], ==, 1);
+        }
+        g_assert_null(fgets(line, sizeof(line), in));
+        fclose(in);
+}
+
+/** \brief Check the layout of a binary series. */
+void test_series_binary(struct sfixture *sf, gconstpointer ignored){
+        series_writer *s = series_open(sf->fname, SERIES_BINARY, 1, 0, 0.9, sf->g);
+        g_assert_nonnull(s);
+        series_record_until(s, sf->g, 0);
+        series_record_until(s, sf->g, 0.5); /* nothing due */
+        series_record_until(s, sf->g, 1);
+        series_close(s);
+
+        FILE *in = fopen(sf->fname, "rb");
+        char magic[8];
+        uint32_t n_fields;
+        double records[2*SERIES_N_OBSERVABLES+1];
+        g_assert_cmpint(fread(magic, 1, 8, in), ==, 8);
+        g_assert_true(!memcmp(magic, "GDSERIES", 8));
+        g_assert_cmpint(fread(&n_fields, sizeof(n_fields), 1, in), ==, 1);
+        g_assert_cmpint(n_fields, ==, SERIES_N_OBSERVABLES);
+        g_assert_cmpint(fread(records, sizeof(double), 2*SERIES_N_OBSERVABLES+1, in),
+                        ==, 2*SERIES_N_OBSERVABLES);
+        fclose(in);
+
+        g_assert_cmpfloat(records[0], ==, 0);
+        g_assert_cmpfloat(records[SERIES_N_OBSERVABLES], ==, 1);
+        g_assert_cmpfloat(records[SERIES_N_OBSERVABLES+1], ==, 83);
+        g_assert_cmpfloat(records[SERIES_N_OBSERVABLES+7], ==, 2);
+}
+
+/** \brief Check the paired difference columns of a coupled csv series, an
+ * unchanged replica gives zeros and the replica with all weights 1 the
+ * differences of its observables. */
+void test_series_coupled(struct sfixture *sf, gconstpointer ignored){
+        graph *coupled[2] = {graph_construct_torus(3, 2, 1), graph_construct_torus(3, 2, 1)};
+        for (int i=0; i<9; i++){
+                add_weight(coupled[0], coupled[0]->edges[i], 2);
+        }
+        add_weight(coupled[0], coupled[0]->edges[0], 80);
+        series_writer *s = series_open_coupled(sf->fname, SERIES_CSV, 1, 0, 0.9,
+                                               sf->g, coupled, 2);
+        g_assert_nonnull(s);
+        series_record_until(s, sf->g, 0);
+        series_close(s);
+
+        FILE *in = fopen(sf->fname, "r");
+        char line[512];
+        g_assert_nonnull(fgets(line, sizeof(line), in));
+        g_assert_cmpstr(line, ==, "time,max_weight,q10,q25,q50,q75,q90,fixated,"
+                                  "d1_max_weight,d1_q10,d1_q25,d1_q50,d1_q75,d1_q90,d1_fixated,"
+                                  "d2_max_weight,d2_q10,d2_q25,d2_q50,d2_q75,d2_q90,d2_fixated\n");
+        int n_fields = SERIES_N_OBSERVABLES + 2*(SERIES_N_OBSERVABLES-1);
+        double record[SERIES_N_OBSERVABLES + 2*(SERIES_N_OBSERVABLES-1)];
+        g_assert_nonnull(fgets(line, sizeof(line), in));
+        char *cur = line;
+        for (int j=0; j<n_fields; j++){
+                record[j] = strtod(cur, &cur);
+                cur++; /* skip the separator */
+        }
+        g_assert_null(fgets(line, sizeof(line), in));
+        fclose(in);
+
+        for (int j=0; j<SERIES_N_OBSERVABLES-1; j++){
+                g_assert_cmpfloat(record[SERIES_N_OBSERVABLES+j], ==, 0);
+        }
+        double *paired = record + 2*SERIES_N_OBSERVABLES-1;
+        g_assert_cmpfloat(paired[0], ==, 1-83);
+        g_assert_cmpfloat(paired[3], ==, 0);
+        g_assert_cmpfloat(paired[5], ==, 1-3);
+        g_assert_cmpfloat(paired[6], ==, -2);
+        graph_free(coupled[0]);
+        graph_free(coupled[1]);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add("/series/csv records", struct sfixture, NULL,
+                   series_setup, test_series_csv, series_teardown);
+        g_test_add("/series/binary records", struct sfixture, NULL,
+                   series_setup, test_series_binary, series_teardown);
+        g_test_add("/series/coupled differences", struct sfixture, NULL,
+                   series_setup, test_series_coupled, series_teardown);
+        return g_test_run();
+}
@@ -0,0 +1,175 @@
+/** \file test_trace.c
+ * \brief Glib testing based test code for \ref trace.h and the recording and
+ * replaying of \ref glauber.h */
+#define _GNU_SOURCE // mkstemp
+
+#include <glib.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "glauber.h"
+#include "ordering.h"
+
+/** \brief A temporary file name, removed by the caller. */
+void static temporary(char *fname){
+        strcpy(fname, "test_trace_XXXXXX");
+        close(mkstemp(fname));
+}
+
+/** \brief Write more than a chunk of random events, including repeated
+ * times, large time steps and events without change, and read them back in
+ * batches of another size. */
+void test_trace_round_trip(void){
+        char fname[64];
+        temporary(fname);
+        graph *g = graph_construct_torus(7, 3, 1);
+        int count = TRACE_CHUNK_EVENTS + 1000;
+        double *times = malloc(count*sizeof(double));
+        graph_index *vertices = malloc(count*sizeof(graph_index));
+        graph_index *slots = malloc(count*sizeof(graph_index));
+        srand(3);
+        double t = 0;
+        for (int i=0; i<count; i++){
+                t += i % 97 ? rand()/(double) RAND_MAX/g->n : (i % 5)*1e3;
+                times[i] = t;
+                vertices[i] = rand() % g->n;
+                slots[i] = rand() % (g->vertices[vertices[i]]->dim + 1) - 1;
+        }
+        trace_writer *out = trace_writer_open(fname, g, 2, TRACE_SORTED_EDGES);
+        g_assert_nonnull(out);
+        trace_write(out, g, times, vertices, slots, 10);
+        trace_write(out, g, times+10, vertices+10, slots+10, count-10);
+        g_assert_cmpint(trace_writer_close(out), ==, 0);
+
+        trace_reader *in = trace_reader_open(fname, g);
+        g_assert_nonnull(in);
+        g_assert_cmpuint(trace_flags(in), ==, TRACE_SORTED_EDGES);
+        g_assert_cmpfloat(trace_increment(in), ==, 2);
+        double read_times[1000];
+        graph_index read_vertices[1000], read_slots[1000];
+        int read = 0, got;
+        while ((got = trace_read(in, g, read_times, read_vertices, read_slots, 1000))){
+                for (int i=0; i<got; i++){
+                        g_assert_cmpfloat(read_times[i], ==, times[read+i]);
+                        g_assert_cmpint(read_vertices[i], ==, vertices[read+i]);
+                        g_assert_cmpint(read_slots[i], ==, slots[read+i]);
+                }
+                read += got;
+        }
+        g_assert_cmpint(read, ==, count);
+        trace_reader_close(in);
+
+        /* the events use less than 8 bytes, 2 of the 3 doubles of raw events */
+        FILE *file = fopen(fname, "rb");
+        fseek(file, 0, SEEK_END);
+        g_assert_cmpint(ftell(file), <, 8*count);
+        fclose(file);
+
+        /* a trace only fits graphs with its numbers of vertices and edges */
+        graph *other = graph_construct_torus(7, 2, 1);
+        g_assert_null(trace_reader_open(fname, other));
+        graph_free(other);
+        free(times);
+        free(vertices);
+        free(slots);
+        graph_free(g);
+        remove(fname);
+}
+
+/** \brief Add up the changes reported to an observer. */
+void static count_changes(void *data, const graph *g, const edge *e, double delta){
+        (void) g;
+        (void) e;
+        *(double*) data += fabs(delta);
+}
+
+/** \brief Record runs of both generators on a relabelled torus and check
+ * that their replays reach the same states at the same times, with the
+ * changes reported to the observers. */
+void test_trace_replay(void){
+        glauber_rng rngs[2] = {GLAUBER_RNG_PCG, GLAUBER_RNG_PHILOX};
+        for (int r=0; r<2; r++){
+                char fname[64];
+                temporary(fname);
+                update_params params = {.alpha=1.5};
+                graph *g = graph_construct_torus(12, 2, 1);
+                graph_index *order = torus_hilbert_order(12, 2);
+                graph_relabel(g, order);
+                glauber_context *ctx = glauber_new(g, &polya_rule, &params, 5, 100);
+                glauber_set_rng(ctx, rngs[r]);
+                trace_writer *out = trace_writer_open(fname, g, polya_rule.increment,
+                                                      r ? TRACE_SORTED_EDGES : 0);
+                g_assert_cmpint(glauber_record_trace(ctx, out), ==, 0);
+                glauber_run_until(ctx, 20);
+                /* leaps run exact events while recording */
+                glauber_leap_until(ctx, 40, 5, 0.1);
+                g_assert_cmpint(glauber_leap_count(ctx), ==, 0);
+                g_assert_cmpint(trace_writer_close(out), ==, 0);
+
+                graph *h = graph_construct_torus(12, 2, 1);
+                graph_relabel(h, order);
+                free(order);
+                glauber_context *replay = glauber_new(h, &polya_rule, &params, 0, 64);
+                double changes = 0;
+                glauber_add_observer(replay, count_changes, &changes);
+                trace_reader *in = trace_reader_open(fname, h);
+                g_assert_nonnull(in);
+                g_assert_cmpint(glauber_replay_trace(replay, in), ==, 0);
+                glauber_run_until(replay, 20);
+                glauber_leap_until(replay, 40, 5, 0.1);
+                g_assert_cmpint(glauber_event_count(replay), ==, glauber_event_count(ctx));
+                g_assert_cmpfloat(changes, ==, glauber_event_count(ctx));
+                for (graph_index v=0; v<g->n; v++){
+                        g_assert_cmpint(g->vertices[v]->dim, ==, h->vertices[v]->dim);
+                        for (graph_index j=0; j<g->vertices[v]->dim; j++){
+                                edge *a = g->vertices[v]->edges[j];
+                                edge *b = h->vertices[v]->edges[j];
+                                g_assert_cmpint(a->v1 + a->v2, ==, b->v1 + b->v2);
+                                g_assert_cmpfloat(a->weight, ==, b->weight);
+                        }
+                }
+                /* after the end of the trace nothing happens */
+                glauber_step(replay, 10);
+                glauber_run_until(replay, 50);
+                g_assert_cmpint(glauber_event_count(replay), ==, glauber_event_count(ctx));
+                g_assert_cmpfloat(glauber_time(replay), ==, 50);
+
+                trace_reader_close(in);
+                glauber_free(replay);
+                glauber_free(ctx);
+                remove(fname);
+        }
+}
+
+/** \brief Check the contexts that can neither record nor replay. */
+void test_trace_refused(void){
+        char fname[64];
+        temporary(fname);
+        glauber_context *a = glauber_new_torus(4, 2, 0.5, 1);
+        glauber_context *b = glauber_new_torus(4, 2, 0.5, 1);
+        trace_writer *out = trace_writer_open(fname, glauber_graph(a), 1, 0);
+        g_assert_cmpint(glauber_record_trace(a, out), ==, 0);
+        glauber_step(a, 100);
+        g_assert_cmpint(trace_writer_close(out), ==, 0);
+        glauber_record_trace(a, NULL);
+        g_assert_cmpint(glauber_couple(a, b), ==, 0);
+        trace_reader *in = trace_reader_open(fname, glauber_graph(b));
+        g_assert_cmpint(glauber_replay_trace(a, in), ==, -1);
+        g_assert_cmpint(glauber_replay_trace(b, in), ==, -1);
+        trace_reader_close(in);
+        glauber_free(a);
+        glauber_free(b);
+        remove(fname);
+}
+
+/** \brief Add all the tests to the test runner. */
+int main(int argc, char **argv){
+        g_test_init(&argc, &argv, NULL);
+        g_test_add_func("/trace/round trip", test_trace_round_trip);
+        g_test_add_func("/trace/replay", test_trace_replay);
+        g_test_add_func("/trace/refused", test_trace_refused);
+        return g_test_run();
+}
@@ -104,6 +104,65 @@ void test_polya_invalid_vertex(struct ufixture *uf, gconstpointer ignored){
          g_test_trap_assert_failed();
 }
 
+/** \brief Check that a batch of \ref polya_rule with the uniforms of the
+ * preseeded RNG gives the same updates as \ref test_polya_update and that the
+ * slots of the incremented edges are returned. */
+void test_polya_rule_batch(struct ufixture *uf, gconstpointer ignored){
+        update_params params = {.alpha=ALPHA};
+        rule_instance *polya = rule_instance_new(&polya_rule, uf->g, &params);
+        graph_index vertex_indices[3] = {4, 4, 4};
+        graph_index slots[3];
+        rule_apply_batch(polya, uf->g, vertex_indices, uf->first_elements, 3,
+                         &uf->rng, slots);
+        rule_instance_free(polya);
+
+        g_assert_cmpint(slots[0], ==, 3);
+        g_assert_cmpint(slots[1], ==, 0);
+        g_assert_cmpint(slots[2], ==, 3);
+
+        vertex *v = uf->g->vertices[4];
+        g_assert_cmpint(v->edges[0]->weight, ==, 2);
+        g_assert_cmpint(v->edges[1]->weight, ==, 1);
+        g_assert_cmpint(v->edges[2]->weight, ==, 1);
+        g_assert_cmpint(v->edges[3]->weight, ==, 3);
+        g_assert_cmpint(v->local_weight, ==, 7);
+
+        /* the local weights of the other vertices of the incremented edges
+         * have to follow */
+        edge *e0 = v->edges[0];
+        edge *e3 = v->edges[3];
+        g_assert_cmpint(uf->g->vertices[e0->v1 == 4 ? e0->v2 : e0->v1]->local_weight, ==, 5);
+        g_assert_cmpint(uf->g->vertices[e3->v1 == 4 ? e3->v2 : e3->v1]->local_weight, ==, 6);
+}
+
+/** \brief Check the leading edge of \ref polya_rule and that the events
+ * excluding it never change it. */
+void test_polya_rule_leading(struct ufixture *uf, gconstpointer ignored){
+        update_params params = {.alpha=2};
+        rule_instance *polya = rule_instance_new(&polya_rule, uf->g, &params);
+        vertex *v = uf->g->vertices[4];
+        v->edges[2]->weight = 3;
+        graph_index slot;
+        double miss = polya_rule.leading(uf->g, 4, &params, polya->state, &slot);
+        g_assert_cmpint(slot, ==, 2);
+        g_assert_cmpfloat_with_epsilon(miss, 3/12., 1e-15);
+
+        for (int i=0; i<10; i++){
+                slot = polya_rule.update_other(uf->g, 4, 2, uf->first_elements[i],
+                                               &params, polya->state, &uf->rng);
+                g_assert_cmpint(slot, !=, 2);
+        }
+        g_assert_cmpfloat(v->edges[2]->weight, ==, 3);
+        g_assert_cmpfloat(v->edges[0]->weight + v->edges[1]->weight +
+                          v->edges[3]->weight, ==, 13);
+
+        /* growing the leading edge with negative alpha lowers its probability */
+        params.alpha = -1;
+        miss = polya_rule.leading(uf->g, 4, &params, NULL, &slot);
+        g_assert_cmpfloat(miss, ==, 1);
+        rule_instance_free(polya);
+}
+
 /** \brief Add all the tests to the test runner. */
 int main(int argc, char **argv){
         g_test_init(&argc, &argv, NULL);
@@ -113,5 +172,9 @@ int main(int argc, char **argv){
 
         g_test_add("/polya/test polya invalid vertex", struct ufixture, NULL,
                    update_rule_setup, test_polya_invalid_vertex, update_rule_teardown);
+        g_test_add("/polya/test polya rule batch", struct ufixture, NULL,
+                   update_rule_setup, test_polya_rule_batch, update_rule_teardown);
+        g_test_add("/polya/test polya rule leading", struct ufixture, NULL,
+                   update_rule_setup, test_polya_rule_leading, update_rule_teardown);
         return g_test_run();
 }